@@ -0,0 +1,32 @@
+#pragma once
+
+/* Timing of the bring-up phases, from process start until all timeslots
+ * are on air
+ *
+ * Each phase is recorded with its start and end time relative to
+ * bringup_init(), together with the TRX and timeslot it belongs to (-1
+ * if none).  Phases of different objects may overlap, and 'show
+ * bring-up' lists them in the order they started, so serialized round
+ * trips are easy to spot.  Recording stops once all timeslots are
+ * enabled, or when BRINGUP_MAX_PHASES have been started. */
+
+struct gsm_bts;
+struct gsm_abis_mo;
+struct vty;
+
+#define BRINGUP_MAX_PHASES	256
+
+void bringup_init(void);
+
+/* 'phase' must be a string constant, begin and end are matched by it */
+void bringup_begin(const char *phase, int trx, int tn);
+void bringup_end(const char *phase, int trx, int tn);
+
+/* the same for the phase of an OML managed object */
+void bringup_mo_begin(const char *phase, const struct gsm_abis_mo *mo);
+void bringup_mo_end(const char *phase, const struct gsm_abis_mo *mo);
+
+/* finish recording if all timeslots of 'bts' are enabled */
+void bringup_check_on_air(struct gsm_bts *bts);
+
+void bringup_vty_dump(struct vty *vty);
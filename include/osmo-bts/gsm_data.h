@@ -7,6 +7,8 @@
 
 #include <osmo-bts/paging.h>
 #include <osmo-bts/tx_power.h>
+#include <osmo-bts/jitbuf.h>
+#include <osmo-bts/rtp_batch.h>
 
 #define GSM_FR_BITS	260
 #define GSM_EFR_BITS	244
@@ -25,16 +27,30 @@
 
 struct pcu_sock_state;
 struct smscb_msg;
+struct gsm_bts_trx_role_bts;
 
 struct gsm_network {
 	struct llist_head bts_list;
 	unsigned int num_bts;
 	uint16_t mcc, mnc;
-	struct pcu_sock_state *pcu_state;
+};
+
+/* RR access bursts aggregated per TDMA frame */
+#define RACH_BATCH_MAX	8
+
+/* parameters of the MS power control loop */
+struct bts_power_ctrl_params {
+	int target;		/* target RxLev in dBm */
+	uint8_t hyst;		/* no change within target +/- hyst dB */
+	uint8_t raise_max;	/* largest step up in dB, 0 = no limit */
+	uint8_t lower_max;	/* largest step down in dB, 0 = no limit */
+	uint8_t ewma;		/* weight of a new sample in %, 100 = none */
+	uint8_t rxqual_max;	/* worse RxQual raises power, never lowers */
 };
 
 /* data structure for BTS related data specific to the BTS role */
 struct gsm_bts_role_bts {
+	struct gsm_bts *bts;	/* back pointer */
 	struct {
 		/* Interference Boundaries for OML */
 		int16_t boundary[6];
@@ -87,6 +103,8 @@ struct gsm_bts_role_bts {
 	struct llist_head oml_queue;
 	unsigned int rtp_jitter_buf_ms;
 	bool rtp_jitter_adaptive;
+	/* batched uplink RTP transmission, NULL if disabled */
+	struct rtp_batch *rtp_batch;
 	struct {
 		uint8_t ciphers;	/* flags A5/1==0x1, A5/2==0x2, A5/3==0x4 */
 	} support;
@@ -96,7 +114,8 @@ struct gsm_bts_role_bts {
 	struct gsm_time gsm_time;
 	uint8_t radio_link_timeout;
 
-	int ul_power_target;		/* Uplink Rx power target */
+	/* MS power control loop, see power_control.c */
+	struct bts_power_ctrl_params ul_power_ctrl;
 
 	/* used by the sysmoBTS to adjust band */
 	uint8_t auto_band;
@@ -107,11 +126,43 @@ struct gsm_bts_role_bts {
 	} smscb_state;
 
 	float min_qual_rach;	/* minimum quality for RACH bursts */
+	/* RACH aggregation, the RR access bursts of one TDMA frame are
+	 * collected and turned into CHAN RQDs together */
+	struct {
+		/* configurable via VTY, 0 disables the respective check */
+		unsigned int max_per_mf;	/* CHAN RQD per 51-multiframe */
+		unsigned int agch_reject;	/* AGCH queue fill in percent */
+
+		uint32_t fn;			/* of the pending bursts */
+		unsigned int num;
+		struct {
+			struct gsm_bts_trx *trx;
+			uint8_t chan_nr;
+			uint8_t ra;
+			uint8_t acc_delay;
+		} req[RACH_BATCH_MAX];
+
+		uint32_t mf;			/* current 51-multiframe */
+		unsigned int mf_admitted;	/* CHAN RQDs sent in it */
+
+		struct {
+			uint32_t received;
+			uint32_t duplicate;
+			uint32_t rejected_limit;
+			uint32_t rejected_load;
+			uint32_t sent;
+			uint32_t batches;
+		} stats;
+	} rach_batch;
 	float min_qual_norm;	/* minimum quality for normal daata */
 
 	struct {
 		char *sock_path;
+		struct pcu_sock_state *state;
 	} pcu;
+
+	/* BTS-side per-TRX state, indexed by trx->nr */
+	struct gsm_bts_trx_role_bts *trx_role;
 };
 
 enum lchan_ciph_state {
@@ -127,7 +178,68 @@ enum lchan_ciph_state {
 
 #include "openbsc/gsm_data_shared.h"
 
+struct lchan_ul_meas_sum {
+	uint32_t ber_full;
+	uint32_t irssi_full;
+	uint32_t ber_sub;
+	uint32_t irssi_sub;
+	int32_t taqb;
+	unsigned int num_sub;
+};
+
+/* exponentially averaged measurements of one power control loop */
+struct lchan_power_ctrl_state {
+	int32_t rxlev;		/* in 1/256 dBm */
+	int32_t rxqual;		/* in 1/256 RxQual steps */
+	uint8_t valid;		/* any measurement averaged yet */
+};
+
+/* BTS-side per-lchan state that has no place in gsm_data_shared.h */
+struct gsm_lchan_role_bts {
+	/* downlink RTP jitter buffer, replaces lchan->dl_tch_queue for RTP */
+	struct jitbuf jitbuf;
+	/* uplink RTP header cache for the batched TX path */
+	struct rtp_batch_lchan rtp_tx;
+	/* running sums of the uplink measurements of the current SACCH
+	 * period, lchan->meas.num_ul_meas holds their number */
+	struct lchan_ul_meas_sum ul_meas;
+	/* MS power control loop state */
+	struct lchan_power_ctrl_state ul_pwr;
+};
+
+/* how rsl_lchan_lookup() judges a chan_nr in the current TS config */
+enum chan_nr_rsl {
+	CHAN_NR_RSL_UNKNOWN,	/* not a valid RSL chan_nr at all */
+	CHAN_NR_RSL_MISMATCH,	/* doesn't match the pchan of the TS */
+	CHAN_NR_RSL_OK,
+};
+
+/* precomputed result of resolving one chan_nr */
+struct chan_nr_map {
+	struct gsm_lchan *lchan;	/* same as get_lchan_by_chan_nr() */
+	uint8_t ss;			/* same as l1sap_chan2ss() */
+	uint8_t rsl;			/* enum chan_nr_rsl */
+};
+
+/* BTS-side per-TRX state that has no place in gsm_data_shared.h */
+struct gsm_bts_trx_role_bts {
+	struct gsm_lchan_role_bts lchan[TRX_NR_TS][TS_MAX_LCHAN];
+	/* indexed by chan_nr, see ts_chan_nr_map_update() */
+	struct chan_nr_map chan_nr_map[256];
+};
+
+#define trx_role_bts(trx) \
+	(&bts_role_bts((trx)->bts)->trx_role[(trx)->nr])
+#define lchan_role_bts(lchan) \
+	(&trx_role_bts((lchan)->ts->trx)->lchan[(lchan)->ts->nr][(lchan)->nr])
+
+#define trx_chan_nr_map(trx, chan_nr) \
+	(&trx_role_bts(trx)->chan_nr_map[(uint8_t)(chan_nr)])
+
 void lchan_set_state(struct gsm_lchan *lchan, enum gsm_lchan_state state);
+/* recompute the chan_nr map of a TS, needed whenever ts->pchan or
+ * ts->dyn change */
+void ts_chan_nr_map_update(struct gsm_bts_trx_ts *ts);
 int conf_lchans_as_pchan(struct gsm_bts_trx_ts *ts,
 			 enum gsm_phys_chan_config pchan);
 
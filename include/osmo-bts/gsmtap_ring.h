@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+struct vty;
+
+/* number of records in the tap ring, must be a power of 2 */
+#define GSMTAP_RING_SIZE	2048
+/* largest payload kept per record (EGPRS MCS-9 block is 155 bytes) */
+#define GSMTAP_RING_DATA_MAX	160
+/* records written out per run of the writer */
+#define GSMTAP_RING_BUDGET	256
+
+struct gsmtap_ring_stats {
+	uint32_t enqueued;	/* records accepted from the L1 path */
+	uint32_t dropped_full;	/* ring full */
+	uint32_t dropped_prio;	/* bulk traffic dropped above high watermark */
+	uint32_t dropped_size;	/* payload too long for a record */
+	uint32_t sent;		/* GSMTAP packets sent */
+	uint32_t send_err;	/* GSMTAP send() failures */
+	uint32_t pcap_written;	/* records written to pcap */
+	uint32_t pcap_err;	/* records not written to pcap */
+	uint32_t pcap_files;	/* number of pcap files opened */
+	uint32_t pcap_fail;	/* pcap open/write failures */
+};
+
+/* the ring is only filled while GSMTAP or a pcap file is configured */
+extern bool gsmtap_ring_active;
+
+int gsmtap_ring_enqueue(uint16_t arfcn, uint8_t tn, uint8_t chan_type,
+			uint8_t ss, uint32_t fn, const uint8_t *data,
+			unsigned int len);
+
+/* (re)evaluate whether the tap is needed, allocate the ring if so */
+int gsmtap_ring_update(void *ctx);
+
+int gsmtap_ring_set_pcap(const char *path);
+void gsmtap_ring_set_pcap_rotate(unsigned int size_mb, unsigned int files);
+const char *gsmtap_ring_get_pcap(void);
+void gsmtap_ring_get_pcap_rotate(unsigned int *size_mb, unsigned int *files);
+
+const struct gsmtap_ring_stats *gsmtap_ring_get_stats(void);
+void gsmtap_ring_vty_dump(struct vty *vty);
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <osmo-bts/logging.h>
+
+struct vty;
+
+/* Logging for the per-burst / per-primitive paths.
+ *
+ * LOGP_HOT() is LOGP() with a per-category token bucket in front, so a
+ * message printed on every TDMA frame can't flood the log targets.  Levels
+ * below HOTLOG_MIN_LEVEL are removed by the compiler altogether, build with
+ * e.g. -DHOTLOG_MIN_LEVEL=LOGL_NOTICE for production images.
+ *
+ * HOTTRACE() records the format string pointer and up to four integer
+ * arguments into an in-memory ring, which is only formatted when dumped
+ * via 'show hot-log trace'.  Tracing is switched on per category.  The
+ * format must only contain integer conversions (%d, %u, %x, %02u, ...). */
+
+#ifndef HOTLOG_MIN_LEVEL
+#define HOTLOG_MIN_LEVEL	LOGL_DEBUG
+#endif
+
+/* number of records in the trace ring, must be a power of 2 */
+#define HOTLOG_TRACE_SIZE	1024
+
+/* default rate limit in messages per second and per category, unlimited
+ * so that explicitly enabled debug logging isn't silently throttled */
+#define HOTLOG_RATE_DEFAULT	0
+
+#define HOTLOG_MAX_CAT		32
+
+extern uint32_t hotlog_trace_mask;
+
+int hotlog_admit(int subsys, int level);
+void hotlog_trace(int subsys, int level, const char *fmt, uint32_t a0,
+		  uint32_t a1, uint32_t a2, uint32_t a3);
+
+#define LOGP_HOT(ss, level, fmt, args...)				\
+	do {								\
+		if ((level) >= HOTLOG_MIN_LEVEL &&			\
+		    log_check_level(ss, level) &&			\
+		    hotlog_admit(ss, level))				\
+			LOGP(ss, level, fmt, ##args);			\
+	} while (0)
+
+#define HOTTRACE(ss, level, fmt, a0, a1, a2, a3)			\
+	do {								\
+		if ((level) >= HOTLOG_MIN_LEVEL &&			\
+		    (hotlog_trace_mask & (1 << (ss))))			\
+			hotlog_trace(ss, level, fmt, a0, a1, a2, a3);	\
+	} while (0)
+
+/* messages per second for one category, 0 means unlimited */
+int hotlog_set_rate(int subsys, unsigned int rate);
+unsigned int hotlog_get_rate(int subsys);
+uint32_t hotlog_get_suppressed(int subsys);
+
+void hotlog_trace_clear(void);
+void hotlog_vty_dump_trace(struct vty *vty);
@@ -0,0 +1,66 @@
+#pragma once
+
+/* Hardware monitoring helpers of sysmobts-mgr and lc15bts-mgr
+ *
+ * Sensor attributes are opened once and then read with pread(), which
+ * sysfs treats like a fresh open and read of the attribute.  Alarm
+ * attributes of drivers calling sysfs_notify() wake up a select() on the
+ * exception set (POLLPRI), see hwmon_alarm_open().  The check interval
+ * shortens while a value is close to its limit and the checked values
+ * are kept in a ring buffer. */
+
+#include <stdint.h>
+#include <time.h>
+
+#include <osmocom/core/select.h>
+
+/* read the integer in the attribute 'path'.  The attribute is opened on
+ * the first call and kept open in '*fd', which has to be -1 initially.
+ * On a read error it is closed again, so a driver that went away and
+ * came back is picked up by the next call. */
+int hwmon_read_int(int *fd, const char *path, int *val);
+void hwmon_close(int *fd);
+
+struct hwmon_sample {
+	time_t		time;
+	int32_t		val;
+};
+
+struct hwmon_hist {
+	struct hwmon_sample *buf;
+	unsigned int	len;		/* size of buf */
+	unsigned int	head;		/* next slot to write */
+	unsigned int	num;		/* valid samples, at most len */
+};
+
+int hwmon_hist_init(void *ctx, struct hwmon_hist *h, unsigned int len);
+void hwmon_hist_add(struct hwmon_hist *h, time_t time, int32_t val);
+/* 'i'th oldest sample, NULL if i >= h->num */
+const struct hwmon_sample *hwmon_hist_get(const struct hwmon_hist *h,
+					  unsigned int i);
+
+/* interval between two checks: 'min' while any value is near its limit,
+ * doubled after each relaxed check up to 'max' */
+struct hwmon_interval {
+	unsigned int	min;
+	unsigned int	max;
+	unsigned int	cur;
+};
+
+unsigned int hwmon_interval_next(struct hwmon_interval *iv, int near);
+
+struct hwmon_alarm;
+typedef void hwmon_alarm_cb(struct hwmon_alarm *alarm, int val);
+
+struct hwmon_alarm {
+	struct osmo_fd	ofd;
+	hwmon_alarm_cb	*cb;
+	void		*data;
+};
+
+/* watch the alarm attribute 'path', 'cb' is called with its new value
+ * when the driver notifies a change.  Fails if the attribute does not
+ * exist, the caller then has to rely on the periodic check. */
+int hwmon_alarm_open(struct hwmon_alarm *alarm, const char *path,
+		     hwmon_alarm_cb *cb, void *data);
+void hwmon_alarm_close(struct hwmon_alarm *alarm);
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+struct msgb;
+
+/* number of 20ms speech frame slots in the ring, must be a power of 2 */
+#define JITBUF_NUM_SLOTS	32
+#define JITBUF_SLOT_MASK	(JITBUF_NUM_SLOTS - 1)
+
+/* duration of one speech frame in ms and in RTP timestamp units */
+#define JITBUF_FRAME_MS		20
+#define JITBUF_FRAME_TS		160
+
+struct jitbuf_stats {
+	uint32_t frames_in;	/* frames accepted into the buffer */
+	uint32_t frames_out;	/* frames handed to the PHY */
+	uint32_t late;		/* frames arriving after their playout slot */
+	uint32_t dup;		/* duplicate frames */
+	uint32_t overflow;	/* frames dropped because the buffer was full */
+	uint32_t lost;		/* gaps played out while later frames waited */
+	uint32_t underrun;	/* buffer ran dry during playout */
+	uint32_t resync;	/* timestamp jumps causing a re-sync */
+	uint64_t fill_sum;	/* sum of buffer fill level at each playout */
+	uint8_t depth_max;	/* highest target depth reached (frames) */
+};
+
+struct jitbuf {
+	/* ring of queued frames, slot[head] is played out next */
+	struct msgb *slot[JITBUF_NUM_SLOTS];
+	uint8_t head;
+	uint8_t fill;		/* number of occupied slots */
+	bool running;		/* prefill complete, playout in progress */
+	uint32_t play_ts;	/* RTP timestamp of slot[head] */
+
+	/* target depth in frames, adapted between depth_min/depth_max */
+	bool adaptive;
+	uint8_t depth;
+	uint8_t depth_min;
+	uint8_t depth_max;
+	uint16_t frames_since_late;
+
+	/* inter-arrival jitter estimation as per RFC 3550 A.8 */
+	bool have_prev;
+	uint32_t prev_arr_fn;
+	uint32_t prev_rtp_ts;
+	uint32_t jitter_q4;	/* in RTP timestamp units, Q4 fixed point */
+
+	struct jitbuf_stats stats;
+};
+
+void jitbuf_init(struct jitbuf *jb, unsigned int depth_ms, bool adaptive);
+void jitbuf_set_depth(struct jitbuf *jb, unsigned int depth_ms,
+		      bool adaptive);
+void jitbuf_flush(struct jitbuf *jb);
+
+/* enqueue a frame, takes ownership of msg */
+int jitbuf_put(struct jitbuf *jb, struct msgb *msg, uint32_t timestamp,
+	       uint32_t arr_fn);
+
+/* dequeue the frame for the next 20ms playout period, NULL on loss */
+struct msgb *jitbuf_get(struct jitbuf *jb);
+
+/* current inter-arrival jitter estimate in RTP timestamp units */
+static inline uint32_t jitbuf_jitter(const struct jitbuf *jb)
+{
+	return jb->jitter_q4 >> 4;
+}
+
+/* average buffering delay in ms */
+uint32_t jitbuf_avg_delay_ms(const struct jitbuf *jb);
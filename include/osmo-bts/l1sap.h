@@ -58,6 +58,9 @@ struct gsm_lchan *get_lchan_by_chan_nr(struct gsm_bts_trx *trx,
 /* allocate a msgb containing a osmo_phsap_prim + optional l2 data */
 struct msgb *l1sap_msgb_alloc(unsigned int l2_len);
 
+/* send the CHAN RQDs of the RR access bursts aggregated so far */
+void l1sap_rach_flush(struct gsm_bts *bts);
+
 /* any L1 prim received from bts model */
 int l1sap_up(struct gsm_bts_trx *trx, struct osmo_phsap_prim *l1sap);
 
@@ -0,0 +1,78 @@
+#pragma once
+
+/* Fixed point accumulator of uplink burst measurements (RSSI, TOA, BER)
+ *
+ * Values are added as integers in a fixed point format chosen by the user,
+ * see the MEAS_ACC_*_SHIFT below.  Adding a value is branch free, so the
+ * per-burst update can be inlined into the receive path at no cost.  The
+ * minimum is kept alongside the sum, which is what the MS power loop
+ * needs instead of a buffer of past values.  A zeroed accumulator is
+ * empty, so it needs no setup in zero-allocated channel states. */
+
+#include <stdint.h>
+
+/* TOA in 1/256 symbol */
+#define MEAS_ACC_TOA_SHIFT	8
+/* BER in 1/65536 */
+#define MEAS_ACC_BER_SHIFT	16
+
+struct meas_acc {
+	int32_t		sum;		/* sum of the values */
+	int32_t		min;		/* lowest value, if num > 0 */
+	uint32_t	num;		/* number of values */
+};
+
+static inline void meas_acc_reset(struct meas_acc *acc)
+{
+	acc->sum = 0;
+	acc->min = 0;
+	acc->num = 0;
+}
+
+static inline void meas_acc_add_n(struct meas_acc *acc, int32_t val,
+				  uint32_t n)
+{
+	/* the select compiles to a conditional move */
+	int32_t min = acc->num ? acc->min : val;
+	int32_t d = val - min;
+
+	acc->sum += val * (int32_t)n;
+	acc->min = min + (d & -(int32_t)(d < 0));
+	acc->num += n;
+}
+
+static inline void meas_acc_add(struct meas_acc *acc, int32_t val)
+{
+	meas_acc_add_n(acc, val, 1);
+}
+
+/* average, rounded to the nearest integer, 0 if nothing was added */
+static inline int32_t meas_acc_avg(const struct meas_acc *acc)
+{
+	int32_t num = acc->num;
+	int32_t half;
+
+	if (!num)
+		return 0;
+	half = num >> 1;
+	return (acc->sum + (acc->sum < 0 ? -half : half)) / num;
+}
+
+/* lowest value, 0 if nothing was added */
+static inline int32_t meas_acc_min(const struct meas_acc *acc)
+{
+	return acc->num ? acc->min : 0;
+}
+
+/* convert a float to fixed point with 'shift' fractional bits */
+static inline int32_t meas_acc_fix(float val, unsigned int shift)
+{
+	float f = val * (float)(1 << shift);
+
+	return (int32_t)(f + (f < 0 ? -0.5f : 0.5f));
+}
+
+static inline float meas_acc_float(int32_t val, unsigned int shift)
+{
+	return (float)val / (float)(1 << shift);
+}
@@ -5,4 +5,6 @@ int lchan_new_ul_meas(struct gsm_lchan *lchan, struct bts_ul_meas *ulm);
 
 int trx_meas_check_compute(struct gsm_bts_trx *trx, uint32_t fn);
 
+uint8_t ber10k_to_rxqual(uint32_t ber10k);
+
 #endif
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <osmo-bts/pcuif_proto.h>
+
+struct pcu_shm;
+
+struct pcu_shm_stats {
+	uint32_t tx;		/* messages written to the BTS->PCU ring */
+	uint32_t tx_full;	/* messages dropped, BTS->PCU ring full */
+	uint32_t rx;		/* messages read from the PCU->BTS ring */
+	uint32_t doorbells;	/* doorbells rung towards the PCU */
+};
+
+/* called for each message the PCU put into its ring */
+typedef int pcu_shm_rx_cb(struct gsm_pcu_if *pcu_prim, void *data);
+
+struct pcu_shm *pcu_shm_alloc(void *ctx, pcu_shm_rx_cb *rx_cb, void *data);
+void pcu_shm_free(struct pcu_shm *shm);
+
+/* send PCU_IF_MSG_SHM_CNF with the descriptors and start reading the ring */
+int pcu_shm_start(struct pcu_shm *shm, int sock_fd, uint8_t bts_nr);
+
+/* next slot towards the PCU, NULL if the ring is full */
+struct gsm_pcu_if *pcu_shm_tx_get(struct pcu_shm *shm);
+/* publish the slot returned by pcu_shm_tx_get() */
+void pcu_shm_tx_put(struct pcu_shm *shm);
+
+const struct pcu_shm_stats *pcu_shm_get_stats(const struct pcu_shm *shm);
@@ -1,18 +1,24 @@
 #ifndef _PCUIF_PROTO_H
 #define _PCUIF_PROTO_H
 
-#define PCU_IF_VERSION		0x07
+#define PCU_IF_VERSION		0x08
+/* last version without PCU_IF_MSG_RTS_BATCH, see PCU_IF_MSG_VERSION_IND */
+#define PCU_IF_VERSION_LEGACY	0x07
 
 /* msg_type */
 #define PCU_IF_MSG_DATA_REQ	0x00	/* send data to given channel */
 #define PCU_IF_MSG_DATA_CNF	0x01	/* confirm (e.g. transmission on PCH) */
 #define PCU_IF_MSG_DATA_IND	0x02	/* receive data from given channel */	
 #define PCU_IF_MSG_RTS_REQ	0x10	/* ready to send request */
+#define PCU_IF_MSG_RTS_BATCH	0x12	/* RTS requests of one FN + GSM time */
 #define PCU_IF_MSG_RACH_IND	0x22	/* receive RACH */
 #define PCU_IF_MSG_INFO_IND	0x32	/* retrieve BTS info */
 #define PCU_IF_MSG_ACT_REQ	0x40	/* activate/deactivate PDCH */
 #define PCU_IF_MSG_TIME_IND	0x52	/* GSM time indication */
 #define PCU_IF_MSG_PAG_REQ	0x60	/* paging request */
+#define PCU_IF_MSG_SHM_REQ	0x70	/* request shared memory transport */
+#define PCU_IF_MSG_SHM_CNF	0x71	/* shared memory transport set up */
+#define PCU_IF_MSG_VERSION_IND	0x74	/* PCU announces its version */
 
 /* sapi */
 #define PCU_IF_SAPI_RACH	0x01	/* channel request on CCCH */
@@ -26,6 +32,7 @@
 /* flags */
 #define PCU_IF_FLAG_ACTIVE	(1 << 0)/* BTS is active */
 #define PCU_IF_FLAG_SYSMO	(1 << 1)/* access PDCH of sysmoBTS directly */
+#define PCU_IF_FLAG_SHM		(1 << 2)/* shared memory transport offered */
 #define PCU_IF_FLAG_CS1		(1 << 16)
 #define PCU_IF_FLAG_CS2		(1 << 17)
 #define PCU_IF_FLAG_CS3		(1 << 18)
@@ -65,6 +72,30 @@ struct gsm_pcu_if_rts_req {
 	uint8_t		block_nr;
 } __attribute__ ((packed));
 
+struct gsm_pcu_if_rts_batch_entry {
+	uint8_t		sapi;
+	uint8_t		trx_nr;
+	uint8_t		ts_nr;
+	uint8_t		block_nr;
+	uint32_t	fn;
+} __attribute__ ((packed));
+
+/* 8 TRX with 8 PDCH each */
+#define PCU_IF_RTS_BATCH_MAX	64
+
+/* Replaces both RTS_REQ and TIME_IND once the PCU announced version 0x08
+ * or later with VERSION_IND.  It is sent at least on every MAC block
+ * boundary, fn is the current GSM time.  It is not part of the union in
+ * struct gsm_pcu_if: the message is the header of struct gsm_pcu_if
+ * followed by this struct with num_rts entries, see
+ * PCU_IF_RTS_BATCH_LEN(). */
+struct gsm_pcu_if_rts_batch {
+	uint32_t	fn;
+	uint8_t		num_rts;
+	uint8_t		spare[3];
+	struct gsm_pcu_if_rts_batch_entry rts[0];
+} __attribute__ ((packed));
+
 struct gsm_pcu_if_rach_ind {
 	uint8_t		sapi;
 	uint16_t	ra;
@@ -136,6 +167,20 @@ struct gsm_pcu_if_pag_req {
 	uint8_t		identity_lv[9];
 } __attribute__ ((packed));
 
+/* Sent by the PCU after connecting.  Until then the BTS assumes a legacy
+ * PCU and reports PCU_IF_VERSION_LEGACY in INFO_IND, afterwards it sends
+ * INFO_IND again with PCU_IF_VERSION. */
+struct gsm_pcu_if_version_ind {
+	uint32_t	version;
+} __attribute__ ((packed));
+
+/* see pcuif_shm.h */
+struct gsm_pcu_if_shm {
+	uint32_t	size;		/* size of the memory region */
+	uint16_t	num_slots;	/* slots per ring */
+	uint16_t	slot_size;	/* sizeof(struct gsm_pcu_if) */
+} __attribute__ ((packed));
+
 struct gsm_pcu_if {
 	/* context based information */
 	uint8_t		msg_type;	/* message type */
@@ -152,7 +197,15 @@ struct gsm_pcu_if {
 		struct gsm_pcu_if_act_req	act_req;
 		struct gsm_pcu_if_time_ind	time_ind;
 		struct gsm_pcu_if_pag_req	pag_req;
+		struct gsm_pcu_if_shm		shm_req;
+		struct gsm_pcu_if_shm		shm_cnf;
+		struct gsm_pcu_if_version_ind	version_ind;
 	} u;
 } __attribute__ ((packed));
 
+/* length of a PCU_IF_MSG_RTS_BATCH message with n RTS entries */
+#define PCU_IF_RTS_BATCH_LEN(n) \
+	(offsetof(struct gsm_pcu_if, u) + sizeof(struct gsm_pcu_if_rts_batch) \
+	 + (n) * sizeof(struct gsm_pcu_if_rts_batch_entry))
+
 #endif /* _PCUIF_PROTO_H */
@@ -0,0 +1,85 @@
+#ifndef _PCUIF_SHM_H
+#define _PCUIF_SHM_H
+
+/* Shared memory transport between BTS and PCU
+ *
+ * The PCU asks for it by sending PCU_IF_MSG_SHM_REQ over the unix socket.
+ * The BTS answers with PCU_IF_MSG_SHM_CNF, carrying three file descriptors
+ * as SCM_RIGHTS ancillary data (in this order): the memory region holding
+ * a struct pcu_if_shm, the doorbell eventfd BTS->PCU and the doorbell
+ * eventfd PCU->BTS.  A CNF without descriptors means the request was
+ * refused and the socket stays in use.
+ *
+ * Once the CNF is sent, all BTS->PCU messages go through the BTS->PCU ring.
+ * The PCU may send through its ring or through the socket.  Each ring has
+ * one producer and one consumer.  The producer rings the doorbell only if
+ * the ring was empty, the consumer drains the ring until it is empty after
+ * each doorbell.  Closing the socket tears the transport down. */
+
+#include <stdint.h>
+
+#include "pcuif_proto.h"
+
+#define PCU_IF_SHM_MAGIC	0x50435553	/* "PCUS" */
+/* number of slots per ring, must be a power of 2 */
+#define PCU_IF_SHM_SLOTS	256
+
+#define PCU_IF_SHM_RING_BTS2PCU	0
+#define PCU_IF_SHM_RING_PCU2BTS	1
+
+struct pcu_if_shm_ring {
+	/* written by the producer only, on their own cache lines */
+	uint32_t	head __attribute__ ((aligned (64)));
+	uint32_t	tail __attribute__ ((aligned (64)));
+	struct gsm_pcu_if slot[PCU_IF_SHM_SLOTS] __attribute__ ((aligned (64)));
+};
+
+struct pcu_if_shm {
+	uint32_t	magic;
+	uint16_t	num_slots;
+	uint16_t	slot_size;
+	struct pcu_if_shm_ring ring[2];
+};
+
+/* get the next free slot for writing, NULL if the ring is full */
+static inline struct gsm_pcu_if *
+pcu_if_shm_ring_get(struct pcu_if_shm_ring *r)
+{
+	uint32_t head = r->head;
+	uint32_t tail = __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+
+	if (head - tail >= PCU_IF_SHM_SLOTS)
+		return NULL;
+	return &r->slot[head & (PCU_IF_SHM_SLOTS - 1)];
+}
+
+/* publish the slot returned by pcu_if_shm_ring_get(), returns 1 if the
+ * ring was empty and the consumer has to be woken up */
+static inline int pcu_if_shm_ring_put(struct pcu_if_shm_ring *r)
+{
+	uint32_t head = r->head + 1;
+
+	/* the store of head and the load of tail must not be reordered,
+	 * or a consumer going to sleep could miss the message */
+	__atomic_store_n(&r->head, head, __ATOMIC_SEQ_CST);
+	return head - __atomic_load_n(&r->tail, __ATOMIC_SEQ_CST) == 1;
+}
+
+/* get the oldest unread slot, NULL if the ring is empty */
+static inline struct gsm_pcu_if *
+pcu_if_shm_ring_peek(struct pcu_if_shm_ring *r)
+{
+	uint32_t tail = r->tail;
+
+	if (__atomic_load_n(&r->head, __ATOMIC_SEQ_CST) == tail)
+		return NULL;
+	return &r->slot[tail & (PCU_IF_SHM_SLOTS - 1)];
+}
+
+/* hand the slot returned by pcu_if_shm_ring_peek() back to the producer */
+static inline void pcu_if_shm_ring_consume(struct pcu_if_shm_ring *r)
+{
+	__atomic_store_n(&r->tail, r->tail + 1, __ATOMIC_SEQ_CST);
+}
+
+#endif /* _PCUIF_SHM_H */
@@ -64,6 +64,8 @@ struct phy_link {
 			uint32_t rf_port_index;
 			uint32_t rx_gain_db;
 			uint32_t tx_atten_db;
+			/* use PACKET_MMAP rings on the PHY socket */
+			bool mmap_ring;
 #if OCTPHY_MULTI_TRX == 1
 			/* arfcn used by TRX with id 0 */
 			uint16_t center_arfcn;
@@ -94,6 +96,7 @@ struct phy_instance {
 			int clk_cal;
 			uint8_t clk_src;
 			char *calib_path;
+			char *calib_cache;
 
 			struct femtol1_hdl *hdl;
 		} sysmobts;
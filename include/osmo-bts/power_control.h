@@ -3,5 +3,19 @@
 #include <stdint.h>
 #include <osmo-bts/gsm_data.h>
 
+extern const struct bts_power_ctrl_params power_ctrl_ul_default;
+
+/* average a new measurement into 'st' and return the power change in dB
+ * that brings the filtered RxLev to 'target' (positive: more power) */
+int power_ctrl_step(const struct bts_power_ctrl_params *par,
+		    struct lchan_power_ctrl_state *st,
+		    int target, int rxlev, int rxqual);
+
+void lchan_power_ctrl_reset(struct gsm_lchan *lchan);
+
+/* change the MS power level by 'delta' dB, returns 1 if it changed */
+int lchan_ms_pwr_change(struct gsm_lchan *lchan, int delta);
+
 int lchan_ms_pwr_ctrl(struct gsm_lchan *lchan,
-		      const uint8_t ms_power, const int rxLevel);
+		      const uint8_t ms_power, const int rxLevel,
+		      const uint8_t rxQual);
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+struct gsm_lchan;
+struct rtp_batch;
+
+#define RTP_BATCH_HDR_LEN	12
+
+/* per-lchan RTP transmit state for the batched TX path, sequence number,
+ * timestamp and statistics are those of the lchan's ORTP session */
+struct rtp_batch_lchan {
+	/* pre-built RTP header, only M/seq/timestamp are patched */
+	uint8_t hdr[RTP_BATCH_HDR_LEN];
+};
+
+struct rtp_batch_stats {
+	uint32_t flushes;	/* number of sendmmsg() calls */
+	uint32_t packets;	/* number of packets handed to the kernel */
+	uint32_t dropped;	/* packets which could not be sent */
+};
+
+struct rtp_batch *rtp_batch_alloc(void *ctx);
+void rtp_batch_free(struct rtp_batch *rb);
+
+/* (re)initialize the header cache at CRCX */
+void rtp_batch_lchan_init(struct gsm_lchan *lchan);
+/* update the cached payload type after MDCX */
+void rtp_batch_lchan_set_pt(struct gsm_lchan *lchan, uint8_t pt);
+
+/* queue an uplink speech frame of an lchan for the next flush, fails
+ * with -ENOTCONN while the lchan has no remote RTP address */
+int rtp_batch_enqueue(struct rtp_batch *rb, struct gsm_lchan *lchan,
+		      const uint8_t *data, unsigned int len,
+		      uint32_t duration, bool marker);
+
+/* send all queued frames, called once per TDMA frame */
+int rtp_batch_flush(struct rtp_batch *rb);
+
+const struct rtp_batch_stats *rtp_batch_get_stats(const struct rtp_batch *rb);
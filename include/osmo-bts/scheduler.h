@@ -4,6 +4,7 @@
 #include <osmocom/core/utils.h>
 
 #include <osmo-bts/gsm_data.h>
+#include <osmo-bts/meas_acc.h>
 
 /* These types define the different channels on a multiframe.
  * Each channel has queues and can be activated individually.
@@ -71,11 +72,9 @@ struct l1sched_chan_state {
 	uint32_t		ul_first_fn;	/* fn of first burst */
 	uint8_t			ul_mask;	/* mask of received bursts */
 
-	/* RSSI / TOA */
-	uint8_t			rssi_num;	/* number of RSSI values */
-	float			rssi_sum;	/* sum of RSSI values */
-	uint8_t			toa_num;	/* number of TOA values */
-	float			toa_sum;	/* sum of TOA values */
+	/* RSSI / TOA of the bursts of the current block */
+	struct meas_acc		rssi;		/* RSSI in dBm */
+	struct meas_acc		toa;		/* TOA, see MEAS_ACC_TOA_SHIFT */
 
 	/* loss detection */
 	uint8_t			lost;		/* (SACCH) loss detection */
@@ -86,8 +85,7 @@ struct l1sched_chan_state {
 	/* AMR */
 	uint8_t			codec[4];	/* 4 possible codecs for amr */
 	int			codecs;		/* number of possible codecs */
-	float			ber_sum;	/* sum of bit error rates */
-	int			ber_num;	/* number of bit error rates */
+	struct meas_acc		ber;		/* see MEAS_ACC_BER_SHIFT */
 	uint8_t			ul_ft;		/* current uplink FT index */
 	uint8_t			dl_ft;		/* current downlink FT index */
 	uint8_t			ul_cmr;		/* current uplink CMR index */
@@ -109,12 +107,9 @@ struct l1sched_chan_state {
 	/* measurements */
 	struct {
 		uint8_t		clock;		/* cyclic clock counter */
-		int8_t		rssi[32];	/* last RSSI values */
-		int		rssi_count;	/* received RSSI values */
-		int		rssi_valid_count; /* number of stored value */
+		struct meas_acc	rssi;		/* RSSI since last clock */
 		int		rssi_got_burst; /* any burst received so far */
-		float		toa_sum;	/* sum of TOA values */
-		int		toa_num;	/* number of TOA value */
+		struct meas_acc	toa;		/* TOA of acked TA */
 	} meas;
 
 	/* handover */
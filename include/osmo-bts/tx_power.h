@@ -6,6 +6,10 @@
 /* our unit is 'milli dB" or "milli dBm", i.e. 1/1000 of a dB(m) */
 #define to_mdB(x)	(x * 1000)
 
+/* number of BS Power IE values (in 2 dB steps) with a precomputed entry
+ * in the per-TRX power tables, larger values are computed on demand */
+#define TX_POWER_IE_NUM	32
+
 /* PA calibration table */
 struct pa_calibration {
 	int gain_mdB[1024];		/* gain provided at given ARFCN */
@@ -55,7 +59,23 @@ struct trx_power_params {
 		unsigned int step_size_mdB;
 		unsigned int step_interval_sec;
 		struct osmo_timer_list step_timer;
+		/* steps are timed by the TDMA frame number once the PHY
+		 * delivers time indications, see power_ramp_fn_tick().
+		 * step_timer takes over if they stop */
+		int fn_clock;
+		int step_pending;
+		uint32_t step_fn;
 	} ramp;
+
+	/* power chain precomputed by power_tables_update() */
+	struct {
+		/* gain of user gain, user PA and internal PA at trx->arfcn,
+		 * INT_MIN if the ARFCN has no calibration entry */
+		int trxout_gain_mdB;
+		/* P_target and TRX output power for each BS Power IE */
+		int p_target_mdBm[TX_POWER_IE_NUM];
+		int p_trxout_target_mdBm[TX_POWER_IE_NUM];
+	} tbl;
 };
 
 int get_p_max_out_mdBm(struct gsm_bts_trx *trx);
@@ -71,6 +91,16 @@ int get_p_trxout_target_mdBm_lchan(struct gsm_lchan *lchan);
 int get_p_trxout_actual_mdBm(struct gsm_bts_trx *trx, uint8_t bs_power_ie);
 int get_p_trxout_actual_mdBm_lchan(struct gsm_lchan *lchan);
 
+int get_p_trxout_eff_mdBm(struct gsm_bts_trx *trx, int p_target_mdBm);
+
+/* recompute the power tables, to be called after any change of the
+ * maximum output power, power reduction, user gain, PA calibration or
+ * ARFCN of the TRX */
+void power_tables_update(struct gsm_bts_trx *trx);
+
 int power_ramp_start(struct gsm_bts_trx *trx, int p_total_tgt_mdBm, int bypass);
 
 void power_trx_change_compl(struct gsm_bts_trx *trx, int p_trxout_cur_mdBm);
+
+/* to be called for each TDMA frame, makes pending ramp steps at 'fn' */
+void power_ramp_fn_tick(struct gsm_bts_trx *trx, uint32_t fn);
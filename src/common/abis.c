@@ -48,6 +48,7 @@
 #include <osmo-bts/rsl.h>
 #include <osmo-bts/oml.h>
 #include <osmo-bts/bts_model.h>
+#include <osmo-bts/bringup.h>
 
 static struct gsm_bts *g_bts;
 
@@ -83,9 +84,18 @@ static void drain_oml_queue(struct gsm_bts *bts)
 
 int abis_bts_rsl_sendmsg(struct msgb *msg)
 {
+	struct gsm_bts_trx *trx = msg->trx;
+
+	if (!trx->rsl_link) {
+		LOGP(DABIS, LOGL_NOTICE, "RSL link for TRX%u down, "
+		     "dropping message\n", trx->nr);
+		msgb_free(msg);
+		return -ENOTCONN;
+	}
+
 	/* osmo-bts uses msg->trx internally, but libosmo-abis uses
 	 * the signalling link at msg->dst */
-	msg->dst = msg->trx->rsl_link;
+	msg->dst = trx->rsl_link;
 	return abis_sendmsg(msg);
 }
 
@@ -99,6 +109,7 @@ static struct e1inp_sign_link *sign_link_up(void *unit, struct e1inp_line *line,
 	switch (type) {
 	case E1INP_SIGN_OML:
 		LOGP(DABIS, LOGL_INFO, "OML Signalling link up\n");
+		bringup_end("oml_connect", -1, -1);
 		e1inp_ts_config_sign(&line->ts[E1INP_SIGN_OML-1], line);
 		sign_link = g_bts->oml_link =
 			e1inp_sign_link_create(&line->ts[E1INP_SIGN_OML-1],
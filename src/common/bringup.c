@@ -0,0 +1,199 @@
+/* Timing of the bring-up phases */
+
+/* (C) 2017 by sysmocom s.f.m.c. GmbH
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+
+#include <osmocom/core/linuxlist.h>
+#include <osmocom/core/utils.h>
+#include <osmocom/gsm/protocol/gsm_12_21.h>
+#include <osmocom/vty/vty.h>
+
+#include <osmo-bts/gsm_data.h>
+#include <osmo-bts/logging.h>
+#include <osmo-bts/bringup.h>
+
+struct bringup_phase {
+	const char *name;
+	int trx;
+	int tn;
+	uint64_t start_us;
+	uint64_t end_us;		/* 0 while the phase is running */
+};
+
+static struct {
+	struct timespec t0;
+	struct bringup_phase phase[BRINGUP_MAX_PHASES];
+	unsigned int num;
+	uint64_t on_air_us;		/* 0 until all timeslots are enabled */
+} bringup;
+
+static uint64_t now_us(void)
+{
+	struct timespec ts;
+	uint64_t us;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	us = (uint64_t)(ts.tv_sec - bringup.t0.tv_sec) * 1000000
+		+ (ts.tv_nsec - bringup.t0.tv_nsec) / 1000;
+	/* 0 is reserved for "not yet" */
+	return us ? us : 1;
+}
+
+void bringup_init(void)
+{
+	memset(&bringup, 0, sizeof(bringup));
+	clock_gettime(CLOCK_MONOTONIC, &bringup.t0);
+}
+
+void bringup_begin(const char *phase, int trx, int tn)
+{
+	struct bringup_phase *p;
+
+	if (bringup.on_air_us || bringup.num >= BRINGUP_MAX_PHASES)
+		return;
+
+	p = &bringup.phase[bringup.num++];
+	p->name = phase;
+	p->trx = trx;
+	p->tn = tn;
+	p->start_us = now_us();
+	p->end_us = 0;
+}
+
+void bringup_end(const char *phase, int trx, int tn)
+{
+	struct bringup_phase *p;
+	int i;
+
+	if (bringup.on_air_us)
+		return;
+
+	/* the latest running instance, ending a phase that was never
+	 * started (e.g. after the table ran full) is no error */
+	for (i = bringup.num - 1; i >= 0; i--) {
+		p = &bringup.phase[i];
+		if (!p->end_us && p->trx == trx && p->tn == tn
+		    && !strcmp(p->name, phase)) {
+			p->end_us = now_us();
+			return;
+		}
+	}
+}
+
+static void mo_to_trx_tn(const struct gsm_abis_mo *mo, int *trx, int *tn)
+{
+	switch (mo->obj_class) {
+	case NM_OC_CHANNEL:
+		*trx = mo->obj_inst.trx_nr;
+		*tn = mo->obj_inst.ts_nr;
+		break;
+	case NM_OC_RADIO_CARRIER:
+	case NM_OC_BASEB_TRANSC:
+		*trx = mo->obj_inst.trx_nr;
+		*tn = -1;
+		break;
+	default:
+		*trx = -1;
+		*tn = -1;
+		break;
+	}
+}
+
+void bringup_mo_begin(const char *phase, const struct gsm_abis_mo *mo)
+{
+	int trx, tn;
+
+	mo_to_trx_tn(mo, &trx, &tn);
+	bringup_begin(phase, trx, tn);
+}
+
+void bringup_mo_end(const char *phase, const struct gsm_abis_mo *mo)
+{
+	int trx, tn;
+
+	mo_to_trx_tn(mo, &trx, &tn);
+	bringup_end(phase, trx, tn);
+}
+
+void bringup_check_on_air(struct gsm_bts *bts)
+{
+	struct gsm_bts_trx *trx;
+	int tn;
+
+	if (bringup.on_air_us)
+		return;
+
+	llist_for_each_entry(trx, &bts->trx_list, list) {
+		for (tn = 0; tn < ARRAY_SIZE(trx->ts); tn++) {
+			if (trx->ts[tn].mo.nm_state.operational
+			    != NM_OPSTATE_ENABLED)
+				return;
+		}
+	}
+
+	bringup.on_air_us = now_us();
+	LOGP(DOML, LOGL_NOTICE, "All timeslots on air %llu ms after start, "
+	     "see 'show bring-up'\n",
+	     (unsigned long long)bringup.on_air_us / 1000);
+}
+
+static void vty_out_ms(struct vty *vty, uint64_t us)
+{
+	vty_out(vty, "%6llu.%03u", (unsigned long long)us / 1000,
+		(unsigned int)(us % 1000));
+}
+
+void bringup_vty_dump(struct vty *vty)
+{
+	const struct bringup_phase *p;
+	unsigned int i;
+
+	vty_out(vty, "%10s  %10s  phase (times in ms)%s", "start",
+		"duration", VTY_NEWLINE);
+	for (i = 0; i < bringup.num; i++) {
+		p = &bringup.phase[i];
+		vty_out_ms(vty, p->start_us);
+		vty_out(vty, "  ");
+		if (p->end_us)
+			vty_out_ms(vty, p->end_us - p->start_us);
+		else
+			vty_out(vty, "%10s", "running");
+		vty_out(vty, "  %s", p->name);
+		if (p->trx >= 0)
+			vty_out(vty, " trx %d", p->trx);
+		if (p->tn >= 0)
+			vty_out(vty, " ts %d", p->tn);
+		vty_out(vty, "%s", VTY_NEWLINE);
+	}
+
+	if (bringup.num >= BRINGUP_MAX_PHASES)
+		vty_out(vty, "(table full, later phases not recorded)%s",
+			VTY_NEWLINE);
+	if (bringup.on_air_us) {
+		vty_out(vty, "All timeslots on air after ");
+		vty_out_ms(vty, bringup.on_air_us);
+		vty_out(vty, " ms%s", VTY_NEWLINE);
+	} else
+		vty_out(vty, "Not all timeslots on air yet%s", VTY_NEWLINE);
+}
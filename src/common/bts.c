@@ -46,6 +46,7 @@
 #include <osmo-bts/oml.h>
 #include <osmo-bts/signal.h>
 #include <osmo-bts/dtx_dl_amr_fsm.h>
+#include <osmo-bts/power_control.h>
 
 #define MIN_QUAL_RACH    5.0f   /* at least  5 dB C/I */
 #define MIN_QUAL_NORM   -0.5f   /* at least -1 dB C/I */
@@ -95,6 +96,7 @@ int bts_init(struct gsm_bts *bts)
 	bts->band = GSM_BAND_1800;
 
 	bts->role = btsb = talloc_zero(bts, struct gsm_bts_role_bts);
+	btsb->bts = bts;
 
 	INIT_LLIST_HEAD(&btsb->agch_queue);
 	btsb->agch_queue_length = 0;
@@ -109,7 +111,7 @@ int bts_init(struct gsm_bts *bts)
 
 	/* configurable via VTY */
 	btsb->paging_state = paging_init(btsb, 200, 0);
-	btsb->ul_power_target = -75;	/* dBm default */
+	btsb->ul_power_ctrl = power_ctrl_ul_default;
 	btsb->rtp_jitter_adaptive = false;
 
 	/* configurable via OML */
@@ -138,6 +140,12 @@ int bts_init(struct gsm_bts *bts)
 	oml_mo_state_init(&bts->gprs.nsvc[0].mo, -1, NM_AVSTATE_DEPENDENCY);
 	oml_mo_state_init(&bts->gprs.nsvc[1].mo, NM_OPSTATE_DISABLED, NM_AVSTATE_OFF_LINE);
 
+	/* BTS-side per-TRX state, all TRX have been allocated by now */
+	btsb->trx_role = talloc_zero_array(btsb, struct gsm_bts_trx_role_bts,
+					   bts->num_trx);
+	if (!btsb->trx_role)
+		return -ENOMEM;
+
 	/* initialize bts data structure */
 	llist_for_each_entry(trx, &bts->trx_list, list) {
 		struct trx_power_params *tpp = &trx->power_params;
@@ -147,6 +155,7 @@ int bts_init(struct gsm_bts *bts)
 			struct gsm_bts_trx_ts *ts = &trx->ts[i];
 			int k;
 
+			ts_chan_nr_map_update(ts);
 			for (k = 0; k < ARRAY_SIZE(ts->lchan); k++) {
 				struct gsm_lchan *lchan = &ts->lchan[k];
 				INIT_LLIST_HEAD(&lchan->dl_tch_queue);
@@ -169,6 +178,9 @@ int bts_init(struct gsm_bts *bts)
 		return rc;
 	}
 
+	llist_for_each_entry(trx, &bts->trx_list, list)
+		power_tables_update(trx);
+
 	bts_gsmnet.num_bts++;
 
 	if (!initialized) {
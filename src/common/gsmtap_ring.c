@@ -0,0 +1,475 @@
+/* GSMTAP / pcap tap decoupled from the L1 path by a record ring */
+
+/* (C) 2017 by sysmocom s.f.m.c. GmbH
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* The L1 path only copies the primitive into a fixed size record of a
+ * preallocated ring.  Building the GSMTAP header, the send() and the pcap
+ * write() happen in a timer driven writer which handles at most
+ * GSMTAP_RING_BUDGET records per run, so a burst of tapped primitives is
+ * spread over several main loop iterations.
+ *
+ * The ring has exactly one producer (to_gsmtap()) and one consumer (the
+ * writer), 'head' is only written by the former and 'tail' only by the
+ * latter.
+ *
+ * Drop policy: once the ring is three quarters full, only signalling
+ * (BCCH, CCCH, RACH, SDCCH, SACCH) is still accepted, traffic channels and
+ * PDCH blocks are dropped.  A full ring drops everything.  Each case has
+ * its own counter.
+ *
+ * If the pcap file can't be opened or written, the error is logged once
+ * and no further attempt is made for GSMTAP_PCAP_RETRY_S seconds, the
+ * records in between are only counted.  Configuring a path retries right
+ * away. */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/timer.h>
+#include <osmocom/core/utils.h>
+#include <osmocom/core/gsmtap.h>
+#include <osmocom/core/gsmtap_util.h>
+#include <osmocom/vty/vty.h>
+
+#include <osmo-bts/logging.h>
+#include <osmo-bts/bts.h>
+#include <osmo-bts/l1sap.h>
+#include <osmo-bts/gsmtap_ring.h>
+
+#define GSMTAP_RING_MASK	(GSMTAP_RING_SIZE - 1)
+#define GSMTAP_RING_HIGH	(GSMTAP_RING_SIZE * 3 / 4)
+/* writer period while records are pending */
+#define GSMTAP_RING_PERIOD_US	10000
+/* back-off after a pcap open/write failure */
+#define GSMTAP_PCAP_RETRY_S	10
+
+/* pcap link type for raw IPv4, so wireshark finds GSMTAP by UDP port */
+#define PCAP_LINKTYPE_IPV4	228
+
+struct gsmtap_ring_rec {
+	struct timeval tv;
+	uint32_t fn;
+	uint16_t arfcn;
+	uint8_t tn;
+	uint8_t chan_type;
+	uint8_t ss;
+	uint8_t len;
+	uint8_t data[GSMTAP_RING_DATA_MAX];
+};
+
+struct pcap_file_hdr {
+	uint32_t magic;
+	uint16_t version_major;
+	uint16_t version_minor;
+	int32_t thiszone;
+	uint32_t sigfigs;
+	uint32_t snaplen;
+	uint32_t network;
+} __attribute__((packed));
+
+struct pcap_rec_hdr {
+	uint32_t ts_sec;
+	uint32_t ts_usec;
+	uint32_t incl_len;
+	uint32_t orig_len;
+} __attribute__((packed));
+
+struct ipv4_udp_hdr {
+	uint8_t ver_ihl;
+	uint8_t tos;
+	uint16_t tot_len;
+	uint16_t id;
+	uint16_t frag_off;
+	uint8_t ttl;
+	uint8_t proto;
+	uint16_t csum;
+	uint32_t saddr;
+	uint32_t daddr;
+	uint16_t sport;
+	uint16_t dport;
+	uint16_t len;
+	uint16_t check;
+} __attribute__((packed));
+
+static struct {
+	struct gsmtap_ring_rec *rec;
+	unsigned int head;
+	unsigned int tail;
+	struct osmo_timer_list timer;
+
+	char *pcap_path;
+	int pcap_fd;
+	uint64_t pcap_bytes;
+	unsigned int pcap_size_mb;
+	unsigned int pcap_files;
+	/* failure logged, no open attempt before pcap_retry */
+	bool pcap_failed;
+	time_t pcap_retry;
+
+	struct gsmtap_ring_stats stats;
+} ring = {
+	.pcap_fd = -1,
+	.pcap_size_mb = 64,
+	.pcap_files = 4,
+};
+
+bool gsmtap_ring_active;
+
+static bool is_bulk_chan(uint8_t chan_type)
+{
+	if (chan_type & GSMTAP_CHANNEL_ACCH)
+		return false;
+
+	switch (chan_type) {
+	case GSMTAP_CHANNEL_TCH_F:
+	case GSMTAP_CHANNEL_TCH_H:
+	case GSMTAP_CHANNEL_PACCH:
+	case GSMTAP_CHANNEL_PDCH:
+	case GSMTAP_CHANNEL_PTCCH:
+		return true;
+	}
+	return false;
+}
+
+/*! \brief queue a tapped primitive, called from the L1 path
+ *  \returns 0 if queued, negative if dropped */
+int gsmtap_ring_enqueue(uint16_t arfcn, uint8_t tn, uint8_t chan_type,
+			uint8_t ss, uint32_t fn, const uint8_t *data,
+			unsigned int len)
+{
+	unsigned int fill = ring.head - ring.tail;
+	struct gsmtap_ring_rec *r;
+
+	if (!ring.rec)
+		return -ENODEV;
+
+	if (len > GSMTAP_RING_DATA_MAX) {
+		ring.stats.dropped_size++;
+		return -EMSGSIZE;
+	}
+	if (fill >= GSMTAP_RING_SIZE) {
+		ring.stats.dropped_full++;
+		return -ENOSPC;
+	}
+	if (fill >= GSMTAP_RING_HIGH && is_bulk_chan(chan_type)) {
+		ring.stats.dropped_prio++;
+		return -ENOSPC;
+	}
+
+	r = &ring.rec[ring.head & GSMTAP_RING_MASK];
+	gettimeofday(&r->tv, NULL);
+	r->fn = fn;
+	r->arfcn = arfcn;
+	r->tn = tn;
+	r->chan_type = chan_type;
+	r->ss = ss;
+	r->len = len;
+	memcpy(r->data, data, len);
+	ring.head++;
+	ring.stats.enqueued++;
+
+	if (!osmo_timer_pending(&ring.timer))
+		osmo_timer_schedule(&ring.timer, 0, GSMTAP_RING_PERIOD_US);
+
+	return 0;
+}
+
+static void fill_gsmtap_hdr(struct gsmtap_hdr *gh,
+			    const struct gsmtap_ring_rec *r)
+{
+	memset(gh, 0, sizeof(*gh));
+	gh->version = GSMTAP_VERSION;
+	gh->hdr_len = sizeof(*gh) / 4;
+	gh->type = GSMTAP_TYPE_UM;
+	gh->timeslot = r->tn;
+	gh->sub_slot = r->ss;
+	gh->arfcn = htons(r->arfcn);
+	gh->frame_number = htonl(r->fn);
+	gh->sub_type = r->chan_type;
+}
+
+static void pcap_close(void)
+{
+	if (ring.pcap_fd >= 0) {
+		close(ring.pcap_fd);
+		ring.pcap_fd = -1;
+	}
+}
+
+/* shift path -> path.1 -> ... -> path.<files-1>, the oldest one is lost */
+static void pcap_rotate(void)
+{
+	char from[PATH_MAX], to[PATH_MAX];
+	int i;
+
+	pcap_close();
+
+	for (i = ring.pcap_files - 1; i > 0; i--) {
+		if (i == 1)
+			snprintf(from, sizeof(from), "%s", ring.pcap_path);
+		else
+			snprintf(from, sizeof(from), "%s.%d", ring.pcap_path,
+				 i - 1);
+		snprintf(to, sizeof(to), "%s.%d", ring.pcap_path, i);
+		rename(from, to);
+	}
+}
+
+static time_t now_s(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec;
+}
+
+/* start the back-off, only the first failure in a row is logged */
+static void pcap_fail(const char *op, int err)
+{
+	ring.stats.pcap_fail++;
+	ring.pcap_retry = now_s() + GSMTAP_PCAP_RETRY_S;
+	if (ring.pcap_failed)
+		return;
+	ring.pcap_failed = true;
+	LOGP(DL1P, LOGL_ERROR, "Cannot %s GSMTAP pcap file %s: %s, retrying "
+	     "every %us\n", op, ring.pcap_path, strerror(err),
+	     GSMTAP_PCAP_RETRY_S);
+}
+
+static int pcap_open(void)
+{
+	struct pcap_file_hdr fh = {
+		.magic = 0xa1b2c3d4,
+		.version_major = 2,
+		.version_minor = 4,
+		.snaplen = 65535,
+		.network = PCAP_LINKTYPE_IPV4,
+	};
+
+	int rc;
+
+	ring.pcap_fd = open(ring.pcap_path, O_WRONLY|O_CREAT|O_TRUNC, 0644);
+	if (ring.pcap_fd < 0) {
+		rc = -errno;
+		pcap_fail("open", errno);
+		return rc;
+	}
+	if (write(ring.pcap_fd, &fh, sizeof(fh)) != sizeof(fh)) {
+		pcap_fail("write", errno);
+		pcap_close();
+		return -EIO;
+	}
+	ring.pcap_bytes = sizeof(fh);
+	ring.stats.pcap_files++;
+
+	if (ring.pcap_failed) {
+		LOGP(DL1P, LOGL_NOTICE, "GSMTAP pcap file %s opened\n",
+		     ring.pcap_path);
+		ring.pcap_failed = false;
+	}
+
+	return 0;
+}
+
+/* returns the checksum in network byte order */
+static uint16_t ipv4_csum(const void *buf, unsigned int len)
+{
+	const uint8_t *p = buf;
+	uint32_t sum = 0;
+
+	for (; len > 1; len -= 2, p += 2)
+		sum += (p[0] << 8) | p[1];
+	while (sum >> 16)
+		sum = (sum & 0xffff) + (sum >> 16);
+	return htons(~sum);
+}
+
+static int pcap_write_rec(const struct gsmtap_hdr *gh,
+			  const struct gsmtap_ring_rec *r)
+{
+	unsigned int pkt_len = sizeof(struct ipv4_udp_hdr) + sizeof(*gh)
+				+ r->len;
+	struct pcap_rec_hdr rh = {
+		.ts_sec = r->tv.tv_sec,
+		.ts_usec = r->tv.tv_usec,
+		.incl_len = pkt_len,
+		.orig_len = pkt_len,
+	};
+	struct ipv4_udp_hdr ih = {
+		.ver_ihl = 0x45,
+		.tot_len = htons(pkt_len),
+		.frag_off = htons(0x4000),
+		.ttl = 64,
+		.proto = IPPROTO_UDP,
+		.saddr = htonl(INADDR_LOOPBACK),
+		.daddr = htonl(INADDR_LOOPBACK),
+		.sport = htons(GSMTAP_UDP_PORT),
+		.dport = htons(GSMTAP_UDP_PORT),
+		.len = htons(pkt_len - 20),
+	};
+	struct iovec iov[4] = {
+		{ .iov_base = &rh, .iov_len = sizeof(rh) },
+		{ .iov_base = &ih, .iov_len = sizeof(ih) },
+		{ .iov_base = (void *)gh, .iov_len = sizeof(*gh) },
+		{ .iov_base = (void *)r->data, .iov_len = r->len },
+	};
+	ssize_t rc;
+
+	if (ring.pcap_fd >= 0 &&
+	    ring.pcap_bytes >= (uint64_t)ring.pcap_size_mb * 1024 * 1024)
+		pcap_rotate();
+	if (ring.pcap_fd < 0) {
+		if (ring.pcap_failed && now_s() < ring.pcap_retry)
+			return -EAGAIN;
+		if (pcap_open() < 0)
+			return -EIO;
+	}
+
+	/* checksum over the 20 byte IPv4 header only */
+	ih.csum = ipv4_csum(&ih, 20);
+
+	rc = writev(ring.pcap_fd, iov, ARRAY_SIZE(iov));
+	if (rc != sizeof(rh) + pkt_len) {
+		pcap_fail("write", rc < 0 ? errno : ENOSPC);
+		pcap_close();
+		return -EIO;
+	}
+	ring.pcap_bytes += rc;
+
+	return 0;
+}
+
+static void gsmtap_ring_writer(void *data)
+{
+	uint8_t buf[sizeof(struct gsmtap_hdr) + GSMTAP_RING_DATA_MAX];
+	struct gsmtap_hdr *gh = (struct gsmtap_hdr *) buf;
+	const struct gsmtap_ring_rec *r;
+	unsigned int budget = GSMTAP_RING_BUDGET;
+
+	while (ring.tail != ring.head && budget--) {
+		r = &ring.rec[ring.tail & GSMTAP_RING_MASK];
+		fill_gsmtap_hdr(gh, r);
+
+		if (gsmtap) {
+			memcpy(buf + sizeof(*gh), r->data, r->len);
+			if (send(gsmtap_inst_fd(gsmtap), buf,
+				 sizeof(*gh) + r->len, MSG_DONTWAIT) < 0)
+				ring.stats.send_err++;
+			else
+				ring.stats.sent++;
+		}
+
+		if (ring.pcap_path) {
+			if (pcap_write_rec(gh, r) < 0)
+				ring.stats.pcap_err++;
+			else
+				ring.stats.pcap_written++;
+		}
+
+		ring.tail++;
+	}
+
+	if (ring.tail != ring.head)
+		osmo_timer_schedule(&ring.timer, 0, GSMTAP_RING_PERIOD_US);
+}
+
+int gsmtap_ring_update(void *ctx)
+{
+	gsmtap_ring_active = gsmtap || ring.pcap_path;
+
+	if (!gsmtap_ring_active || ring.rec)
+		return 0;
+
+	ring.rec = talloc_zero_array(ctx, struct gsmtap_ring_rec,
+				     GSMTAP_RING_SIZE);
+	if (!ring.rec) {
+		gsmtap_ring_active = false;
+		return -ENOMEM;
+	}
+	ring.head = ring.tail = 0;
+	ring.timer.cb = gsmtap_ring_writer;
+
+	return 0;
+}
+
+int gsmtap_ring_set_pcap(const char *path)
+{
+	pcap_close();
+	talloc_free(ring.pcap_path);
+	ring.pcap_path = path ? talloc_strdup(tall_bts_ctx, path) : NULL;
+	ring.pcap_failed = false;
+
+	return gsmtap_ring_update(tall_bts_ctx);
+}
+
+void gsmtap_ring_set_pcap_rotate(unsigned int size_mb, unsigned int files)
+{
+	ring.pcap_size_mb = size_mb;
+	ring.pcap_files = files;
+}
+
+const char *gsmtap_ring_get_pcap(void)
+{
+	return ring.pcap_path;
+}
+
+void gsmtap_ring_get_pcap_rotate(unsigned int *size_mb, unsigned int *files)
+{
+	*size_mb = ring.pcap_size_mb;
+	*files = ring.pcap_files;
+}
+
+const struct gsmtap_ring_stats *gsmtap_ring_get_stats(void)
+{
+	return &ring.stats;
+}
+
+void gsmtap_ring_vty_dump(struct vty *vty)
+{
+	const struct gsmtap_ring_stats *st = &ring.stats;
+
+	vty_out(vty, "  GSMTAP tap: %s, %u of %u records queued%s",
+		gsmtap_ring_active ? "active" : "inactive",
+		ring.head - ring.tail, GSMTAP_RING_SIZE, VTY_NEWLINE);
+	vty_out(vty, "    enqueued %u, dropped %u (full) %u (prio) %u (size)%s",
+		st->enqueued, st->dropped_full, st->dropped_prio,
+		st->dropped_size, VTY_NEWLINE);
+	vty_out(vty, "    GSMTAP sent %u, errors %u%s", st->sent, st->send_err,
+		VTY_NEWLINE);
+	if (ring.pcap_path)
+		vty_out(vty, "    pcap %s: written %u, not written %u, "
+			"files %u, failures %u%s%s", ring.pcap_path,
+			st->pcap_written, st->pcap_err, st->pcap_files,
+			st->pcap_fail, ring.pcap_failed ? " (backing off)" : "",
+			VTY_NEWLINE);
+}
@@ -0,0 +1,194 @@
+/* Rate limited logging and binary tracing for hot paths */
+
+/* (C) 2017 by sysmocom s.f.m.c. GmbH
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdint.h>
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+
+#include <osmocom/core/logging.h>
+#include <osmocom/core/utils.h>
+#include <osmocom/vty/vty.h>
+
+#include <osmo-bts/logging.h>
+#include <osmo-bts/hotlog.h>
+
+/* token bucket of one log category, tokens are in 1/1000 messages */
+struct hotlog_bucket {
+	unsigned int rate;
+	int64_t tokens;
+	int64_t last_ms;
+	uint32_t suppressed;		/* since the last summary */
+	uint32_t suppressed_total;
+};
+
+struct hotlog_rec {
+	struct timespec ts;
+	const char *fmt;
+	uint32_t arg[4];
+	uint8_t subsys;
+	uint8_t level;
+};
+
+uint32_t hotlog_trace_mask;
+
+static struct hotlog_bucket buckets[HOTLOG_MAX_CAT] = {
+	[0 ... HOTLOG_MAX_CAT-1] = {
+		.rate = HOTLOG_RATE_DEFAULT,
+		.tokens = HOTLOG_RATE_DEFAULT * 1000,
+	},
+};
+
+static struct {
+	struct hotlog_rec rec[HOTLOG_TRACE_SIZE];
+	unsigned int next;
+	bool wrapped;
+} trace;
+
+static int64_t now_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/*! \brief check whether a hot path message may be logged now
+ *  \param[in] subsys logging category
+ *  \param[in] level log level of the message
+ *  \returns 1 if the message may be printed, 0 if it is suppressed
+ *
+ * The bucket holds up to one second worth of messages.  Once a message is
+ * admitted after others were suppressed, a summary is logged first. */
+int hotlog_admit(int subsys, int level)
+{
+	struct hotlog_bucket *b;
+	uint32_t suppressed;
+	int64_t now;
+
+	if (subsys < 0 || subsys >= HOTLOG_MAX_CAT)
+		return 1;
+	b = &buckets[subsys];
+	if (!b->rate)
+		return 1;
+
+	now = now_ms();
+	b->tokens += (now - b->last_ms) * b->rate;
+	if (b->tokens > b->rate * 1000)
+		b->tokens = b->rate * 1000;
+	b->last_ms = now;
+
+	if (b->tokens < 1000) {
+		b->suppressed++;
+		b->suppressed_total++;
+		return 0;
+	}
+	b->tokens -= 1000;
+
+	if (b->suppressed) {
+		suppressed = b->suppressed;
+		b->suppressed = 0;
+		LOGP(subsys, level, "%u messages suppressed by rate limit\n",
+		     suppressed);
+	}
+
+	return 1;
+}
+
+void hotlog_trace(int subsys, int level, const char *fmt, uint32_t a0,
+		  uint32_t a1, uint32_t a2, uint32_t a3)
+{
+	struct hotlog_rec *r = &trace.rec[trace.next];
+
+	clock_gettime(CLOCK_MONOTONIC, &r->ts);
+	r->fmt = fmt;
+	r->arg[0] = a0;
+	r->arg[1] = a1;
+	r->arg[2] = a2;
+	r->arg[3] = a3;
+	r->subsys = subsys;
+	r->level = level;
+
+	trace.next = (trace.next + 1) & (HOTLOG_TRACE_SIZE - 1);
+	if (trace.next == 0)
+		trace.wrapped = true;
+}
+
+int hotlog_set_rate(int subsys, unsigned int rate)
+{
+	if (subsys < 0 || subsys >= HOTLOG_MAX_CAT)
+		return -EINVAL;
+
+	buckets[subsys].rate = rate;
+	buckets[subsys].tokens = (int64_t)rate * 1000;
+	buckets[subsys].suppressed = 0;
+	return 0;
+}
+
+unsigned int hotlog_get_rate(int subsys)
+{
+	if (subsys < 0 || subsys >= HOTLOG_MAX_CAT)
+		return 0;
+	return buckets[subsys].rate;
+}
+
+uint32_t hotlog_get_suppressed(int subsys)
+{
+	if (subsys < 0 || subsys >= HOTLOG_MAX_CAT)
+		return 0;
+	return buckets[subsys].suppressed_total;
+}
+
+void hotlog_trace_clear(void)
+{
+	trace.next = 0;
+	trace.wrapped = false;
+}
+
+/* print the trace ring, oldest record first */
+void hotlog_vty_dump_trace(struct vty *vty)
+{
+	unsigned int i, idx, num;
+	const struct hotlog_rec *r;
+	const char *name;
+	char line[256];
+	size_t len;
+
+	num = trace.wrapped ? HOTLOG_TRACE_SIZE : trace.next;
+	idx = trace.wrapped ? trace.next : 0;
+
+	for (i = 0; i < num; i++) {
+		r = &trace.rec[(idx + i) & (HOTLOG_TRACE_SIZE - 1)];
+		name = r->subsys < osmo_log_info->num_cat ?
+			osmo_log_info->cat[r->subsys].name : "?";
+		/* the format strings only contain integer conversions,
+		 * surplus arguments are ignored by snprintf() */
+		snprintf(line, sizeof(line), r->fmt, r->arg[0], r->arg[1],
+			 r->arg[2], r->arg[3]);
+		len = strlen(line);
+		if (len && line[len-1] == '\n')
+			line[len-1] = '\0';
+		vty_out(vty, "%5lu.%06lu %s <%u> %s%s",
+			(unsigned long)r->ts.tv_sec,
+			(unsigned long)r->ts.tv_nsec / 1000, name, r->level,
+			line, VTY_NEWLINE);
+	}
+}
@@ -0,0 +1,165 @@
+/* Hardware monitoring helpers of sysmobts-mgr and lc15bts-mgr */
+
+/* (C) 2017 by sysmocom s.f.m.c. GmbH
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <osmocom/core/talloc.h>
+
+#include <osmo-bts/hwmon.h>
+
+static int read_int(int fd, int *val)
+{
+	char buf[16];
+	char *end;
+	ssize_t rc;
+	long l;
+
+	rc = pread(fd, buf, sizeof(buf) - 1, 0);
+	if (rc < 0)
+		return -errno;
+	if (rc == 0)
+		return -EIO;
+	buf[rc] = '\0';
+
+	l = strtol(buf, &end, 10);
+	if (end == buf)
+		return -EINVAL;
+	*val = l;
+	return 0;
+}
+
+int hwmon_read_int(int *fd, const char *path, int *val)
+{
+	int rc;
+
+	if (*fd < 0) {
+		*fd = open(path, O_RDONLY);
+		if (*fd < 0)
+			return -errno;
+	}
+
+	rc = read_int(*fd, val);
+	if (rc < 0 && rc != -EINVAL)
+		hwmon_close(fd);
+	return rc;
+}
+
+void hwmon_close(int *fd)
+{
+	if (*fd < 0)
+		return;
+	close(*fd);
+	*fd = -1;
+}
+
+int hwmon_hist_init(void *ctx, struct hwmon_hist *h, unsigned int len)
+{
+	h->buf = talloc_zero_array(ctx, struct hwmon_sample, len);
+	if (!h->buf)
+		return -ENOMEM;
+	h->len = len;
+	h->head = 0;
+	h->num = 0;
+	return 0;
+}
+
+void hwmon_hist_add(struct hwmon_hist *h, time_t time, int32_t val)
+{
+	if (!h->len)
+		return;
+
+	h->buf[h->head].time = time;
+	h->buf[h->head].val = val;
+	h->head = (h->head + 1) % h->len;
+	if (h->num < h->len)
+		h->num++;
+}
+
+const struct hwmon_sample *hwmon_hist_get(const struct hwmon_hist *h,
+					  unsigned int i)
+{
+	if (i >= h->num)
+		return NULL;
+	return &h->buf[(h->head + h->len - h->num + i) % h->len];
+}
+
+unsigned int hwmon_interval_next(struct hwmon_interval *iv, int near)
+{
+	if (near || !iv->cur)
+		iv->cur = iv->min;
+	else if (iv->cur < iv->max)
+		iv->cur = iv->cur * 2 < iv->max ? iv->cur * 2 : iv->max;
+	return iv->cur;
+}
+
+static int alarm_fd_cb(struct osmo_fd *ofd, unsigned int what)
+{
+	struct hwmon_alarm *alarm = ofd->data;
+	int val;
+
+	/* the read re-arms the notification, it is needed even if the
+	 * value is not of interest */
+	if (read_int(ofd->fd, &val) < 0)
+		return 0;
+	alarm->cb(alarm, val);
+	return 0;
+}
+
+int hwmon_alarm_open(struct hwmon_alarm *alarm, const char *path,
+		     hwmon_alarm_cb *cb, void *data)
+{
+	int val, rc;
+
+	alarm->ofd.fd = open(path, O_RDONLY);
+	if (alarm->ofd.fd < 0)
+		return -errno;
+
+	/* sysfs only notifies readers that read the attribute before */
+	rc = read_int(alarm->ofd.fd, &val);
+	if (rc < 0) {
+		hwmon_close(&alarm->ofd.fd);
+		return rc;
+	}
+
+	alarm->ofd.when = BSC_FD_EXCEPT;
+	alarm->ofd.cb = alarm_fd_cb;
+	alarm->ofd.data = alarm;
+	alarm->cb = cb;
+	alarm->data = data;
+
+	rc = osmo_fd_register(&alarm->ofd);
+	if (rc < 0) {
+		hwmon_close(&alarm->ofd.fd);
+		return rc;
+	}
+	return 0;
+}
+
+void hwmon_alarm_close(struct hwmon_alarm *alarm)
+{
+	if (alarm->ofd.fd < 0)
+		return;
+	osmo_fd_unregister(&alarm->ofd);
+	hwmon_close(&alarm->ofd.fd);
+}
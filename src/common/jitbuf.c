@@ -0,0 +1,289 @@
+/* Downlink RTP jitter buffer for TCH */
+
+/* (C) 2017 by sysmocom s.f.m.c. GmbH
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* The buffer is a ring of JITBUF_NUM_SLOTS speech frame slots.  The slot
+ * of a frame is derived from its RTP timestamp relative to the timestamp
+ * of the frame to be played out next, so insertion, re-ordering and
+ * duplicate detection are O(1).  Gaps in the timestamp sequence are played
+ * out as empty TCH.req, which lets the PHY code generate BFI / repeat the
+ * last SID just like for a queue underrun.
+ *
+ * Playout starts (and re-starts after the buffer ran dry, e.g. during a
+ * DTX pause) once 'depth' frames worth of audio are buffered.  In adaptive
+ * mode, 'depth' grows on every late frame and slowly shrinks back towards
+ * what the measured inter-arrival jitter requires. */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+
+#include <osmocom/core/msgb.h>
+#include <osmocom/core/utils.h>
+
+#include <osmo-bts/gsm_data.h>
+#include <osmo-bts/jitbuf.h>
+
+/* number of played frames without late arrival before shrinking (5s) */
+#define JITBUF_ADAPT_FRAMES	250
+
+/* don't use arrival times further apart than this for jitter estimation */
+#define JITBUF_MAX_ARR_FN	(26 * 50)
+
+static void jitbuf_reset(struct jitbuf *jb)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(jb->slot); i++) {
+		if (jb->slot[i]) {
+			msgb_free(jb->slot[i]);
+			jb->slot[i] = NULL;
+		}
+	}
+	jb->head = 0;
+	jb->fill = 0;
+	jb->running = false;
+}
+
+void jitbuf_set_depth(struct jitbuf *jb, unsigned int depth_ms,
+		      bool adaptive)
+{
+	unsigned int depth = depth_ms / JITBUF_FRAME_MS;
+
+	if (depth < 1)
+		depth = 1;
+	if (depth > JITBUF_NUM_SLOTS / 2)
+		depth = JITBUF_NUM_SLOTS / 2;
+
+	jb->adaptive = adaptive;
+	if (adaptive) {
+		/* configured value is the upper bound, start small */
+		jb->depth_min = 1;
+		jb->depth_max = depth;
+		jb->depth = OSMO_MIN(2, depth);
+	} else
+		jb->depth_min = jb->depth_max = jb->depth = depth;
+
+	if (jb->depth > jb->stats.depth_max)
+		jb->stats.depth_max = jb->depth;
+}
+
+void jitbuf_init(struct jitbuf *jb, unsigned int depth_ms, bool adaptive)
+{
+	jitbuf_reset(jb);
+	memset(jb, 0, sizeof(*jb));
+	jitbuf_set_depth(jb, depth_ms, adaptive);
+}
+
+void jitbuf_flush(struct jitbuf *jb)
+{
+	jitbuf_reset(jb);
+	jb->have_prev = false;
+}
+
+/* offset in frames of 'timestamp' relative to the playout point, rounded */
+static int32_t jitbuf_rel(const struct jitbuf *jb, uint32_t timestamp)
+{
+	int32_t rel_ts = timestamp - jb->play_ts;
+
+	if (rel_ts >= 0)
+		return (rel_ts + JITBUF_FRAME_TS / 2) / JITBUF_FRAME_TS;
+	return -((-rel_ts + JITBUF_FRAME_TS / 2) / JITBUF_FRAME_TS);
+}
+
+/* RFC 3550 A.8 using the TDMA frame number as arrival clock */
+static void jitbuf_update_jitter(struct jitbuf *jb, uint32_t timestamp,
+				 uint32_t arr_fn)
+{
+	uint32_t fn_diff;
+	int32_t d;
+
+	if (!jb->have_prev)
+		goto out;
+
+	fn_diff = (arr_fn + GSM_HYPERFRAME - jb->prev_arr_fn) % GSM_HYPERFRAME;
+	if (fn_diff > JITBUF_MAX_ARR_FN)
+		goto out;
+
+	/* 4.615ms per TDMA frame = 480/13 samples at 8kHz */
+	d = (int32_t)(fn_diff * 480 / 13)
+		- (int32_t)(timestamp - jb->prev_rtp_ts);
+	if (d < 0)
+		d = -d;
+	jb->jitter_q4 += d - ((jb->jitter_q4 + 8) >> 4);
+out:
+	jb->have_prev = true;
+	jb->prev_arr_fn = arr_fn;
+	jb->prev_rtp_ts = timestamp;
+}
+
+static void jitbuf_grow(struct jitbuf *jb)
+{
+	jb->frames_since_late = 0;
+	if (!jb->adaptive || jb->depth >= jb->depth_max)
+		return;
+	jb->depth++;
+	if (jb->depth > jb->stats.depth_max)
+		jb->stats.depth_max = jb->depth;
+}
+
+static void jitbuf_shrink(struct jitbuf *jb)
+{
+	unsigned int target;
+
+	jb->frames_since_late = 0;
+	if (!jb->adaptive)
+		return;
+
+	/* twice the mean deviation covers the bulk of the arrivals */
+	target = 1 + (2 * jitbuf_jitter(jb) + JITBUF_FRAME_TS - 1)
+							/ JITBUF_FRAME_TS;
+	if (target < jb->depth_min)
+		target = jb->depth_min;
+	if (jb->depth > target)
+		jb->depth--;
+}
+
+int jitbuf_put(struct jitbuf *jb, struct msgb *msg, uint32_t timestamp,
+	       uint32_t arr_fn)
+{
+	unsigned int idx;
+	int32_t rel;
+	int i;
+
+	jitbuf_update_jitter(jb, timestamp, arr_fn);
+
+	/* first frame of a talk spurt anchors the playout point */
+	if (!jb->running && jb->fill == 0)
+		jb->play_ts = timestamp;
+
+	rel = jitbuf_rel(jb, timestamp);
+
+	/* sender clock jump (e.g. SSRC change): start from scratch */
+	if (rel >= 2 * JITBUF_NUM_SLOTS || rel <= -JITBUF_NUM_SLOTS) {
+		jitbuf_reset(jb);
+		jb->play_ts = timestamp;
+		jb->stats.resync++;
+		rel = 0;
+	}
+
+	if (rel < 0) {
+		/* still prefilling: move the playout point back if the
+		 * slots in front of the head are free */
+		if (!jb->running) {
+			for (i = rel; i < 0; i++) {
+				if (jb->slot[(jb->head + i) & JITBUF_SLOT_MASK])
+					break;
+			}
+			if (i == 0) {
+				jb->head = (jb->head + rel) & JITBUF_SLOT_MASK;
+				jb->play_ts += rel * JITBUF_FRAME_TS;
+				rel = 0;
+			}
+		}
+		if (rel < 0) {
+			jb->stats.late++;
+			jitbuf_grow(jb);
+			msgb_free(msg);
+			return -ETIME;
+		}
+	}
+
+	/* no room: drop the oldest frames to catch up */
+	while (rel >= JITBUF_NUM_SLOTS) {
+		if (jb->slot[jb->head]) {
+			msgb_free(jb->slot[jb->head]);
+			jb->slot[jb->head] = NULL;
+			jb->fill--;
+			jb->stats.overflow++;
+		}
+		jb->head = (jb->head + 1) & JITBUF_SLOT_MASK;
+		jb->play_ts += JITBUF_FRAME_TS;
+		rel--;
+	}
+
+	idx = (jb->head + rel) & JITBUF_SLOT_MASK;
+	if (jb->slot[idx]) {
+		jb->stats.dup++;
+		msgb_free(msg);
+		return -EEXIST;
+	}
+
+	jb->slot[idx] = msg;
+	jb->fill++;
+	jb->stats.frames_in++;
+
+	return 0;
+}
+
+/* number of frames between playout point and newest buffered frame */
+static unsigned int jitbuf_span(const struct jitbuf *jb)
+{
+	int i;
+
+	for (i = JITBUF_NUM_SLOTS - 1; i >= 0; i--) {
+		if (jb->slot[(jb->head + i) & JITBUF_SLOT_MASK])
+			return i + 1;
+	}
+	return 0;
+}
+
+struct msgb *jitbuf_get(struct jitbuf *jb)
+{
+	struct msgb *msg;
+
+	if (!jb->running) {
+		if (jb->fill == 0 || jitbuf_span(jb) < jb->depth)
+			return NULL;
+		jb->running = true;
+	}
+
+	jb->stats.fill_sum += jb->fill;
+
+	msg = jb->slot[jb->head];
+	jb->slot[jb->head] = NULL;
+	jb->head = (jb->head + 1) & JITBUF_SLOT_MASK;
+	jb->play_ts += JITBUF_FRAME_TS;
+
+	if (msg) {
+		jb->fill--;
+		jb->stats.frames_out++;
+	} else if (jb->fill) {
+		/* later frames are there, this one is lost or late */
+		jb->stats.lost++;
+	} else {
+		/* ran dry (DTX pause or starvation), prefill again */
+		jb->stats.underrun++;
+		jb->running = false;
+	}
+
+	if (++jb->frames_since_late >= JITBUF_ADAPT_FRAMES)
+		jitbuf_shrink(jb);
+
+	return msg;
+}
+
+uint32_t jitbuf_avg_delay_ms(const struct jitbuf *jb)
+{
+	if (!jb->stats.frames_out)
+		return 0;
+	return jb->stats.fill_sum * JITBUF_FRAME_MS / jb->stats.frames_out;
+}
@@ -49,11 +49,15 @@
 #include <osmo-bts/handover.h>
 #include <osmo-bts/power_control.h>
 #include <osmo-bts/msg_utils.h>
+#include <osmo-bts/jitbuf.h>
+#include <osmo-bts/rtp_batch.h>
+#include <osmo-bts/hotlog.h>
+#include <osmo-bts/gsmtap_ring.h>
 
 struct gsm_lchan *get_lchan_by_chan_nr(struct gsm_bts_trx *trx,
 				       unsigned int chan_nr)
 {
-	return &trx->ts[L1SAP_CHAN2TS(chan_nr)].lchan[l1sap_chan2ss(chan_nr)];
+	return trx_chan_nr_map(trx, chan_nr)->lchan;
 }
 
 static struct gsm_lchan *
@@ -308,7 +312,7 @@ static int to_gsmtap(struct gsm_bts_trx *trx, struct osmo_phsap_prim *l1sap)
 	uint16_t uplink = GSMTAP_ARFCN_F_UPLINK;
 	int rc;
 
-	if (!gsmtap)
+	if (!gsmtap_ring_active)
 		return 0;
 
 	switch (OSMO_PRIM_HDR(&l1sap->oph)) {
@@ -346,8 +350,9 @@ static int to_gsmtap(struct gsm_bts_trx *trx, struct osmo_phsap_prim *l1sap)
 			return 0;
 	}
 
-	gsmtap_send(gsmtap, trx->arfcn | uplink, tn, chan_type, ss, fn, 0, 0,
-		data, len);
+	/* GSMTAP header and send() are done later by the tap writer */
+	gsmtap_ring_enqueue(trx->arfcn | uplink, tn, chan_type, ss, fn,
+			    data, len);
 
 	return 0;
 }
@@ -413,16 +418,24 @@ static int l1sap_info_time_ind(struct gsm_bts *bts,
 		     "Invalid condition detected: Frame difference is > 1!\n");
 	}
 
+	/* Send the uplink RTP frames collected in the last TDMA frame */
+	rtp_batch_flush(btsb->rtp_batch);
+	/* and the CHAN RQDs for its RR access bursts */
+	l1sap_rach_flush(bts);
+
 	/* Update our data structures with the current GSM time */
 	gsm_fn2gsmtime(&btsb->gsm_time, info_time_ind->fn);
 
 	/* Update time on PCU interface */
-	pcu_tx_time_ind(info_time_ind->fn);
+	pcu_tx_time_ind(bts, info_time_ind->fn);
 
 	/* check if the measurement period of some lchan has ended
-	 * and pre-compute the respective measurement */
-	llist_for_each_entry(trx, &bts->trx_list, list)
-	    trx_meas_check_compute(trx, info_time_ind->fn - 1);
+	 * and pre-compute the respective measurement, make due power
+	 * ramp steps */
+	llist_for_each_entry(trx, &bts->trx_list, list) {
+		trx_meas_check_compute(trx, info_time_ind->fn - 1);
+		power_ramp_fn_tick(trx, info_time_ind->fn);
+	}
 
 	/* increment number of RACH slots that have passed by since the
 	 * last time indication */
@@ -584,8 +597,11 @@ static int l1sap_ph_rts_ind(struct gsm_bts_trx *trx,
 
 	gsm_fn2gsmtime(&g_time, fn);
 
-	DEBUGP(DL1P, "Rx PH-RTS.ind %02u/%02u/%02u chan_nr=%d link_id=%d\n",
-		g_time.t1, g_time.t2, g_time.t3, chan_nr, link_id);
+	HOTTRACE(DL1P, LOGL_DEBUG, "Rx PH-RTS.ind fn=%u chan_nr=%d "
+		 "link_id=%d\n", fn, chan_nr, link_id, 0);
+	LOGP_HOT(DL1P, LOGL_DEBUG, "Rx PH-RTS.ind %02u/%02u/%02u chan_nr=%d "
+		 "link_id=%d\n", g_time.t1, g_time.t2, g_time.t3, chan_nr,
+		 link_id);
 
 	if (ts_is_pdch(&trx->ts[tn])) {
 		if (L1SAP_IS_PTCCH(rts_ind->fn)) {
@@ -673,8 +689,9 @@ static int l1sap_ph_rts_ind(struct gsm_bts_trx *trx,
 			memcpy(p, fill_frame, GSM_MACBLOCK_LEN);
 	}
 
-	DEBUGP(DL1P, "Tx PH-DATA.req %02u/%02u/%02u chan_nr=%d link_id=%d\n",
-		g_time.t1, g_time.t2, g_time.t3, chan_nr, link_id);
+	LOGP_HOT(DL1P, LOGL_DEBUG, "Tx PH-DATA.req %02u/%02u/%02u chan_nr=%d "
+		 "link_id=%d\n", g_time.t1, g_time.t2, g_time.t3, chan_nr,
+		 link_id);
 
 	l1sap_down(trx, l1sap);
 
@@ -682,6 +699,94 @@ static int l1sap_ph_rts_ind(struct gsm_bts_trx *trx,
 	return 1;
 }
 
+/* send the CHAN RQDs for the RR access bursts collected in one TDMA frame */
+void l1sap_rach_flush(struct gsm_bts *bts)
+{
+	struct gsm_bts_role_bts *btsb = bts_role_bts(bts);
+	struct gsm_time gtime;
+	unsigned int i;
+
+	if (!btsb->rach_batch.num)
+		return;
+
+	gsm_fn2gsmtime(&gtime, btsb->rach_batch.fn);
+	for (i = 0; i < btsb->rach_batch.num; i++)
+		rsl_tx_chan_rqd(btsb->rach_batch.req[i].trx, &gtime,
+				btsb->rach_batch.req[i].ra,
+				btsb->rach_batch.req[i].acc_delay);
+
+	btsb->rach_batch.stats.sent += btsb->rach_batch.num;
+	btsb->rach_batch.stats.batches++;
+	btsb->rach_batch.num = 0;
+}
+
+/* should an RR access burst be turned away before it reaches the BSC? */
+static bool rach_reject(struct gsm_bts_role_bts *btsb, uint32_t fn)
+{
+	uint32_t mf = fn / 51;
+
+	if (mf != btsb->rach_batch.mf) {
+		btsb->rach_batch.mf = mf;
+		btsb->rach_batch.mf_admitted = 0;
+	}
+
+	/* the BSC answers with IMM ASS on the AGCH, if that queue is
+	 * already close to its limit, the answer would be dropped anyway */
+	if (btsb->rach_batch.agch_reject && btsb->agch_max_queue_length &&
+	    btsb->agch_queue_length * 100 >=
+	    btsb->agch_max_queue_length * btsb->rach_batch.agch_reject) {
+		btsb->rach_batch.stats.rejected_load++;
+		return true;
+	}
+
+	if (btsb->rach_batch.max_per_mf &&
+	    btsb->rach_batch.mf_admitted >= btsb->rach_batch.max_per_mf) {
+		btsb->rach_batch.stats.rejected_limit++;
+		return true;
+	}
+
+	return false;
+}
+
+static void l1sap_rach_enqueue(struct gsm_bts_trx *trx,
+			       struct ph_rach_ind_param *rach_ind)
+{
+	struct gsm_bts_role_bts *btsb = bts_role_bts(trx->bts);
+	unsigned int i;
+
+	btsb->rach_batch.stats.received++;
+
+	if (btsb->rach_batch.num && btsb->rach_batch.fn != rach_ind->fn)
+		l1sap_rach_flush(trx->bts);
+
+	/* some PHYs report the same burst more than once, the same RA on
+	 * another timeslot (CCCH on TS2/4/6) is a different burst */
+	for (i = 0; i < btsb->rach_batch.num; i++) {
+		if (btsb->rach_batch.req[i].trx == trx &&
+		    btsb->rach_batch.req[i].chan_nr == rach_ind->chan_nr &&
+		    btsb->rach_batch.req[i].ra == rach_ind->ra) {
+			btsb->rach_batch.stats.duplicate++;
+			return;
+		}
+	}
+
+	if (rach_reject(btsb, rach_ind->fn))
+		return;
+
+	if (btsb->rach_batch.num == RACH_BATCH_MAX)
+		l1sap_rach_flush(trx->bts);
+
+	btsb->rach_batch.fn = rach_ind->fn;
+	btsb->rach_batch.req[btsb->rach_batch.num].trx = trx;
+	btsb->rach_batch.req[btsb->rach_batch.num].chan_nr =
+							rach_ind->chan_nr;
+	btsb->rach_batch.req[btsb->rach_batch.num].ra = rach_ind->ra;
+	btsb->rach_batch.req[btsb->rach_batch.num].acc_delay =
+							rach_ind->acc_delay;
+	btsb->rach_batch.num++;
+	btsb->rach_batch.mf_admitted++;
+}
+
 static int check_acc_delay(struct ph_rach_ind_param *rach_ind,
 	struct gsm_bts_role_bts *btsb, uint8_t *acc_delay)
 {
@@ -727,18 +832,12 @@ static int l1sap_tch_rts_ind(struct gsm_bts_trx *trx,
 	if (!lchan)
 		return 0;
 
-	if (!lchan->loopback && lchan->abis_ip.rtp_socket) {
-		osmo_rtp_socket_poll(lchan->abis_ip.rtp_socket);
-		/* FIXME: we _assume_ that we never miss TDMA
-		 * frames and that we always get to this point
-		 * for every to-be-transmitted voice frame.  A
-		 * better solution would be to compute
-		 * rx_user_ts based on how many TDMA frames have
-		 * elapsed since the last call */
-		lchan->abis_ip.rtp_socket->rx_user_ts += GSM_RTP_DURATION;
-	}
-	/* get a msgb from the dl_tx_queue */
-	resp_msg = msgb_dequeue(&lchan->dl_tch_queue);
+	/* get a msgb from the jitter buffer, or from the dl_tx_queue
+	 * in case of loopback */
+	if (!lchan->loopback && lchan->abis_ip.rtp_socket)
+		resp_msg = jitbuf_get(&lchan_role_bts(lchan)->jitbuf);
+	else
+		resp_msg = msgb_dequeue(&lchan->dl_tch_queue);
 	if (!resp_msg) {
 		LOGP(DL1P, LOGL_DEBUG, "%s DL TCH Tx queue underrun\n",
 			gsm_lchan_name(lchan));
@@ -920,7 +1019,8 @@ static int l1sap_ph_data_ind(struct gsm_bts_trx *trx,
 		lchan->meas.l1_info[1] = data[1];
 		lchan->meas.flags |= LC_UL_M_F_L1_VALID;
 
-		lchan_ms_pwr_ctrl(lchan, data[0] & 0x1f, data_ind->rssi);
+		lchan_ms_pwr_ctrl(lchan, data[0] & 0x1f, data_ind->rssi,
+				  ber10k_to_rxqual(data_ind->ber10k));
 	} else
 		le = &lchan->lapdm_ch.lapdm_dcch;
 
@@ -941,6 +1041,7 @@ static int l1sap_tch_ind(struct gsm_bts_trx *trx, struct osmo_phsap_prim *l1sap,
 	struct ph_tch_param *tch_ind)
 {
 	struct msgb *msg = l1sap->oph.msg;
+	struct gsm_bts_role_bts *btsb = bts_role_bts(trx->bts);
 	struct gsm_time g_time;
 	struct gsm_lchan *lchan;
 	uint8_t  chan_nr;
@@ -960,10 +1061,17 @@ static int l1sap_tch_ind(struct gsm_bts_trx *trx, struct osmo_phsap_prim *l1sap,
 
 	msgb_pull(msg, sizeof(*l1sap));
 
-	/* hand msg to RTP code for transmission */
-	if (lchan->abis_ip.rtp_socket)
-		osmo_rtp_send_frame_ext(lchan->abis_ip.rtp_socket,
-			msg->data, msg->len, fn_ms_adj(fn, lchan), lchan->rtp_tx_marker);
+	/* hand msg to RTP code for transmission, or queue it for the
+	 * batched transmission at the next TDMA frame */
+	if (lchan->abis_ip.rtp_socket) {
+		if (btsb->rtp_batch)
+			rtp_batch_enqueue(btsb->rtp_batch, lchan, msg->data,
+					  msg->len, fn_ms_adj(fn, lchan),
+					  lchan->rtp_tx_marker);
+		else
+			osmo_rtp_send_frame_ext(lchan->abis_ip.rtp_socket,
+				msg->data, msg->len, fn_ms_adj(fn, lchan), lchan->rtp_tx_marker);
+	}
 
 	/* if loopback is enabled, also queue received RTP data */
 	if (lchan->loopback) {
@@ -996,13 +1104,10 @@ static int l1sap_ph_rach_ind(struct gsm_bts_trx *trx,
 {
 	struct gsm_bts *bts = trx->bts;
 	struct gsm_bts_role_bts *btsb = bts->role;
-	struct lapdm_channel *lc;
 	uint8_t acc_delay;
 
 	DEBUGP(DL1P, "Rx PH-RA.ind");
 
-	lc = &trx->ts[0].lchan[CCCH_LCHAN].lapdm_ch;
-
 	/* check for under/overflow / sign */
 	if (!check_acc_delay(rach_ind, btsb, &acc_delay)) {
 		LOGP(DL1C, LOGL_INFO, "ignoring RACH request %u > max_ta(%u)\n",
@@ -1027,7 +1132,7 @@ static int l1sap_ph_rach_ind(struct gsm_bts_trx *trx,
 
 	LOGP(DL1P, LOGL_INFO, "RACH for RR access (toa=%d, ra=%d)\n",
 		rach_ind->acc_delay, rach_ind->ra);
-	lapdm_phsap_up(&l1sap->oph, &lc->lapdm_dcch);
+	l1sap_rach_enqueue(trx, rach_ind);
 
 	return 0;
 }
@@ -1122,9 +1227,10 @@ void l1sap_rtp_rx_cb(struct osmo_rtp_socket *rs, const uint8_t *rtp_pl,
 		     uint32_t timestamp, bool marker)
 {
 	struct gsm_lchan *lchan = rs->priv;
-	struct msgb *msg, *tmp;
+	struct gsm_bts_role_bts *btsb = bts_role_bts(lchan->ts->trx->bts);
+	struct msgb *msg;
 	struct osmo_phsap_prim *l1sap;
-	int count = 0;
+	int rc;
 
 	msg = l1sap_msgb_alloc(rtp_pl_len);
 	if (!msg)
@@ -1139,16 +1245,14 @@ void l1sap_rtp_rx_cb(struct osmo_rtp_socket *rs, const uint8_t *rtp_pl,
 	/* Store RTP header Timestamp in control buffer */
 	rtpmsg_ts(msg) = timestamp;
 
-	/* make sure the queue doesn't get too long */
-	llist_for_each_entry(tmp, &lchan->dl_tch_queue, list)
-	count++;
-	while (count >= 2) {
-		tmp = msgb_dequeue(&lchan->dl_tch_queue);
-		msgb_free(tmp);
-		count--;
-	}
-
-	msgb_enqueue(&lchan->dl_tch_queue, msg);
+	/* re-order and de-jitter by RTP timestamp, using the current
+	 * TDMA frame number as arrival time */
+	rc = jitbuf_put(&lchan_role_bts(lchan)->jitbuf, msg, timestamp,
+			btsb->gsm_time.fn);
+	if (rc < 0)
+		DEBUGP(DRTP, "%s RTP frame seq=%u ts=%u dropped: %s\n",
+		       gsm_lchan_name(lchan), seq_number, timestamp,
+		       rc == -ETIME ? "late" : "duplicate");
 }
 
 static int l1sap_chan_act_dact_modify(struct gsm_bts_trx *trx, uint8_t chan_nr,
@@ -22,6 +22,7 @@
 #include <osmocom/core/logging.h>
 #include <osmo-bts/logging.h>
 #include <osmo-bts/gsm_data.h>
+#include <osmo-bts/l1sap.h>
 
 void lchan_set_state(struct gsm_lchan *lchan, enum gsm_lchan_state state)
 {
@@ -32,6 +33,29 @@ void lchan_set_state(struct gsm_lchan *lchan, enum gsm_lchan_state state)
 	lchan->state = state;
 }
 
+void ts_chan_nr_map_update(struct gsm_bts_trx_ts *ts)
+{
+	unsigned int cbits;
+	int rc;
+
+	for (cbits = 0; cbits < 0x20; cbits++) {
+		uint8_t chan_nr = (cbits << 3) | ts->nr;
+		struct chan_nr_map *e = trx_chan_nr_map(ts->trx, chan_nr);
+
+		e->ss = l1sap_chan2ss(chan_nr);
+		e->lchan = &ts->lchan[e->ss];
+
+		/* where RSL knows the chan_nr, it resolves to the same lchan
+		 * as L1SAP does, only the verdict needs to be kept */
+		if (!rsl_lchan_lookup(ts->trx, chan_nr, &rc))
+			e->rsl = CHAN_NR_RSL_UNKNOWN;
+		else if (rc < 0)
+			e->rsl = CHAN_NR_RSL_MISMATCH;
+		else
+			e->rsl = CHAN_NR_RSL_OK;
+	}
+}
+
 bool ts_is_pdch(const struct gsm_bts_trx_ts *ts)
 {
 	switch (ts->pchan) {
@@ -34,6 +34,8 @@ static void reset_load_counters(struct gsm_bts *bts)
 
 	/* re-set the counters */
 	btsb->load.ccch.pch_used = btsb->load.ccch.pch_total = 0;
+	btsb->load.rach.total = btsb->load.rach.busy = 0;
+	btsb->load.rach.access = 0;
 }
 
 static void load_timer_cb(void *data)
@@ -50,6 +50,8 @@
 #include <osmo-bts/bts_model.h>
 #include <osmo-bts/pcu_if.h>
 #include <osmo-bts/control_if.h>
+#include <osmo-bts/gsmtap_ring.h>
+#include <osmo-bts/bringup.h>
 #include <osmocom/ctrl/control_if.h>
 #include <osmocom/ctrl/ports.h>
 #include <osmocom/ctrl/control_vty.h>
@@ -236,6 +238,8 @@ int bts_main(int argc, char **argv)
 
 	printf("((*))\n  |\n / \\ OsmoBTS\n");
 
+	bringup_init();
+
 	tall_bts_ctx = talloc_named_const(NULL, 1, "OsmoBTS context");
 	msgb_talloc_ctx_init(tall_bts_ctx, 100*1024);
 
@@ -283,20 +287,24 @@ int bts_main(int argc, char **argv)
 		gsmtap_source_add_sink(gsmtap);
 	}
 
+	bringup_begin("bts_init", -1, -1);
 	if (bts_init(bts) < 0) {
 		fprintf(stderr, "unable to open bts\n");
 		exit(1);
 	}
+	bringup_end("bts_init", -1, -1);
 	btsb = bts_role_bts(bts);
 
 	abis_init(bts);
 
+	bringup_begin("config", -1, -1);
 	rc = vty_read_config_file(config_file, NULL);
 	if (rc < 0) {
 		fprintf(stderr, "Failed to parse the config file: '%s'\n",
 			config_file);
 		exit(1);
 	}
+	bringup_end("config", -1, -1);
 
 	if (!phy_link_by_num(0)) {
 		fprintf(stderr, "You need to configure at least phy0\n");
@@ -322,7 +330,13 @@ int bts_main(int argc, char **argv)
 		exit(1);
 	}
 
-	if (pcu_sock_init(btsb->pcu.sock_path)) {
+	/* GSMTAP from the command line and/or a pcap file from the config */
+	if (gsmtap_ring_update(tall_bts_ctx) < 0) {
+		fprintf(stderr, "Failed to allocate GSMTAP tap ring\n");
+		exit(1);
+	}
+
+	if (pcu_sock_init(bts, btsb->pcu.sock_path)) {
 		fprintf(stderr, "PCU L1 socket failed\n");
 		exit(1);
 	}
@@ -338,17 +352,21 @@ int bts_main(int argc, char **argv)
 		exit(1);
 	}
 
+	/* ends when the OML link is up */
+	bringup_begin("oml_connect", -1, -1);
 	line = abis_open(bts, btsb->bsc_oml_host, "sysmoBTS");
 	if (!line) {
 		fprintf(stderr, "unable to connect to BSC\n");
 		exit(2);
 	}
 
+	bringup_begin("phy_links_open", -1, -1);
 	rc = phy_links_open();
 	if (rc < 0) {
 		fprintf(stderr, "unable ot open PHY link(s)\n");
 		exit(2);
 	}
+	bringup_end("phy_links_open", -1, -1);
 
 	if (daemonize) {
 		rc = osmo_daemonize();
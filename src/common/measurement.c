@@ -1,6 +1,7 @@
 
 #include <stdint.h>
 #include <errno.h>
+#include <string.h>
 
 #include <osmocom/gsm/gsm_utils.h>
 
@@ -9,88 +10,31 @@
 #include <osmo-bts/measurement.h>
 
 /* TS 05.08, Chapter 8.4.1 */
-/* measurement period ends at fn % 104 == ? */
-static const uint8_t tchf_meas_rep_fn104[] = {
-	[0] =	103,
-	[1] =	12,
-	[2] =	25,
-	[3] =	38,
-	[4] =	51,
-	[5] =	64,
-	[6] =	77,
-	[7] =	90,
+/* timeslots whose measurement period ends at a given fn % 104, as bit mask */
+struct meas_end {
+	uint8_t tchf;
+	uint8_t tchh0;	/* TCH/H subchannel 0 */
+	uint8_t tchh1;	/* TCH/H subchannel 1 */
 };
-static const uint8_t tchh0_meas_rep_fn104[] = {
-	[0] =	103,
-	[1] =	103,
-	[2] =	25,
-	[3] =	25,
-	[4] =	51,
-	[5] =	51,
-	[6] =	77,
-	[7] =	77,
+static const struct meas_end meas_end_fn104[104] = {
+	[103] =	{ .tchf = 0x01, .tchh0 = 0x03 },
+	[12] =	{ .tchf = 0x02, .tchh1 = 0x03 },
+	[25] =	{ .tchf = 0x04, .tchh0 = 0x0c },
+	[38] =	{ .tchf = 0x08, .tchh1 = 0x0c },
+	[51] =	{ .tchf = 0x10, .tchh0 = 0x30 },
+	[64] =	{ .tchf = 0x20, .tchh1 = 0x30 },
+	[77] =	{ .tchf = 0x40, .tchh0 = 0xc0 },
+	[90] =	{ .tchf = 0x80, .tchh1 = 0xc0 },
 };
-static const uint8_t tchh1_meas_rep_fn104[] = {
-	[0] =	12,
-	[1] =	12,
-	[2] =	38,
-	[3] =	38,
-	[4] =	64,
-	[5] =	64,
-	[6] =	90,
-	[7] =	90,
-};
-
-/* determine if a measurement period ends at the given frame number */
-static int is_meas_complete(enum gsm_phys_chan_config pchan, unsigned int ts,
-			    unsigned int subch, uint32_t fn)
-{
-	unsigned int fn_mod;
-	const uint8_t *tbl;
-	int rc = 0;
-
-	if (ts >= 8)
-		return -EINVAL;
-	if (pchan >= _GSM_PCHAN_MAX)
-		return -EINVAL;
-
-	switch (pchan) {
-	case GSM_PCHAN_TCH_F:
-		fn_mod = fn % 104;
-		if (tchf_meas_rep_fn104[ts] == fn_mod)
-			rc = 1;
-		break;
-	case GSM_PCHAN_TCH_H:
-		fn_mod = fn % 104;
-		if (subch == 0)	
-			tbl = tchh0_meas_rep_fn104;
-		else
-			tbl = tchh1_meas_rep_fn104;
-		if (tbl[ts] == fn_mod)
-			rc = 1;
-		break;
-	case GSM_PCHAN_SDCCH8_SACCH8C:
-	case GSM_PCHAN_SDCCH8_SACCH8C_CBCH:
-		fn_mod = fn % 102;
-		if (fn_mod == 11)
-			rc = 1;
-		break;
-	case GSM_PCHAN_CCCH_SDCCH4:
-	case GSM_PCHAN_CCCH_SDCCH4_CBCH:
-		fn_mod = fn % 102;
-		if (fn_mod == 36)
-			rc = 1;
-		break;
-	default:
-		rc = 0;
-		break;
-	}
-	return rc;
-}
+/* SDCCH periods end at the same fn % 102 on all timeslots */
+#define SDCCH8_MEAS_END_FN102	11
+#define SDCCH4_MEAS_END_FN102	36
 
 /* receive a L1 uplink measurement from L1 */
 int lchan_new_ul_meas(struct gsm_lchan *lchan, struct bts_ul_meas *ulm)
 {
+	struct lchan_ul_meas_sum *sum = &lchan_role_bts(lchan)->ul_meas;
+
 	DEBUGP(DMEAS, "%s adding measurement, num_ul_meas=%d\n",
 		gsm_lchan_name(lchan), lchan->meas.num_ul_meas);
 
@@ -105,14 +49,21 @@ int lchan_new_ul_meas(struct gsm_lchan *lchan, struct bts_ul_meas *ulm)
 		return -ENOSPC;
 	}
 
-	memcpy(&lchan->meas.uplink[lchan->meas.num_ul_meas++], ulm,
-		sizeof(*ulm));
+	sum->ber_full += ulm->ber10k;
+	sum->irssi_full += ulm->inv_rssi;
+	sum->taqb += ulm->ta_offs_qbits;
+	if (ulm->is_sub) {
+		sum->num_sub++;
+		sum->ber_sub += ulm->ber10k;
+		sum->irssi_sub += ulm->inv_rssi;
+	}
+	lchan->meas.num_ul_meas++;
 
 	return 0;
 }
 
 /* input: BER in steps of .01%, i.e. percent/100 */
-static uint8_t ber10k_to_rxqual(uint32_t ber10k)
+uint8_t ber10k_to_rxqual(uint32_t ber10k)
 {
 	/* 05.08 / 8.2.4 */
 	if (ber10k < 20)
@@ -132,107 +83,111 @@ static uint8_t ber10k_to_rxqual(uint32_t ber10k)
 	return 7;
 }
 
-static int lchan_meas_check_compute(struct gsm_lchan *lchan, uint32_t fn)
+static int lchan_meas_compute(struct gsm_lchan *lchan)
 {
+	struct lchan_ul_meas_sum *sum = &lchan_role_bts(lchan)->ul_meas;
 	struct gsm_meas_rep_unidir *mru;
-	uint32_t ber_full_sum = 0;
-	uint32_t irssi_full_sum = 0;
-	uint32_t ber_sub_sum = 0;
-	uint32_t irssi_sub_sum = 0;
-	int32_t taqb_sum = 0;
-	unsigned int num_meas_sub = 0;
-	int i;
-
-	/* if measurement period is not complete, abort */
-	if (!is_meas_complete(ts_pchan(lchan->ts), lchan->ts->nr,
-			      lchan->nr, fn))
-		return 0;
+	unsigned int num = lchan->meas.num_ul_meas;
+	uint32_t ber_full, irssi_full;
+	uint32_t ber_sub = 0, irssi_sub = 0;
+	int32_t taqb;
 
 	/* if there are no measurements, skip computation */
-	if (lchan->meas.num_ul_meas == 0)
+	if (num == 0)
 		return 0;
 
-	/* compute the actual measurements */
-
-	/* step 1: add up */
-	for (i = 0; i < lchan->meas.num_ul_meas; i++) {
-		struct bts_ul_meas *m = &lchan->meas.uplink[i];
-
-		ber_full_sum += m->ber10k;
-		irssi_full_sum += m->inv_rssi;
-		taqb_sum += m->ta_offs_qbits;
+	/* the sums were kept up to date by lchan_new_ul_meas(), divide */
+	ber_full = sum->ber_full / num;
+	irssi_full = sum->irssi_full / num;
+	taqb = sum->taqb / (int32_t)num;
 
-		if (m->is_sub) {
-			num_meas_sub++;
-			ber_sub_sum += m->ber10k;
-			irssi_sub_sum += m->inv_rssi;
-		}
-	}
-
-	/* step 2: divide */
-	ber_full_sum = ber_full_sum / lchan->meas.num_ul_meas;
-	irssi_full_sum = irssi_full_sum / lchan->meas.num_ul_meas;
-	taqb_sum = taqb_sum / lchan->meas.num_ul_meas;
-
-	if (num_meas_sub) {
-		ber_sub_sum = ber_sub_sum / num_meas_sub;
-		irssi_sub_sum = irssi_sub_sum / num_meas_sub;
+	if (sum->num_sub) {
+		ber_sub = sum->ber_sub / sum->num_sub;
+		irssi_sub = sum->irssi_sub / sum->num_sub;
 	}
 
 	DEBUGP(DMEAS, "%s Computed TA(% 4dqb) BER-FULL(%2u.%02u%%), RSSI-FULL(-%3udBm), "
 		"BER-SUB(%2u.%02u%%), RSSI-SUB(-%3udBm)\n", gsm_lchan_name(lchan),
-		taqb_sum, ber_full_sum/100,
-		ber_full_sum%100, irssi_full_sum, ber_sub_sum/100, ber_sub_sum%100,
-		irssi_sub_sum);
+		taqb, ber_full/100,
+		ber_full%100, irssi_full, ber_sub/100, ber_sub%100,
+		irssi_sub);
 
 	/* store results */
 	mru = &lchan->meas.ul_res;
-	mru->full.rx_lev = dbm2rxlev((int)irssi_full_sum * -1);
-	mru->sub.rx_lev = dbm2rxlev((int)irssi_sub_sum * -1);
-	mru->full.rx_qual = ber10k_to_rxqual(ber_full_sum);
-	mru->sub.rx_qual = ber10k_to_rxqual(ber_sub_sum);
+	mru->full.rx_lev = dbm2rxlev((int)irssi_full * -1);
+	mru->sub.rx_lev = dbm2rxlev((int)irssi_sub * -1);
+	mru->full.rx_qual = ber10k_to_rxqual(ber_full);
+	mru->sub.rx_qual = ber10k_to_rxqual(ber_sub);
 
 	lchan->meas.flags |= LC_UL_M_F_RES_VALID;
 	lchan->meas.num_ul_meas = 0;
+	memset(sum, 0, sizeof(*sum));
 
 	/* send a signal indicating computation is complete */
 
 	return 1;
 }
 
-static int ts_meas_check_compute(struct gsm_bts_trx_ts *ts, uint32_t fn)
+static void lchan_meas_check_compute(struct gsm_lchan *lchan)
 {
-	int i;
-	const int num_subslots = ts_subslots(ts);
-
-	for (i = 0; i < num_subslots; ++i) {
-		struct gsm_lchan *lchan = &ts->lchan[i];
-
-		if (lchan->state != LCHAN_S_ACTIVE)
-			continue;
-
-		switch (lchan->type) {
-		case GSM_LCHAN_SDCCH:
-		case GSM_LCHAN_TCH_F:
-		case GSM_LCHAN_TCH_H:
-		case GSM_LCHAN_PDTCH:
-			lchan_meas_check_compute(lchan, fn);
-			break;
-		default:
-			break;
-		}
+	if (lchan->state != LCHAN_S_ACTIVE)
+		return;
+
+	switch (lchan->type) {
+	case GSM_LCHAN_SDCCH:
+	case GSM_LCHAN_TCH_F:
+	case GSM_LCHAN_TCH_H:
+	case GSM_LCHAN_PDTCH:
+		lchan_meas_compute(lchan);
+		break;
+	default:
+		break;
 	}
-	return 0;
 }
 
 /* needs to be called once every TDMA frame ! */
 int trx_meas_check_compute(struct gsm_bts_trx *trx, uint32_t fn)
 {
-	int i;
+	const struct meas_end *me = &meas_end_fn104[fn % 104];
+	unsigned int fn102 = fn % 102;
+	int i, k;
+
+	/* in most frames no measurement period ends at all */
+	if (!me->tchf && fn102 != SDCCH8_MEAS_END_FN102 &&
+	    fn102 != SDCCH4_MEAS_END_FN102)
+		return 0;
 
 	for (i = 0; i < ARRAY_SIZE(trx->ts); i++) {
 		struct gsm_bts_trx_ts *ts = &trx->ts[i];
-		ts_meas_check_compute(ts, fn);
+
+		switch (ts_pchan(ts)) {
+		case GSM_PCHAN_TCH_F:
+			if (me->tchf & (1 << i))
+				lchan_meas_check_compute(&ts->lchan[0]);
+			break;
+		case GSM_PCHAN_TCH_H:
+			if (me->tchh0 & (1 << i))
+				lchan_meas_check_compute(&ts->lchan[0]);
+			if (me->tchh1 & (1 << i))
+				lchan_meas_check_compute(&ts->lchan[1]);
+			break;
+		case GSM_PCHAN_SDCCH8_SACCH8C:
+		case GSM_PCHAN_SDCCH8_SACCH8C_CBCH:
+			if (fn102 != SDCCH8_MEAS_END_FN102)
+				break;
+			for (k = 0; k < 8; k++)
+				lchan_meas_check_compute(&ts->lchan[k]);
+			break;
+		case GSM_PCHAN_CCCH_SDCCH4:
+		case GSM_PCHAN_CCCH_SDCCH4_CBCH:
+			if (fn102 != SDCCH4_MEAS_END_FN102)
+				break;
+			for (k = 0; k < 4; k++)
+				lchan_meas_check_compute(&ts->lchan[k]);
+			break;
+		default:
+			break;
+		}
 	}
 	return 0;
 }
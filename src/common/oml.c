@@ -41,6 +41,7 @@
 #include <osmo-bts/bts_model.h>
 #include <osmo-bts/bts.h>
 #include <osmo-bts/signal.h>
+#include <osmo-bts/bringup.h>
 
 static int oml_ipa_set_attr(struct gsm_bts *bts, struct msgb *msg);
 
@@ -157,6 +158,8 @@ int oml_mo_state_chg(struct gsm_abis_mo *mo, int op_state, int avail_state)
 				abis_nm_opstate_name(op_state));
 			mo->nm_state.operational = op_state;
 			osmo_signal_dispatch(SS_GLOBAL, S_NEW_OP_STATE, NULL);
+			if (op_state == NM_OPSTATE_ENABLED)
+				bringup_check_on_air(mo->bts);
 		}
 
 		/* send state change report */
@@ -205,11 +208,13 @@ int oml_mo_statechg_nack(struct gsm_abis_mo *mo, uint8_t nack_cause)
 
 int oml_mo_opstart_ack(struct gsm_abis_mo *mo)
 {
+	bringup_mo_end("opstart", mo);
 	return oml_mo_fom_ack_nack(mo, NM_MT_OPSTART, 0);
 }
 
 int oml_mo_opstart_nack(struct gsm_abis_mo *mo, uint8_t nack_cause)
 {
+	bringup_mo_end("opstart", mo);
 	return oml_mo_fom_ack_nack(mo, NM_MT_OPSTART, nack_cause);
 }
 
@@ -481,8 +486,10 @@ static int oml_rx_set_bts_attr(struct gsm_bts *bts, struct msgb *msg)
 		btsb->ny1 = *TLVP_VAL(&tp, NM_ATT_NY1);
 	
 	/* 9.4.8 BCCH ARFCN */
-	if (TLVP_PRESENT(&tp, NM_ATT_BCCH_ARFCN))
+	if (TLVP_PRESENT(&tp, NM_ATT_BCCH_ARFCN)) {
 		bts->c0->arfcn = ntohs(tlvp_val16_unal(&tp, NM_ATT_BCCH_ARFCN));
+		power_tables_update(bts->c0);
+	}
 
 	/* 9.4.9 BSIC */
 	if (TLVP_PRESENT(&tp, NM_ATT_BSIC))
@@ -573,6 +580,8 @@ static int oml_rx_set_radio_attr(struct gsm_bts_trx *trx, struct msgb *msg)
 		trx->arfcn = arfcn;
 	}
 #endif
+	power_tables_update(trx);
+
 	/* call into BTS driver to apply new attributes to hardware */
 	return bts_model_apply_oml(trx->bts, msg, tp_merged, NM_OC_RADIO_CARRIER, trx);
 }
@@ -604,6 +613,9 @@ int conf_lchans_as_pchan(struct gsm_bts_trx_ts *ts,
 	struct gsm_lchan *lchan;
 	unsigned int i;
 
+	/* dynamic TS switch in progress */
+	ts_chan_nr_map_update(ts);
+
 	switch (pchan) {
 	case GSM_PCHAN_CCCH_SDCCH4_CBCH:
 		/* fallthrough */
@@ -709,6 +721,7 @@ static int oml_rx_set_chan_attr(struct gsm_bts_trx_ts *ts, struct msgb *msg)
 	if (TLVP_PRESENT(&tp, NM_ATT_CHAN_COMB)) {
 		uint8_t comb = *TLVP_VAL(&tp, NM_ATT_CHAN_COMB);
 		ts->pchan = abis_nm_pchan4chcomb(comb);
+		ts_chan_nr_map_update(ts);
 		rc = conf_lchans(ts);
 		if (rc < 0) {
 			talloc_free(tp_merged);
@@ -756,6 +769,7 @@ static int oml_rx_opstart(struct gsm_bts *bts, struct msgb *msg)
 	}
 
 	/* Step 3: Ask BTS driver to apply the opstart */
+	bringup_mo_begin("opstart", mo);
 	return bts_model_opstart(bts, mo, obj);
 }
 
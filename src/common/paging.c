@@ -439,8 +439,9 @@ int paging_gen_msg(struct paging_state *ps, uint8_t *out_buf, struct gsm_time *g
 			/* get message and free record */
 			memcpy(out_buf, pr[num_pr]->u.imm_ass.msg,
 							GSM_MACBLOCK_LEN);
-			pcu_tx_pch_data_cnf(gt->fn, pr[num_pr]->u.imm_ass.msg,
-							GSM_MACBLOCK_LEN);
+			pcu_tx_pch_data_cnf(ps->btsb->bts, gt->fn,
+					    pr[num_pr]->u.imm_ass.msg,
+					    GSM_MACBLOCK_LEN);
 			talloc_free(pr[num_pr]);
 			return GSM_MACBLOCK_LEN;
 		}
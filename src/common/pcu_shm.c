@@ -0,0 +1,262 @@
+/* Shared memory ring transport towards the PCU */
+
+/* (C) 2017 by sysmocom s.f.m.c. GmbH
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/eventfd.h>
+
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/select.h>
+#include <osmocom/core/utils.h>
+
+#include <osmo-bts/logging.h>
+#include <osmo-bts/hotlog.h>
+#include <osmo-bts/pcuif_proto.h>
+#include <osmo-bts/pcuif_shm.h>
+#include <osmo-bts/pcu_shm.h>
+
+struct pcu_shm {
+	struct pcu_if_shm *mem;
+	int mem_fd;
+	int tx_efd;			/* doorbell towards the PCU */
+	struct osmo_fd rx_bfd;		/* doorbell from the PCU */
+
+	pcu_shm_rx_cb *rx_cb;
+	void *data;
+
+	struct pcu_shm_stats stats;
+};
+
+/* memfd_create() is too new for the toolchains we build with, use an
+ * unlinked file on a tmpfs instead */
+static int shm_file_create(size_t size)
+{
+	static const char *tmpl[] = {
+		"/dev/shm/osmo-bts-pcu.XXXXXX",
+		"/tmp/osmo-bts-pcu.XXXXXX",
+	};
+	char path[32];
+	unsigned int i;
+	int fd;
+
+	for (i = 0; i < ARRAY_SIZE(tmpl); i++) {
+		snprintf(path, sizeof(path), "%s", tmpl[i]);
+		fd = mkstemp(path);
+		if (fd < 0)
+			continue;
+		unlink(path);
+		if (ftruncate(fd, size) == 0)
+			return fd;
+		close(fd);
+	}
+
+	return -1;
+}
+
+static int pcu_shm_rx_doorbell(struct osmo_fd *bfd, unsigned int flags)
+{
+	struct pcu_shm *shm = bfd->data;
+	struct pcu_if_shm_ring *r = &shm->mem->ring[PCU_IF_SHM_RING_PCU2BTS];
+	struct gsm_pcu_if *pcu_prim;
+	uint64_t val;
+
+	if (read(bfd->fd, &val, sizeof(val)) < 0 && errno != EAGAIN)
+		return -errno;
+
+	/* the slot is processed in place and only released afterwards */
+	while ((pcu_prim = pcu_if_shm_ring_peek(r))) {
+		shm->rx_cb(pcu_prim, shm->data);
+		pcu_if_shm_ring_consume(r);
+		shm->stats.rx++;
+	}
+
+	return 0;
+}
+
+static int pcu_shm_destructor(struct pcu_shm *shm)
+{
+	/* 'when' is only set once the fd got registered */
+	if (shm->rx_bfd.when)
+		osmo_fd_unregister(&shm->rx_bfd);
+	if (shm->rx_bfd.fd >= 0)
+		close(shm->rx_bfd.fd);
+	if (shm->tx_efd >= 0)
+		close(shm->tx_efd);
+	if (shm->mem_fd >= 0)
+		close(shm->mem_fd);
+	if (shm->mem)
+		munmap(shm->mem, sizeof(*shm->mem));
+	return 0;
+}
+
+struct pcu_shm *pcu_shm_alloc(void *ctx, pcu_shm_rx_cb *rx_cb, void *data)
+{
+	struct pcu_shm *shm;
+	void *mem;
+
+	shm = talloc_zero(ctx, struct pcu_shm);
+	if (!shm)
+		return NULL;
+	shm->mem_fd = -1;
+	shm->tx_efd = -1;
+	shm->rx_bfd.fd = -1;
+	talloc_set_destructor(shm, pcu_shm_destructor);
+
+	shm->mem_fd = shm_file_create(sizeof(*shm->mem));
+	if (shm->mem_fd < 0) {
+		LOGP(DPCU, LOGL_ERROR, "Cannot create PCU shared memory: %s\n",
+		     strerror(errno));
+		goto err;
+	}
+	mem = mmap(NULL, sizeof(*shm->mem), PROT_READ | PROT_WRITE,
+		   MAP_SHARED, shm->mem_fd, 0);
+	if (mem == MAP_FAILED) {
+		LOGP(DPCU, LOGL_ERROR, "Cannot map PCU shared memory: %s\n",
+		     strerror(errno));
+		goto err;
+	}
+	shm->mem = mem;
+	shm->mem->magic = PCU_IF_SHM_MAGIC;
+	shm->mem->num_slots = PCU_IF_SHM_SLOTS;
+	shm->mem->slot_size = sizeof(struct gsm_pcu_if);
+
+	shm->tx_efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	shm->rx_bfd.fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (shm->tx_efd < 0 || shm->rx_bfd.fd < 0) {
+		LOGP(DPCU, LOGL_ERROR, "Cannot create PCU doorbell: %s\n",
+		     strerror(errno));
+		goto err;
+	}
+	shm->rx_bfd.cb = pcu_shm_rx_doorbell;
+	shm->rx_bfd.data = shm;
+	shm->rx_cb = rx_cb;
+	shm->data = data;
+
+	return shm;
+
+err:
+	talloc_free(shm);
+	return NULL;
+}
+
+void pcu_shm_free(struct pcu_shm *shm)
+{
+	talloc_free(shm);
+}
+
+int pcu_shm_start(struct pcu_shm *shm, int sock_fd, uint8_t bts_nr)
+{
+	struct gsm_pcu_if pcu_prim;
+	int fds[3] = { shm->mem_fd, shm->tx_efd, shm->rx_bfd.fd };
+	union {
+		char buf[CMSG_SPACE(sizeof(fds))];
+		struct cmsghdr align;
+	} cmsg_buf;
+	struct iovec iov = {
+		.iov_base = &pcu_prim,
+		.iov_len = sizeof(pcu_prim),
+	};
+	struct msghdr mh = {
+		.msg_iov = &iov,
+		.msg_iovlen = 1,
+		.msg_control = cmsg_buf.buf,
+		.msg_controllen = sizeof(cmsg_buf.buf),
+	};
+	struct cmsghdr *cmsg;
+	int rc;
+
+	memset(&pcu_prim, 0, sizeof(pcu_prim));
+	pcu_prim.msg_type = PCU_IF_MSG_SHM_CNF;
+	pcu_prim.bts_nr = bts_nr;
+	pcu_prim.u.shm_cnf.size = sizeof(*shm->mem);
+	pcu_prim.u.shm_cnf.num_slots = PCU_IF_SHM_SLOTS;
+	pcu_prim.u.shm_cnf.slot_size = sizeof(struct gsm_pcu_if);
+
+	cmsg = CMSG_FIRSTHDR(&mh);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+	memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+	rc = sendmsg(sock_fd, &mh, MSG_DONTWAIT);
+	if (rc < 0)
+		return -errno;
+
+	/* the mapping stays valid, the PCU holds its own descriptor */
+	close(shm->mem_fd);
+	shm->mem_fd = -1;
+
+	shm->rx_bfd.when = BSC_FD_READ;
+	rc = osmo_fd_register(&shm->rx_bfd);
+	if (rc < 0) {
+		shm->rx_bfd.when = 0;
+		return rc;
+	}
+
+	/* the PCU may have written before we started listening */
+	pcu_shm_rx_doorbell(&shm->rx_bfd, BSC_FD_READ);
+
+	return 0;
+}
+
+struct gsm_pcu_if *pcu_shm_tx_get(struct pcu_shm *shm)
+{
+	struct pcu_if_shm_ring *r = &shm->mem->ring[PCU_IF_SHM_RING_BTS2PCU];
+	struct gsm_pcu_if *pcu_prim;
+
+	pcu_prim = pcu_if_shm_ring_get(r);
+	if (!pcu_prim) {
+		shm->stats.tx_full++;
+		LOGP_HOT(DPCU, LOGL_ERROR, "PCU shared memory ring full, "
+			 "dropping message\n");
+		return NULL;
+	}
+
+	/* slots are reused, don't leak a previous message into spare
+	 * fields of the new one */
+	memset(pcu_prim, 0, sizeof(*pcu_prim));
+	return pcu_prim;
+}
+
+void pcu_shm_tx_put(struct pcu_shm *shm)
+{
+	static const uint64_t one = 1;
+
+	shm->stats.tx++;
+	if (!pcu_if_shm_ring_put(&shm->mem->ring[PCU_IF_SHM_RING_BTS2PCU]))
+		return;
+
+	shm->stats.doorbells++;
+	if (write(shm->tx_efd, &one, sizeof(one)) < 0 && errno != EAGAIN)
+		LOGP_HOT(DPCU, LOGL_ERROR, "Cannot ring PCU doorbell: %s\n",
+			 strerror(errno));
+}
+
+const struct pcu_shm_stats *pcu_shm_get_stats(const struct pcu_shm *shm)
+{
+	return &shm->stats;
+}
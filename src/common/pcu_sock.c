@@ -22,6 +22,7 @@
  */
 
 #include <stdio.h>
+#include <stddef.h>
 #include <unistd.h>
 #include <stdlib.h>
 #include <string.h>
@@ -33,10 +34,12 @@
 #include <osmocom/core/talloc.h>
 #include <osmocom/core/select.h>
 #include <osmocom/core/socket.h>
+#include <osmocom/vty/vty.h>
 #include <osmo-bts/logging.h>
 #include <osmo-bts/gsm_data.h>
 #include <osmo-bts/pcu_if.h>
 #include <osmo-bts/pcuif_proto.h>
+#include <osmo-bts/pcu_shm.h>
 #include <osmo-bts/bts.h>
 #include <osmo-bts/rsl.h>
 #include <osmo-bts/signal.h>
@@ -46,7 +49,6 @@ uint32_t trx_get_hlayer1(struct gsm_bts_trx *trx);
 
 extern struct gsm_network bts_gsmnet;
 int pcu_direct = 0;
-static int avail_lai = 0, avail_nse = 0, avail_cell = 0, avail_nsvc[2] = {0, 0};
 
 static const char *sapi_string[] = {
 	[PCU_IF_SAPI_RACH] =	"RACH",
@@ -58,7 +60,49 @@ static const char *sapi_string[] = {
 	[PCU_IF_SAPI_PTCCH] = 	"PTCCH",
 };
 
-static int pcu_sock_send(struct gsm_network *net, struct msgb *msg);
+/* upper bound for the messages queued towards the PCU */
+#define PCU_UPQUEUE_MAX		1024
+
+/* priority classes of the upqueue, highest first */
+enum pcu_prio {
+	PCU_PRIO_CTRL,		/* INFO.ind, shared memory set-up */
+	PCU_PRIO_DATA,		/* RACH.ind, DATA.ind, paging */
+	PCU_PRIO_CLOCK,		/* RTS.req, TIME.ind */
+	_NUM_PCU_PRIO
+};
+
+/* one per BTS, each with its own socket and queue */
+struct pcu_sock_state {
+	struct gsm_bts *bts;
+	struct osmo_fd listen_bfd;	/* fd for listen socket */
+	struct osmo_fd conn_bfd;	/* fd for connection to lcr */
+	/* queues for sending messages, one per enum pcu_prio */
+	struct llist_head upqueue[_NUM_PCU_PRIO];
+	unsigned int upqueue_len;	/* messages in all queues */
+	struct {
+		unsigned int hwm;	/* high watermark of upqueue_len */
+		uint32_t dropped_stale;	/* RTS/TIME for past frames */
+		uint32_t dropped_full;	/* by priority, queue full */
+	} upqueue_stats;
+	struct pcu_shm *shm;		/* shared memory transport, if any */
+	struct pcu_shm *shm_pending;	/* requested, upqueue not yet empty */
+	uint32_t pcu_version;		/* from VERSION_IND, 0 if legacy */
+	/* RTS.req of one FN, to be sent as PCU_IF_MSG_RTS_BATCH */
+	struct gsm_pcu_if_rts_batch_entry rts_batch[PCU_IF_RTS_BATCH_MAX];
+	unsigned int rts_batch_num;
+	/* BTS attributes received so far */
+	int avail_lai, avail_nse, avail_cell, avail_nsvc[2];
+};
+
+static int pcu_sock_send(struct pcu_sock_state *state, struct msgb *msg);
+static struct gsm_pcu_if *pcu_prim_get(struct pcu_sock_state *state,
+	uint8_t msg_type, struct msgb **msg);
+static int pcu_prim_send(struct pcu_sock_state *state, struct msgb *msg);
+
+static struct pcu_sock_state *pcu_state(struct gsm_bts *bts)
+{
+	return bts_role_bts(bts)->pcu.state;
+}
 
 
 static struct gsm_bts_trx *trx_by_nr(struct gsm_bts *bts, uint8_t trx_nr)
@@ -94,6 +138,91 @@ struct msgb *pcu_msgb_alloc(uint8_t msg_type, uint8_t bts_nr)
 	return msg;
 }
 
+static bool pcu_rts_batching(struct pcu_sock_state *state)
+{
+	return state && state->pcu_version >= PCU_IF_VERSION;
+}
+
+/* RTS entries of a batch fitting into one shared memory slot */
+#define RTS_BATCH_SHM_MAX \
+	((sizeof(struct gsm_pcu_if) - PCU_IF_RTS_BATCH_LEN(0)) \
+	 / sizeof(struct gsm_pcu_if_rts_batch_entry))
+
+static int pcu_rts_batch_send(struct pcu_sock_state *state, uint32_t fn,
+	const struct gsm_pcu_if_rts_batch_entry *rts, unsigned int num)
+{
+	unsigned int len = PCU_IF_RTS_BATCH_LEN(num);
+	struct gsm_pcu_if_rts_batch *batch;
+	struct gsm_pcu_if *pcu_prim;
+	struct msgb *msg = NULL;
+
+	/* the batch is sized by num_rts, not by struct gsm_pcu_if */
+	if (state->shm) {
+		pcu_prim = pcu_shm_tx_get(state->shm);
+		if (!pcu_prim)
+			return -ENOBUFS;
+	} else {
+		msg = msgb_alloc(len, "pcu_sock_tx");
+		if (!msg)
+			return -ENOMEM;
+		pcu_prim = (struct gsm_pcu_if *) msgb_put(msg, len);
+	}
+	pcu_prim->msg_type = PCU_IF_MSG_RTS_BATCH;
+	pcu_prim->bts_nr = state->bts->nr;
+	memset(pcu_prim->spare, 0, sizeof(pcu_prim->spare));
+
+	batch = (struct gsm_pcu_if_rts_batch *) &pcu_prim->u;
+	batch->fn = fn;
+	batch->num_rts = num;
+	memset(batch->spare, 0, sizeof(batch->spare));
+	memcpy(batch->rts, rts, num * sizeof(*rts));
+
+	return pcu_prim_send(state, msg);
+}
+
+/* send the collected RTS requests, an empty batch is sent as well.  A ring
+ * slot holds fewer entries than a socket message, so the batch may have
+ * to be split. */
+static int pcu_rts_batch_flush(struct pcu_sock_state *state, uint32_t fn)
+{
+	unsigned int num = state->rts_batch_num, i = 0, n;
+	unsigned int max = state->shm ? RTS_BATCH_SHM_MAX : PCU_IF_RTS_BATCH_MAX;
+	int rc;
+
+	state->rts_batch_num = 0;
+
+	do {
+		n = OSMO_MIN(num - i, max);
+		rc = pcu_rts_batch_send(state, fn, &state->rts_batch[i], n);
+		i += n;
+	} while (i < num && rc >= 0);
+
+	return rc;
+}
+
+/* collect the RTS requests of one TDMA frame, they are sent along with
+ * the next time indication or as soon as one for another FN comes in */
+static int pcu_rts_batch_add(struct pcu_sock_state *state,
+	struct gsm_bts_trx_ts *ts, uint8_t is_ptcch, uint32_t fn,
+	uint8_t block_nr)
+{
+	struct gsm_bts_role_bts *btsb = bts_role_bts(ts->trx->bts);
+	struct gsm_pcu_if_rts_batch_entry *e;
+
+	if (state->rts_batch_num && (state->rts_batch[0].fn != fn ||
+			state->rts_batch_num >= PCU_IF_RTS_BATCH_MAX))
+		pcu_rts_batch_flush(state, btsb->gsm_time.fn);
+
+	e = &state->rts_batch[state->rts_batch_num++];
+	e->sapi = (is_ptcch) ? PCU_IF_SAPI_PTCCH : PCU_IF_SAPI_PDTCH;
+	e->trx_nr = ts->trx->nr;
+	e->ts_nr = ts->nr;
+	e->block_nr = block_nr;
+	e->fn = fn;
+
+	return 0;
+}
+
 static bool ts_should_be_pdch(struct gsm_bts_trx_ts *ts) {
 	if (ts->pchan == GSM_PCHAN_PDCH)
 		return true;
@@ -120,13 +249,13 @@ static bool ts_should_be_pdch(struct gsm_bts_trx_ts *ts) {
 	return false;
 }
 
-int pcu_tx_info_ind(void)
+int pcu_tx_info_ind(struct gsm_bts *bts)
 {
 	struct gsm_network *net = &bts_gsmnet;
+	struct pcu_sock_state *state = pcu_state(bts);
 	struct msgb *msg;
 	struct gsm_pcu_if *pcu_prim;
 	struct gsm_pcu_if_info_ind *info_ind;
-	struct gsm_bts *bts;
 	struct gprs_rlc_cfg *rlcc;
 	struct gsm_bts_gprs_nsvc *nsvc;
 	struct gsm_bts_trx *trx;
@@ -135,8 +264,6 @@ int pcu_tx_info_ind(void)
 
 	LOGP(DPCU, LOGL_INFO, "Sending info\n");
 
-	/* FIXME: allow multiple BTS */
-	bts = llist_entry(net->bts_list.next, struct gsm_bts, list);
 	rlcc = &bts->gprs.cell.rlc_cfg;
 
 	msg = pcu_msgb_alloc(PCU_IF_MSG_INFO_IND, bts->nr);
@@ -144,9 +271,14 @@ int pcu_tx_info_ind(void)
 		return -ENOMEM;
 	pcu_prim = (struct gsm_pcu_if *) msg->data;
 	info_ind = &pcu_prim->u.info_ind;
-	info_ind->version = PCU_IF_VERSION;
+	/* don't make a legacy PCU bail out on the version check */
+	if (pcu_rts_batching(state))
+		info_ind->version = PCU_IF_VERSION;
+	else
+		info_ind->version = PCU_IF_VERSION_LEGACY;
 
-	if (avail_lai && avail_nse && avail_cell && avail_nsvc[0]) {
+	if (state && state->avail_lai && state->avail_nse &&
+	    state->avail_cell && state->avail_nsvc[0]) {
 		info_ind->flags |= PCU_IF_FLAG_ACTIVE;
 		LOGP(DPCU, LOGL_INFO, "BTS is up\n");
 	} else
@@ -154,6 +286,7 @@ int pcu_tx_info_ind(void)
 
 	if (pcu_direct)
 		info_ind->flags |= PCU_IF_FLAG_SYSMO;
+	info_ind->flags |= PCU_IF_FLAG_SHM;
 
 	/* RAI */
 	info_ind->mcc = net->mcc;
@@ -245,12 +378,13 @@ int pcu_tx_info_ind(void)
 		}
 	}
 
-	return pcu_sock_send(net, msg);
+	return pcu_sock_send(state, msg);
 }
 
 static int pcu_if_signal_cb(unsigned int subsys, unsigned int signal,
 	void *hdlr_data, void *signal_data)
 {
+	struct pcu_sock_state *state = hdlr_data;
 	struct gsm_network *net = &bts_gsmnet;
 	struct gsm_bts_gprs_nsvc *nsvc;
 	struct gsm_bts *bts;
@@ -263,6 +397,8 @@ static int pcu_if_signal_cb(unsigned int subsys, unsigned int signal,
 	switch(signal) {
 	case S_NEW_SYSINFO:
 		bts = signal_data;
+		if (bts != state->bts)
+			return 0;
 		if (!(bts->si_valid & (1 << SYSINFO_TYPE_3)))
 			break;
 		si3 = (struct gsm48_system_information_type_3 *)
@@ -277,22 +413,28 @@ static int pcu_if_signal_cb(unsigned int subsys, unsigned int signal,
 			net->mnc >>= 4;
 		bts->location_area_code = ntohs(si3->lai.lac);
 		bts->cell_identity = si3->cell_identity;
-		avail_lai = 1;
+		state->avail_lai = 1;
 		break;
 	case S_NEW_NSE_ATTR:
 		bts = signal_data;
-		avail_nse = 1;
+		if (bts != state->bts)
+			return 0;
+		state->avail_nse = 1;
 		break;
 	case S_NEW_CELL_ATTR:
 		bts = signal_data;
-		avail_cell = 1;
+		if (bts != state->bts)
+			return 0;
+		state->avail_cell = 1;
 		break;
 	case S_NEW_NSVC_ATTR:
 		nsvc = signal_data;
+		if (nsvc->bts != state->bts)
+			return 0;
 		id = nsvc->id;
 		if (id < 0 || id > 1)
 			return -EINVAL;
-		avail_nsvc[id] = 1;
+		state->avail_nsvc[id] = 1;
 		break;
 	case S_NEW_OP_STATE:
 		break;
@@ -302,8 +444,9 @@ static int pcu_if_signal_cb(unsigned int subsys, unsigned int signal,
 
 	/* If all infos have been received, of if one info is updated after
 	 * all infos have been received, transmit info update. */
-	if (avail_lai && avail_nse && avail_cell && avail_nsvc[0])
-		pcu_tx_info_ind();
+	if (state->avail_lai && state->avail_nse && state->avail_cell
+	 && state->avail_nsvc[0])
+		pcu_tx_info_ind(state->bts);
 	return 0;
 }
 
@@ -314,15 +457,17 @@ int pcu_tx_rts_req(struct gsm_bts_trx_ts *ts, uint8_t is_ptcch, uint32_t fn,
 	struct msgb *msg;
 	struct gsm_pcu_if *pcu_prim;
 	struct gsm_pcu_if_rts_req *rts_req;
-	struct gsm_bts *bts = ts->trx->bts;
+	struct pcu_sock_state *state = pcu_state(ts->trx->bts);
 
 	LOGP(DPCU, LOGL_DEBUG, "Sending rts request: is_ptcch=%d arfcn=%d "
 		"block=%d\n", is_ptcch, arfcn, block_nr);
 
-	msg = pcu_msgb_alloc(PCU_IF_MSG_RTS_REQ, bts->nr);
-	if (!msg)
+	if (pcu_rts_batching(state))
+		return pcu_rts_batch_add(state, ts, is_ptcch, fn, block_nr);
+
+	pcu_prim = pcu_prim_get(state, PCU_IF_MSG_RTS_REQ, &msg);
+	if (!pcu_prim)
 		return -ENOMEM;
-	pcu_prim = (struct gsm_pcu_if *) msg->data;
 	rts_req = &pcu_prim->u.rts_req;
 
 	rts_req->sapi = (is_ptcch) ? PCU_IF_SAPI_PTCCH : PCU_IF_SAPI_PDTCH;
@@ -332,7 +477,7 @@ int pcu_tx_rts_req(struct gsm_bts_trx_ts *ts, uint8_t is_ptcch, uint32_t fn,
 	rts_req->ts_nr = ts->nr;
 	rts_req->block_nr = block_nr;
 
-	return pcu_sock_send(&bts_gsmnet, msg);
+	return pcu_prim_send(state, msg);
 }
 
 int pcu_tx_data_ind(struct gsm_bts_trx_ts *ts, uint8_t is_ptcch, uint32_t fn,
@@ -342,16 +487,15 @@ int pcu_tx_data_ind(struct gsm_bts_trx_ts *ts, uint8_t is_ptcch, uint32_t fn,
 	struct msgb *msg;
 	struct gsm_pcu_if *pcu_prim;
 	struct gsm_pcu_if_data *data_ind;
-	struct gsm_bts *bts = ts->trx->bts;
+	struct pcu_sock_state *state = pcu_state(ts->trx->bts);
 
 	LOGP(DPCU, LOGL_DEBUG, "Sending data indication: is_ptcch=%d arfcn=%d "
 		"block=%d data=%s\n", is_ptcch, arfcn, block_nr,
 		osmo_hexdump(data, len));
 
-	msg = pcu_msgb_alloc(PCU_IF_MSG_DATA_IND, bts->nr);
-	if (!msg)
+	pcu_prim = pcu_prim_get(state, PCU_IF_MSG_DATA_IND, &msg);
+	if (!pcu_prim)
 		return -ENOMEM;
-	pcu_prim = (struct gsm_pcu_if *) msg->data;
 	data_ind = &pcu_prim->u.data_ind;
 
 	data_ind->sapi = (is_ptcch) ? PCU_IF_SAPI_PTCCH : PCU_IF_SAPI_PDTCH;
@@ -368,7 +512,7 @@ int pcu_tx_data_ind(struct gsm_bts_trx_ts *ts, uint8_t is_ptcch, uint32_t fn,
 	memcpy(data_ind->data, data, len);
 	data_ind->len = len;
 
-	return pcu_sock_send(&bts_gsmnet, msg);
+	return pcu_prim_send(state, msg);
 }
 
 int pcu_tx_rach_ind(struct gsm_bts *bts, int16_t qta, uint16_t ra, uint32_t fn,
@@ -377,14 +521,14 @@ int pcu_tx_rach_ind(struct gsm_bts *bts, int16_t qta, uint16_t ra, uint32_t fn,
 	struct msgb *msg;
 	struct gsm_pcu_if *pcu_prim;
 	struct gsm_pcu_if_rach_ind *rach_ind;
+	struct pcu_sock_state *state = pcu_state(bts);
 
 	LOGP(DPCU, LOGL_INFO, "Sending RACH indication: qta=%d, ra=%d, "
 		"fn=%d\n", qta, ra, fn);
 
-	msg = pcu_msgb_alloc(PCU_IF_MSG_RACH_IND, bts->nr);
-	if (!msg)
+	pcu_prim = pcu_prim_get(state, PCU_IF_MSG_RACH_IND, &msg);
+	if (!pcu_prim)
 		return -ENOMEM;
-	pcu_prim = (struct gsm_pcu_if *) msg->data;
 	rach_ind = &pcu_prim->u.rach_ind;
 
 	rach_ind->sapi = PCU_IF_SAPI_RACH;
@@ -394,34 +538,43 @@ int pcu_tx_rach_ind(struct gsm_bts *bts, int16_t qta, uint16_t ra, uint32_t fn,
 	rach_ind->is_11bit = is_11bit;
 	rach_ind->burst_type = burst_type;
 
-	return pcu_sock_send(&bts_gsmnet, msg);
+	return pcu_prim_send(state, msg);
 }
 
-int pcu_tx_time_ind(uint32_t fn)
+int pcu_tx_time_ind(struct gsm_bts *bts, uint32_t fn)
 {
 	struct msgb *msg;
 	struct gsm_pcu_if *pcu_prim;
 	struct gsm_pcu_if_time_ind *time_ind;
+	struct pcu_sock_state *state = pcu_state(bts);
 	uint8_t fn13 = fn % 13;
 
+	/* pending RTS requests go out right away, together with the time */
+	if (pcu_rts_batching(state) && state->rts_batch_num)
+		return pcu_rts_batch_flush(state, fn);
+
 	/* omit frame numbers not starting at a MAC block */
 	if (fn13 != 0 && fn13 != 4 && fn13 != 8)
 		return 0;
 
-	msg = pcu_msgb_alloc(PCU_IF_MSG_TIME_IND, 0);
-	if (!msg)
+	/* an empty batch serves as time indication */
+	if (pcu_rts_batching(state))
+		return pcu_rts_batch_flush(state, fn);
+
+	pcu_prim = pcu_prim_get(state, PCU_IF_MSG_TIME_IND, &msg);
+	if (!pcu_prim)
 		return -ENOMEM;
-	pcu_prim = (struct gsm_pcu_if *) msg->data;
 	time_ind = &pcu_prim->u.time_ind;
 
 	time_ind->fn = fn;
 
-	return pcu_sock_send(&bts_gsmnet, msg);
+	return pcu_prim_send(state, msg);
 }
 
-int pcu_tx_pag_req(const uint8_t *identity_lv, uint8_t chan_needed)
+int pcu_tx_pag_req(struct gsm_bts *bts, const uint8_t *identity_lv,
+	uint8_t chan_needed)
 {
-	struct pcu_sock_state *state = bts_gsmnet.pcu_state;
+	struct pcu_sock_state *state = pcu_state(bts);
 	struct msgb *msg;
 	struct gsm_pcu_if *pcu_prim;
 	struct gsm_pcu_if_pag_req *pag_req;
@@ -440,7 +593,7 @@ int pcu_tx_pag_req(const uint8_t *identity_lv, uint8_t chan_needed)
 		return 0;
 	}
 
-	msg = pcu_msgb_alloc(PCU_IF_MSG_PAG_REQ, 0);
+	msg = pcu_msgb_alloc(PCU_IF_MSG_PAG_REQ, bts->nr);
 	if (!msg)
 		return -ENOMEM;
 	pcu_prim = (struct gsm_pcu_if *) msg->data;
@@ -449,20 +602,16 @@ int pcu_tx_pag_req(const uint8_t *identity_lv, uint8_t chan_needed)
 	pag_req->chan_needed = chan_needed;
 	memcpy(pag_req->identity_lv, identity_lv, identity_lv[0] + 1);
 
-	return pcu_sock_send(&bts_gsmnet, msg);
+	return pcu_sock_send(state, msg);
 }
 
-int pcu_tx_pch_data_cnf(uint32_t fn, uint8_t *data, uint8_t len)
+int pcu_tx_pch_data_cnf(struct gsm_bts *bts, uint32_t fn, uint8_t *data,
+	uint8_t len)
 {
-	struct gsm_network *net = &bts_gsmnet;
-	struct gsm_bts *bts;
 	struct msgb *msg;
 	struct gsm_pcu_if *pcu_prim;
 	struct gsm_pcu_if_data *data_cnf;
 
-	/* FIXME: allow multiple BTS */
-	bts = llist_entry(net->bts_list.next, struct gsm_bts, list);
-
 	LOGP(DPCU, LOGL_INFO, "Sending PCH confirm\n");
 
 	msg = pcu_msgb_alloc(PCU_IF_MSG_DATA_CNF, bts->nr);
@@ -476,7 +625,7 @@ int pcu_tx_pch_data_cnf(uint32_t fn, uint8_t *data, uint8_t len)
 	memcpy(data_cnf->data, data, len);
 	data_cnf->len = len;
 
-	return pcu_sock_send(&bts_gsmnet, msg);
+	return pcu_sock_send(pcu_state(bts), msg);
 }
 
 static int pcu_rx_data_req(struct gsm_bts *bts, uint8_t msg_type,
@@ -583,14 +732,12 @@ static int pcu_rx_act_req(struct gsm_bts *bts,
 	return 0;
 }
 
-static int pcu_rx(struct gsm_network *net, uint8_t msg_type,
+static int pcu_rx(struct pcu_sock_state *state, uint8_t msg_type,
 	struct gsm_pcu_if *pcu_prim)
 {
 	int rc = 0;
-	struct gsm_bts *bts;
-
-	/* FIXME: allow multiple BTS */
-	bts = llist_entry(net->bts_list.next, struct gsm_bts, list);
+	/* the socket determines the BTS, bts_nr is not evaluated */
+	struct gsm_bts *bts = state->bts;
 
 	switch (msg_type) {
 	case PCU_IF_MSG_DATA_REQ:
@@ -613,18 +760,116 @@ static int pcu_rx(struct gsm_network *net, uint8_t msg_type,
  * PCU socket interface
  */
 
-struct pcu_sock_state {
-	struct gsm_network *net;
-	struct osmo_fd listen_bfd;	/* fd for listen socket */
-	struct osmo_fd conn_bfd;	/* fd for connection to lcr */
-	struct llist_head upqueue;	/* queue for sending messages */
-};
+static enum pcu_prio pcu_msg_prio(uint8_t msg_type)
+{
+	switch (msg_type) {
+	case PCU_IF_MSG_INFO_IND:
+	case PCU_IF_MSG_SHM_CNF:
+		return PCU_PRIO_CTRL;
+	case PCU_IF_MSG_RTS_REQ:
+	case PCU_IF_MSG_RTS_BATCH:
+	case PCU_IF_MSG_TIME_IND:
+		return PCU_PRIO_CLOCK;
+	default:
+		return PCU_PRIO_DATA;
+	}
+}
+
+/* is fn before the current frame number of the BTS? */
+static bool pcu_fn_past(struct pcu_sock_state *state, uint32_t fn)
+{
+	uint32_t now = bts_role_bts(state->bts)->gsm_time.fn;
+	uint32_t delta = (now + GSM_HYPERFRAME - fn) % GSM_HYPERFRAME;
+
+	return delta != 0 && delta < GSM_HYPERFRAME / 2;
+}
+
+/* An RTS.req for a frame in the past can't be served anymore.  A time
+ * indication older than the current frame is superseded by the next one,
+ * so these go first when the queue runs full. */
+static bool pcu_msg_stale(struct pcu_sock_state *state,
+	const struct gsm_pcu_if *pcu_prim, bool drop_time)
+{
+	const struct gsm_pcu_if_rts_batch *batch =
+		(const struct gsm_pcu_if_rts_batch *) &pcu_prim->u;
+	unsigned int i;
+
+	switch (pcu_prim->msg_type) {
+	case PCU_IF_MSG_RTS_REQ:
+		return pcu_fn_past(state, pcu_prim->u.rts_req.fn);
+	case PCU_IF_MSG_TIME_IND:
+		return drop_time && pcu_fn_past(state, pcu_prim->u.time_ind.fn);
+	case PCU_IF_MSG_RTS_BATCH:
+		/* like an RTS.req once none of its RTS can be served */
+		if (batch->num_rts) {
+			for (i = 0; i < batch->num_rts; i++) {
+				if (!pcu_fn_past(state, batch->rts[i].fn))
+					return false;
+			}
+			return true;
+		}
+		return drop_time && pcu_fn_past(state, batch->fn);
+	default:
+		return false;
+	}
+}
+
+static void pcu_upqueue_shed_stale(struct pcu_sock_state *state)
+{
+	struct msgb *msg, *msg2;
+
+	llist_for_each_entry_safe(msg, msg2, &state->upqueue[PCU_PRIO_CLOCK],
+				  list) {
+		if (!pcu_msg_stale(state, (struct gsm_pcu_if *) msg->data,
+				   true))
+			continue;
+		llist_del(&msg->list);
+		msgb_free(msg);
+		state->upqueue_len--;
+		state->upqueue_stats.dropped_stale++;
+	}
+}
+
+/* make room for a message of class prio by dropping the oldest message of
+ * the lowest class below it, returns -ENOBUFS if there is none */
+static int pcu_upqueue_drop_below(struct pcu_sock_state *state,
+	enum pcu_prio prio)
+{
+	struct msgb *msg;
+	int i;
+
+	for (i = _NUM_PCU_PRIO - 1; i > prio; i--) {
+		msg = msgb_dequeue(&state->upqueue[i]);
+		if (!msg)
+			continue;
+		msgb_free(msg);
+		state->upqueue_len--;
+		state->upqueue_stats.dropped_full++;
+		return 0;
+	}
+
+	return -ENOBUFS;
+}
+
+/* oldest message of the highest priority class, NULL if all are empty */
+static struct msgb *pcu_upqueue_peek(struct pcu_sock_state *state)
+{
+	int i;
+
+	for (i = 0; i < _NUM_PCU_PRIO; i++) {
+		if (!llist_empty(&state->upqueue[i]))
+			return llist_entry(state->upqueue[i].next,
+					   struct msgb, list);
+	}
+
+	return NULL;
+}
 
-static int pcu_sock_send(struct gsm_network *net, struct msgb *msg)
+static int pcu_sock_send(struct pcu_sock_state *state, struct msgb *msg)
 {
-	struct pcu_sock_state *state = net->pcu_state;
 	struct osmo_fd *conn_bfd;
 	struct gsm_pcu_if *pcu_prim = (struct gsm_pcu_if *) msg->data;
+	enum pcu_prio prio;
 
 	if (!state) {
 		if (pcu_prim->msg_type != PCU_IF_MSG_TIME_IND)
@@ -641,24 +886,165 @@ static int pcu_sock_send(struct gsm_network *net, struct msgb *msg)
 		msgb_free(msg);
 		return -EIO;
 	}
-	msgb_enqueue(&state->upqueue, msg);
+	if (state->shm) {
+		/* the rare messages still built in a msgb */
+		struct gsm_pcu_if *slot = pcu_shm_tx_get(state->shm);
+		if (slot) {
+			memcpy(slot, pcu_prim, OSMO_MIN(msgb_length(msg),
+							sizeof(*slot)));
+			pcu_shm_tx_put(state->shm);
+		}
+		msgb_free(msg);
+		return slot ? 0 : -ENOBUFS;
+	}
+	prio = pcu_msg_prio(pcu_prim->msg_type);
+	if (state->upqueue_len >= PCU_UPQUEUE_MAX) {
+		pcu_upqueue_shed_stale(state);
+		if (state->upqueue_len >= PCU_UPQUEUE_MAX
+		 && pcu_upqueue_drop_below(state, prio) < 0) {
+			LOGP_HOT(DPCU, LOGL_ERROR, "PCU socket queue full, "
+				 "dropping message type 0x%02x\n",
+				 pcu_prim->msg_type);
+			state->upqueue_stats.dropped_full++;
+			msgb_free(msg);
+			return -ENOBUFS;
+		}
+	}
+	msgb_enqueue(&state->upqueue[prio], msg);
+	state->upqueue_len++;
+	if (state->upqueue_len > state->upqueue_stats.hwm)
+		state->upqueue_stats.hwm = state->upqueue_len;
 	conn_bfd->when |= BSC_FD_WRITE;
 
 	return 0;
 }
 
+/* Start a message towards the PCU.  With the shared memory transport the
+ * message is built directly in the ring slot and *msg is set to NULL,
+ * otherwise a msgb is allocated.  Returns NULL if the message can't be
+ * sent at all.  Must be followed by pcu_prim_send(). */
+static struct gsm_pcu_if *pcu_prim_get(struct pcu_sock_state *state,
+	uint8_t msg_type, struct msgb **msg)
+{
+	struct gsm_pcu_if *pcu_prim;
+	uint8_t bts_nr;
+
+	*msg = NULL;
+	if (!state)
+		return NULL;
+	bts_nr = state->bts->nr;
+
+	if (state->shm) {
+		pcu_prim = pcu_shm_tx_get(state->shm);
+		if (!pcu_prim)
+			return NULL;
+	} else {
+		*msg = pcu_msgb_alloc(msg_type, bts_nr);
+		if (!*msg)
+			return NULL;
+		pcu_prim = (struct gsm_pcu_if *) (*msg)->data;
+	}
+	pcu_prim->msg_type = msg_type;
+	pcu_prim->bts_nr = bts_nr;
+
+	return pcu_prim;
+}
+
+static int pcu_prim_send(struct pcu_sock_state *state, struct msgb *msg)
+{
+	if (msg)
+		return pcu_sock_send(state, msg);
+
+	pcu_shm_tx_put(state->shm);
+	return 0;
+}
+
+static int pcu_shm_rx(struct gsm_pcu_if *pcu_prim, void *data)
+{
+	struct pcu_sock_state *state = data;
+
+	return pcu_rx(state, pcu_prim->msg_type, pcu_prim);
+}
+
+static int pcu_rx_shm_req(struct pcu_sock_state *state,
+	struct gsm_pcu_if_shm *shm_req)
+{
+	if (state->shm || state->shm_pending)
+		return 0;
+
+	/* a PCU built against a different struct gsm_pcu_if can't use the
+	 * rings, it gets a CNF without descriptors and stays on the socket */
+	if (shm_req->slot_size != sizeof(struct gsm_pcu_if)) {
+		struct msgb *msg;
+
+		LOGP(DPCU, LOGL_NOTICE, "PCU requests shared memory with slot "
+			"size %u, expected %zu\n", shm_req->slot_size,
+			sizeof(struct gsm_pcu_if));
+		msg = pcu_msgb_alloc(PCU_IF_MSG_SHM_CNF, state->bts->nr);
+		if (!msg)
+			return -ENOMEM;
+		return pcu_sock_send(state, msg);
+	}
+
+	state->shm_pending = pcu_shm_alloc(state, pcu_shm_rx, state);
+	if (!state->shm_pending)
+		return -ENOMEM;
+
+	/* the CNF goes out once everything queued before it is sent, so the
+	 * PCU receives the messages in order */
+	state->conn_bfd.when |= BSC_FD_WRITE;
+
+	return 0;
+}
+
+static int pcu_rx_version_ind(struct pcu_sock_state *state,
+	struct gsm_pcu_if_version_ind *version_ind)
+{
+	LOGP(DPCU, LOGL_NOTICE, "PCU announces interface version 0x%02x\n",
+		version_ind->version);
+
+	state->pcu_version = version_ind->version;
+	state->rts_batch_num = 0;
+
+	/* the first INFO_IND carried the legacy version */
+	if (pcu_rts_batching(state))
+		return pcu_tx_info_ind(state->bts);
+
+	return 0;
+}
+
+static void pcu_shm_activate(struct pcu_sock_state *state)
+{
+	struct pcu_shm *shm = state->shm_pending;
+	int rc;
+
+	rc = pcu_shm_start(shm, state->conn_bfd.fd, state->bts->nr);
+	if (rc == -EAGAIN) {
+		state->conn_bfd.when |= BSC_FD_WRITE;
+		return;
+	}
+	state->shm_pending = NULL;
+	if (rc < 0) {
+		LOGP(DPCU, LOGL_ERROR, "Cannot set up PCU shared memory "
+			"transport: %s\n", strerror(-rc));
+		pcu_shm_free(shm);
+		return;
+	}
+
+	LOGP(DPCU, LOGL_NOTICE, "PCU uses shared memory transport\n");
+	state->shm = shm;
+}
+
 static void pcu_sock_close(struct pcu_sock_state *state)
 {
 	struct osmo_fd *bfd = &state->conn_bfd;
-	struct gsm_bts *bts;
+	struct gsm_bts *bts = state->bts;
 	struct gsm_bts_trx *trx;
 	struct gsm_bts_trx_ts *ts;
 	int i, j;
 
-	/* FIXME: allow multiple BTS */
-	bts = llist_entry(state->net->bts_list.next, struct gsm_bts, list);
-
-	LOGP(DPCU, LOGL_NOTICE, "PCU socket has LOST connection\n");
+	LOGP(DPCU, LOGL_NOTICE, "PCU socket of BTS %u has LOST connection\n",
+		bts->nr);
 
 	close(bfd->fd);
 	bfd->fd = -1;
@@ -667,6 +1053,17 @@ static void pcu_sock_close(struct pcu_sock_state *state)
 	/* re-enable the generation of ACCEPT for new connections */
 	state->listen_bfd.when |= BSC_FD_READ;
 
+	if (state->shm) {
+		pcu_shm_free(state->shm);
+		state->shm = NULL;
+	}
+	if (state->shm_pending) {
+		pcu_shm_free(state->shm_pending);
+		state->shm_pending = NULL;
+	}
+	state->pcu_version = 0;
+	state->rts_batch_num = 0;
+
 #if 0
 	/* remove si13, ... */
 	bts->si_valid &= ~(1 << SYSINFO_TYPE_13);
@@ -689,27 +1086,46 @@ static void pcu_sock_close(struct pcu_sock_state *state)
 		}
 	}
 
-	/* flush the queue */
-	while (!llist_empty(&state->upqueue)) {
-		struct msgb *msg = msgb_dequeue(&state->upqueue);
-		msgb_free(msg);
+	/* flush the queues */
+	for (i = 0; i < _NUM_PCU_PRIO; i++) {
+		while (!llist_empty(&state->upqueue[i])) {
+			struct msgb *msg = msgb_dequeue(&state->upqueue[i]);
+			msgb_free(msg);
+		}
+	}
+	state->upqueue_len = 0;
+}
+
+/* minimum length of a message received from the PCU */
+static size_t pcu_rx_min_len(uint8_t msg_type)
+{
+	size_t len = offsetof(struct gsm_pcu_if, u);
+
+	switch (msg_type) {
+	case PCU_IF_MSG_DATA_REQ:
+	case PCU_IF_MSG_PAG_REQ:
+		/* both are parsed as data_req */
+		return len + sizeof(struct gsm_pcu_if_data);
+	case PCU_IF_MSG_ACT_REQ:
+		return len + sizeof(struct gsm_pcu_if_act_req);
+	case PCU_IF_MSG_SHM_REQ:
+		return len + sizeof(struct gsm_pcu_if_shm);
+	case PCU_IF_MSG_VERSION_IND:
+		return len + sizeof(struct gsm_pcu_if_version_ind);
+	default:
+		return len;
 	}
 }
 
 static int pcu_sock_read(struct osmo_fd *bfd)
 {
 	struct pcu_sock_state *state = (struct pcu_sock_state *)bfd->data;
-	struct gsm_pcu_if *pcu_prim;
-	struct msgb *msg;
+	struct gsm_pcu_if pcu_prim;
 	int rc;
 
-	msg = msgb_alloc(sizeof(*pcu_prim), "pcu_sock_rx");
-	if (!msg)
-		return -ENOMEM;
-
-	pcu_prim = (struct gsm_pcu_if *) msg->tail;
-
-	rc = recv(bfd->fd, msg->tail, msgb_tailroom(msg), 0);
+	/* as we always synchronously process the message in pcu_rx() and
+	 * its callbacks, it can be received into a buffer on the stack */
+	rc = recv(bfd->fd, &pcu_prim, sizeof(pcu_prim), 0);
 	if (rc == 0)
 		goto close;
 
@@ -719,16 +1135,21 @@ static int pcu_sock_read(struct osmo_fd *bfd)
 		goto close;
 	}
 
-	rc = pcu_rx(state->net, pcu_prim->msg_type, pcu_prim);
+	/* whatever recv() did not fill in is uninitialized */
+	if (rc < pcu_rx_min_len(pcu_prim.msg_type)) {
+		LOGP(DPCU, LOGL_ERROR, "Received short PCU message type 0x%02x "
+			"(%d bytes)\n", pcu_prim.msg_type, rc);
+		return -EINVAL;
+	}
 
-	/* as we always synchronously process the message in pcu_rx() and
-	 * its callbacks, we can free the message here. */
-	msgb_free(msg);
+	if (pcu_prim.msg_type == PCU_IF_MSG_SHM_REQ)
+		return pcu_rx_shm_req(state, &pcu_prim.u.shm_req);
+	if (pcu_prim.msg_type == PCU_IF_MSG_VERSION_IND)
+		return pcu_rx_version_ind(state, &pcu_prim.u.version_ind);
 
-	return rc;
+	return pcu_rx(state, pcu_prim.msg_type, &pcu_prim);
 
 close:
-	msgb_free(msg);
 	pcu_sock_close(state);
 	return -1;
 }
@@ -736,18 +1157,23 @@ close:
 static int pcu_sock_write(struct osmo_fd *bfd)
 {
 	struct pcu_sock_state *state = bfd->data;
+	struct msgb *msg;
 	int rc;
 
-	while (!llist_empty(&state->upqueue)) {
-		struct msgb *msg, *msg2;
+	/* peek at the beginning of the queues */
+	while ((msg = pcu_upqueue_peek(state))) {
 		struct gsm_pcu_if *pcu_prim;
 
-		/* peek at the beginning of the queue */
-		msg = llist_entry(state->upqueue.next, struct msgb, list);
 		pcu_prim = (struct gsm_pcu_if *)msg->data;
 
 		bfd->when &= ~BSC_FD_WRITE;
 
+		/* the PCU can't serve an RTS.req that waited too long */
+		if (pcu_msg_stale(state, pcu_prim, false)) {
+			state->upqueue_stats.dropped_stale++;
+			goto dontsend;
+		}
+
 		/* bug hunter 8-): maybe someone forgot msgb_put(...) ? */
 		if (!msgb_length(msg)) {
 			LOGP(DPCU, LOGL_ERROR, "message type (%d) with ZERO "
@@ -769,10 +1195,16 @@ static int pcu_sock_write(struct osmo_fd *bfd)
 
 dontsend:
 		/* _after_ we send it, we can deueue */
-		msg2 = msgb_dequeue(&state->upqueue);
-		assert(msg == msg2);
+		llist_del(&msg->list);
+		state->upqueue_len--;
 		msgb_free(msg);
 	}
+
+	if (state->shm_pending && !state->upqueue_len) {
+		bfd->when &= ~BSC_FD_WRITE;
+		pcu_shm_activate(state);
+	}
+
 	return 0;
 
 close:
@@ -834,26 +1266,28 @@ static int pcu_sock_accept(struct osmo_fd *bfd, unsigned int flags)
 		return -1;
 	}
 
-	LOGP(DPCU, LOGL_NOTICE, "PCU socket connected to external PCU\n");
+	LOGP(DPCU, LOGL_NOTICE, "PCU socket of BTS %u connected to external "
+		"PCU\n", state->bts->nr);
 
 	/* send current info */
-	pcu_tx_info_ind();
+	pcu_tx_info_ind(state->bts);
 
 	return 0;
 }
 
-int pcu_sock_init(const char *path)
+int pcu_sock_init(struct gsm_bts *bts, const char *path)
 {
 	struct pcu_sock_state *state;
 	struct osmo_fd *bfd;
-	int rc;
+	int rc, i;
 
-	state = talloc_zero(NULL, struct pcu_sock_state);
+	state = talloc_zero(bts, struct pcu_sock_state);
 	if (!state)
 		return -ENOMEM;
 
-	INIT_LLIST_HEAD(&state->upqueue);
-	state->net = &bts_gsmnet;
+	for (i = 0; i < _NUM_PCU_PRIO; i++)
+		INIT_LLIST_HEAD(&state->upqueue[i]);
+	state->bts = bts;
 	state->conn_bfd.fd = -1;
 
 	bfd = &state->listen_bfd;
@@ -880,22 +1314,22 @@ int pcu_sock_init(const char *path)
 		return rc;
 	}
 
-	osmo_signal_register_handler(SS_GLOBAL, pcu_if_signal_cb, NULL);
+	osmo_signal_register_handler(SS_GLOBAL, pcu_if_signal_cb, state);
 
-	bts_gsmnet.pcu_state = state;
+	bts_role_bts(bts)->pcu.state = state;
 
 	return 0;
 }
 
-void pcu_sock_exit(void)
+void pcu_sock_exit(struct gsm_bts *bts)
 {
-	struct pcu_sock_state *state = bts_gsmnet.pcu_state;
+	struct pcu_sock_state *state = pcu_state(bts);
 	struct osmo_fd *bfd, *conn_bfd;
 
 	if (!state)
 		return;
 
-	osmo_signal_unregister_handler(SS_GLOBAL, pcu_if_signal_cb, NULL);
+	osmo_signal_unregister_handler(SS_GLOBAL, pcu_if_signal_cb, state);
 	conn_bfd = &state->conn_bfd;
 	if (conn_bfd->fd > 0)
 		pcu_sock_close(state);
@@ -903,12 +1337,11 @@ void pcu_sock_exit(void)
 	close(bfd->fd);
 	osmo_fd_unregister(bfd);
 	talloc_free(state);
-	bts_gsmnet.pcu_state = NULL;
+	bts_role_bts(bts)->pcu.state = NULL;
 }
 
-bool pcu_connected(void) {
-	struct gsm_network *net = &bts_gsmnet;
-	struct pcu_sock_state *state = net->pcu_state;
+bool pcu_connected(struct gsm_bts *bts) {
+	struct pcu_sock_state *state = pcu_state(bts);
 
 	if (!state)
 		return false;
@@ -916,3 +1349,32 @@ bool pcu_connected(void) {
 		return false;
 	return true;
 }
+
+void pcu_sock_vty_dump(struct vty *vty, struct gsm_bts *bts)
+{
+	struct pcu_sock_state *state = pcu_state(bts);
+	const struct pcu_shm_stats *st;
+
+	if (!state)
+		return;
+
+	vty_out(vty, "  PCU: %s, interface version 0x%02x%s",
+		pcu_connected(bts) ? "connected" : "not connected",
+		state->pcu_version ? state->pcu_version : PCU_IF_VERSION_LEGACY,
+		VTY_NEWLINE);
+	vty_out(vty, "    Queue: %u of %u (ctrl %u, data %u, clock %u), "
+		"high watermark %u%s", state->upqueue_len, PCU_UPQUEUE_MAX,
+		llist_length(&state->upqueue[PCU_PRIO_CTRL]),
+		llist_length(&state->upqueue[PCU_PRIO_DATA]),
+		llist_length(&state->upqueue[PCU_PRIO_CLOCK]),
+		state->upqueue_stats.hwm, VTY_NEWLINE);
+	vty_out(vty, "    Dropped: %u stale RTS/TIME, %u on full queue%s",
+		state->upqueue_stats.dropped_stale,
+		state->upqueue_stats.dropped_full, VTY_NEWLINE);
+	if (state->shm) {
+		st = pcu_shm_get_stats(state->shm);
+		vty_out(vty, "    Shared memory: %u sent, %u received, "
+			"%u dropped, %u doorbells%s", st->tx, st->rx,
+			st->tx_full, st->doorbells, VTY_NEWLINE);
+	}
+}
@@ -22,6 +22,7 @@
 #include <stdint.h>
 #include <unistd.h>
 #include <errno.h>
+#include <string.h>
 
 #include <osmo-bts/logging.h>
 #include <osmo-bts/bts.h>
@@ -29,47 +30,72 @@
 #include <osmo-bts/measurement.h>
 #include <osmo-bts/bts_model.h>
 #include <osmo-bts/l1sap.h>
+#include <osmo-bts/power_control.h>
 
-/*
- * Check if manual power control is needed
- * Check if fixed power was selected
- * Check if the MS is already using our level if not
- * the value is bogus..
- * TODO: Add a timeout.. e.g. if the ms is not capable of reaching
- * the value we have set.
- */
-int lchan_ms_pwr_ctrl(struct gsm_lchan *lchan,
-		      const uint8_t ms_power, const int rxLevel)
+/* the defaults keep the behaviour of the former MS power loop: no
+ * averaging, no hysteresis, any step size */
+const struct bts_power_ctrl_params power_ctrl_ul_default = {
+	.target = -75,
+	.ewma = 100,
+	.rxqual_max = 7,
+};
+
+/* divide by 256, rounding to the nearest integer */
+static int q8_round(int32_t val)
 {
-	int rx;
-	int cur_dBm, new_dBm, new_pwr;
-	struct gsm_bts *bts = lchan->ts->trx->bts;
-	struct gsm_bts_role_bts *btsb = bts_role_bts(bts);
-	const enum gsm_band band = bts->band;
+	return (val + (val < 0 ? -128 : 128)) / 256;
+}
 
-	if (!trx_ms_pwr_ctrl_is_osmo(lchan->ts->trx))
-		return 0;
-	if (lchan->ms_power_ctrl.fixed)
-		return 0;
+int power_ctrl_step(const struct bts_power_ctrl_params *par,
+		    struct lchan_power_ctrl_state *st,
+		    int target, int rxlev, int rxqual)
+{
+	int32_t rxlev256 = rxlev * 256;
+	int32_t rxqual256 = rxqual * 256;
+	int delta;
 
-	/* The phone hasn't reached the power level yet */
-	if (lchan->ms_power_ctrl.current != ms_power)
-		return 0;
+	if (!st->valid) {
+		st->rxlev = rxlev256;
+		st->rxqual = rxqual256;
+		st->valid = 1;
+	} else {
+		st->rxlev += (rxlev256 - st->rxlev) * par->ewma / 100;
+		st->rxqual += (rxqual256 - st->rxqual) * par->ewma / 100;
+	}
 
-	/*
-	 * What is the difference between what we want and received?
-	 * Ignore a margin that is within the range of measurement
-	 * and MS output issues.
-	 */
-	rx = btsb->ul_power_target - rxLevel;
-	if (rx >= 0 && rx < 1)
-		return 0;
-	if (rx < 0 && rx > -1)
+	delta = target - q8_round(st->rxlev);
+	if (delta >= -par->hyst && delta <= par->hyst)
+		delta = 0;
+
+	/* a bad link needs more power, whatever the level says */
+	if (st->rxqual > par->rxqual_max * 256 && delta < 2)
+		delta = 2;
+
+	if (par->raise_max && delta > par->raise_max)
+		delta = par->raise_max;
+	if (par->lower_max && delta < -par->lower_max)
+		delta = -par->lower_max;
+
+	return delta;
+}
+
+void lchan_power_ctrl_reset(struct gsm_lchan *lchan)
+{
+	struct gsm_lchan_role_bts *lrb = lchan_role_bts(lchan);
+
+	memset(&lrb->ul_pwr, 0, sizeof(lrb->ul_pwr));
+}
+
+int lchan_ms_pwr_change(struct gsm_lchan *lchan, int delta)
+{
+	const enum gsm_band band = lchan->ts->trx->bts->band;
+	int cur_dBm, new_dBm, new_pwr;
+
+	if (delta == 0)
 		return 0;
 
-	/* We don't really care about the truncation of int + float */
-	cur_dBm = ms_pwr_dbm(band, ms_power);
-	new_dBm = cur_dBm + rx;
+	cur_dBm = ms_pwr_dbm(band, lchan->ms_power_ctrl.current);
+	new_dBm = cur_dBm + delta;
 
 	/* Clamp negative values and do it depending on the band */
 	if (new_dBm < 0)
@@ -89,11 +115,50 @@ int lchan_ms_pwr_ctrl(struct gsm_lchan *lchan,
 	}
 
 	new_pwr = ms_pwr_ctl_lvl(band, new_dBm);
-	if (lchan->ms_power_ctrl.current != new_pwr) {
-		lchan->ms_power_ctrl.current = new_pwr;
-		bts_model_adjst_ms_pwr(lchan);
-		return 1;
-	}
+	if (lchan->ms_power_ctrl.current == new_pwr)
+		return 0;
+
+	LOGP(DLOOP, LOGL_INFO, "%s %s MS power from %d dBm to %d dBm\n",
+	     gsm_lchan_name(lchan), delta > 0 ? "Raising" : "Lowering",
+	     cur_dBm, ms_pwr_dbm(band, new_pwr));
+
+	lchan->ms_power_ctrl.current = new_pwr;
+	bts_model_adjst_ms_pwr(lchan);
+	return 1;
+}
+
+/*
+ * Check if manual power control is needed
+ * Check if fixed power was selected
+ * Check if the MS is already using our level if not
+ * the value is bogus..
+ * TODO: Add a timeout.. e.g. if the ms is not capable of reaching
+ * the value we have set.
+ */
+int lchan_ms_pwr_ctrl(struct gsm_lchan *lchan,
+		      const uint8_t ms_power, const int rxLevel,
+		      const uint8_t rxQual)
+{
+	struct gsm_bts_role_bts *btsb = bts_role_bts(lchan->ts->trx->bts);
+	int delta;
+
+	if (!trx_ms_pwr_ctrl_is_osmo(lchan->ts->trx))
+		return 0;
+	if (lchan->ms_power_ctrl.fixed)
+		return 0;
+
+	/* The phone hasn't reached the power level yet */
+	if (lchan->ms_power_ctrl.current != ms_power)
+		return 0;
+
+	/*
+	 * What is the difference between what we want and received?
+	 * Ignore a margin that is within the range of measurement
+	 * and MS output issues.
+	 */
+	delta = power_ctrl_step(&btsb->ul_power_ctrl,
+				&lchan_role_bts(lchan)->ul_pwr,
+				btsb->ul_power_ctrl.target, rxLevel, rxQual);
 
-	return 0;
+	return lchan_ms_pwr_change(lchan, delta);
 }
@@ -36,6 +36,8 @@
 #include <osmocom/gsm/protocol/ipaccess.h>
 #include <osmocom/trau/osmo_ortp.h>
 
+#include <ortp/ortp.h>
+
 #include <osmo-bts/logging.h>
 #include <osmo-bts/gsm_data.h>
 #include <osmo-bts/abis.h>
@@ -50,6 +52,7 @@
 #include <osmo-bts/cbch.h>
 #include <osmo-bts/l1sap.h>
 #include <osmo-bts/bts_model.h>
+#include <osmo-bts/power_control.h>
 
 //#define FAKE_CIPH_MODE_COMPL
 
@@ -147,19 +150,18 @@ static int report_error(struct gsm_bts_trx *trx)
 static struct gsm_lchan *lchan_lookup(struct gsm_bts_trx *trx, uint8_t chan_nr,
 				      const char *log_name)
 {
-	int rc;
-	struct gsm_lchan *lchan = rsl_lchan_lookup(trx, chan_nr, &rc);
+	const struct chan_nr_map *e = trx_chan_nr_map(trx, chan_nr);
 
-	if (!lchan) {
+	if (e->rsl == CHAN_NR_RSL_UNKNOWN) {
 		LOGP(DRSL, LOGL_ERROR, "%sunknown chan_nr=0x%02x\n", log_name,
 		     chan_nr);
 		return NULL;
 	}
 
-	if (rc < 0)
+	if (e->rsl == CHAN_NR_RSL_MISMATCH)
 		LOGP(DRSL, LOGL_ERROR, "%s %smismatching chan_nr=0x%02x\n",
-		     gsm_ts_and_pchan_name(lchan->ts), log_name, chan_nr);
-	return lchan;
+		     gsm_ts_and_pchan_name(e->lchan->ts), log_name, chan_nr);
+	return e->lchan;
 }
 
 static struct msgb *rsl_msgb_alloc(int hdr_size)
@@ -408,7 +410,7 @@ static int rsl_rx_paging_cmd(struct gsm_bts_trx *trx, struct msgb *msg)
 						 "BTS paging table is full\n");
 	}
 
-	pcu_tx_pag_req(identity_lv, chan_needed);
+	pcu_tx_pag_req(trx->bts, identity_lv, chan_needed);
 
 	return 0;
 }
@@ -795,6 +797,7 @@ static int rsl_rx_chan_activ(struct msgb *msg)
 
 	if (ts->pchan == GSM_PCHAN_TCH_F_TCH_H_PDCH) {
 		ts->dyn.pchan_want = dyn_pchan_from_chan_nr(dch->chan_nr);
+		ts_chan_nr_map_update(ts);
 		DEBUGP(DRSL, "%s rx chan activ\n", gsm_ts_and_pchan_name(ts));
 
 		if (ts->dyn.pchan_is != ts->dyn.pchan_want) {
@@ -864,6 +867,8 @@ static int rsl_rx_chan_activ(struct msgb *msg)
 		lchan->ms_power_ctrl.current = lchan->ms_power;
 		lchan->ms_power_ctrl.fixed = 0;
 	}
+	/* start the power control loops from the levels given above */
+	lchan_power_ctrl_reset(lchan);
 	/* 9.3.24 Timing Advance */
 	if (TLVP_PRESENT(&tp, RSL_IE_TIMING_ADVANCE))
 		lchan->rqd_ta = *TLVP_VAL(&tp, RSL_IE_TIMING_ADVANCE);
@@ -965,9 +970,9 @@ static int rsl_rx_chan_activ(struct msgb *msg)
 		 * the PCU is not connected yet, ignore for now; the PCU will
 		 * catch up (and send the RSL ack) once it connects.
 		 */
-		if (pcu_connected()) {
+		if (pcu_connected(ts->trx->bts)) {
 			DEBUGP(DRSL, "%s Activate via PCU\n", gsm_ts_and_pchan_name(ts));
-			rc = pcu_tx_info_ind();
+			rc = pcu_tx_info_ind(ts->trx->bts);
 		}
 		else {
 			DEBUGP(DRSL, "%s Activate via PCU when PCU connects\n",
@@ -1006,15 +1011,17 @@ static int dyn_ts_pdch_release(struct gsm_lchan *lchan)
 	 * pick it up and wait for PCU to disable the channel.
 	 */
 	ts->dyn.pchan_want = GSM_PCHAN_NONE;
+	ts_chan_nr_map_update(ts);
 
-	if (!pcu_connected()) {
+	if (!pcu_connected(ts->trx->bts)) {
 		/* PCU not connected yet. Just record the new type and done,
 		 * the PCU will pick it up once connected. */
 		ts->dyn.pchan_is = GSM_PCHAN_NONE;
+		ts_chan_nr_map_update(ts);
 		return 1;
 	}
 
-	return pcu_tx_info_ind();
+	return pcu_tx_info_ind(ts->trx->bts);
 }
 
 /* 8.4.14 RF CHANnel RELease is received */
@@ -1024,9 +1031,12 @@ static int rsl_rx_rf_chan_rel(struct gsm_lchan *lchan, uint8_t chan_nr)
 
 	if (lchan->abis_ip.rtp_socket) {
 		rsl_tx_ipac_dlcx_ind(lchan, RSL_ERR_NORMAL_UNSPEC);
+		/* batched uplink frames still refer to the socket */
+		rtp_batch_flush(bts_role_bts(lchan->ts->trx->bts)->rtp_batch);
 		osmo_rtp_socket_free(lchan->abis_ip.rtp_socket);
 		lchan->abis_ip.rtp_socket = NULL;
 		msgb_queue_flush(&lchan->dl_tch_queue);
+		jitbuf_flush(&lchan_role_bts(lchan)->jitbuf);
 	}
 
 	/* release handover state */
@@ -1371,6 +1381,7 @@ static void rsl_add_rtp_stats(struct gsm_lchan *lchan, struct msgb *msg)
 	} __attribute__((packed));
 
 	struct ipa_stats stats;
+	struct jitbuf *jb = &lchan_role_bts(lchan)->jitbuf;
 
 
 	memset(&stats, 0, sizeof(stats));
@@ -1380,12 +1391,28 @@ static void rsl_add_rtp_stats(struct gsm_lchan *lchan, struct msgb *msg)
 				&stats.packets_sent, &stats.octets_sent,
 				&stats.packets_recv, &stats.octets_recv,
 				&stats.packets_lost, &stats.arrival_jitter);
+
+	/* frames which made it to us but were discarded by the jitter
+	 * buffer are as good as lost for the downlink */
+	stats.packets_lost += jb->stats.late + jb->stats.overflow;
+	stats.avg_tx_delay = jitbuf_avg_delay_ms(jb);
+
+	LOGP(DRTP, LOGL_INFO, "%s jitter buffer: in=%u out=%u late=%u dup=%u "
+	     "overflow=%u lost=%u underrun=%u resync=%u jitter=%u depth=%u/%u "
+	     "avg_delay=%ums\n", gsm_lchan_name(lchan), jb->stats.frames_in,
+	     jb->stats.frames_out, jb->stats.late, jb->stats.dup,
+	     jb->stats.overflow, jb->stats.lost, jb->stats.underrun,
+	     jb->stats.resync, jitbuf_jitter(jb), jb->depth,
+	     jb->stats.depth_max, stats.avg_tx_delay);
+
 	/* convert to network byte order */
 	stats.packets_sent = htonl(stats.packets_sent);
 	stats.octets_sent = htonl(stats.octets_sent);
 	stats.packets_recv = htonl(stats.packets_recv);
 	stats.octets_recv = htonl(stats.octets_recv);
 	stats.packets_lost = htonl(stats.packets_lost);
+	stats.arrival_jitter = htonl(stats.arrival_jitter);
+	stats.avg_tx_delay = htonl(stats.avg_tx_delay);
 
 	msgb_tlv_put(msg, RSL_IE_IPAC_CONN_STAT, sizeof(stats), (uint8_t *) &stats);
 }
@@ -1647,8 +1674,7 @@ static int rsl_rx_ipac_XXcx(struct msgb *msg)
 		/* FIXME: select default value depending on speech_mode */
 		//if (!payload_type)
 		lchan->tch.last_fn = LCHAN_FN_DUMMY;
-		lchan->abis_ip.rtp_socket = osmo_rtp_socket_create(lchan->ts->trx,
-								OSMO_RTP_F_POLL);
+		lchan->abis_ip.rtp_socket = osmo_rtp_socket_create(lchan->ts->trx, 0);
 		if (!lchan->abis_ip.rtp_socket) {
 			LOGP(DRSL, LOGL_ERROR,
 			     "%s IPAC Failed to create RTP/RTCP sockets\n",
@@ -1661,11 +1687,10 @@ static int rsl_rx_ipac_XXcx(struct msgb *msg)
 			return tx_ipac_XXcx_nack(lchan, RSL_ERR_RES_UNAVAIL,
 						 inc_ip_port, dch->c.msg_type);
 		}
+		/* de-jittering is done by our own per-lchan buffer, so
+		 * have ORTP hand us every packet as soon as it arrives */
 		rc = osmo_rtp_socket_set_param(lchan->abis_ip.rtp_socket,
-					       btsb->rtp_jitter_adaptive ?
-					       OSMO_RTP_P_JIT_ADAP :
-					       OSMO_RTP_P_JITBUF,
-					       btsb->rtp_jitter_buf_ms);
+					       OSMO_RTP_P_JITBUF, 0);
 		if (rc < 0)
 			LOGP(DRSL, LOGL_ERROR,
 			     "%s IPAC Failed to set RTP socket parameters: %s\n",
@@ -1674,6 +1699,12 @@ static int rsl_rx_ipac_XXcx(struct msgb *msg)
 			LOGP(DRSL, LOGL_INFO,
 			     "%s IPAC set RTP socket parameters: %d\n",
 			     gsm_lchan_name(lchan), rc);
+		/* a compensation of 0 still leaves ORTP's buffer in the
+		 * path, switch it off entirely */
+		rtp_session_enable_jitter_buffer(
+				lchan->abis_ip.rtp_socket->sess, FALSE);
+		jitbuf_init(&lchan_role_bts(lchan)->jitbuf,
+			    btsb->rtp_jitter_buf_ms, btsb->rtp_jitter_adaptive);
 		lchan->abis_ip.rtp_socket->priv = lchan;
 		lchan->abis_ip.rtp_socket->rx_cb = &l1sap_rtp_rx_cb;
 
@@ -1705,6 +1736,7 @@ static int rsl_rx_ipac_XXcx(struct msgb *msg)
 			osmo_rtp_socket_free(lchan->abis_ip.rtp_socket);
 			lchan->abis_ip.rtp_socket = NULL;
 			msgb_queue_flush(&lchan->dl_tch_queue);
+			jitbuf_flush(&lchan_role_bts(lchan)->jitbuf);
 			return tx_ipac_XXcx_nack(lchan, RSL_ERR_RES_UNAVAIL,
 						 inc_ip_port, dch->c.msg_type);
 		}
@@ -1736,9 +1768,11 @@ static int rsl_rx_ipac_XXcx(struct msgb *msg)
 		LOGP(DRSL, LOGL_ERROR,
 		     "%s Failed to connect RTP/RTCP sockets\n",
 		     gsm_lchan_name(lchan));
+		rtp_batch_flush(btsb->rtp_batch);
 		osmo_rtp_socket_free(lchan->abis_ip.rtp_socket);
 		lchan->abis_ip.rtp_socket = NULL;
 		msgb_queue_flush(&lchan->dl_tch_queue);
+		jitbuf_flush(&lchan_role_bts(lchan)->jitbuf);
 		return tx_ipac_XXcx_nack(lchan, RSL_ERR_RES_UNAVAIL,
 					 inc_ip_port, dch->c.msg_type);
 	}
@@ -1771,6 +1805,13 @@ static int rsl_rx_ipac_XXcx(struct msgb *msg)
 	if (speech_mode)
 		lchan->abis_ip.speech_mode = *speech_mode;
 
+	/* header cache of the batched RTP TX path */
+	if (dch->c.msg_type == RSL_MT_IPAC_CRCX)
+		rtp_batch_lchan_init(lchan);
+	else if (payload_type2 || payload_type)
+		rtp_batch_lchan_set_pt(lchan, payload_type2 ? *payload_type2 :
+							      *payload_type);
+
 	/* FIXME: CSD, jitterbuffer, compression */
 
 	return rsl_tx_ipac_XXcx_ack(lchan, payload_type2 ? 1 : 0,
@@ -1791,9 +1832,11 @@ static int rsl_rx_ipac_dlcx(struct msgb *msg)
 		inc_conn_id = 1;
 
 	rc = rsl_tx_ipac_dlcx_ack(lchan, inc_conn_id);
+	rtp_batch_flush(bts_role_bts(lchan->ts->trx->bts)->rtp_batch);
 	osmo_rtp_socket_free(lchan->abis_ip.rtp_socket);
 	lchan->abis_ip.rtp_socket = NULL;
 	msgb_queue_flush(&lchan->dl_tch_queue);
+	jitbuf_flush(&lchan_role_bts(lchan)->jitbuf);
 	return rc;
 }
 
@@ -1940,8 +1983,8 @@ static void rsl_rx_dyn_pdch(struct msgb *msg, bool pdch_act)
 		 * disconnect immediately from here. The PCU will catch up when
 		 * it connects. */
 		/* TODO: timeout on channel connect / disconnect request from PCU? */
-		if (pcu_connected())
-			rc = pcu_tx_info_ind();
+		if (pcu_connected(ts->trx->bts))
+			rc = pcu_tx_info_ind(ts->trx->bts);
 		else
 			rc = bts_model_ts_disconnect(ts);
 	}
@@ -1997,6 +2040,7 @@ static void osmo_dyn_ts_disconnected(struct gsm_bts_trx_ts *ts)
 		     "%s Dyn TS disconnected, but invalid desired pchan",
 		     gsm_ts_and_pchan_name(ts));
 		ts->dyn.pchan_want = GSM_PCHAN_NONE;
+		ts_chan_nr_map_update(ts);
 		/* TODO: how would this recover? */
 		return;
 	}
@@ -2055,7 +2099,7 @@ static void ipacc_dyn_pdch_ts_connected(struct gsm_bts_trx_ts *ts)
 		/* The PDTCH is connected, now tell the PCU about it. Except
 		 * when the PCU is not connected (yet), then there's nothing
 		 * left to do now. The PCU will catch up when it connects. */
-		if (!pcu_connected()) {
+		if (!pcu_connected(ts->trx->bts)) {
 			ipacc_dyn_pdch_complete(ts, 0);
 			return;
 		}
@@ -2063,7 +2107,7 @@ static void ipacc_dyn_pdch_ts_connected(struct gsm_bts_trx_ts *ts)
 		/* The PCU will request to activate the PDTCH SAPIs, which,
 		 * when done, will call back to ipacc_dyn_pdch_complete(). */
 		/* TODO: timeout on channel connect / disconnect request from PCU? */
-		rc = pcu_tx_info_ind();
+		rc = pcu_tx_info_ind(ts->trx->bts);
 
 		/* Error? then NACK right now. */
 		if (rc)
@@ -2085,6 +2129,7 @@ static void osmo_dyn_ts_connected(struct gsm_bts_trx_ts *ts)
 	}
 
 	ts->dyn.pchan_is = ts->dyn.pchan_want;
+	ts_chan_nr_map_update(ts);
 	DEBUGP(DRSL, "%s Connected\n", gsm_ts_and_pchan_name(ts));
 
 	/* continue where we left off before re-connecting the TS. */
@@ -0,0 +1,233 @@
+/* Batched uplink RTP transmission across all lchans */
+
+/* (C) 2017 by sysmocom s.f.m.c. GmbH
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* Instead of one osmo_rtp_send_frame_ext() per uplink speech frame, frames
+ * of all lchans are collected during one TDMA frame and handed to the
+ * kernel with sendmmsg() at its end.  This avoids the msgb and ORTP
+ * scheduling overhead per frame.
+ *
+ * The frames leave from the RTP socket of their lchan and carry the SSRC
+ * of its ORTP session, so the MGW sees the source port and SSRC announced
+ * in the IPAC CRCX ACK.  Sequence number, timestamp and sender statistics
+ * are taken from and written back to that session, so the RTCP SRs ORTP
+ * sends match the stream, and switching batching on or off during a call
+ * doesn't make sequence number or timestamp jump.  As one sendmmsg() only
+ * covers one socket, queued frames are sent in runs of the same socket. */
+
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/utils.h>
+#include <osmocom/trau/osmo_ortp.h>
+
+#include <ortp/ortp.h>
+
+#include <osmo-bts/logging.h>
+#include <osmo-bts/gsm_data.h>
+#include <osmo-bts/rtp_batch.h>
+
+/* 8 TRX * 8 TS * 2 TCH/H, more than one TDMA frame worth of frames */
+#define RTP_BATCH_MAX		128
+/* largest speech payload is FR with 33 bytes, leave some margin */
+#define RTP_BATCH_PL_MAX	64
+
+struct rtp_batch_pkt {
+	uint8_t buf[RTP_BATCH_HDR_LEN + RTP_BATCH_PL_MAX];
+	struct sockaddr_in dst;
+	int fd;
+};
+
+struct rtp_batch {
+	unsigned int count;
+	struct rtp_batch_pkt pkt[RTP_BATCH_MAX];
+	struct iovec iov[RTP_BATCH_MAX];
+	struct mmsghdr mmsg[RTP_BATCH_MAX];
+
+	struct rtp_batch_stats stats;
+};
+
+struct rtp_batch *rtp_batch_alloc(void *ctx)
+{
+	struct rtp_batch *rb;
+	int i;
+
+	rb = talloc_zero(ctx, struct rtp_batch);
+	if (!rb)
+		return NULL;
+
+	/* the iovec/msghdr arrays point into the packet slots once and
+	 * for all, only the lengths change per packet */
+	for (i = 0; i < RTP_BATCH_MAX; i++) {
+		rb->iov[i].iov_base = rb->pkt[i].buf;
+		rb->mmsg[i].msg_hdr.msg_iov = &rb->iov[i];
+		rb->mmsg[i].msg_hdr.msg_iovlen = 1;
+		rb->mmsg[i].msg_hdr.msg_name = &rb->pkt[i].dst;
+		rb->mmsg[i].msg_hdr.msg_namelen = sizeof(rb->pkt[i].dst);
+	}
+
+	return rb;
+}
+
+void rtp_batch_free(struct rtp_batch *rb)
+{
+	talloc_free(rb);
+}
+
+void rtp_batch_lchan_init(struct gsm_lchan *lchan)
+{
+	struct rtp_batch_lchan *rbl = &lchan_role_bts(lchan)->rtp_tx;
+	struct osmo_rtp_socket *rs = lchan->abis_ip.rtp_socket;
+	uint32_t ssrc;
+
+	memset(rbl, 0, sizeof(*rbl));
+	if (!rs)
+		return;
+
+	/* the SSRC of the ORTP session, which also sends the RTCP */
+	ssrc = rtp_session_get_send_ssrc(rs->sess);
+
+	rbl->hdr[0] = 0x80;	/* version 2, no padding/extension/CSRC */
+	rbl->hdr[8] = ssrc >> 24;
+	rbl->hdr[9] = ssrc >> 16;
+	rbl->hdr[10] = ssrc >> 8;
+	rbl->hdr[11] = ssrc;
+
+	rtp_batch_lchan_set_pt(lchan, lchan->abis_ip.rtp_payload2 ?
+				      lchan->abis_ip.rtp_payload2 :
+				      lchan->abis_ip.rtp_payload);
+}
+
+void rtp_batch_lchan_set_pt(struct gsm_lchan *lchan, uint8_t pt)
+{
+	lchan_role_bts(lchan)->rtp_tx.hdr[1] = pt & 0x7f;
+}
+
+int rtp_batch_enqueue(struct rtp_batch *rb, struct gsm_lchan *lchan,
+		      const uint8_t *data, unsigned int len,
+		      uint32_t duration, bool marker)
+{
+	struct rtp_batch_lchan *rbl = &lchan_role_bts(lchan)->rtp_tx;
+	struct osmo_rtp_socket *rs = lchan->abis_ip.rtp_socket;
+	struct rtp_batch_pkt *pkt;
+	uint16_t seq;
+	uint8_t *h;
+
+	if (len > RTP_BATCH_PL_MAX) {
+		LOGP(DRTP, LOGL_ERROR, "%s RTP payload too long for batch "
+		     "(%u)\n", gsm_lchan_name(lchan), len);
+		rb->stats.dropped++;
+		return -EMSGSIZE;
+	}
+
+	/* no remote address before MDCX */
+	if (!rs || !lchan->abis_ip.connect_ip)
+		return -ENOTCONN;
+	if (rs->flags & OSMO_RTP_F_DISABLED)
+		return 0;
+
+	/* batching was enabled after CRCX of this lchan */
+	if (!rbl->hdr[0])
+		rtp_batch_lchan_init(lchan);
+
+	if (rb->count >= RTP_BATCH_MAX)
+		rtp_batch_flush(rb);
+
+	pkt = &rb->pkt[rb->count];
+	h = pkt->buf;
+
+	/* continue the stream exactly like osmo_rtp_send_frame_ext() and
+	 * rtp_session_sendm_with_ts() would */
+	rs->tx_timestamp += duration;
+	seq = rs->sess->rtp.snd_seq++;
+	rs->sess->rtp.snd_last_ts = rs->tx_timestamp;
+	rs->sess->rtp.stats.packet_sent++;
+	rs->sess->rtp.stats.sent += len;
+
+	memcpy(h, rbl->hdr, RTP_BATCH_HDR_LEN);
+	if (marker)
+		h[1] |= 0x80;
+	h[2] = seq >> 8;
+	h[3] = seq;
+	h[4] = rs->tx_timestamp >> 24;
+	h[5] = rs->tx_timestamp >> 16;
+	h[6] = rs->tx_timestamp >> 8;
+	h[7] = rs->tx_timestamp;
+	memcpy(h + RTP_BATCH_HDR_LEN, data, len);
+
+	pkt->dst.sin_family = AF_INET;
+	pkt->dst.sin_addr.s_addr = htonl(lchan->abis_ip.connect_ip);
+	pkt->dst.sin_port = htons(lchan->abis_ip.connect_port);
+	pkt->fd = rs->rtp_bfd.fd;
+	rb->iov[rb->count].iov_len = RTP_BATCH_HDR_LEN + len;
+	rb->count++;
+
+	return 0;
+}
+
+int rtp_batch_flush(struct rtp_batch *rb)
+{
+	unsigned int sent = 0, run;
+	int rc;
+
+	if (!rb || !rb->count)
+		return 0;
+
+	while (sent < rb->count) {
+		/* queued frames of the same socket */
+		for (run = 1; sent + run < rb->count; run++) {
+			if (rb->pkt[sent + run].fd != rb->pkt[sent].fd)
+				break;
+		}
+
+		rc = sendmmsg(rb->pkt[sent].fd, &rb->mmsg[sent], run,
+			      MSG_DONTWAIT);
+		if (rc > 0) {
+			rb->stats.flushes++;
+			sent += rc;
+			continue;
+		}
+		if (rc < 0 && errno == EINTR)
+			continue;
+		/* the first remaining packet failed, skip it */
+		LOGP(DRTP, LOGL_DEBUG, "RTP batch sendmmsg() failed: %s\n",
+		     strerror(errno));
+		rb->stats.dropped++;
+		sent++;
+	}
+
+	rb->stats.packets += rb->count;
+	rb->count = 0;
+
+	return sent;
+}
+
+const struct rtp_batch_stats *rtp_batch_get_stats(const struct rtp_batch *rb)
+{
+	return &rb->stats;
+}
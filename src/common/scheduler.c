@@ -1453,8 +1453,7 @@ int trx_sched_set_mode(struct l1sched_trx *l1t, uint8_t chan_nr, uint8_t rsl_cmo
 				chan_state->dl_ft = initial_id;
 				chan_state->ul_cmr = initial_id;
 				chan_state->dl_cmr = initial_id;
-				chan_state->ber_sum = 0;
-				chan_state->ber_num = 0;
+				meas_acc_reset(&chan_state->ber);
 			}
 			rc = 0;
 		}
@@ -62,6 +62,9 @@ int get_p_nominal_mdBm(struct gsm_bts_trx *trx)
  * thermal management */
 int get_p_target_mdBm(struct gsm_bts_trx *trx, uint8_t bs_power_ie)
 {
+	if (bs_power_ie < TX_POWER_IE_NUM)
+		return trx->power_params.tbl.p_target_mdBm[bs_power_ie];
+
 	/* Pn subtracted by RSL BS Power IE (in 2 dB steps) */
 	return get_p_nominal_mdBm(trx) - to_mdB(bs_power_ie * 2);
 }
@@ -90,25 +93,23 @@ int get_p_eff_mdBm(struct gsm_bts_trx *trx, int p_target_mdBm)
 	return p_target_mdBm - tpp->ramp.attenuation_mdB - tpp->thermal_attenuation_mdB;
 }
 
+/* TRX output power required for a total output power of 'p_mdBm', i.e.
+ * the input drive level of the internal PA.  All gains are constant for
+ * a given ARFCN, so this is a single subtraction. */
+static inline int p_trxout_mdBm(const struct trx_power_params *tpp, int p_mdBm)
+{
+	if (tpp->tbl.trxout_gain_mdB == INT_MIN)
+		return INT_MIN;
+	return p_mdBm - tpp->tbl.trxout_gain_mdB;
+}
+
 /* calculate effect TRX output power required, taking into account the
  * attenuations required for power ramping and thermal management */
 int get_p_trxout_eff_mdBm(struct gsm_bts_trx *trx, int p_target_mdBm)
 {
 	struct trx_power_params *tpp = &trx->power_params;
-	int p_actual_mdBm, user_pa_drvlvl_mdBm, pa_drvlvl_mdBm;
-	unsigned int arfcn = trx->arfcn;
 
-	/* P_actual subtracted by any bulk gain added by the user */
-	p_actual_mdBm = get_p_eff_mdBm(trx, p_target_mdBm) - tpp->user_gain_mdB;
-
-	/* determine input drive level required at input to user PA */
-	user_pa_drvlvl_mdBm = get_pa_drive_level_mdBm(&tpp->user_pa, p_actual_mdBm, arfcn);
-
-	/* determine input drive level required at input to internal PA */
-	pa_drvlvl_mdBm = get_pa_drive_level_mdBm(&tpp->pa, user_pa_drvlvl_mdBm, arfcn);
-
-	/* internal PA input drive level is TRX output power */
-	return pa_drvlvl_mdBm;
+	return p_trxout_mdBm(tpp, get_p_eff_mdBm(trx, p_target_mdBm));
 }
 
 /* calculate target TRX output power required, ignoring the
@@ -116,26 +117,43 @@ int get_p_trxout_eff_mdBm(struct gsm_bts_trx *trx, int p_target_mdBm)
 int get_p_trxout_target_mdBm(struct gsm_bts_trx *trx, uint8_t bs_power_ie)
 {
 	struct trx_power_params *tpp = &trx->power_params;
-	int p_target_mdBm, user_pa_drvlvl_mdBm, pa_drvlvl_mdBm;
-	unsigned int arfcn = trx->arfcn;
-
-	/* P_target subtracted by any bulk gain added by the user */
-	p_target_mdBm = get_p_target_mdBm(trx, bs_power_ie) - tpp->user_gain_mdB;
 
-	/* determine input drive level required at input to user PA */
-	user_pa_drvlvl_mdBm = get_pa_drive_level_mdBm(&tpp->user_pa, p_target_mdBm, arfcn);
+	if (bs_power_ie < TX_POWER_IE_NUM)
+		return tpp->tbl.p_trxout_target_mdBm[bs_power_ie];
 
-	/* determine input drive level required at input to internal PA */
-	pa_drvlvl_mdBm = get_pa_drive_level_mdBm(&tpp->pa, user_pa_drvlvl_mdBm, arfcn);
-
-	/* internal PA input drive level is TRX output power */
-	return pa_drvlvl_mdBm;
+	return p_trxout_mdBm(tpp, get_p_target_mdBm(trx, bs_power_ie));
 }
 int get_p_trxout_target_mdBm_lchan(struct gsm_lchan *lchan)
 {
 	return get_p_trxout_target_mdBm(lchan->ts->trx, lchan->bs_power);
 }
 
+void power_tables_update(struct gsm_bts_trx *trx)
+{
+	struct trx_power_params *tpp = &trx->power_params;
+	int p_nominal_mdBm = get_p_nominal_mdBm(trx);
+	int user_pa_drvlvl_mdBm, pa_drvlvl_mdBm;
+	unsigned int arfcn = trx->arfcn;
+	int i;
+
+	/* walk the chain once for 0 dBm at the antenna, anything else is
+	 * just offset from that */
+	user_pa_drvlvl_mdBm = get_pa_drive_level_mdBm(&tpp->user_pa,
+						      -tpp->user_gain_mdB, arfcn);
+	pa_drvlvl_mdBm = get_pa_drive_level_mdBm(&tpp->pa,
+						 user_pa_drvlvl_mdBm, arfcn);
+	if (pa_drvlvl_mdBm == INT_MIN)
+		tpp->tbl.trxout_gain_mdB = INT_MIN;
+	else
+		tpp->tbl.trxout_gain_mdB = -pa_drvlvl_mdBm;
+
+	for (i = 0; i < TX_POWER_IE_NUM; i++) {
+		tpp->tbl.p_target_mdBm[i] = p_nominal_mdBm - to_mdB(i * 2);
+		tpp->tbl.p_trxout_target_mdBm[i] =
+			p_trxout_mdBm(tpp, tpp->tbl.p_target_mdBm[i]);
+	}
+}
+
 
 /* output power ramping code */
 
@@ -158,6 +176,12 @@ static int we_are_ramping_up(struct gsm_bts_trx *trx)
 
 static void power_ramp_do_step(struct gsm_bts_trx *trx, int first);
 
+/* a step timed by the frame number is also guarded by the step timer, so
+ * the ramp continues if the PHY stops delivering time indications */
+#define RAMP_FN_BACKUP_SEC	2
+
+static void power_ramp_backup_cb(void *_trx);
+
 /* timer call-back for the ramp tumer */
 static void power_ramp_timer_cb(void *_trx)
 {
@@ -229,10 +253,58 @@ static void power_ramp_do_step(struct gsm_bts_trx *trx, int first)
 		}
 	}
 
-	/* schedule timer for the next step */
-	tpp->ramp.step_timer.data = trx;
-	tpp->ramp.step_timer.cb = power_ramp_timer_cb;
-	osmo_timer_schedule(&tpp->ramp.step_timer, tpp->ramp.step_interval_sec, 0);
+	/* schedule the next step */
+	if (tpp->ramp.fn_clock) {
+		struct gsm_bts_role_bts *btsb = bts_role_bts(trx->bts);
+		/* a TDMA frame lasts 60/13 ms */
+		uint32_t frames = tpp->ramp.step_interval_sec * 650 / 3;
+
+		tpp->ramp.step_fn = (btsb->gsm_time.fn + frames) % GSM_HYPERFRAME;
+		tpp->ramp.step_pending = 1;
+		tpp->ramp.step_timer.data = trx;
+		tpp->ramp.step_timer.cb = power_ramp_backup_cb;
+		osmo_timer_schedule(&tpp->ramp.step_timer,
+			tpp->ramp.step_interval_sec + RAMP_FN_BACKUP_SEC, 0);
+	} else {
+		tpp->ramp.step_timer.data = trx;
+		tpp->ramp.step_timer.cb = power_ramp_timer_cb;
+		osmo_timer_schedule(&tpp->ramp.step_timer,
+				    tpp->ramp.step_interval_sec, 0);
+	}
+}
+
+void power_ramp_fn_tick(struct gsm_bts_trx *trx, uint32_t fn)
+{
+	struct trx_power_params *tpp = &trx->power_params;
+	uint32_t delta;
+
+	tpp->ramp.fn_clock = 1;
+	if (!tpp->ramp.step_pending)
+		return;
+
+	/* not yet due as long as step_fn lies ahead of fn */
+	delta = (fn + GSM_HYPERFRAME - tpp->ramp.step_fn) % GSM_HYPERFRAME;
+	if (delta >= GSM_HYPERFRAME / 2)
+		return;
+
+	tpp->ramp.step_pending = 0;
+	osmo_timer_del(&tpp->ramp.step_timer);
+	power_ramp_timer_cb(trx);
+}
+
+/* the frame number did not reach step_fn in time, go back to the timer
+ * until the next time indication */
+static void power_ramp_backup_cb(void *_trx)
+{
+	struct gsm_bts_trx *trx = _trx;
+	struct trx_power_params *tpp = &trx->power_params;
+
+	LOGP(DL1C, LOGL_NOTICE, "No TDMA frame numbers from the PHY, "
+	     "timing the power ramp by timer\n");
+
+	tpp->ramp.fn_clock = 0;
+	tpp->ramp.step_pending = 0;
+	power_ramp_timer_cb(trx);
 }
 
 
@@ -247,6 +319,9 @@ int power_ramp_start(struct gsm_bts_trx *trx, int p_total_tgt_mdBm, int bypass)
 	LOGP(DL1C, LOGL_INFO, "power_ramp_start(cur=%d, tgt=%d)\n",
 		tpp->p_total_cur_mdBm, p_total_tgt_mdBm);
 
+	/* the TRX is (re)started, pick up what the BTS model configured */
+	power_tables_update(trx);
+
 	if (!bypass && (p_total_tgt_mdBm > get_p_nominal_mdBm(trx))) {
 		LOGP(DL1C, LOGL_ERROR, "Asked to ramp power up to "
 		     "%d mdBm, which exceeds P_max_out (%d)\n",
@@ -256,6 +331,7 @@ int power_ramp_start(struct gsm_bts_trx *trx, int p_total_tgt_mdBm, int bypass)
 
 	/* Cancel any pending request */
 	osmo_timer_del(&tpp->ramp.step_timer);
+	tpp->ramp.step_pending = 0;
 
 	/* set the new target */
 	tpp->p_total_tgt_mdBm = p_total_tgt_mdBm;
@@ -52,6 +52,10 @@
 #include <osmo-bts/measurement.h>
 #include <osmo-bts/vty.h>
 #include <osmo-bts/l1sap.h>
+#include <osmo-bts/hotlog.h>
+#include <osmo-bts/bringup.h>
+#include <osmo-bts/gsmtap_ring.h>
+#include <osmo-bts/power_control.h>
 
 #define VTY_STR	"Configure the VTY\n"
 
@@ -261,6 +265,26 @@ char *osmo_str_tolower(const char *in)
 	return buf_casecnvt;
 }
 
+static void config_write_power_ctrl(struct vty *vty,
+				   const struct bts_power_ctrl_params *par)
+{
+	const struct bts_power_ctrl_params *def = &power_ctrl_ul_default;
+
+	if (par->ewma != def->ewma)
+		vty_out(vty, " power-control uplink filter %u%s", par->ewma,
+			VTY_NEWLINE);
+	if (par->hyst != def->hyst)
+		vty_out(vty, " power-control uplink hysteresis %u%s", par->hyst,
+			VTY_NEWLINE);
+	if (par->raise_max != def->raise_max
+	 || par->lower_max != def->lower_max)
+		vty_out(vty, " power-control uplink step-limit raise %u lower %u%s",
+			par->raise_max, par->lower_max, VTY_NEWLINE);
+	if (par->rxqual_max != def->rxqual_max)
+		vty_out(vty, " power-control uplink rxqual-max %u%s",
+			par->rxqual_max, VTY_NEWLINE);
+}
+
 static void config_write_bts_single(struct vty *vty, struct gsm_bts *bts)
 {
 	struct gsm_bts_role_bts *btsb = bts_role_bts(bts);
@@ -280,11 +304,14 @@ static void config_write_bts_single(struct vty *vty, struct gsm_bts *bts)
 	if (btsb->rtp_jitter_adaptive)
 		vty_out(vty, " adaptive");
 	vty_out(vty, "%s", VTY_NEWLINE);
+	if (btsb->rtp_batch)
+		vty_out(vty, " rtp tx-batch%s", VTY_NEWLINE);
 	vty_out(vty, " paging queue-size %u%s", paging_get_queue_max(btsb->paging_state),
 		VTY_NEWLINE);
 	vty_out(vty, " paging lifetime %u%s", paging_get_lifetime(btsb->paging_state),
 		VTY_NEWLINE);
-	vty_out(vty, " uplink-power-target %d%s", btsb->ul_power_target, VTY_NEWLINE);
+	vty_out(vty, " uplink-power-target %d%s", btsb->ul_power_ctrl.target, VTY_NEWLINE);
+	config_write_power_ctrl(vty, &btsb->ul_power_ctrl);
 	if (btsb->agch_queue_thresh_level != GSM_BTS_AGCH_QUEUE_THRESH_LEVEL_DEFAULT
 		 || btsb->agch_queue_low_level != GSM_BTS_AGCH_QUEUE_LOW_LEVEL_DEFAULT
 		 || btsb->agch_queue_high_level != GSM_BTS_AGCH_QUEUE_HIGH_LEVEL_DEFAULT)
@@ -302,8 +329,22 @@ static void config_write_bts_single(struct vty *vty, struct gsm_bts *bts)
 		const char *name = get_value_string(gsmtap_sapi_names, GSMTAP_CHANNEL_ACCH);
 		vty_out(vty, " gsmtap-sapi %s%s", osmo_str_tolower(name), VTY_NEWLINE);
 	}
+	if (gsmtap_ring_get_pcap()) {
+		unsigned int size_mb, files;
+		gsmtap_ring_get_pcap_rotate(&size_mb, &files);
+		vty_out(vty, " gsmtap-pcap file %s%s", gsmtap_ring_get_pcap(),
+			VTY_NEWLINE);
+		vty_out(vty, " gsmtap-pcap rotate %u %u%s", size_mb, files,
+			VTY_NEWLINE);
+	}
 	vty_out(vty, " min-qual-rach %.0f%s", btsb->min_qual_rach * 10.0f,
 		VTY_NEWLINE);
+	if (btsb->rach_batch.max_per_mf)
+		vty_out(vty, " rach max-per-multiframe %u%s",
+			btsb->rach_batch.max_per_mf, VTY_NEWLINE);
+	if (btsb->rach_batch.agch_reject)
+		vty_out(vty, " rach agch-reject-level %u%s",
+			btsb->rach_batch.agch_reject, VTY_NEWLINE);
 	vty_out(vty, " min-qual-norm %.0f%s", btsb->min_qual_norm * 10.0f,
 		VTY_NEWLINE);
 	if (strcmp(btsb->pcu.sock_path, PCU_SOCK_DEFAULT))
@@ -335,11 +376,33 @@ static void config_write_bts_single(struct vty *vty, struct gsm_bts *bts)
 	}
 }
 
+/* the hot-log settings are process wide, not per BTS */
+static void config_write_hotlog(struct vty *vty)
+{
+	int i;
+
+	for (i = 0; i < bts_log_info.num_cat && i < HOTLOG_MAX_CAT; i++) {
+		const char *name = bts_log_info.cat[i].name;
+		if (!name)
+			continue;
+		/* skip the leading 'D' like log_parse_category() does */
+		if (hotlog_get_rate(i) != HOTLOG_RATE_DEFAULT)
+			vty_out(vty, "hot-log rate-limit %s %u%s",
+				osmo_str_tolower(name + 1), hotlog_get_rate(i),
+				VTY_NEWLINE);
+		if (hotlog_trace_mask & (1 << i))
+			vty_out(vty, "hot-log trace %s%s",
+				osmo_str_tolower(name + 1), VTY_NEWLINE);
+	}
+}
+
 static int config_write_bts(struct vty *vty)
 {
 	struct gsm_network *net = gsmnet_from_vty(vty);
 	struct gsm_bts *bts;
 
+	config_write_hotlog(vty);
+
 	llist_for_each_entry(bts, &net->bts_list, list)
 		config_write_bts_single(vty, bts);
 
@@ -502,6 +565,102 @@ DEFUN(cfg_bts_rtp_jitbuf,
 	return CMD_SUCCESS;
 }
 
+DEFUN(cfg_bts_rtp_tx_batch,
+	cfg_bts_rtp_tx_batch_cmd,
+	"rtp tx-batch",
+	RTP_STR "Send uplink RTP of all channels in one batch per TDMA frame\n")
+{
+	struct gsm_bts *bts = vty->index;
+	struct gsm_bts_role_bts *btsb = bts_role_bts(bts);
+
+	if (btsb->rtp_batch)
+		return CMD_SUCCESS;
+
+	btsb->rtp_batch = rtp_batch_alloc(btsb);
+	if (!btsb->rtp_batch) {
+		vty_out(vty, "%% Cannot allocate RTP batch%s", VTY_NEWLINE);
+		return CMD_WARNING;
+	}
+
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_bts_no_rtp_tx_batch,
+	cfg_bts_no_rtp_tx_batch_cmd,
+	"no rtp tx-batch",
+	NO_STR RTP_STR "Send uplink RTP of each channel individually\n")
+{
+	struct gsm_bts *bts = vty->index;
+	struct gsm_bts_role_bts *btsb = bts_role_bts(bts);
+	struct rtp_batch *rb = btsb->rtp_batch;
+
+	btsb->rtp_batch = NULL;
+	rtp_batch_flush(rb);
+	rtp_batch_free(rb);
+
+	return CMD_SUCCESS;
+}
+
+#define HOTLOG_STR "Rate limited logging / tracing of per-burst code paths\n"
+
+static int vty_hotlog_category(struct vty *vty, const char *name)
+{
+	int cat = log_parse_category(name);
+
+	if (cat < 0 || cat >= HOTLOG_MAX_CAT) {
+		vty_out(vty, "%% Unknown log category '%s'%s", name,
+			VTY_NEWLINE);
+		return -1;
+	}
+	return cat;
+}
+
+DEFUN(cfg_hotlog_rate, cfg_hotlog_rate_cmd,
+	"hot-log rate-limit CATEGORY <0-10000>",
+	HOTLOG_STR "Limit the number of messages per second\n"
+	"Log category (e.g. l1c, l1p, trx)\n"
+	"Messages per second, 0 for no limit\n")
+{
+	int cat = vty_hotlog_category(vty, argv[0]);
+
+	if (cat < 0)
+		return CMD_WARNING;
+
+	hotlog_set_rate(cat, atoi(argv[1]));
+
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_hotlog_trace, cfg_hotlog_trace_cmd,
+	"hot-log trace CATEGORY",
+	HOTLOG_STR "Record hot path events into the in-memory trace ring\n"
+	"Log category (e.g. l1c, l1p, trx)\n")
+{
+	int cat = vty_hotlog_category(vty, argv[0]);
+
+	if (cat < 0)
+		return CMD_WARNING;
+
+	hotlog_trace_mask |= (1 << cat);
+
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_no_hotlog_trace, cfg_no_hotlog_trace_cmd,
+	"no hot-log trace CATEGORY",
+	NO_STR HOTLOG_STR "Record hot path events into the in-memory trace ring\n"
+	"Log category (e.g. l1c, l1p, trx)\n")
+{
+	int cat = vty_hotlog_category(vty, argv[0]);
+
+	if (cat < 0)
+		return CMD_WARNING;
+
+	hotlog_trace_mask &= ~(1 << cat);
+
+	return CMD_SUCCESS;
+}
+
 #define PAG_STR "Paging related parameters\n"
 
 DEFUN(cfg_bts_paging_queue_size,
@@ -576,7 +735,65 @@ DEFUN(cfg_bts_ul_power_target, cfg_bts_ul_power_target_cmd,
 	struct gsm_bts *bts = vty->index;
 	struct gsm_bts_role_bts *btsb = bts_role_bts(bts);
 
-	btsb->ul_power_target = atoi(argv[0]);
+	btsb->ul_power_ctrl.target = atoi(argv[0]);
+
+	return CMD_SUCCESS;
+}
+
+#define PWR_CTRL_STR "Power control loops\n" "MS power control\n"
+
+static struct bts_power_ctrl_params *vty_power_ctrl(struct vty *vty)
+{
+	struct gsm_bts *bts = vty->index;
+	struct gsm_bts_role_bts *btsb = bts_role_bts(bts);
+
+	return &btsb->ul_power_ctrl;
+}
+
+DEFUN(cfg_bts_pwr_ctrl_filter, cfg_bts_pwr_ctrl_filter_cmd,
+	"power-control uplink filter <1-100>",
+	PWR_CTRL_STR
+	"Exponential averaging of the RxLev and RxQual measurements\n"
+	"Weight of a new measurement in %%, 100 disables averaging\n")
+{
+	vty_power_ctrl(vty)->ewma = atoi(argv[0]);
+
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_bts_pwr_ctrl_hyst, cfg_bts_pwr_ctrl_hyst_cmd,
+	"power-control uplink hysteresis <0-30>",
+	PWR_CTRL_STR
+	"Keep the power while the RxLev is close to the target\n"
+	"Largest deviation from the target in dB\n")
+{
+	vty_power_ctrl(vty)->hyst = atoi(argv[0]);
+
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_bts_pwr_ctrl_step, cfg_bts_pwr_ctrl_step_cmd,
+	"power-control uplink step-limit raise <0-30> lower <0-30>",
+	PWR_CTRL_STR
+	"Limit the power change per measurement period\n"
+	"Largest increase\n" "Increase in dB, 0 for no limit\n"
+	"Largest decrease\n" "Decrease in dB, 0 for no limit\n")
+{
+	struct bts_power_ctrl_params *par = vty_power_ctrl(vty);
+
+	par->raise_max = atoi(argv[0]);
+	par->lower_max = atoi(argv[1]);
+
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_bts_pwr_ctrl_rxqual, cfg_bts_pwr_ctrl_rxqual_cmd,
+	"power-control uplink rxqual-max <0-7>",
+	PWR_CTRL_STR
+	"Raise the power while the averaged RxQual is worse\n"
+	"Worst acceptable RxQual, 7 to ignore RxQual\n")
+{
+	vty_power_ctrl(vty)->rxqual_max = atoi(argv[0]);
 
 	return CMD_SUCCESS;
 }
@@ -594,6 +811,36 @@ DEFUN(cfg_bts_min_qual_rach, cfg_bts_min_qual_rach_cmd,
 	return CMD_SUCCESS;
 }
 
+#define RACH_STR "Random Access Channel\n"
+
+DEFUN(cfg_bts_rach_max_per_mf, cfg_bts_rach_max_per_mf_cmd,
+	"rach max-per-multiframe <0-1000>",
+	RACH_STR
+	"Limit the CHANNEL REQUIRED messages sent per 51-multiframe\n"
+	"Maximum number, 0 for no limit\n")
+{
+	struct gsm_bts *bts = vty->index;
+	struct gsm_bts_role_bts *btsb = bts_role_bts(bts);
+
+	btsb->rach_batch.max_per_mf = atoi(argv[0]);
+
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_bts_rach_agch_reject, cfg_bts_rach_agch_reject_cmd,
+	"rach agch-reject-level <0-100>",
+	RACH_STR
+	"Drop RR access bursts while the AGCH queue is filled above a level\n"
+	"Level in %% of the maximum AGCH queue length, 0 to disable\n")
+{
+	struct gsm_bts *bts = vty->index;
+	struct gsm_bts_role_bts *btsb = bts_role_bts(bts);
+
+	btsb->rach_batch.agch_reject = atoi(argv[0]);
+
+	return CMD_SUCCESS;
+}
+
 DEFUN(cfg_bts_min_qual_norm, cfg_bts_min_qual_norm_cmd,
 	"min-qual-norm <-100-100>",
 	"Set the minimum quality level of normal burst to be accpeted\n"
@@ -648,6 +895,7 @@ DEFUN(cfg_trx_user_gain,
 	struct gsm_bts_trx *trx = vty->index;
 
 	trx->power_params.user_gain_mdB = parse_mdbm(argv[0], argv[1]);
+	power_tables_update(trx);
 
 	return CMD_SUCCESS;
 }
@@ -782,6 +1030,24 @@ static void bts_dump_vty(struct vty *vty, struct gsm_bts *bts)
 		VTY_NEWLINE);
 	vty_out(vty, "  CBCH backlog queue length: %u%s",
 		llist_length(&btsb->smscb_state.queue), VTY_NEWLINE);
+	if (btsb->rtp_batch) {
+		const struct rtp_batch_stats *rbs =
+					rtp_batch_get_stats(btsb->rtp_batch);
+		vty_out(vty, "  RTP TX batching: %u packets in %u batches, "
+			"%u dropped%s", rbs->packets, rbs->flushes,
+			rbs->dropped, VTY_NEWLINE);
+	}
+	vty_out(vty, "  RACH: %u RR access bursts, %u duplicates, "
+		"%u over limit, %u rejected on AGCH load, "
+		"%u CHAN RQD in %u batches%s",
+		btsb->rach_batch.stats.received,
+		btsb->rach_batch.stats.duplicate,
+		btsb->rach_batch.stats.rejected_limit,
+		btsb->rach_batch.stats.rejected_load,
+		btsb->rach_batch.stats.sent, btsb->rach_batch.stats.batches,
+		VTY_NEWLINE);
+	pcu_sock_vty_dump(vty, bts);
+	gsmtap_ring_vty_dump(vty);
 #if 0
 	vty_out(vty, "  Paging: %u pending requests, %u free slots%s",
 		paging_pending_requests_nr(bts),
@@ -828,6 +1094,47 @@ DEFUN(show_bts, show_bts_cmd, "show bts <0-255>",
 	return CMD_SUCCESS;
 }
 
+DEFUN(show_hotlog, show_hotlog_cmd, "show hot-log",
+	SHOW_STR "Display rate limiting of hot path logging\n")
+{
+	int i;
+
+	for (i = 0; i < bts_log_info.num_cat && i < HOTLOG_MAX_CAT; i++) {
+		const char *name = bts_log_info.cat[i].name;
+		if (!name)
+			continue;
+		vty_out(vty, "%-6s rate-limit %5u/s, %u suppressed%s%s", name,
+			hotlog_get_rate(i), hotlog_get_suppressed(i),
+			hotlog_trace_mask & (1 << i) ? ", tracing" : "",
+			VTY_NEWLINE);
+	}
+
+	return CMD_SUCCESS;
+}
+
+DEFUN(show_hotlog_trace, show_hotlog_trace_cmd, "show hot-log trace",
+	SHOW_STR "Display rate limiting of hot path logging\n"
+	"Dump the in-memory trace ring\n")
+{
+	hotlog_vty_dump_trace(vty);
+	return CMD_SUCCESS;
+}
+
+DEFUN(show_bringup, show_bringup_cmd, "show bring-up",
+	SHOW_STR "Display the timing of the bring-up phases\n")
+{
+	bringup_vty_dump(vty);
+	return CMD_SUCCESS;
+}
+
+DEFUN(clear_hotlog_trace, clear_hotlog_trace_cmd, "clear hot-log trace",
+	"Clear information\n" "Hot path logging\n"
+	"Empty the in-memory trace ring\n")
+{
+	hotlog_trace_clear();
+	return CMD_SUCCESS;
+}
+
 static struct gsm_lchan *resolve_lchan(struct gsm_network *net,
 					const char **argv, int idx)
 {
@@ -867,6 +1174,41 @@ static struct gsm_lchan *resolve_lchan(struct gsm_network *net,
 	"logical channel commands\n"	\
 	"logical channel number\n"
 
+#define GSMTAP_PCAP_STR "Write tapped primitives (see gsmtap-sapi) to pcap files\n"
+
+DEFUN(cfg_bts_gsmtap_pcap, cfg_bts_gsmtap_pcap_cmd,
+	"gsmtap-pcap file PATH",
+	GSMTAP_PCAP_STR "Set the pcap file name\n" "Path of the pcap file\n")
+{
+	if (gsmtap_ring_set_pcap(argv[0]) < 0) {
+		vty_out(vty, "%% Failed to allocate GSMTAP tap ring%s",
+			VTY_NEWLINE);
+		return CMD_WARNING;
+	}
+
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_bts_no_gsmtap_pcap, cfg_bts_no_gsmtap_pcap_cmd,
+	"no gsmtap-pcap file",
+	NO_STR GSMTAP_PCAP_STR "Stop writing the pcap file\n")
+{
+	gsmtap_ring_set_pcap(NULL);
+
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_bts_gsmtap_pcap_rotate, cfg_bts_gsmtap_pcap_rotate_cmd,
+	"gsmtap-pcap rotate <1-4096> <1-100>",
+	GSMTAP_PCAP_STR "Rotate the pcap file once it reaches a size\n"
+	"Maximum size of one file in MiB\n"
+	"Number of files to keep, including the current one\n")
+{
+	gsmtap_ring_set_pcap_rotate(atoi(argv[0]), atoi(argv[1]));
+
+	return CMD_SUCCESS;
+}
+
 DEFUN(cfg_trx_gsmtap_sapi, cfg_trx_gsmtap_sapi_cmd,
 	"HIDDEN", "HIDDEN")
 {
@@ -1008,7 +1350,7 @@ DEFUN(bts_t_t_l_jitter_buf,
 	struct gsm_network *net = gsmnet_from_vty(vty);
 	struct gsm_lchan *lchan;
 	struct gsm_bts_role_bts *btsb;
-	int jitbuf_ms = atoi(argv[4]), rc;
+	int jitbuf_ms = atoi(argv[4]);
 
 	lchan = resolve_lchan(net, argv, 0);
 	if (!lchan) {
@@ -1021,15 +1363,10 @@ DEFUN(bts_t_t_l_jitter_buf,
 		return CMD_WARNING;
 	}
 	btsb = bts_role_bts(lchan->ts->trx->bts);
-	rc = osmo_rtp_socket_set_param(lchan->abis_ip.rtp_socket,
-				  btsb->rtp_jitter_adaptive ?
-				  OSMO_RTP_P_JIT_ADAP : OSMO_RTP_P_JITBUF,
-				  jitbuf_ms);
-	if (rc < 0)
-		vty_out(vty, "%% error setting jitter parameters: %s%s",
-			strerror(-rc), VTY_NEWLINE);
-	else
-		vty_out(vty, "%% jitter parameters set: %d%s", rc, VTY_NEWLINE);
+	jitbuf_set_depth(&lchan_role_bts(lchan)->jitbuf, jitbuf_ms,
+			 btsb->rtp_jitter_adaptive);
+	vty_out(vty, "%% jitter buffer depth set: %u frames%s",
+		lchan_role_bts(lchan)->jitbuf.depth, VTY_NEWLINE);
 
 	return CMD_SUCCESS;
 }
@@ -1145,17 +1482,25 @@ int bts_vty_init(struct gsm_bts *bts, const struct log_info *cat)
 						"\n", "", 0);
 
 	install_element_ve(&show_bts_cmd);
+	install_element_ve(&show_hotlog_cmd);
+	install_element_ve(&show_hotlog_trace_cmd);
+	install_element_ve(&show_bringup_cmd);
 
 	logging_vty_add_cmds(cat);
 
 	install_node(&bts_node, config_write_bts);
 	install_element(CONFIG_NODE, &cfg_bts_cmd);
 	install_element(CONFIG_NODE, &cfg_vty_telnet_port_cmd);
+	install_element(CONFIG_NODE, &cfg_hotlog_rate_cmd);
+	install_element(CONFIG_NODE, &cfg_hotlog_trace_cmd);
+	install_element(CONFIG_NODE, &cfg_no_hotlog_trace_cmd);
 	install_default(BTS_NODE);
 	install_element(BTS_NODE, &cfg_bts_unit_id_cmd);
 	install_element(BTS_NODE, &cfg_bts_oml_ip_cmd);
 	install_element(BTS_NODE, &cfg_bts_rtp_bind_ip_cmd);
 	install_element(BTS_NODE, &cfg_bts_rtp_jitbuf_cmd);
+	install_element(BTS_NODE, &cfg_bts_rtp_tx_batch_cmd);
+	install_element(BTS_NODE, &cfg_bts_no_rtp_tx_batch_cmd);
 	install_element(BTS_NODE, &cfg_bts_band_cmd);
 	install_element(BTS_NODE, &cfg_description_cmd);
 	install_element(BTS_NODE, &cfg_no_description_cmd);
@@ -1164,9 +1509,18 @@ int bts_vty_init(struct gsm_bts *bts, const struct log_info *cat)
 	install_element(BTS_NODE, &cfg_bts_agch_queue_mgmt_default_cmd);
 	install_element(BTS_NODE, &cfg_bts_agch_queue_mgmt_params_cmd);
 	install_element(BTS_NODE, &cfg_bts_ul_power_target_cmd);
+	install_element(BTS_NODE, &cfg_bts_pwr_ctrl_filter_cmd);
+	install_element(BTS_NODE, &cfg_bts_pwr_ctrl_hyst_cmd);
+	install_element(BTS_NODE, &cfg_bts_pwr_ctrl_step_cmd);
+	install_element(BTS_NODE, &cfg_bts_pwr_ctrl_rxqual_cmd);
 	install_element(BTS_NODE, &cfg_bts_min_qual_rach_cmd);
+	install_element(BTS_NODE, &cfg_bts_rach_max_per_mf_cmd);
+	install_element(BTS_NODE, &cfg_bts_rach_agch_reject_cmd);
 	install_element(BTS_NODE, &cfg_bts_min_qual_norm_cmd);
 	install_element(BTS_NODE, &cfg_bts_pcu_sock_cmd);
+	install_element(BTS_NODE, &cfg_bts_gsmtap_pcap_cmd);
+	install_element(BTS_NODE, &cfg_bts_no_gsmtap_pcap_cmd);
+	install_element(BTS_NODE, &cfg_bts_gsmtap_pcap_rotate_cmd);
 
 	install_element(BTS_NODE, &cfg_trx_gsmtap_sapi_cmd);
 	install_element(BTS_NODE, &cfg_trx_no_gsmtap_sapi_cmd);
@@ -1183,6 +1537,7 @@ int bts_vty_init(struct gsm_bts *bts, const struct log_info *cat)
 	install_element(TRX_NODE, &cfg_trx_ms_power_control_cmd);
 	install_element(TRX_NODE, &cfg_trx_phy_cmd);
 
+	install_element(ENABLE_NODE, &clear_hotlog_trace_cmd);
 	install_element(ENABLE_NODE, &bts_t_t_l_jitter_buf_cmd);
 	install_element(ENABLE_NODE, &bts_t_t_l_loopback_cmd);
 	install_element(ENABLE_NODE, &no_bts_t_t_l_loopback_cmd);
@@ -29,11 +29,15 @@
 #include <fcntl.h>
 #include <limits.h>
 #include <errno.h>
+#include <time.h>
+#include <sys/stat.h>
 
 #include <osmocom/core/utils.h>
+#include <osmocom/core/talloc.h>
 
 #include <osmo-bts/gsm_data.h>
 #include <osmo-bts/logging.h>
+#include <osmo-bts/bringup.h>
 
 #include <nrw/litecell15/litecell15.h>
 #include <nrw/litecell15/gsml1const.h>
@@ -114,8 +118,10 @@ struct calTbl_t
 };
 
 
-static int calib_file_send(struct lc15l1_hdl *fl1h,
-			   const struct calib_file_desc *desc);
+/* SetCalibTbl chunks queued to the DSP at once, the SYS write queue
+ * holds 10 messages and is shared with the other system primitives */
+#define CALIB_MAX_INFLIGHT	4
+
 static int calib_verify(struct lc15l1_hdl *fl1h,
 			const struct calib_file_desc *desc);
 
@@ -132,40 +138,56 @@ static int get_next_calib_file_idx(struct lc15l1_hdl *fl1h, int last_idx)
         return -1;
 }
 
-static int calib_file_open(struct lc15l1_hdl *fl1h,
-                           const struct calib_file_desc *desc)
+static unsigned long calib_ms_since(const struct timespec *t)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - t->tv_sec) * 1000
+		+ (now.tv_nsec - t->tv_nsec) / 1000000;
+}
+
+/* read the whole table, it is verified and then sent from memory */
+static int calib_file_read(struct lc15l1_hdl *fl1h,
+			   const struct calib_file_desc *desc)
 {
 	struct calib_send_state *st = &fl1h->st;
 	char *calib_path = fl1h->phy_inst->u.lc15.calib_path;
-        char fname[PATH_MAX];
+	char fname[PATH_MAX];
+	struct stat sb;
+	FILE *in;
 
-	if (st->fp) {
-		LOGP(DL1C, LOGL_NOTICE, "L1 calibration file was left opened !!\n");
-		fclose(st->fp);
-		st->fp = NULL;
-	}
+	talloc_free(st->buf);
+	st->buf = NULL;
+	st->len = 0;
 
-        fname[0] = '\0';
-        snprintf(fname, sizeof(fname)-1, "%s/%s", calib_path, desc->fname);
-        fname[sizeof(fname)-1] = '\0';
+	snprintf(fname, sizeof(fname), "%s/%s", calib_path, desc->fname);
 
-        st->fp = fopen(fname, "rb");
-        if (!st->fp) {
-                LOGP(DL1C, LOGL_ERROR,
-                        "Failed to open '%s' for calibration data.\n", fname);
-                return -1;
-        }
-	return 0;
-}
+	in = fopen(fname, "rb");
+	if (!in) {
+		LOGP(DL1C, LOGL_ERROR,
+			"Failed to open '%s' for calibration data.\n", fname);
+		return -1;
+	}
 
-static int calib_file_close(struct lc15l1_hdl *fl1h)
-{
-	struct calib_send_state *st = &fl1h->st;
+	if (fstat(fileno(in), &sb) < 0 || sb.st_size > MAX_CALIB_TBL_SIZE
+	    || (size_t) sb.st_size < sizeof(((struct calTbl_t *) 0)->hdr)) {
+		LOGP(DL1C, LOGL_ERROR, "%s has an invalid size\n", desc->fname);
+		fclose(in);
+		return -3;
+	}
 
-	if (st->fp) {
-		fclose(st->fp);
-		st->fp = NULL;
+	st->buf = talloc_size(fl1h, sb.st_size);
+	if (!st->buf || fread(st->buf, 1, sb.st_size, in) != (size_t) sb.st_size) {
+		LOGP(DL1C, LOGL_ERROR, "%s reading error\n", desc->fname);
+		talloc_free(st->buf);
+		st->buf = NULL;
+		fclose(in);
+		return -2;
 	}
+	st->len = sb.st_size;
+	fclose(in);
+
 	return 0;
 }
 
@@ -174,82 +196,75 @@ static int calib_file_close(struct lc15l1_hdl *fl1h)
 static int calib_send_compl_cb(struct gsm_bts_trx *trx, struct msgb *l1_msg,
 			       void *data);
 
-/* send a chunk of calibration tabledata for a single specified file */
-static int calib_file_send_next_chunk(struct lc15l1_hdl *fl1h)
+/* queue the chunks of the current table up to CALIB_MAX_INFLIGHT, the
+ * DSP puts each of them at its offset */
+static int calib_file_send_chunks(struct lc15l1_hdl *fl1h)
 {
 	struct calib_send_state *st = &fl1h->st;
 	Litecell15_Prim_t *prim;
 	struct msgb *msg;
 	size_t n;
+	int rc;
 
-	msg = sysp_msgb_alloc();
-	prim = msgb_sysprim(msg);
-
-	prim->id = Litecell15_PrimId_SetCalibTblReq;
-	prim->u.setCalibTblReq.offset = (uint32_t)ftell(st->fp);
-	n = fread(prim->u.setCalibTblReq.u8Data, 1, 
-			sizeof(prim->u.setCalibTblReq.u8Data), st->fp);
-	prim->u.setCalibTblReq.length = n;
-
-
-	if (n == 0) {
-		/* The table data has been completely sent and acknowledged */
-                LOGP(DL1C, LOGL_NOTICE, "L1 calibration table %s loaded\n",
-                        calib_files[st->last_file_idx].fname);
-
-                calib_file_close(fl1h);
+	while (st->ofs < st->len && st->inflight < CALIB_MAX_INFLIGHT) {
+		msg = sysp_msgb_alloc();
+		prim = msgb_sysprim(msg);
 
-                msgb_free(msg);
+		n = OSMO_MIN(st->len - st->ofs,
+			     sizeof(prim->u.setCalibTblReq.u8Data));
+		prim->id = Litecell15_PrimId_SetCalibTblReq;
+		prim->u.setCalibTblReq.offset = st->ofs;
+		prim->u.setCalibTblReq.length = n;
+		memcpy(prim->u.setCalibTblReq.u8Data, st->buf + st->ofs, n);
 
-                /* Send the next one if any */
-                st->last_file_idx = get_next_calib_file_idx(fl1h, st->last_file_idx);
-                if (st->last_file_idx >= 0) {
-                        return calib_file_send(fl1h,
-                                       &calib_files[st->last_file_idx]);
-                }
+		st->ofs += n;
+		st->inflight++;
 
-                LOGP(DL1C, LOGL_INFO, "L1 calibration table loading complete!\n");
-                return 0;
+		rc = l1if_req_compl(fl1h, msg, calib_send_compl_cb, NULL);
+		if (rc < 0)
+			return rc;
 	}
 
-	return l1if_req_compl(fl1h, msg, calib_send_compl_cb, NULL);
+	return 0;
 }
 
-/* send the calibration table for a single specified file */
-static int calib_file_send(struct lc15l1_hdl *fl1h,
-			   const struct calib_file_desc *desc)
+/* start sending the next table that can be read and verified, chunks
+ * of different tables must not be mixed */
+static int calib_file_send_next(struct lc15l1_hdl *fl1h)
 {
 	struct calib_send_state *st = &fl1h->st;
+	const struct calib_file_desc *desc;
 	int rc;
 
-	rc = calib_file_open(fl1h, desc);
-	if (rc < 0) {
-		/* still, we'd like to continue trying to load
-                 * calibration for all other bands */
-                st->last_file_idx = get_next_calib_file_idx(fl1h, st->last_file_idx);
-                if (st->last_file_idx >= 0)
-                        return calib_file_send(fl1h,
-                                               &calib_files[st->last_file_idx]);
-
-		LOGP(DL1C, LOGL_INFO, "L1 calibration table loading complete!\n");
-                return 0;
-	}
+	while ((st->last_file_idx = get_next_calib_file_idx(fl1h,
+						st->last_file_idx)) >= 0) {
+		desc = &calib_files[st->last_file_idx];
 
-	rc = calib_verify(fl1h, desc);
-	if ( rc < 0 ) {
-		LOGP(DL1C, LOGL_ERROR, "Verify L1 calibration table %s -> failed (%d)\n", desc->fname, rc);
-		st->last_file_idx = get_next_calib_file_idx(fl1h, st->last_file_idx);
-
-		if (st->last_file_idx >= 0)
-			return calib_file_send(fl1h,
-				&calib_files[st->last_file_idx]);
-		return 0;
+		/* still, we'd like to continue trying to load
+		 * calibration for all other bands */
+		if (calib_file_read(fl1h, desc) < 0)
+			continue;
+
+		rc = calib_verify(fl1h, desc);
+		if (rc < 0) {
+			LOGP(DL1C, LOGL_ERROR, "Verify L1 calibration table %s -> failed (%d)\n", desc->fname, rc);
+			continue;
+		}
+		LOGP(DL1C, LOGL_INFO, "Verify L1 calibration table %s -> done\n", desc->fname);
 
+		st->ofs = 0;
+		st->rejected = false;
+		return calib_file_send_chunks(fl1h);
 	}
 
-	LOGP(DL1C, LOGL_INFO, "Verify L1 calibration table %s -> done\n", desc->fname);
+	talloc_free(st->buf);
+	st->buf = NULL;
 
-	return calib_file_send_next_chunk(fl1h);
+	LOGP(DL1C, LOGL_INFO, "L1 calibration table loading complete! "
+	     "%u tables in %lu ms\n", st->num_tables,
+	     calib_ms_since(&st->t_start));
+	bringup_end("calibration", fl1h->phy_inst->trx->nr, -1);
+	return 0;
 }
 
 /* completion callback after every SetCalibTbl is confirmed */
@@ -260,33 +275,36 @@ static int calib_send_compl_cb(struct gsm_bts_trx *trx, struct msgb *l1_msg,
 	struct calib_send_state *st = &fl1h->st;
 	Litecell15_Prim_t *prim = msgb_sysprim(l1_msg);
 
-	if (prim->u.setCalibTblCnf.status != GsmL1_Status_Success) {
-		LOGP(DL1C, LOGL_ERROR, "L1 rejected calibration table\n");
-
-		msgb_free(l1_msg);
+	st->inflight--;
 
-		calib_file_close(fl1h);
-
-		/* Skip this one and try the next one */
-		st->last_file_idx = get_next_calib_file_idx(fl1h, st->last_file_idx);
-	        if (st->last_file_idx >= 0) {
-        	        return calib_file_send(fl1h, 
-					&calib_files[st->last_file_idx]);
-		}
-
-		LOGP(DL1C, LOGL_INFO, "L1 calibration table loading complete!\n");
-		return 0;
+	if (prim->u.setCalibTblCnf.status != GsmL1_Status_Success
+	    && !st->rejected) {
+		LOGP(DL1C, LOGL_ERROR, "L1 rejected calibration table\n");
+		/* Skip this one once all its chunks are confirmed */
+		st->rejected = true;
 	}
 
 	msgb_free(l1_msg);
 
 	/* Keep sending the calibration file data */
-	return calib_file_send_next_chunk(fl1h);
+	if (!st->rejected && st->ofs < st->len)
+		return calib_file_send_chunks(fl1h);
+	if (st->inflight)
+		return 0;
+
+	if (!st->rejected) {
+		/* The table data has been completely sent and acknowledged */
+		LOGP(DL1C, LOGL_NOTICE, "L1 calibration table %s loaded\n",
+			calib_files[st->last_file_idx].fname);
+		st->num_tables++;
+	}
+
+	/* Send the next one if any */
+	return calib_file_send_next(fl1h);
 }
 
 int calib_load(struct lc15l1_hdl *fl1h)
 {
-	int rc;
 	struct calib_send_state *st = &fl1h->st;
 	char *calib_path = fl1h->phy_inst->u.lc15.calib_path;
 
@@ -295,58 +313,32 @@ int calib_load(struct lc15l1_hdl *fl1h)
                 return -1;
         }
 
-	rc = get_next_calib_file_idx(fl1h, -1);
-	if (rc < 0) {
+	if (get_next_calib_file_idx(fl1h, -1) < 0)
 		return -1;
-	}
-	st->last_file_idx = rc;
 
-	return calib_file_send(fl1h, &calib_files[st->last_file_idx]);
+	bringup_begin("calibration", fl1h->phy_inst->trx->nr, -1);
+	clock_gettime(CLOCK_MONOTONIC, &st->t_start);
+	st->last_file_idx = -1;
+	st->inflight = 0;
+	st->num_tables = 0;
+
+	return calib_file_send_next(fl1h);
 }
 
 
 static int calib_verify(struct lc15l1_hdl *fl1h, const struct calib_file_desc *desc)
 {
-       int rc, sz;
        struct calib_send_state *st = &fl1h->st;
        struct phy_link *plink = fl1h->phy_inst->phy_link;
-       char *rbuf;
-       struct calTbl_t *calTbl;
+       struct calTbl_t *calTbl = (struct calTbl_t *) st->buf;
+       size_t sz = st->len;
        char calChkSum ;
 
 
-       //calculate file size in bytes
-       fseek(st->fp, 0L, SEEK_END);
-       sz = ftell(st->fp);
-
-       //rewind read poiner
-       fseek(st->fp, 0L, SEEK_SET);
-
-       //read file
-       rbuf = (char *) malloc( sizeof(char) * sz );
-
-       rc = fread(rbuf, 1, sizeof(char) * sz, st->fp);
-       if ( rc != sz) {
-
-               LOGP(DL1C, LOGL_ERROR, "%s reading error\n", desc->fname);
-               free(rbuf);
-
-               //close file
-               rc = calib_file_close(fl1h);
-               if (rc < 0 ) {
-                       LOGP(DL1C, LOGL_ERROR, "%s can not close\n", desc->fname);
-                       return rc;
-               }
-
-               return -2;
-       }
-
-
-       calTbl = (struct calTbl_t*) rbuf;
        //calcualte file checksum
        calChkSum = 0;
        while ( sz-- ) {
-               calChkSum ^= rbuf[sz];
+               calChkSum ^= st->buf[sz];
        }
 
        //validate Tx calibration parity
@@ -443,16 +435,14 @@ static int calib_verify(struct lc15l1_hdl *fl1h, const struct calib_file_desc *d
                        fl1h->phy_inst->trx->power_params.trx_p_max_out_mdBm = to_mdB(fl1h->phy_inst->u.lc15.minTxPower);
                }
 
+               power_tables_update(fl1h->phy_inst->trx);
+
                LOGP(DL1C, LOGL_DEBUG, "%s: minTxPower=%d, maxTxPower=%d\n",
                                desc->fname,
                                fl1h->phy_inst->u.lc15.minTxPower,
                                fl1h->phy_inst->u.lc15.maxTxPower );
        }
 
-       //rewind read poiner for subsequence tasks
-       fseek(st->fp, 0L, SEEK_SET);
-       free(rbuf);
-
        return 0;
 }
 
@@ -55,6 +55,7 @@
 #include <osmo-bts/l1sap.h>
 #include <osmo-bts/msg_utils.h>
 #include <osmo-bts/dtx_dl_amr_fsm.h>
+#include <osmo-bts/bringup.h>
 
 #include <nrw/litecell15/litecell15.h>
 #include <nrw/litecell15/gsml1prim.h>
@@ -206,7 +207,7 @@ static int _l1if_req_compl(struct lc15l1_hdl *fl1h, struct msgb *msg,
 			is_system_prim ? "system primitive" : "gsm");
 		msgb_free(msg);
 	}
-	llist_add(&wlc->list, &fl1h->wlc_list);
+	llist_add_tail(&wlc->list, &fl1h->wlc_list);
 
 	/* schedule a timer for timeout_secs seconds. If DSP fails to respond, we terminate */
 	wlc->timer.data = wlc;
@@ -359,7 +360,7 @@ static int ph_data_req(struct gsm_bts_trx *trx, struct msgb *msg,
 	if (L1SAP_IS_LINK_SACCH(link_id)) {
 		sapi = GsmL1_Sapi_Sacch;
 		if (!L1SAP_IS_CHAN_TCHF(chan_nr))
-			subCh = l1sap_chan2ss(chan_nr);
+			subCh = trx_chan_nr_map(trx, chan_nr)->ss;
 	} else if (L1SAP_IS_CHAN_TCHF(chan_nr)) {
 		if (ts_is_pdch(&trx->ts[u8Tn])) {
 			if (L1SAP_IS_PTCCH(u32Fn)) {
@@ -949,10 +950,8 @@ static int handle_ph_data_ind(struct lc15l1_hdl *fl1, GsmL1_PhDataInd_t *data_in
 	/* check for TCH */
 	if (data_ind->sapi == GsmL1_Sapi_TchF
 	 || data_ind->sapi == GsmL1_Sapi_TchH) {
-		/* TCH speech frame handling */
-		rc = l1if_tch_rx(trx, chan_nr, l1p_msg);
-		msgb_free(l1p_msg);
-		return rc;
+		/* TCH speech frame handling, consumes l1p_msg */
+		return l1if_tch_rx(trx, chan_nr, l1p_msg);
 	}
 
 	/* get rssi */
@@ -1352,6 +1351,8 @@ static int info_compl_cb(struct gsm_bts_trx *trx, struct msgb *resp,
 	struct lc15l1_hdl *fl1h = trx_lc15l1_hdl(trx);
 	int rc;
 
+	bringup_end("l1_info", trx->nr, -1);
+
 	fl1h->hw_info.dsp_version[0] = sic->dspVersion.major;
 	fl1h->hw_info.dsp_version[1] = sic->dspVersion.minor;
 	fl1h->hw_info.dsp_version[2] = sic->dspVersion.build;
@@ -1390,6 +1391,7 @@ static int l1if_get_info(struct lc15l1_hdl *hdl)
 
 	sysp->id = Litecell15_PrimId_SystemInfoReq;
 
+	bringup_begin("l1_info", hdl->phy_inst->trx->nr, -1);
 	return l1if_req_compl(hdl, msg, info_compl_cb, NULL);
 }
 
@@ -1400,6 +1402,8 @@ static int reset_compl_cb(struct gsm_bts_trx *trx, struct msgb *resp,
 	Litecell15_Prim_t *sysp = msgb_sysprim(resp);
 	GsmL1_Status_t status = sysp->u.layer1ResetCnf.status;
 
+	bringup_end("l1_reset", trx->nr, -1);
+
 	LOGP(DL1C, LOGL_NOTICE, "Rx L1-RESET.conf (status=%s)\n",
 		get_value_string(lc15bts_l1status_names, status));
 
@@ -1428,6 +1432,7 @@ int l1if_reset(struct lc15l1_hdl *hdl)
 	Litecell15_Prim_t *sysp = msgb_sysprim(msg);
 	sysp->id = Litecell15_PrimId_Layer1ResetReq;
 
+	bringup_begin("l1_reset", hdl->phy_inst->trx->nr, -1);
 	return l1if_req_compl(hdl, msg, reset_compl_cb, NULL);
 }
 
@@ -12,6 +12,7 @@
 #include <nrw/litecell15/gsml1prim.h>
 
 #include <stdbool.h>
+#include <time.h>
 
 enum {
 	MQ_SYS_READ,
@@ -30,9 +31,15 @@ enum {
 };
 
 struct calib_send_state {
-	FILE *fp;
 	const char *path;
 	int last_file_idx;
+	uint8_t *buf;		/* content of the current table */
+	size_t len;
+	size_t ofs;		/* offset of the next chunk to send */
+	unsigned int inflight;	/* chunks not confirmed yet */
+	bool rejected;		/* the DSP rejected a chunk of the table */
+	unsigned int num_tables;
+	struct timespec t_start;
 };
 
 struct lc15l1_hdl {
@@ -89,10 +96,17 @@ uint32_t l1if_lchan_to_hLayer(struct gsm_lchan *lchan);
 struct gsm_lchan *l1if_hLayer_to_lchan(struct gsm_bts_trx *trx, uint32_t hLayer);
 
 /* tch.c */
+
+/* size of the buffer for one uplink RTP payload, AMR 12.2 being the largest */
+#define TCH_RTP_PL_MAX	64
+
 int l1if_tch_encode(struct gsm_lchan *lchan, uint8_t *data, uint8_t *len,
 		    const uint8_t *rtp_pl, unsigned int rtp_pl_len, uint32_t fn,
 		    bool use_cache, bool marker);
 int l1if_tch_rx(struct gsm_bts_trx *trx, uint8_t chan_nr, struct msgb *l1p_msg);
+int l1if_tch_ul_to_rtp(struct gsm_lchan *lchan, uint8_t payload_type,
+		       uint8_t *l1_payload, uint8_t payload_len,
+		       uint8_t *rtp_pl);
 int l1if_tch_fill(struct gsm_lchan *lchan, uint8_t *l1_buffer);
 struct msgb *gen_empty_tch_msg(struct gsm_lchan *lchan, uint32_t fn);
 
@@ -316,6 +316,7 @@ DEFUN(cfg_trx_nominal_power, cfg_trx_nominal_power_cmd,
 
 	trx->nominal_power = nominal_power;
 	trx->power_params.trx_p_max_out_mdBm = to_mdB(nominal_power);
+	power_tables_update(trx);
 
 	return CMD_SUCCESS;
 }
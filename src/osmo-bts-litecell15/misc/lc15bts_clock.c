@@ -55,9 +55,8 @@ static int sysfs_read_val(int fd, int *val)
 	int rc;
 	char szVal[32] = {0};
 
-	lseek( fd, 0, SEEK_SET );
-
-	rc = read(fd, szVal, sizeof(szVal) - 1);
+	/* one syscall, sysfs rereads the attribute at offset 0 */
+	rc = pread(fd, szVal, sizeof(szVal) - 1, 0);
 	if (rc < 0) {
 		return -errno;
 	}
@@ -77,8 +76,7 @@ static int sysfs_write_val(int fd, int val)
 
 	n = sprintf(szVal, "%d", val);
 
-	lseek(fd, 0, SEEK_SET);
-	rc = write(fd, szVal, n+1);
+	rc = pwrite(fd, szVal, n+1, 0);
 	if (rc < 0) {
 		return -errno;
 	}
@@ -89,8 +87,7 @@ static int sysfs_write_str(int fd, const char *str)
 {
 	int rc;
 
-	lseek( fd, 0, SEEK_SET );
-	rc = write(fd, str, strlen(str)+1);
+	rc = pwrite(fd, str, strlen(str)+1, 0);
 	if (rc < 0) {
 		return -errno;
 	}
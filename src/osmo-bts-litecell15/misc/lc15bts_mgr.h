@@ -7,8 +7,15 @@
 #include <osmocom/core/select.h>
 #include <osmocom/core/timer.h>
 
+#include <osmo-bts/hwmon.h>
+
 #include <stdint.h>
 
+#include "lc15bts_temp.h"
+
+/* number of temperature checks kept per sensor */
+#define TEMP_HIST_LEN		64
+
 enum {
 	DTEMP,
 	DFW,
@@ -89,6 +96,9 @@ struct lc15bts_mgr_instance {
 		struct lc15bts_temp_limit tx1_limit;
 		struct lc15bts_temp_limit pa0_limit;
 		struct lc15bts_temp_limit pa1_limit;
+
+		struct hwmon_interval interval;
+		struct hwmon_hist hist[_NUM_TEMP_SENSORS];
 	} temp;
 
 	struct {
@@ -103,6 +113,7 @@ int lc15bts_mgr_parse_config(struct lc15bts_mgr_instance *mgr);
 int lc15bts_mgr_nl_init(void);
 int lc15bts_mgr_temp_init(struct lc15bts_mgr_instance *mgr);
 const char *lc15bts_mgr_temp_get_state(enum lc15bts_temp_state state);
+const char *lc15bts_mgr_temp_get_name(enum lc15bts_temp_sensor sensor);
 
 
 int lc15bts_mgr_calib_init(struct lc15bts_mgr_instance *mgr);
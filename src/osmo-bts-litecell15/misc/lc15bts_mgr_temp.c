@@ -23,16 +23,26 @@
  *
  */
 
+#include <stddef.h>
+#include <time.h>
+
 #include "misc/lc15bts_mgr.h"
 #include "misc/lc15bts_misc.h"
 #include "misc/lc15bts_temp.h"
 #include "misc/lc15bts_power.h"
 
 #include <osmo-bts/logging.h>
+#include <osmo-bts/hwmon.h>
 
 #include <osmocom/core/timer.h>
 #include <osmocom/core/utils.h>
 
+/* check interval in seconds, see hwmon_interval_next() */
+#define TEMP_CHECK_MIN		10
+#define TEMP_CHECK_MAX		(2 * 60)
+/* degrees below a warning limit that count as near the limit */
+#define TEMP_NEAR_MARGIN	5
+
 static struct lc15bts_mgr_instance *s_mgr;
 static struct osmo_timer_list temp_ctrl_timer;
 
@@ -206,162 +216,108 @@ static void lc15bts_mgr_temp_handle(struct lc15bts_mgr_instance *manager,
 	};
 } 
 
-static void temp_ctrl_check()
-{
-	int rc;
-	int warn_thresh_passed = 0;
-	int crit_thresh_passed = 0;
-
-	LOGP(DTEMP, LOGL_DEBUG, "Going to check the temperature.\n");
+static const struct {
+	const char *name;
+	enum lc15bts_temp_sensor sensor;
+	size_t limit;		/* offset in struct lc15bts_mgr_instance */
+} temp_sensors[] = {
+	{ "supply", LC15BTS_TEMP_SUPPLY,
+	  offsetof(struct lc15bts_mgr_instance, temp.supply_limit) },
+	{ "SoC", LC15BTS_TEMP_SOC,
+	  offsetof(struct lc15bts_mgr_instance, temp.soc_limit) },
+	{ "FPGA", LC15BTS_TEMP_FPGA,
+	  offsetof(struct lc15bts_mgr_instance, temp.fpga_limit) },
+	{ "RF log detector", LC15BTS_TEMP_LOGRF,
+	  offsetof(struct lc15bts_mgr_instance, temp.logrf_limit) },
+	{ "OCXO", LC15BTS_TEMP_OCXO,
+	  offsetof(struct lc15bts_mgr_instance, temp.ocxo_limit) },
+	{ "TX #0", LC15BTS_TEMP_TX0,
+	  offsetof(struct lc15bts_mgr_instance, temp.tx0_limit) },
+	{ "TX #1", LC15BTS_TEMP_TX1,
+	  offsetof(struct lc15bts_mgr_instance, temp.tx1_limit) },
+	{ "PA #0", LC15BTS_TEMP_PA0,
+	  offsetof(struct lc15bts_mgr_instance, temp.pa0_limit) },
+	{ "PA #1", LC15BTS_TEMP_PA1,
+	  offsetof(struct lc15bts_mgr_instance, temp.pa1_limit) },
+};
 
-	/* Read the current supply temperature */
-	rc = lc15bts_temp_get(LC15BTS_TEMP_SUPPLY);
-	if (rc < 0) {
-		LOGP(DTEMP, LOGL_ERROR,
-			"Failed to read the supply temperature. rc=%d\n", rc);
-		warn_thresh_passed = crit_thresh_passed = 1;
-	} else {
-		int temp = rc / 1000;
-		if (temp > s_mgr->temp.supply_limit.thresh_warn)
-			warn_thresh_passed = 1;
-		if (temp > s_mgr->temp.supply_limit.thresh_crit)
-			crit_thresh_passed = 1;
-		LOGP(DTEMP, LOGL_DEBUG, "Supply temperature is: %d\n", temp);
-	}
+const char *lc15bts_mgr_temp_get_name(enum lc15bts_temp_sensor sensor)
+{
+	int i;
 
-	/* Read the current SoC temperature */
-	rc = lc15bts_temp_get(LC15BTS_TEMP_SOC);
-	if (rc < 0) {
-		LOGP(DTEMP, LOGL_ERROR,
-			"Failed to read the SoC temperature. rc=%d\n", rc);
-		warn_thresh_passed = crit_thresh_passed = 1;
-	} else {
-		int temp = rc / 1000;
-		if (temp > s_mgr->temp.soc_limit.thresh_warn)
-			warn_thresh_passed = 1;
-		if (temp > s_mgr->temp.soc_limit.thresh_crit)
-			crit_thresh_passed = 1;
-		LOGP(DTEMP, LOGL_DEBUG, "SoC temperature is: %d\n", temp);
+	for (i = 0; i < ARRAY_SIZE(temp_sensors); i++) {
+		if (temp_sensors[i].sensor == sensor)
+			return temp_sensors[i].name;
 	}
+	return "unknown";
+}
 
-	/* Read the current fpga temperature */
-	rc = lc15bts_temp_get(LC15BTS_TEMP_FPGA);
-	if (rc < 0) {
-		LOGP(DTEMP, LOGL_ERROR,
-			"Failed to read the fpga temperature. rc=%d\n", rc);
-		warn_thresh_passed = crit_thresh_passed = 1;
-	} else {
-		int temp = rc / 1000;
-		if (temp > s_mgr->temp.fpga_limit.thresh_warn)
-			warn_thresh_passed = 1;
-		if (temp > s_mgr->temp.fpga_limit.thresh_crit)
-			crit_thresh_passed = 1;
-		LOGP(DTEMP, LOGL_DEBUG, "FPGA temperature is: %d\n", temp);
-	}
+/* returns 1 if a temperature is near or above its warning limit */
+static int temp_ctrl_check(void)
+{
+	time_t now = time(NULL);
+	int warn_thresh_passed = 0;
+	int crit_thresh_passed = 0;
+	int near = 0;
+	int i, rc;
 
-	/* Read the current RF log detector temperature */
-	rc = lc15bts_temp_get(LC15BTS_TEMP_LOGRF);
-	if (rc < 0) {
-		LOGP(DTEMP, LOGL_ERROR,
-			"Failed to read the RF log detector temperature. rc=%d\n", rc);
-		warn_thresh_passed = crit_thresh_passed = 1;
-	} else {
-		int temp = rc / 1000;
-		if (temp > s_mgr->temp.logrf_limit.thresh_warn)
-			warn_thresh_passed = 1;
-		if (temp > s_mgr->temp.logrf_limit.thresh_crit)
-			crit_thresh_passed = 1;
-		LOGP(DTEMP, LOGL_DEBUG, "RF log detector temperature is: %d\n", temp);
-	}
+	LOGP(DTEMP, LOGL_DEBUG, "Going to check the temperature.\n");
 
-	/* Read the current OCXO temperature */
-	rc = lc15bts_temp_get(LC15BTS_TEMP_OCXO);
-	if (rc < 0) {
-		LOGP(DTEMP, LOGL_ERROR,
-			"Failed to read the OCXO temperature. rc=%d\n", rc);
-		warn_thresh_passed = crit_thresh_passed = 1;
-	} else {
-		int temp = rc / 1000;
-		if (temp > s_mgr->temp.ocxo_limit.thresh_warn)
-			warn_thresh_passed = 1;
-		if (temp > s_mgr->temp.ocxo_limit.thresh_crit)
-			crit_thresh_passed = 1;
-		LOGP(DTEMP, LOGL_DEBUG, "OCXO temperature is: %d\n", temp);
-	}
+	for (i = 0; i < ARRAY_SIZE(temp_sensors); i++) {
+		const struct lc15bts_temp_limit *limit = (const void *)
+			((const uint8_t *) s_mgr + temp_sensors[i].limit);
+		int temp;
 
-	/* Read the current TX #1 temperature */
-	rc = lc15bts_temp_get(LC15BTS_TEMP_TX0);
-	if (rc < 0) {
-		LOGP(DTEMP, LOGL_ERROR,
-			"Failed to read the TX #0 temperature. rc=%d\n", rc);
-		warn_thresh_passed = crit_thresh_passed = 1;
-	} else {
-		int temp = rc / 1000;
-		if (temp > s_mgr->temp.tx0_limit.thresh_warn)
-			warn_thresh_passed = 1;
-		if (temp > s_mgr->temp.tx0_limit.thresh_crit)
-			crit_thresh_passed = 1;
-		LOGP(DTEMP, LOGL_DEBUG, "TX #0 temperature is: %d\n", temp);
-	}
+		rc = lc15bts_temp_get(temp_sensors[i].sensor);
+		if (rc < 0) {
+			LOGP(DTEMP, LOGL_ERROR,
+				"Failed to read the %s temperature. rc=%d\n",
+				temp_sensors[i].name, rc);
+			warn_thresh_passed = crit_thresh_passed = 1;
+			continue;
+		}
 
-	/* Read the current TX #2 temperature */
-	rc = lc15bts_temp_get(LC15BTS_TEMP_TX1);
-	if (rc < 0) {
-		LOGP(DTEMP, LOGL_ERROR,
-			"Failed to read the TX #1 temperature. rc=%d\n", rc);
-		warn_thresh_passed = crit_thresh_passed = 1;
-	} else {
-		int temp = rc / 1000;
-		if (temp > s_mgr->temp.tx1_limit.thresh_warn)
-			warn_thresh_passed = 1;
-		if (temp > s_mgr->temp.tx1_limit.thresh_crit)
-			crit_thresh_passed = 1;
-		LOGP(DTEMP, LOGL_DEBUG, "TX #1 temperature is: %d\n", temp);
-	}
+		hwmon_hist_add(&s_mgr->temp.hist[temp_sensors[i].sensor],
+			       now, rc);
 
-	/* Read the current PA #1 temperature */
-	rc = lc15bts_temp_get(LC15BTS_TEMP_PA0);
-	if (rc < 0) {
-		LOGP(DTEMP, LOGL_ERROR,
-			"Failed to read the PA #0 temperature. rc=%d\n", rc);
-		warn_thresh_passed = crit_thresh_passed = 1;
-	} else {
-		int temp = rc / 1000;
-		if (temp > s_mgr->temp.pa0_limit.thresh_warn)
+		temp = rc / 1000;
+		if (temp > limit->thresh_warn)
 			warn_thresh_passed = 1;
-		if (temp > s_mgr->temp.pa0_limit.thresh_crit)
+		if (temp > limit->thresh_crit)
 			crit_thresh_passed = 1;
-		LOGP(DTEMP, LOGL_DEBUG, "PA #0 temperature is: %d\n", temp);
+		if (temp > limit->thresh_warn - TEMP_NEAR_MARGIN)
+			near = 1;
+		LOGP(DTEMP, LOGL_DEBUG, "%s temperature is: %d\n",
+			temp_sensors[i].name, temp);
 	}
 
-	/* Read the current PA #2 temperature */
-	rc = lc15bts_temp_get(LC15BTS_TEMP_PA1);
-	if (rc < 0) {
-		LOGP(DTEMP, LOGL_ERROR,
-			"Failed to read the PA #1 temperature. rc=%d\n", rc);
-		warn_thresh_passed = crit_thresh_passed = 1;
-	} else {
-		int temp = rc / 1000;
-		if (temp > s_mgr->temp.pa1_limit.thresh_warn)
-			warn_thresh_passed = 1;
-		if (temp > s_mgr->temp.pa1_limit.thresh_crit)
-			crit_thresh_passed = 1;
-		LOGP(DTEMP, LOGL_DEBUG, "PA #1 temperature is: %d\n", temp);
-	}
+	lc15bts_mgr_temp_handle(s_mgr, crit_thresh_passed, warn_thresh_passed);
 
-	lc15bts_mgr_temp_handle(s_mgr, crit_thresh_passed, warn_thresh_passed);	
+	return near || warn_thresh_passed
+		|| s_mgr->temp.state != STATE_NORMAL;
 }
 
 static void temp_ctrl_check_cb(void *unused)
 {
-	temp_ctrl_check();
-	/* Check every two minutes? XXX make it configurable! */
-	osmo_timer_schedule(&temp_ctrl_timer, 2 * 60, 0);
+	unsigned int interval;
+
+	interval = hwmon_interval_next(&s_mgr->temp.interval,
+				       temp_ctrl_check());
+	osmo_timer_schedule(&temp_ctrl_timer, interval, 0);
 }
 
 int lc15bts_mgr_temp_init(struct lc15bts_mgr_instance *mgr)
 {
+	int i;
+
 	s_mgr = mgr;
+
+	for (i = 0; i < _NUM_TEMP_SENSORS; i++)
+		hwmon_hist_init(tall_mgr_ctx, &s_mgr->temp.hist[i],
+				TEMP_HIST_LEN);
+	s_mgr->temp.interval.min = TEMP_CHECK_MIN;
+	s_mgr->temp.interval.max = TEMP_CHECK_MAX;
+
 	temp_ctrl_timer.cb = temp_ctrl_check_cb;
 	temp_ctrl_check_cb(NULL);
 	return 0;
@@ -29,6 +29,7 @@
 #include <stdint.h>
 #include <ctype.h>
 #include <string.h>
+#include <time.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
@@ -481,6 +482,34 @@ DEFUN(show_mgr, show_mgr_cmd, "show manager",
 	return CMD_SUCCESS;
 }
 
+DEFUN(show_temp_hist, show_temp_hist_cmd, "show temperature history",
+      SHOW_STR "Display temperature information\n"
+      "Values of the last temperature checks\n")
+{
+	int i, j;
+
+	vty_out(vty, "Check interval: %u seconds%s",
+		s_mgr->temp.interval.cur, VTY_NEWLINE);
+
+	for (i = 0; i < _NUM_TEMP_SENSORS; i++) {
+		const struct hwmon_hist *hist = &s_mgr->temp.hist[i];
+		const struct hwmon_sample *sample;
+
+		vty_out(vty, "%s:%s", lc15bts_mgr_temp_get_name(i),
+			VTY_NEWLINE);
+		for (j = 0; (sample = hwmon_hist_get(hist, j)); j++) {
+			char buf[16];
+
+			strftime(buf, sizeof(buf), "%H:%M:%S",
+				 localtime(&sample->time));
+			vty_out(vty, " %s %f Celcius%s", buf,
+				sample->val / 1000.0f, VTY_NEWLINE);
+		}
+	}
+
+	return CMD_SUCCESS;
+}
+
 DEFUN(calibrate_clock, calibrate_clock_cmd,
       "calibrate clock",
       "Calibration commands\n" 
@@ -524,6 +553,7 @@ int lc15bts_mgr_vty_init(void)
 	vty_init(&vty_info);
 
 	install_element_ve(&show_mgr_cmd);
+	install_element_ve(&show_temp_hist_cmd);
 
 	install_element(ENABLE_NODE, &calibrate_clock_cmd);
 
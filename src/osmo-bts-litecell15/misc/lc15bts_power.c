@@ -26,6 +26,8 @@
 #include <fcntl.h>
 #include <limits.h>
 
+#include <osmo-bts/hwmon.h>
+
 #include "lc15bts_power.h"
 
 #define LC15BTS_PA_VOLTAGE      24000000
@@ -50,13 +52,17 @@ static const char *power_sensor_type_str[_NUM_POWER_TYPES] = {
 	[LC15BTS_POWER_CURRENT]	= "current",
 };
 
+/* kept open, see hwmon_read_int() */
+static int power_sensor_fds[_NUM_POWER_SOURCES][_NUM_POWER_TYPES] = {
+	[0 ... _NUM_POWER_SOURCES-1] = { [0 ... _NUM_POWER_TYPES-1] = -1 }
+};
+
 int lc15bts_power_sensor_get(
         enum lc15bts_power_source source,
         enum lc15bts_power_type type)
 {
 	char buf[PATH_MAX];
-	char pwrstr[10];
-	int fd, rc;
+	int val, rc;
 
 	if (source >= _NUM_POWER_SOURCES)
 		return -EINVAL;
@@ -67,23 +73,11 @@ int lc15bts_power_sensor_get(
 	snprintf(buf, sizeof(buf)-1, "%s%s", power_sensor_devs[source], power_sensor_type_str[type]);
 	buf[sizeof(buf)-1] = '\0';
 
-	fd = open(buf, O_RDONLY);
-	if (fd < 0)
-		return fd;
-
-	rc = read(fd, pwrstr, sizeof(pwrstr));
-	pwrstr[sizeof(pwrstr)-1] = '\0';
-	if (rc < 0) {
-		close(fd);
+	rc = hwmon_read_int(&power_sensor_fds[source][type], buf, &val);
+	if (rc < 0)
 		return rc;
-	}
-	if (rc == 0) {
-		close(fd);
-		return -EIO;
-	}
-	close(fd);
 
-	return atoi(pwrstr);
+	return val;
 }
 
 
@@ -27,6 +27,8 @@
 
 #include <osmocom/core/utils.h>
 
+#include <osmo-bts/hwmon.h>
+
 #include "lc15bts_temp.h"
 
 
@@ -42,34 +44,21 @@ static const char *temp_devs[_NUM_TEMP_SENSORS] = {
 	[LC15BTS_TEMP_PA1]	= "/var/lc15/temp/pa1/temp",
 };
 
+/* kept open, see hwmon_read_int() */
+static int temp_fds[_NUM_TEMP_SENSORS] = {
+	[0 ... _NUM_TEMP_SENSORS-1] = -1
+};
+
 int lc15bts_temp_get(enum lc15bts_temp_sensor sensor)
 {
-	char buf[PATH_MAX];
-	char tempstr[8];
-	int fd, rc;
+	int temp, rc;
 
 	if (sensor < 0 || sensor >= _NUM_TEMP_SENSORS)
 		return -EINVAL;
 
-	snprintf(buf, sizeof(buf)-1, "%s", temp_devs[sensor]);
-	buf[sizeof(buf)-1] = '\0';
-
-	fd = open(buf, O_RDONLY);
-	if (fd < 0)
-		return fd;
-
-	rc = read(fd, tempstr, sizeof(tempstr));
-	tempstr[sizeof(tempstr)-1] = '\0';
-	if (rc < 0) {
-		close(fd);
+	rc = hwmon_read_int(&temp_fds[sensor], temp_devs[sensor], &temp);
+	if (rc < 0)
 		return rc;
-	}
-	if (rc == 0) {
-		close(fd);
-		return -EIO;
-	}
-	close(fd);
 
-	return atoi(tempstr);
+	return temp;
 }
-
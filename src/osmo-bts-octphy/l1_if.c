@@ -28,6 +28,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <time.h>
 #include <sys/socket.h>
 #include <sys/ioctl.h>
 #include <linux/if_packet.h>
@@ -36,6 +37,7 @@
 
 #include <osmocom/core/talloc.h>
 #include <osmocom/core/socket.h>
+#include <osmocom/core/utils.h>
 
 #include <osmo-bts/gsm_data.h>
 #include <osmo-bts/bts_model.h>
@@ -49,6 +51,7 @@
 #include "l1_utils.h"
 
 #include "octpkt.h"
+#include "packet_ring.h"
 
 #include <octphy/octpkt/octpkt_hdr.h>
 #define OCTVC1_RC2STRING_DECLARE
@@ -62,13 +65,26 @@
 
 #define cPKTAPI_FIFO_ID_MSG                                0xAAAA0001
 
-/* maximum window of unacknowledged commands */
-#define UNACK_CMD_WINDOW	8
+/* bounds and initial size of the window of unacknowledged commands */
+#define UNACK_CMD_WINDOW_MIN	2
+#define UNACK_CMD_WINDOW_INIT	8
+#define UNACK_CMD_WINDOW_MAX	64
 /* maximum number of re-transmissions of a command */
 #define MAX_RETRANS		3
-/* timeout until which we expect PHY to respond */
+/* responses to later commands before a missing one is re-transmitted */
+#define RETRANS_DUP_THRESH	3
+/* commands in a row given up on before we consider the PHY dead */
+#define MAX_FAILED_CMDS		16
+/* re-transmission timeout: initial, lower bound, upper bound (seconds) */
+#define CMD_RTO_INIT_MS		1000
+#define CMD_RTO_MIN_MS		50
 #define CMD_TIMEOUT		5
 
+/* size of the PACKET_MMAP rings, see 'octphy mmap-ring' */
+#define RING_RX_BLOCKS		16
+#define RING_RX_TOV_MS		1
+#define RING_TX_FRAMES		256
+
 /* allocate a msgb for a Layer1 primitive */
 struct msgb *l1p_msgb_alloc(void)
 {
@@ -177,6 +193,12 @@ struct wait_l1_conf {
 	void *cb_data;
 	/* number of re-transmissions so far */
 	uint32_t num_retrans;
+	/* time of the last (re-)transmission in us */
+	uint64_t tx_time;
+	/* responses to later commands received since then */
+	unsigned int later_rsps;
+	/* the phy handle we belong to */
+	struct octphy_hdl *fl1h;
 };
 
 static void release_wlc(struct wait_l1_conf *wlc)
@@ -186,17 +208,6 @@ static void release_wlc(struct wait_l1_conf *wlc)
 	talloc_free(wlc);
 }
 
-static void l1if_req_timeout(void *data)
-{
-	struct wait_l1_conf *wlc = data;
-
-	/* FIXME: Implement re-transmission of command on timer expiration */
-
-	LOGP(DL1C, LOGL_FATAL, "Timeout waiting for L1 primitive %s\n",
-		get_value_string(octphy_cid_vals, wlc->prim_id));
-	exit(23);
-}
-
 /* FIXME: this should be in libosmocore */
 static struct llist_head *llist_first(struct llist_head *head)
 {
@@ -205,10 +216,199 @@ static struct llist_head *llist_first(struct llist_head *head)
 	return head->next;
 }
 
+/* one sendto() for all frames put into the TX ring during this iteration
+ * of the main loop */
+static void ring_tx_timer_cb(void *data)
+{
+	struct octphy_hdl *fl1h = data;
+	int rc;
+
+	rc = pkt_ring_tx_kick(fl1h->ring, &fl1h->phy_addr);
+	if (rc < 0)
+		LOGP(DL1P, LOGL_ERROR, "Tx to PHY has failed: %s\n",
+			strerror(-rc));
+}
+
+/* send a message to the PHY, takes ownership of msg */
+static int octphy_tx(struct octphy_hdl *fl1h, struct msgb *msg)
+{
+	unsigned int len = msgb_length(msg);
+	uint8_t *buf;
+
+	/* only bypass the write queue if that keeps the order */
+	if (fl1h->ring && len <= PKT_RING_TX_MTU &&
+	    llist_empty(&fl1h->phy_wq.msg_queue)) {
+		buf = pkt_ring_tx_get(fl1h->ring);
+		if (buf) {
+			memcpy(buf, msg->data, len);
+			pkt_ring_tx_put(fl1h->ring, len);
+			msgb_free(msg);
+			if (!osmo_timer_pending(&fl1h->ring_tx_timer))
+				osmo_timer_schedule(&fl1h->ring_tx_timer, 0, 0);
+			return 0;
+		}
+	}
+
+	/* whatever is in the ring has to go out first */
+	if (fl1h->ring)
+		ring_tx_timer_cb(fl1h);
+
+	return osmo_wqueue_enqueue(&fl1h->phy_wq, msg);
+}
+
+static uint64_t now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/* mark this message as RETRANSMIT of a previous msg */
+static void msg_set_retrans_flag(struct msgb *msg)
+{
+	tOCTVC1_MSG_HEADER *mh = (tOCTVC1_MSG_HEADER *) msg->l2h;
+	uint32_t type_r_cmdid = ntohl(mh->ul_Type_R_CmdId);
+	type_r_cmdid |= cOCTVC1_MSG_RETRANSMIT_FLAG;
+	mh->ul_Type_R_CmdId = htonl(type_r_cmdid);
+}
+
+/* (re)start the timer of a command that was just sent, backing off
+ * exponentially with each re-transmission */
+static void wlc_start_timer(struct wait_l1_conf *wlc)
+{
+	unsigned int rto_ms = wlc->fl1h->wlc_wnd.rto_ms << wlc->num_retrans;
+
+	if (rto_ms > CMD_TIMEOUT * 1000)
+		rto_ms = CMD_TIMEOUT * 1000;
+
+	wlc->tx_time = now_us();
+	wlc->later_rsps = 0;
+	osmo_timer_schedule(&wlc->timer, rto_ms / 1000,
+			    (rto_ms % 1000) * 1000);
+}
+
+/* RTT estimation as in RFC 6298, only from commands that were sent once */
+static void wlc_wnd_rtt_sample(struct octphy_hdl *fl1h,
+			       const struct wait_l1_conf *wlc)
+{
+	uint32_t rtt = now_us() - wlc->tx_time;
+	uint32_t rto_ms;
+
+	if (!fl1h->wlc_wnd.srtt_us) {
+		fl1h->wlc_wnd.srtt_us = rtt;
+		fl1h->wlc_wnd.rttvar_us = rtt / 2;
+	} else {
+		uint32_t err = fl1h->wlc_wnd.srtt_us > rtt ?
+			fl1h->wlc_wnd.srtt_us - rtt : rtt - fl1h->wlc_wnd.srtt_us;
+
+		fl1h->wlc_wnd.rttvar_us = (3 * fl1h->wlc_wnd.rttvar_us + err) / 4;
+		fl1h->wlc_wnd.srtt_us = (7 * fl1h->wlc_wnd.srtt_us + rtt) / 8;
+	}
+	if (!fl1h->wlc_wnd.min_rtt_us || rtt < fl1h->wlc_wnd.min_rtt_us)
+		fl1h->wlc_wnd.min_rtt_us = rtt;
+
+	rto_ms = (fl1h->wlc_wnd.srtt_us + 4 * fl1h->wlc_wnd.rttvar_us) / 1000;
+	fl1h->wlc_wnd.rto_ms = OSMO_MAX(CMD_RTO_MIN_MS,
+					OSMO_MIN(rto_ms, CMD_TIMEOUT * 1000));
+}
+
+/* a response arrived: grow the window by one per response until the
+ * first loss, by one per window afterwards.  Stop growing once the
+ * commands start to queue up in the PHY, i.e. the RTT doubles. */
+static void wlc_wnd_ack(struct octphy_hdl *fl1h)
+{
+	fl1h->wlc_wnd.failed_in_row = 0;
+
+	if (fl1h->wlc_wnd.size >= UNACK_CMD_WINDOW_MAX)
+		return;
+	if (fl1h->wlc_wnd.srtt_us > 2 * fl1h->wlc_wnd.min_rtt_us)
+		return;
+
+	if (fl1h->wlc_wnd.size < fl1h->wlc_wnd.ssthresh) {
+		fl1h->wlc_wnd.size++;
+	} else if (++fl1h->wlc_wnd.acked >= fl1h->wlc_wnd.size) {
+		fl1h->wlc_wnd.acked = 0;
+		fl1h->wlc_wnd.size++;
+	}
+}
+
+/* a command got lost: halve the window, once per window of commands */
+static void wlc_wnd_loss(struct octphy_hdl *fl1h,
+			 const struct wait_l1_conf *wlc)
+{
+	if ((int32_t) (wlc->trans_id - fl1h->wlc_wnd.recover) < 0)
+		return;
+
+	fl1h->wlc_wnd.ssthresh = OSMO_MAX(fl1h->wlc_wnd.size / 2,
+					  UNACK_CMD_WINDOW_MIN);
+	fl1h->wlc_wnd.size = fl1h->wlc_wnd.ssthresh;
+	fl1h->wlc_wnd.acked = 0;
+	fl1h->wlc_wnd.recover = fl1h->next_trans_id;
+}
+
+/* re-transmit a single command of the window.  Returns 0 if the command
+ * was sent again, or -1 if we gave up on it and it was released.  The
+ * completion call-back of a command we give up on is called without a
+ * response, so that whatever waits for it can fail. */
+static int wlc_retransmit(struct octphy_hdl *fl1h, struct wait_l1_conf *wlc)
+{
+	struct msgb *msg;
+
+	wlc_wnd_loss(fl1h, wlc);
+
+	if (wlc->num_retrans >= MAX_RETRANS) {
+		LOGP(DL1C, LOGL_ERROR, "Command %s (trans_id=%u): maximum "
+		     "number of retransmissions reached, giving up\n",
+		     get_value_string(octphy_cid_vals, wlc->prim_id),
+		     wlc->trans_id);
+		fl1h->stats.cmds_failed++;
+		if (++fl1h->wlc_wnd.failed_in_row >= MAX_FAILED_CMDS) {
+			LOGP(DL1C, LOGL_FATAL, "PHY does not respond to "
+			     "commands anymore\n");
+			exit(24);
+		}
+		llist_del(&wlc->list);
+		fl1h->wlc_list_len--;
+		if (wlc->cb)
+			wlc->cb(fl1h, NULL, wlc->cb_data);
+		release_wlc(wlc);
+		return -1;
+	}
+
+	wlc->num_retrans++;
+	LOGP(DL1C, LOGL_INFO, "Re-transmitting %s (trans_id=%u, attempt %u)\n",
+	     get_value_string(octphy_cid_vals, wlc->prim_id),
+	     wlc->trans_id, wlc->num_retrans);
+
+	msg = msgb_copy(wlc->cmd_msg, "PHY CMD Retrans");
+	msg_set_retrans_flag(msg);
+	octphy_tx(fl1h, msg);
+	wlc_start_timer(wlc);
+
+	return 0;
+}
+
+static void check_refill_window(struct octphy_hdl *fl1h, struct wait_l1_conf *recent);
+
+static void l1if_req_timeout(void *data)
+{
+	struct wait_l1_conf *wlc = data;
+	struct octphy_hdl *fl1h = wlc->fl1h;
+
+	LOGP(DL1C, LOGL_NOTICE, "Timeout waiting for L1 primitive %s "
+	     "(trans_id=%u)\n", get_value_string(octphy_cid_vals, wlc->prim_id),
+	     wlc->trans_id);
+
+	fl1h->stats.retrans_cmds_timeout++;
+	if (wlc_retransmit(fl1h, wlc) < 0)
+		check_refill_window(fl1h, NULL);
+}
+
 static void check_refill_window(struct octphy_hdl *fl1h, struct wait_l1_conf *recent)
 {
 	struct wait_l1_conf *wlc;
-	int space = UNACK_CMD_WINDOW - fl1h->wlc_list_len;
+	int space = fl1h->wlc_wnd.size - fl1h->wlc_list_len;
 	int i;
 
 	for (i = 0; i < space; i++) {
@@ -226,6 +426,8 @@ static void check_refill_window(struct octphy_hdl *fl1h, struct wait_l1_conf *re
 		/* add to window */
 		llist_add_tail(&wlc->list, &fl1h->wlc_list);
 		fl1h->wlc_list_len++;
+		if (fl1h->wlc_list_len > fl1h->stats.wlc_max_len)
+			fl1h->stats.wlc_max_len = fl1h->wlc_list_len;
 
 		if (wlc != recent) {
 			LOGP(DL1C, LOGL_INFO, "Txing formerly postponed "
@@ -235,16 +437,14 @@ static void check_refill_window(struct octphy_hdl *fl1h, struct wait_l1_conf *re
 		}
 		msg = msgb_copy(wlc->cmd_msg, "Tx from wlc_postponed");
 		/* queue for execution and response handling */
-		if (osmo_wqueue_enqueue(&fl1h->phy_wq, msg) != 0) {
+		if (octphy_tx(fl1h, msg) != 0) {
 			LOGP(DL1C, LOGL_ERROR, "Tx Write queue full. dropping msg\n");
 			llist_del(&wlc->list);
 			msgb_free(msg);
 			exit(24);
 		}
-		/* schedule a timer for CMD_TIMEOUT seconds. If PHY fails to
-		 * respond, we terminate */
-		osmo_timer_schedule(&wlc->timer, CMD_TIMEOUT, 0);
-
+		/* re-transmit if the PHY fails to respond in time */
+		wlc_start_timer(wlc);
 	}
 }
 
@@ -277,6 +477,7 @@ int l1if_req_compl(struct octphy_hdl *fl1h, struct msgb *msg,
 	wlc->cb_data = data;
 	wlc->prim_id = cmd_id;
 	wlc->trans_id = ntohl(msg_hdr->ulTransactionId);
+	wlc->fl1h = fl1h;
 	wlc->timer.data = wlc;
 	wlc->timer.cb = l1if_req_timeout;
 
@@ -463,7 +664,7 @@ static int ph_data_req(struct gsm_bts_trx *trx, struct msgb *msg,
 	if (L1SAP_IS_LINK_SACCH(link_id)) {
 		sapi = cOCTVC1_GSM_SAPI_ENUM_SACCH;
 		if (!L1SAP_IS_CHAN_TCHF(chan_nr))
-			subCh = l1sap_chan2ss(chan_nr);
+			subCh = trx_chan_nr_map(trx, chan_nr)->ss;
 	} else if (L1SAP_IS_CHAN_TCHF(chan_nr)) {
 		if (trx->ts[u8Tn].pchan == GSM_PCHAN_PDCH) {
 			if (L1SAP_IS_PTCCH(u32Fn)) {
@@ -700,12 +901,16 @@ int bts_model_l1sap_down(struct gsm_bts_trx *trx, struct osmo_phsap_prim *l1sap)
 
 static int trx_close_all_cb(struct octphy_hdl *fl1, struct msgb *resp, void *data)
 {
-	tOCTVC1_GSM_MSG_TRX_CLOSE_ALL_RSP *car =
-		(tOCTVC1_GSM_MSG_TRX_CLOSE_ALL_RSP *) resp->l2h;
+	tOCTVC1_GSM_MSG_TRX_CLOSE_ALL_RSP *car;
+
+	/* the PHY link stays down */
+	if (!resp)
+		return 0;
 
 	/* in a completion call-back, we take msgb ownership and must
 	 * release it before returning */
 
+	car = (tOCTVC1_GSM_MSG_TRX_CLOSE_ALL_RSP *) resp->l2h;
 	mOCTVC1_GSM_MSG_TRX_CLOSE_ALL_RSP_SWAP(car);
 
 	/* we now know that the PHY link is connected */
@@ -1123,117 +1328,74 @@ static int rx_gsm_trx_time_ind(struct msgb *msg)
 	return handle_mph_time_ind(fl1h, tind->TrxId.byTrxId, tind->ulFrameNumber);
 }
 
-/* mark this message as RETRANSMIT of a previous msg */
-static void msg_set_retrans_flag(struct msgb *msg)
-{
-	tOCTVC1_MSG_HEADER *mh = (tOCTVC1_MSG_HEADER *) msg->l2h;
-	uint32_t type_r_cmdid = ntohl(mh->ul_Type_R_CmdId);
-	type_r_cmdid |= cOCTVC1_MSG_RETRANSMIT_FLAG;
-	mh->ul_Type_R_CmdId = htonl(type_r_cmdid);
-}
-
-/* re-transmit all commands in the window that have a transaction ID lower than
- * trans_id */
-static int retransmit_wlc_upto(struct octphy_hdl *fl1h, uint32_t trans_id)
-{
-	struct wait_l1_conf *wlc;
-	int count = 0;
-
-	LOGP(DL1C, LOGL_INFO, "Retransmitting up to trans_id=%u\n", trans_id);
-
-	/* trans_id represents the trans_id of the just-received response, we
-	 * therefore need to re-send any commands with a lower trans_id */
-	llist_for_each_entry(wlc, &fl1h->wlc_list, list) {
-		if (wlc->trans_id <= trans_id) {
-			struct msgb *msg;
-			if (wlc->num_retrans >= MAX_RETRANS) {
-				LOGP(DL1C, LOGL_ERROR, "Command %s: maximum "
-				     "number of retransmissions reached\n",
-				     get_value_string(octphy_cid_vals,
-						      wlc->prim_id));
-				exit(24);
-			}
-			wlc->num_retrans++;
-			msg = msgb_copy(wlc->cmd_msg, "PHY CMD Retrans");
-			msg_set_retrans_flag(msg);
-			osmo_wqueue_enqueue(&fl1h->phy_wq, msg);
-			osmo_timer_schedule(&wlc->timer, CMD_TIMEOUT, 0);
-			count++;
-			LOGP(DL1C, LOGL_INFO, "Re-transmitting %s "
-			     "(trans_id=%u, attempt %u)\n",
-			     get_value_string(octphy_cid_vals, wlc->prim_id),
-			     wlc->trans_id, wlc->num_retrans);
-		}
-	}
-
-	return count;
-}
-
 /* Receive a response (to a prior command) from the PHY */
 static int rx_octvc1_resp(struct msgb *msg, uint32_t msg_id, uint32_t trans_id)
 {
 	tOCTVC1_MSG_HEADER *mh = (tOCTVC1_MSG_HEADER *) msg->l2h;
-	struct llist_head *first;
 	uint32_t return_code = ntohl(mh->ulReturnCode);
 	struct octphy_hdl *fl1h = msg->dst;
-	struct wait_l1_conf *wlc = NULL;
+	struct wait_l1_conf *wlc, *wlc2, *found = NULL;
 	int rc;
 
 	LOGP(DL1C, LOGL_DEBUG, "rx_octvc1_resp(msg_id=%s, trans_id=%u)\n",
 		octvc1_rc2string(msg_id), trans_id);
 
-	/* check if the response is for the oldest (first) entry in wlc_list */
-	first = llist_first(&fl1h->wlc_list);
-	if (first) {
-		wlc = llist_entry(first, struct wait_l1_conf, list);
-		if (wlc->trans_id == trans_id) {
-			/* process the received response */
-			llist_del(&wlc->list);
-			fl1h->wlc_list_len--;
-			if (wlc->cb) {
-				/* call-back function must take msgb
-				 * ownership. */
-				rc = wlc->cb(fl1h, msg, wlc->cb_data);
-			} else {
-				rc = 0;
-				msgb_free(msg);
-			}
-			release_wlc(wlc);
-			/* check if there are postponed wlcs and re-fill the window */
-			check_refill_window(fl1h, NULL);
-			return rc;
+	llist_for_each_entry(wlc, &fl1h->wlc_list, list) {
+		if (wlc->prim_id == msg_id && wlc->trans_id == trans_id) {
+			found = wlc;
+			break;
 		}
 	}
 
-	LOGP(DL1C, LOGL_NOTICE, "Sequence error: Rx response (cmd=%s, trans_id=%u) "
-	     "for cmd != oldest entry in window (trans_id=%u)!!\n",
-	     get_value_string(octphy_cid_vals, msg_id), trans_id,
-	     wlc ? wlc->trans_id : 0);
-
-	/* check if the response is for any of the other entries in wlc_list */
-	llist_for_each_entry(wlc, &fl1h->wlc_list, list) {
-		if (wlc->prim_id == msg_id && wlc->trans_id == trans_id) {
-			/* it is assumed that all of the previous response
-			 * message(s) have been lost, and we need to
-			 * re-transmit older messages from the window */
-			rc = retransmit_wlc_upto(fl1h, trans_id);
-			fl1h->stats.retrans_cmds_trans_id += rc;
-			/* do not process the received response, we rather wait
-			 * for the in-order retransmissions to arrive */
-			msgb_free(msg);
-			return 0;
+	if (!found) {
+		/* a late response to a command we re-transmitted or gave
+		 * up on.  Ignore it if it went ok, but let the user know
+		 * about failing ones. */
+		if (return_code != cOCTVC1_RC_OK) {
+			LOGP(DL1C, LOGL_NOTICE, "Rx Unexpected response %s "
+			     "(trans_id=%u)\n",
+			     get_value_string(octphy_cid_vals, msg_id),
+			     trans_id);
 		}
+		msgb_free(msg);
+		return 0;
 	}
 
-	/* ignore unhandled responses that went ok, but let the user know about
-	 * failing ones.  */
-	if (return_code != cOCTVC1_RC_OK) {
-		LOGP(DL1C, LOGL_NOTICE, "Rx Unexpected response %s (trans_id=%u)\n",
-		     get_value_string(octphy_cid_vals, msg_id), trans_id);
+	/* The responses to older commands are still missing, they were
+	 * lost or overtaken.  Re-transmit only those that were overtaken
+	 * several times, a single lost one is caught by its timer. */
+	llist_for_each_entry_safe(wlc, wlc2, &fl1h->wlc_list, list) {
+		if (wlc == found)
+			break;
+		if (++wlc->later_rsps != RETRANS_DUP_THRESH)
+			continue;
+		LOGP(DL1C, LOGL_INFO, "Sequence error: no response for cmd "
+		     "%s (trans_id=%u) before trans_id=%u\n",
+		     get_value_string(octphy_cid_vals, wlc->prim_id),
+		     wlc->trans_id, trans_id);
+		fl1h->stats.retrans_cmds_trans_id++;
+		wlc_retransmit(fl1h, wlc);
 	}
-	msgb_free(msg);
-	return 0;
 
+	/* process the received response */
+	wlc = found;
+	llist_del(&wlc->list);
+	fl1h->wlc_list_len--;
+	if (!wlc->num_retrans)
+		wlc_wnd_rtt_sample(fl1h, wlc);
+	wlc_wnd_ack(fl1h);
+
+	if (wlc->cb) {
+		/* call-back function must take msgb ownership. */
+		rc = wlc->cb(fl1h, msg, wlc->cb_data);
+	} else {
+		rc = 0;
+		msgb_free(msg);
+	}
+	release_wlc(wlc);
+	/* check if there are postponed wlcs and re-fill the window */
+	check_refill_window(fl1h, NULL);
+	return rc;
 }
 
 static int rx_gsm_clockmgr_status_ind(struct msgb *msg)
@@ -1385,8 +1547,9 @@ static int rx_octvc1_supv(struct msgb *msg, uint32_t msg_id, uint32_t trans_id)
 	tOCTVC1_MSG_HEADER *mh = (tOCTVC1_MSG_HEADER *) msg->l2h;
 	tOCTVC1_CTRL_MSG_MODULE_REJECT_SPV *rej;
 	uint32_t return_code = ntohl(mh->ulReturnCode);
+	struct wait_l1_conf *wlc, *wlc2;
+	uint32_t next_trans_id = fl1h->next_trans_id;
 	uint32_t rejected_msg_id;
-	int rc;
 
 	switch (msg_id) {
 	case cOCTVC1_CTRL_MSG_MODULE_REJECT_SID:
@@ -1398,8 +1561,20 @@ static int rx_octvc1_supv(struct msgb *msg, uint32_t msg_id, uint32_t trans_id)
 		     "ExpectedTID=0x%08x, RejectedCmdID=%s)\n",
 		     trans_id, rej->ulExpectedTransactionId,
 		     get_value_string(octphy_cid_vals, rejected_msg_id));
-		rc = retransmit_wlc_upto(fl1h, trans_id);
-		fl1h->stats.retrans_cmds_supv += rc;
+		/* the PHY has executed everything before the expected
+		 * command, their responses are on the way.  Only what
+		 * follows needs to be sent again. */
+		llist_for_each_entry_safe(wlc, wlc2, &fl1h->wlc_list, list) {
+			if ((int32_t) (wlc->trans_id -
+				       rej->ulExpectedTransactionId) < 0)
+				continue;
+			/* sent by the call-back of a command given up on */
+			if ((int32_t) (wlc->trans_id - next_trans_id) >= 0)
+				break;
+			fl1h->stats.retrans_cmds_supv++;
+			wlc_retransmit(fl1h, wlc);
+		}
+		check_refill_window(fl1h, NULL);
 		break;
 	default:
 		LOGP(DL1C, LOGL_NOTICE, "Rx unhandled supervisory msg_id "
@@ -1407,6 +1582,7 @@ static int rx_octvc1_supv(struct msgb *msg, uint32_t msg_id, uint32_t trans_id)
 		break;
 	}
 
+	msgb_free(msg);
 	return 0;
 }
 
@@ -1569,7 +1745,7 @@ static int octphy_read_cb(struct osmo_fd *ofd)
 	struct sockaddr_ll sll;
 	socklen_t sll_len = sizeof(sll);
 	int rc;
-	struct msgb *msg = msgb_alloc_headroom(1500, 24, "PHY Rx");
+	struct msgb *msg = l1p_msgb_alloc();
 
 	if (!msg)
 		return -ENOMEM;
@@ -1590,6 +1766,37 @@ static int octphy_read_cb(struct osmo_fd *ofd)
 	return rx_octphy_msg(msg);
 }
 
+/* rx_octphy_msg() keeps the msgb, so each frame is copied out of the RX
+ * ring into a new msgb */
+static void octphy_ring_rx_frame(const uint8_t *buf, unsigned int len,
+				 void *data)
+{
+	struct msgb *msg;
+
+	if (len > 1500 - 24) {
+		LOGP(DL1C, LOGL_ERROR, "Dropping oversized PHY frame (%u)\n",
+			len);
+		return;
+	}
+
+	msg = l1p_msgb_alloc();
+	if (!msg)
+		return;
+
+	msg->dst = data;
+	memcpy(msgb_put(msg, len), buf, len);
+	rx_octphy_msg(msg);
+}
+
+static int octphy_ring_read_cb(struct osmo_fd *ofd)
+{
+	struct octphy_hdl *fl1h = ofd->data;
+
+	pkt_ring_rx(fl1h->ring, octphy_ring_rx_frame, fl1h);
+
+	return 0;
+}
+
 static int octphy_write_cb(struct osmo_fd *fd, struct msgb *msg)
 {
 	struct octphy_hdl *fl1h = fd->data;
@@ -1622,6 +1829,9 @@ struct octphy_hdl *l1if_open(struct phy_link *plink)
 
 	INIT_LLIST_HEAD(&fl1h->wlc_list);
 	INIT_LLIST_HEAD(&fl1h->wlc_postponed);
+	fl1h->wlc_wnd.size = UNACK_CMD_WINDOW_INIT;
+	fl1h->wlc_wnd.ssthresh = UNACK_CMD_WINDOW_MAX;
+	fl1h->wlc_wnd.rto_ms = CMD_RTO_INIT_MS;
 	fl1h->phy_link = plink;
 
 	if (!phy_dev) {
@@ -1674,6 +1884,19 @@ struct octphy_hdl *l1if_open(struct phy_link *plink)
 	fl1h->phy_wq.bfd.when = BSC_FD_READ;
 	fl1h->phy_wq.bfd.cb = osmo_wqueue_bfd_cb;
 	fl1h->phy_wq.bfd.data = fl1h;
+
+	if (plink->u.octphy.mmap_ring) {
+		fl1h->ring = pkt_ring_alloc(fl1h, sfd, RING_RX_BLOCKS,
+					    RING_RX_TOV_MS, RING_TX_FRAMES);
+		if (fl1h->ring) {
+			fl1h->phy_wq.read_cb = octphy_ring_read_cb;
+			fl1h->ring_tx_timer.cb = ring_tx_timer_cb;
+			fl1h->ring_tx_timer.data = fl1h;
+		} else
+			LOGP(DL1C, LOGL_NOTICE, "Using recvfrom()/sendto() "
+				"for the PHY\n");
+	}
+
 	rc = osmo_fd_register(&fl1h->phy_wq.bfd);
 	if (rc < 0) {
 		close(sfd);
@@ -1686,6 +1909,10 @@ struct octphy_hdl *l1if_open(struct phy_link *plink)
 
 int l1if_close(struct octphy_hdl *fl1h)
 {
+	if (fl1h->ring) {
+		osmo_timer_del(&fl1h->ring_tx_timer);
+		pkt_ring_free(fl1h->ring);
+	}
 	osmo_fd_unregister(&fl1h->phy_wq.bfd);
 	close(fl1h->phy_wq.bfd.fd);
 	talloc_free(fl1h);
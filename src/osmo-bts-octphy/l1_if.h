@@ -23,6 +23,9 @@ struct octphy_hdl {
 
 	/* packet socket to talk with PHY */
 	struct osmo_wqueue phy_wq;
+	/* optional PACKET_MMAP rings on that socket */
+	struct pkt_ring *ring;
+	struct osmo_timer_list ring_tx_timer;
 
 	/* address parameters of the PHY */
 	uint32_t session_id;
@@ -58,8 +61,31 @@ struct octphy_hdl {
 		uint32_t retrans_cmds_supv;
 		/* number of commands/wlcs that we ever had to postpone */
 		uint32_t wlc_postponed;
+		/* messages retransmitted after their timer expired */
+		uint32_t retrans_cmds_timeout;
+		/* commands given up after MAX_RETRANS retransmissions */
+		uint32_t cmds_failed;
+		/* highest number of commands in the window */
+		uint32_t wlc_max_len;
 	} stats;
 
+	/* The window adapts to the PHY: it grows as long as the responses
+	 * come back in time and shrinks on loss, see l1_if.c */
+	struct {
+		unsigned int size;
+		unsigned int ssthresh;
+		unsigned int acked;
+		/* losses of commands before this trans_id were counted */
+		uint32_t recover;
+		/* round trip time of the commands */
+		uint32_t srtt_us;
+		uint32_t rttvar_us;
+		uint32_t min_rtt_us;
+		/* current re-transmission timeout */
+		uint32_t rto_ms;
+		unsigned int failed_in_row;
+	} wlc_wnd;
+
 	/* This is a list of wait_la_conf that OsmoBTS wanted to transmit to
 	 * the PHY, but which couldn't yet been sent as the unacknowledged
 	 * command window was full. */
@@ -79,6 +105,7 @@ struct octphy_hdl {
 void l1if_fill_msg_hdr(tOCTVC1_MSG_HEADER *mh, struct msgb *msg,
 			struct octphy_hdl *fl1h, uint32_t msg_type, uint32_t api_cmd);
 
+/* l1_msg is NULL if the PHY never responded to the command */
 typedef int l1if_compl_cb(struct octphy_hdl *fl1, struct msgb *l1_msg, void *data);
 
 /* send a request primitive to the L1 and schedule completion call-back */
@@ -196,6 +196,12 @@ static int opstart_compl(struct gsm_abis_mo *mo)
 	return oml_mo_opstart_ack(mo);
 }
 
+static int opstart_fail(struct gsm_abis_mo *mo)
+{
+	oml_mo_state_chg(mo, NM_OPSTATE_DISABLED, NM_AVSTATE_FAILED);
+	return oml_mo_opstart_nack(mo, NM_NACK_CANT_PERFORM);
+}
+
 static
 tOCTVC1_GSM_ID_SUB_CHANNEL_NB_ENUM lchan_to_GsmL1_SubCh_t(const struct gsm_lchan
 							  * lchan)
@@ -352,19 +358,52 @@ static void sapi_clear_queue(struct llist_head *queue)
 	}
 }
 
+/* the PHY never responded to the command at the head of the queue,
+ * fail it like the PHY had rejected it */
+static void sapi_queue_no_rsp(struct gsm_lchan *lchan)
+{
+	struct sapi_cmd *cmd;
+
+	if (llist_empty(&lchan->sapi_cmds))
+		return;
+
+	cmd = llist_entry(lchan->sapi_cmds.next, struct sapi_cmd, entry);
+	LOGP(DL1C, LOGL_ERROR, "%s No response for L1 SAPI %s\n",
+	     gsm_lchan_name(lchan),
+	     get_value_string(octphy_l1sapi_names, cmd->sapi));
+
+	if (cmd->type == SAPI_CMD_ACTIVATE || cmd->type == SAPI_CMD_DEACTIVATE) {
+		switch (cmd->dir) {
+		case cOCTVC1_GSM_DIRECTION_ENUM_TX_BTS_MS:
+			lchan->sapis_dl[cmd->sapi] = LCHAN_SAPI_S_ERROR;
+			break;
+		case cOCTVC1_GSM_DIRECTION_ENUM_RX_BTS_MS:
+			lchan->sapis_ul[cmd->sapi] = LCHAN_SAPI_S_ERROR;
+			break;
+		}
+	}
+
+	sapi_queue_dispatch(lchan, -ETIMEDOUT);
+}
+
 static int lchan_act_compl_cb(struct octphy_hdl *fl1, struct msgb *resp, void *data)
 {
-	tOCTVC1_GSM_MSG_TRX_ACTIVATE_LOGICAL_CHANNEL_RSP *ar =
-		(tOCTVC1_GSM_MSG_TRX_ACTIVATE_LOGICAL_CHANNEL_RSP *) resp->l2h;
+	tOCTVC1_GSM_MSG_TRX_ACTIVATE_LOGICAL_CHANNEL_RSP *ar;
 	struct gsm_bts_trx *trx;
 	struct gsm_lchan *lchan;
 	uint8_t sapi;
 	uint8_t direction;
 	uint8_t status;
 
+	if (!resp) {
+		sapi_queue_no_rsp(data);
+		return 0;
+	}
+
 	/* in a completion call-back, we take msgb ownership and must
 	 * release it before returning */
 
+	ar = (tOCTVC1_GSM_MSG_TRX_ACTIVATE_LOGICAL_CHANNEL_RSP *) resp->l2h;
 	mOCTVC1_GSM_MSG_TRX_ACTIVATE_LOGICAL_CHANNEL_RSP_SWAP(ar);
 	trx = trx_by_l1h(fl1, ar->TrxId.byTrxId);
 
@@ -445,7 +484,7 @@ static int mph_send_activate_req(struct gsm_lchan *lchan, struct sapi_cmd *cmd)
 	LOGPC(DL1C, LOGL_INFO, "%s)\n",
 		get_value_string(octphy_dir_names, cmd->dir));
 
-	return l1if_req_compl(fl1h, msg, lchan_act_compl_cb, NULL);
+	return l1if_req_compl(fl1h, msg, lchan_act_compl_cb, lchan);
 }
 
 
@@ -459,15 +498,20 @@ static tOCTVC1_GSM_CIPHERING_ID_ENUM rsl2l1_ciph[] = {
 
 static int set_ciph_compl_cb(struct octphy_hdl *fl1, struct msgb *resp, void *data)
 {
-	tOCTVC1_GSM_MSG_TRX_MODIFY_PHYSICAL_CHANNEL_CIPHERING_RSP *pcr =
-		(tOCTVC1_GSM_MSG_TRX_MODIFY_PHYSICAL_CHANNEL_CIPHERING_RSP *) resp->l2h;
-	struct gsm_bts_trx *trx;
-	struct gsm_bts_trx_ts *ts;
-	struct gsm_lchan *lchan;
+	tOCTVC1_GSM_MSG_TRX_MODIFY_PHYSICAL_CHANNEL_CIPHERING_RSP *pcr;
+	/* the response does not tell the sub-channel, the request
+	 * hands us the lchan */
+	struct gsm_lchan *lchan = data;
+
+	if (!resp) {
+		sapi_queue_no_rsp(lchan);
+		return 0;
+	}
 
 	/* in a completion call-back, we take msgb ownership and must
 	 * release it before returning */
 
+	pcr = (tOCTVC1_GSM_MSG_TRX_MODIFY_PHYSICAL_CHANNEL_CIPHERING_RSP *) resp->l2h;
 	mOCTVC1_GSM_MSG_TRX_MODIFY_PHYSICAL_CHANNEL_CIPHERING_RSP_SWAP(pcr);
 
 	if (pcr->Header.ulReturnCode != cOCTVC1_RC_OK) {
@@ -477,13 +521,6 @@ static int set_ciph_compl_cb(struct octphy_hdl *fl1, struct msgb *resp, void *da
 		exit(-1);
 	}
 
-	trx = trx_by_l1h(fl1, pcr->TrxId.byTrxId);
-	OSMO_ASSERT(pcr->TrxId.byTrxId == trx->nr);
-	ts = &trx->ts[pcr->PchId.byTimeslotNb];
-	/* for some strange reason the response does not tell which
-	 * sub-channel, only th request contains this information :( */
-	lchan = &ts->lchan[(unsigned long) data];
-
 	/* TODO: This state machine should be shared accross BTS models? */
 	switch (lchan->ciph_state) {
 	case LCHAN_CIPH_RX_REQ:	
@@ -539,10 +576,9 @@ static int mph_send_config_ciphering(struct gsm_lchan *lchan, struct sapi_cmd *c
 
 	mOCTVC1_GSM_MSG_TRX_MODIFY_PHYSICAL_CHANNEL_CIPHERING_CMD_SWAP(pcc);
 
-	/* we have to save the lchan number in this strange way, as the
-	 * PHY does not return the ulSubchannelNr in the response to
-	 * this command */
-	return l1if_req_compl(fl1h, msg, set_ciph_compl_cb, (void *)(unsigned long) lchan->nr);
+	/* we have to save the lchan, as the PHY does not return the
+	 * ulSubchannelNr in the response to this command */
+	return l1if_req_compl(fl1h, msg, set_ciph_compl_cb, lchan);
 }
 
 
@@ -666,16 +702,21 @@ static int lchan_deactivate_sapis(struct gsm_lchan *lchan)
 
 static int lchan_deact_compl_cb(struct octphy_hdl *fl1, struct msgb *resp, void *data)
 {
-	tOCTVC1_GSM_MSG_TRX_DEACTIVATE_LOGICAL_CHANNEL_RSP *ldr =
-		(tOCTVC1_GSM_MSG_TRX_DEACTIVATE_LOGICAL_CHANNEL_RSP *) resp->l2h;
+	tOCTVC1_GSM_MSG_TRX_DEACTIVATE_LOGICAL_CHANNEL_RSP *ldr;
 	struct gsm_bts_trx *trx;
 	struct gsm_lchan *lchan;
 	struct sapi_cmd *cmd;
 	uint8_t status;
 
+	if (!resp) {
+		sapi_queue_no_rsp(data);
+		return 0;
+	}
+
 	/* in a completion call-back, we take msgb ownership and must
 	 * release it before returning */
 
+	ldr = (tOCTVC1_GSM_MSG_TRX_DEACTIVATE_LOGICAL_CHANNEL_RSP *) resp->l2h;
 	mOCTVC1_GSM_MSG_TRX_DEACTIVATE_LOGICAL_CHANNEL_RSP_SWAP(ldr);
 	trx = trx_by_l1h(fl1, ldr->TrxId.byTrxId);
 
@@ -760,7 +801,7 @@ static int mph_send_deactivate_req(struct gsm_lchan *lchan, struct sapi_cmd *cmd
 	LOGPC(DL1C, LOGL_INFO, "%s)\n",
 		get_value_string(octphy_dir_names, cmd->dir));
 
-	return l1if_req_compl(fl1h, msg, lchan_deact_compl_cb, NULL);
+	return l1if_req_compl(fl1h, msg, lchan_deact_compl_cb, lchan);
 
 }
 
@@ -1084,12 +1125,15 @@ int l1if_rsl_chan_act(struct gsm_lchan *lchan)
 
 static int enable_events_compl_cb(struct octphy_hdl *fl1, struct msgb *resp, void *data)
 {
-	tOCTVC1_MAIN_MSG_API_SYSTEM_MODIFY_SESSION_EVT_RSP *mser =
-		(tOCTVC1_MAIN_MSG_API_SYSTEM_MODIFY_SESSION_EVT_RSP *) resp->l2h;
+	tOCTVC1_MAIN_MSG_API_SYSTEM_MODIFY_SESSION_EVT_RSP *mser;
+
+	if (!resp)
+		return 0;
 
 	/* in a completion call-back, we take msgb ownership and must
 	 * release it before returning */
 
+	mser = (tOCTVC1_MAIN_MSG_API_SYSTEM_MODIFY_SESSION_EVT_RSP *) resp->l2h;
 	mOCTVC1_MAIN_MSG_API_SYSTEM_MODIFY_SESSION_EVT_RSP_SWAP(mser);
 
 	LOGP(DL1C, LOGL_INFO, "Rx ENABLE-EVT-REC.resp\n");
@@ -1101,12 +1145,15 @@ static int enable_events_compl_cb(struct octphy_hdl *fl1, struct msgb *resp, voi
 
 static int disable_events_compl_cb(struct octphy_hdl *fl1, struct msgb *resp, void *data)
 {
-	tOCTVC1_MAIN_MSG_API_SYSTEM_MODIFY_SESSION_EVT_RSP *mser =
-		(tOCTVC1_MAIN_MSG_API_SYSTEM_MODIFY_SESSION_EVT_RSP *) resp->l2h;
+	tOCTVC1_MAIN_MSG_API_SYSTEM_MODIFY_SESSION_EVT_RSP *mser;
+
+	if (!resp)
+		return 0;
 
 	/* in a completion call-back, we take msgb ownership and must
 	 * release it before returning */
 
+	mser = (tOCTVC1_MAIN_MSG_API_SYSTEM_MODIFY_SESSION_EVT_RSP *) resp->l2h;
 	mOCTVC1_MAIN_MSG_API_SYSTEM_MODIFY_SESSION_EVT_RSP_SWAP(mser);
 
 	LOGP(DL1C, LOGL_INFO, "Rx DISABLE-EVT-REC.resp\n");
@@ -1169,12 +1216,15 @@ int l1if_disable_events(struct gsm_bts_trx *trx)
 
 static int app_info_sys_compl_cb(struct octphy_hdl *fl1h, struct msgb *resp, void *data)
 {
-	tOCTVC1_MAIN_MSG_APPLICATION_INFO_SYSTEM_RSP *aisr =
-		(tOCTVC1_MAIN_MSG_APPLICATION_INFO_SYSTEM_RSP *) resp->l2h;
+	tOCTVC1_MAIN_MSG_APPLICATION_INFO_SYSTEM_RSP *aisr;
+
+	if (!resp)
+		return 0;
 
 	/* in a completion call-back, we take msgb ownership and must
 	 * release it before returning */
 
+	aisr = (tOCTVC1_MAIN_MSG_APPLICATION_INFO_SYSTEM_RSP *) resp->l2h;
 	mOCTVC1_MAIN_MSG_APPLICATION_INFO_SYSTEM_RSP_SWAP(aisr);
 
 	LOGP(DL1C, LOGL_INFO, "Rx APP-INFO-SYSTEM.resp (platform='%s', version='%s')\n",
@@ -1213,8 +1263,12 @@ static int app_info_compl_cb(struct octphy_hdl *fl1h, struct msgb *resp,
 {
 	char ver_hdr[32];
 
-	tOCTVC1_MAIN_MSG_APPLICATION_INFO_RSP *air =
-		(tOCTVC1_MAIN_MSG_APPLICATION_INFO_RSP *) resp->l2h;
+	tOCTVC1_MAIN_MSG_APPLICATION_INFO_RSP *air;
+
+	if (!resp)
+		return 0;
+
+	air = (tOCTVC1_MAIN_MSG_APPLICATION_INFO_RSP *) resp->l2h;
 
 	sprintf(ver_hdr, "%02i.%02i.%02i-B%i", cOCTVC1_MAIN_VERSION_MAJOR,
 		cOCTVC1_MAIN_VERSION_MINOR, cOCTVC1_MAIN_VERSION_MAINTENANCE,
@@ -1265,12 +1319,15 @@ int l1if_check_app_version(struct gsm_bts_trx *trx)
 
 static int trx_close_cb(struct octphy_hdl *fl1, struct msgb *resp, void *data)
 {
-	tOCTVC1_GSM_MSG_TRX_CLOSE_RSP *car =
-		(tOCTVC1_GSM_MSG_TRX_CLOSE_RSP *) resp->l2h;
+	tOCTVC1_GSM_MSG_TRX_CLOSE_RSP *car;
+
+	if (!resp)
+		return 0;
 
 	/* in a completion call-back, we take msgb ownership and must
 	 * release it before returning */
 
+	car = (tOCTVC1_GSM_MSG_TRX_CLOSE_RSP *) resp->l2h;
 	mOCTVC1_GSM_MSG_TRX_CLOSE_RSP_SWAP(car);
 
 	LOGP(DL1C, LOGL_INFO, "Rx TRX-CLOSE.conf(%u)\n", car->TrxId.byTrxId);
@@ -1307,12 +1364,19 @@ static int trx_open_compl_cb(struct octphy_hdl *fl1h, struct msgb *resp, void *d
 {
 	struct gsm_bts_trx *trx;
 
-	tOCTVC1_GSM_MSG_TRX_OPEN_RSP *or =
-		(tOCTVC1_GSM_MSG_TRX_OPEN_RSP *) resp->l2h;
+	tOCTVC1_GSM_MSG_TRX_OPEN_RSP *or;
+
+	if (!resp) {
+		trx = data;
+		LOGP(DL1C, LOGL_ERROR, "No response to TRX-OPEN.req(trx=%u)\n",
+			trx->nr);
+		return opstart_fail(&trx->mo);
+	}
 
 	/* in a completion call-back, we take msgb ownership and must
 	 * release it before returning */
 
+	or = (tOCTVC1_GSM_MSG_TRX_OPEN_RSP *) resp->l2h;
 	mOCTVC1_GSM_MSG_TRX_OPEN_RSP_SWAP(or);
 	trx = trx_by_l1h(fl1h, or->TrxId.byTrxId);
 
@@ -1391,7 +1455,7 @@ int l1if_trx_open(struct gsm_bts_trx *trx)
 
 	mOCTVC1_GSM_MSG_TRX_OPEN_CMD_SWAP(oc);
 
-	return l1if_req_compl(fl1h, msg, trx_open_compl_cb, NULL);
+	return l1if_req_compl(fl1h, msg, trx_open_compl_cb, trx);
 }
 
 uint32_t trx_get_hlayer1(struct gsm_bts_trx * trx)
@@ -1421,16 +1485,23 @@ static int trx_init(struct gsm_bts_trx *trx)
 
 static int pchan_act_compl_cb(struct octphy_hdl *fl1, struct msgb *resp, void *data)
 {
-	tOCTVC1_GSM_MSG_TRX_ACTIVATE_PHYSICAL_CHANNEL_RSP *ar =
-		(tOCTVC1_GSM_MSG_TRX_ACTIVATE_PHYSICAL_CHANNEL_RSP *) resp->l2h;
+	tOCTVC1_GSM_MSG_TRX_ACTIVATE_PHYSICAL_CHANNEL_RSP *ar;
 	uint8_t ts_nr;
 	struct gsm_bts_trx *trx;
 	struct gsm_bts_trx_ts *ts;
 	struct gsm_abis_mo *mo;
 
+	if (!resp) {
+		ts = data;
+		LOGP(DL1C, LOGL_ERROR, "No response to PCHAN-ACT.req(trx=%u, "
+			"ts=%u)\n", ts->trx->nr, ts->nr);
+		return opstart_fail(&ts->mo);
+	}
+
 	/* in a completion call-back, we take msgb ownership and must
 	 * release it before returning */
 
+	ar = (tOCTVC1_GSM_MSG_TRX_ACTIVATE_PHYSICAL_CHANNEL_RSP *) resp->l2h;
 	mOCTVC1_GSM_MSG_TRX_ACTIVATE_PHYSICAL_CHANNEL_RSP_SWAP(ar);
 	trx = trx_by_l1h(fl1, ar->TrxId.byTrxId);
 	ts_nr = ar->PchId.byTimeslotNb;
@@ -1493,7 +1564,7 @@ static int ts_connect(struct gsm_bts_trx_ts *ts)
 
 	mOCTVC1_GSM_MSG_TRX_ACTIVATE_PHYSICAL_CHANNEL_CMD_SWAP(oc);
 
-	return l1if_req_compl(fl1h, msg, pchan_act_compl_cb, NULL);
+	return l1if_req_compl(fl1h, msg, pchan_act_compl_cb, ts);
 }
 
 /***********************************************************************
@@ -190,8 +190,7 @@ int l1if_tch_rx(struct gsm_bts_trx *trx, uint8_t chan_nr,
 
 	uint8_t payload_len;
 	struct msgb *rmsg = NULL;
-	struct gsm_lchan *lchan =
-	    &trx->ts[L1SAP_CHAN2TS(chan_nr)].lchan[l1sap_chan2ss(chan_nr)];
+	struct gsm_lchan *lchan = get_lchan_by_chan_nr(trx, chan_nr);
 
 	if (data_ind->Data.ulDataLength < 1) {
 		LOGP(DL1C, LOGL_ERROR, "chan_nr %d Rx Payload size 0\n",
@@ -0,0 +1,957 @@
+/* Software emulation of an OCTPHY-2G for load and regression tests */
+
+/* (C) 2017 by sysmocom s.f.m.c. GmbH
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* The emulator speaks the OCTPKT/OCTVOCNET framing on a packet socket,
+ * just like the DSP on the other end of the Ethernet link.  It answers
+ * the VC1 commands osmo-bts-octphy sends, keeps track of the opened TRX
+ * and the activated logical channels, and generates TIME, RTS, DATA and
+ * RACH indications at TDMA rate.  Replies and indications can be lost or
+ * swapped with the next packet, commands can be lost on the way in, to
+ * exercise the command window and its retransmission.
+ *
+ * Typical setup on a single machine:
+ *
+ *   ip link add octbts type veth peer name octphy
+ *   ip link set octbts up; ip link set octphy up
+ *   src/osmo-bts-octphy/osmo-bts-octphy-emu -i octphy -d 60
+ *
+ * with "netdev octbts" and the MAC address of octphy as "hw-addr" in the
+ * phy node of the osmo-bts-octphy configuration.  The emulator is not
+ * installed, tests/octphy_emu drives it over the loopback device.
+ *
+ * The indications follow a simple block rate per SAPI, not the real
+ * multiframe structure.  Uplink data carries idle LAPDm frames or silent
+ * speech frames. */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <getopt.h>
+
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <linux/if_packet.h>
+
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/utils.h>
+#include <osmocom/core/select.h>
+#include <osmocom/core/timer.h>
+#include <osmocom/core/msgb.h>
+#include <osmocom/core/linuxlist.h>
+#include <osmocom/core/socket.h>
+#include <osmocom/gsm/gsm_utils.h>
+#include <osmocom/gsm/protocol/gsm_04_08.h>
+#include <osmocom/codec/codec.h>
+
+#include <octphy/octpkt/octpkt_hdr.h>
+#include <octphy/octvc1/octvocnet_pkt.h>
+#include <octphy/octvc1/octvc1_msg.h>
+#include <octphy/octvc1/octvc1_msg_swap.h>
+#include <octphy/octvc1/gsm/octvc1_gsm_api.h>
+#include <octphy/octvc1/gsm/octvc1_gsm_api_swap.h>
+#include <octphy/octvc1/gsm/octvc1_gsm_evt_swap.h>
+#include <octphy/octvc1/gsm/octvc1_gsm_id.h>
+#include <octphy/octvc1/hw/octvc1_hw_api.h>
+#include <octphy/octvc1/main/octvc1_main_default.h>
+#include <octphy/octvc1/main/octvc1_main_version.h>
+
+#include "octpkt.h"
+
+/* FIFO of the BTS side, see l1_if.c */
+#define cPKTAPI_FIFO_ID_MSG	0xAAAA0001
+
+#define EMU_MAX_TRX		8
+#define EMU_MSGB_SIZE		1500
+#define EMU_MSGB_HEADROOM	64
+
+/* duration of n TDMA frames in ns, 120ms per 26 frames */
+#define FN_NS(n)		((uint64_t)(n) * 120000000ULL / 26)
+
+struct emu_lchan {
+	struct llist_head list;
+	uint8_t trx;
+	tOCTVC1_GSM_LOGICAL_CHANNEL_ID lch_id;
+};
+
+struct emu_trx {
+	bool open;
+	uint32_t payload_type[8];
+};
+
+struct emu_stats {
+	uint32_t rx_cmds;
+	uint32_t rx_cmds_lost;
+	uint32_t rx_cmds_dup;
+	uint32_t rx_cmds_ooo;
+	uint32_t tx_rsps;
+	uint32_t tx_rejects;
+	uint32_t tx_evts;
+	uint32_t tx_lost;
+	uint32_t tx_reordered;
+	uint32_t fn_late;
+};
+
+struct emu_state {
+	struct osmo_fd ofd;
+	struct sockaddr_ll bts_addr;
+	bool have_bts;
+
+	/* command sequence of the current session */
+	uint32_t session_id;
+	bool have_session;
+	uint32_t expected_tid;
+	bool reject_sent;
+	bool evt_enabled;
+
+	struct emu_trx trx[EMU_MAX_TRX];
+	struct llist_head lchans;
+
+	/* TDMA clock */
+	uint32_t fn;
+	uint64_t start_ns;
+	uint64_t frames;
+	struct osmo_timer_list fn_timer;
+
+	/* packet held back to be sent after the next one */
+	struct msgb *held;
+
+	struct osmo_timer_list stats_timer;
+	struct emu_stats stats;
+	struct emu_stats last;
+};
+
+/* configuration */
+static const char *netdev;
+static unsigned int num_trx = 1;
+static unsigned int tx_loss_pm;
+static unsigned int rx_loss_pm;
+static unsigned int reorder_pm;
+static unsigned int rach_per_sec;
+static unsigned int duration;
+static unsigned int seed = 1;
+
+/* response size per command, the response begins with the same ids as
+ * the command, which the emulator copies over */
+#define RSP(x)	{ c##x##_CID, sizeof(t##x##_RSP) }
+static const struct {
+	uint32_t cid;
+	uint32_t len;
+} rsp_len_tbl[] = {
+	RSP(OCTVC1_GSM_MSG_TRX_OPEN),
+	RSP(OCTVC1_GSM_MSG_TRX_CLOSE),
+	RSP(OCTVC1_GSM_MSG_TRX_CLOSE_ALL),
+	RSP(OCTVC1_GSM_MSG_TRX_ACTIVATE_PHYSICAL_CHANNEL),
+	RSP(OCTVC1_GSM_MSG_TRX_ACTIVATE_LOGICAL_CHANNEL),
+	RSP(OCTVC1_GSM_MSG_TRX_DEACTIVATE_LOGICAL_CHANNEL),
+	RSP(OCTVC1_GSM_MSG_TRX_MODIFY_PHYSICAL_CHANNEL_CIPHERING),
+	RSP(OCTVC1_GSM_MSG_TRX_REQUEST_LOGICAL_CHANNEL_DATA),
+	RSP(OCTVC1_GSM_MSG_TRX_REQUEST_LOGICAL_CHANNEL_EMPTY_FRAME),
+	RSP(OCTVC1_MAIN_MSG_API_SYSTEM_MODIFY_SESSION_EVT),
+	RSP(OCTVC1_MAIN_MSG_APPLICATION_INFO),
+	RSP(OCTVC1_MAIN_MSG_APPLICATION_INFO_SYSTEM),
+	RSP(OCTVC1_HW_MSG_PCB_INFO),
+	RSP(OCTVC1_HW_MSG_RF_PORT_INFO),
+	RSP(OCTVC1_HW_MSG_RF_PORT_STATS),
+	RSP(OCTVC1_HW_MSG_RF_PORT_INFO_ANTENNA_RX_CONFIG),
+	RSP(OCTVC1_HW_MSG_CLOCK_SYNC_MGR_INFO),
+	RSP(OCTVC1_HW_MSG_CLOCK_SYNC_MGR_STATS),
+};
+#undef RSP
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* true with a probability of 'pm' per mille */
+static bool chance(unsigned int pm)
+{
+	return pm && (unsigned int) (rand() % 1000) < pm;
+}
+
+static struct msgb *emu_msgb_alloc(void)
+{
+	return msgb_alloc_headroom(EMU_MSGB_SIZE, EMU_MSGB_HEADROOM, "emu");
+}
+
+/***********************************************************************
+ * transmit side, with loss and reordering
+ ***********************************************************************/
+
+static void emu_sendto(struct emu_state *emu, struct msgb *msg)
+{
+	int rc;
+
+	rc = sendto(emu->ofd.fd, msg->data, msgb_length(msg), 0,
+		    (struct sockaddr *) &emu->bts_addr,
+		    sizeof(emu->bts_addr));
+	if (rc < 0)
+		fprintf(stderr, "sendto() failed: %s\n", strerror(errno));
+	msgb_free(msg);
+}
+
+static void emu_tx(struct emu_state *emu, struct msgb *msg)
+{
+	if (!emu->have_bts || chance(tx_loss_pm)) {
+		emu->stats.tx_lost++;
+		msgb_free(msg);
+		return;
+	}
+
+	if (!emu->held && chance(reorder_pm)) {
+		emu->stats.tx_reordered++;
+		emu->held = msg;
+		return;
+	}
+
+	emu_sendto(emu, msg);
+	if (emu->held) {
+		emu_sendto(emu, emu->held);
+		emu->held = NULL;
+	}
+}
+
+/* send a VC1 control message, 'msg' starts with the VC1 header */
+static void emu_tx_ctrl(struct emu_state *emu, struct msgb *msg,
+			const tOCTVOCNET_PKT_CTL_HEADER *cmd_ctlh)
+{
+	octvocnet_push_ctl_hdr(msg, ntohl(cmd_ctlh->ulSourceFifoId),
+			       ntohl(cmd_ctlh->ulDestFifoId),
+			       ntohl(cmd_ctlh->ulSocketId));
+	octpkt_push_common_hdr(msg, cOCTVOCNET_PKT_FORMAT_CTRL, 0,
+			       cOCTPKT_HDR_CONTROL_PROTOCOL_TYPE_ENUM_OCTVOCNET);
+	emu_tx(emu, msg);
+}
+
+/* send an event, 'msg' starts with the (swapped) event */
+static void emu_tx_evt(struct emu_state *emu, struct msgb *msg)
+{
+	tOCTVOCNET_PKT_DATA_F_HEADER *dfh;
+
+	dfh = (tOCTVOCNET_PKT_DATA_F_HEADER *) msgb_push(msg, sizeof(*dfh));
+	memset(dfh, 0, sizeof(*dfh));
+	dfh->VocNetHeader.ulLogicalObjPktPort =
+		htonl(cOCTVOCNET_PKT_DATA_LOGICAL_OBJ_PKT_PORT_EVENT_SESSION);
+	dfh->VocNetHeader.ulDestFifoId = htonl(cPKTAPI_FIFO_ID_MSG);
+	dfh->ulSubType = htonl(cOCTVOCNET_PKT_SUBTYPE_API_EVENT);
+	octpkt_push_common_hdr(msg, cOCTVOCNET_PKT_FORMAT_F, 0,
+			       cOCTPKT_HDR_CONTROL_PROTOCOL_TYPE_ENUM_OCTVOCNET);
+	emu->stats.tx_evts++;
+	emu_tx(emu, msg);
+}
+
+#define EVT_INIT(evt, eid) do {					\
+		memset(evt, 0, sizeof(*evt));				\
+		(evt)->Header.ulLength = sizeof(*evt);			\
+		(evt)->Header.ulEventId = eid;				\
+	} while (0)
+
+/***********************************************************************
+ * commands from the BTS
+ ***********************************************************************/
+
+static struct emu_lchan *lchan_find(struct emu_state *emu, uint8_t trx,
+				    const tOCTVC1_GSM_LOGICAL_CHANNEL_ID *id)
+{
+	struct emu_lchan *el;
+
+	llist_for_each_entry(el, &emu->lchans, list) {
+		if (el->trx == trx &&
+		    el->lch_id.byTimeslotNb == id->byTimeslotNb &&
+		    el->lch_id.bySubChannelNb == id->bySubChannelNb &&
+		    el->lch_id.bySAPI == id->bySAPI &&
+		    el->lch_id.byDirection == id->byDirection)
+			return el;
+	}
+
+	return NULL;
+}
+
+static void trx_close(struct emu_state *emu, uint8_t trx)
+{
+	struct emu_lchan *el, *el2;
+
+	if (trx >= EMU_MAX_TRX)
+		return;
+
+	emu->trx[trx].open = false;
+	llist_for_each_entry_safe(el, el2, &emu->lchans, list) {
+		if (el->trx != trx)
+			continue;
+		llist_del(&el->list);
+		talloc_free(el);
+	}
+}
+
+/* update the emulated PHY state for a command in sequence.  'cmd' is in
+ * network byte order and at least 'len' bytes long. */
+static void emu_exec_cmd(struct emu_state *emu, uint32_t cid,
+			 const uint8_t *cmd, uint32_t len)
+{
+	union {
+		tOCTVC1_GSM_MSG_TRX_OPEN_CMD open;
+		tOCTVC1_GSM_MSG_TRX_CLOSE_CMD close;
+		tOCTVC1_GSM_MSG_TRX_ACTIVATE_PHYSICAL_CHANNEL_CMD pch_act;
+		tOCTVC1_GSM_MSG_TRX_ACTIVATE_LOGICAL_CHANNEL_CMD lch_act;
+		tOCTVC1_GSM_MSG_TRX_DEACTIVATE_LOGICAL_CHANNEL_CMD lch_deact;
+		tOCTVC1_MAIN_MSG_API_SYSTEM_MODIFY_SESSION_EVT_CMD mse;
+	} c;
+	struct emu_lchan *el;
+	unsigned int i;
+
+	memset(&c, 0, sizeof(c));
+	memcpy(&c, cmd, OSMO_MIN(len, sizeof(c)));
+
+	switch (cid) {
+	case cOCTVC1_GSM_MSG_TRX_OPEN_CID:
+		mOCTVC1_GSM_MSG_TRX_OPEN_CMD_SWAP(&c.open);
+		if (c.open.TrxId.byTrxId >= num_trx)
+			break;
+		trx_close(emu, c.open.TrxId.byTrxId);
+		emu->trx[c.open.TrxId.byTrxId].open = true;
+		printf("TRX %u opened (arfcn=%u)\n", c.open.TrxId.byTrxId,
+			c.open.Config.usArfcn);
+		break;
+	case cOCTVC1_GSM_MSG_TRX_CLOSE_CID:
+		mOCTVC1_GSM_MSG_TRX_CLOSE_CMD_SWAP(&c.close);
+		trx_close(emu, c.close.TrxId.byTrxId);
+		printf("TRX %u closed\n", c.close.TrxId.byTrxId);
+		break;
+	case cOCTVC1_GSM_MSG_TRX_CLOSE_ALL_CID:
+		for (i = 0; i < EMU_MAX_TRX; i++)
+			trx_close(emu, i);
+		break;
+	case cOCTVC1_GSM_MSG_TRX_ACTIVATE_PHYSICAL_CHANNEL_CID:
+		mOCTVC1_GSM_MSG_TRX_ACTIVATE_PHYSICAL_CHANNEL_CMD_SWAP(&c.pch_act);
+		if (c.pch_act.TrxId.byTrxId >= EMU_MAX_TRX ||
+		    c.pch_act.PchId.byTimeslotNb >= 8)
+			break;
+		emu->trx[c.pch_act.TrxId.byTrxId]
+			.payload_type[c.pch_act.PchId.byTimeslotNb] =
+				c.pch_act.ulPayloadType;
+		break;
+	case cOCTVC1_GSM_MSG_TRX_ACTIVATE_LOGICAL_CHANNEL_CID:
+		mOCTVC1_GSM_MSG_TRX_ACTIVATE_LOGICAL_CHANNEL_CMD_SWAP(&c.lch_act);
+		if (lchan_find(emu, c.lch_act.TrxId.byTrxId, &c.lch_act.LchId))
+			break;
+		el = talloc_zero(emu, struct emu_lchan);
+		el->trx = c.lch_act.TrxId.byTrxId;
+		el->lch_id = c.lch_act.LchId;
+		llist_add_tail(&el->list, &emu->lchans);
+		break;
+	case cOCTVC1_GSM_MSG_TRX_DEACTIVATE_LOGICAL_CHANNEL_CID:
+		mOCTVC1_GSM_MSG_TRX_DEACTIVATE_LOGICAL_CHANNEL_CMD_SWAP(&c.lch_deact);
+		el = lchan_find(emu, c.lch_deact.TrxId.byTrxId,
+				&c.lch_deact.LchId);
+		if (el) {
+			llist_del(&el->list);
+			talloc_free(el);
+		}
+		break;
+	case cOCTVC1_MAIN_MSG_API_SYSTEM_MODIFY_SESSION_EVT_CID:
+		mOCTVC1_MAIN_MSG_API_SYSTEM_MODIFY_SESSION_EVT_CMD_SWAP(&c.mse);
+		emu->evt_enabled = c.mse.ulEvtActiveFlag == cOCT_TRUE;
+		break;
+	}
+}
+
+static void emu_fill_rsp(uint32_t cid, uint8_t *body)
+{
+	tOCTVC1_MAIN_MSG_APPLICATION_INFO_RSP *air;
+	tOCTVC1_MAIN_MSG_APPLICATION_INFO_SYSTEM_RSP *aisr;
+
+	switch (cid) {
+	case cOCTVC1_MAIN_MSG_APPLICATION_INFO_CID:
+		/* l1_oml.c insists on the version of its headers */
+		air = (tOCTVC1_MAIN_MSG_APPLICATION_INFO_RSP *) body;
+		snprintf((char *) air->szName, sizeof(air->szName),
+			 "OCTPHY-2G emulator");
+		snprintf((char *) air->szDescription,
+			 sizeof(air->szDescription), "osmo-bts-octphy-emu");
+		snprintf((char *) air->szVersion, sizeof(air->szVersion),
+			 "%02i.%02i.%02i-B%i", cOCTVC1_MAIN_VERSION_MAJOR,
+			 cOCTVC1_MAIN_VERSION_MINOR,
+			 cOCTVC1_MAIN_VERSION_MAINTENANCE,
+			 cOCTVC1_MAIN_VERSION_BUILD);
+		break;
+	case cOCTVC1_MAIN_MSG_APPLICATION_INFO_SYSTEM_CID:
+		aisr = (tOCTVC1_MAIN_MSG_APPLICATION_INFO_SYSTEM_RSP *) body;
+		snprintf((char *) aisr->szPlatform, sizeof(aisr->szPlatform),
+			 "emulator");
+		snprintf((char *) aisr->szVersion, sizeof(aisr->szVersion),
+			 "%02i.%02i.%02i", cOCTVC1_MAIN_VERSION_MAJOR,
+			 cOCTVC1_MAIN_VERSION_MINOR,
+			 cOCTVC1_MAIN_VERSION_MAINTENANCE);
+		break;
+	}
+}
+
+static void emu_tx_rsp(struct emu_state *emu,
+		       const tOCTVOCNET_PKT_CTL_HEADER *ctlh,
+		       const tOCTVC1_MSG_HEADER *mh, uint32_t cid)
+{
+	uint32_t cmd_len = ntohl(mh->ulLength);
+	uint32_t len = cmd_len;
+	tOCTVC1_MSG_HEADER *rh;
+	struct msgb *msg;
+	unsigned int i;
+
+	for (i = 0; i < ARRAY_SIZE(rsp_len_tbl); i++) {
+		if (rsp_len_tbl[i].cid == cid) {
+			len = rsp_len_tbl[i].len;
+			break;
+		}
+	}
+
+	msg = emu_msgb_alloc();
+	if (!msg || len > msgb_tailroom(msg)) {
+		msgb_free(msg);
+		return;
+	}
+	rh = (tOCTVC1_MSG_HEADER *) msgb_put(msg, len);
+	memset(rh, 0, len);
+	memcpy(rh, mh, OSMO_MIN(len, cmd_len));
+	emu_fill_rsp(cid, (uint8_t *) rh);
+
+	rh->ulLength = htonl(len);
+	rh->ul_Type_R_CmdId = htonl(
+		(cOCTVC1_MSG_TYPE_RESPONSE << cOCTVC1_MSG_TYPE_BIT_OFFSET) |
+		((cid & cOCTVC1_MSG_ID_BIT_MASK) << cOCTVC1_MSG_ID_BIT_OFFSET));
+	rh->ulReturnCode = htonl(cOCTVC1_RC_OK);
+
+	emu->stats.tx_rsps++;
+	emu_tx_ctrl(emu, msg, ctlh);
+}
+
+/* tell the BTS that a command is missing before 'mh' */
+static void emu_tx_reject(struct emu_state *emu,
+			  const tOCTVOCNET_PKT_CTL_HEADER *ctlh,
+			  const tOCTVC1_MSG_HEADER *mh)
+{
+	tOCTVC1_CTRL_MSG_MODULE_REJECT_SPV *rej;
+	struct msgb *msg = emu_msgb_alloc();
+
+	if (!msg)
+		return;
+
+	rej = (tOCTVC1_CTRL_MSG_MODULE_REJECT_SPV *) msgb_put(msg, sizeof(*rej));
+	memset(rej, 0, sizeof(*rej));
+	octvc1_fill_msg_hdr(&rej->Header, sizeof(*rej), emu->session_id,
+			    ntohl(mh->ulTransactionId), 0,
+			    cOCTVC1_MSG_TYPE_SUPERVISORY, 0,
+			    cOCTVC1_CTRL_MSG_MODULE_REJECT_SID);
+	rej->ulExpectedTransactionId = emu->expected_tid;
+	rej->ulRejectedCmdId = ntohl(mh->ul_Type_R_CmdId);
+	mOCTVC1_CTRL_MSG_MODULE_REJECT_SPV_SWAP(rej);
+
+	emu->stats.tx_rejects++;
+	emu_tx_ctrl(emu, msg, ctlh);
+}
+
+static void emu_rx_ctrl(struct emu_state *emu, struct msgb *msg)
+{
+	const tOCTVOCNET_PKT_CTL_HEADER *ctlh;
+	const tOCTVC1_MSG_HEADER *mh;
+	uint32_t len, tid, session, type_r_cmdid, cid;
+	int32_t d;
+
+	if (msgb_length(msg) < 4 + sizeof(*ctlh) + sizeof(*mh))
+		return;
+	ctlh = (const tOCTVOCNET_PKT_CTL_HEADER *) (msg->data + 4);
+	mh = (const tOCTVC1_MSG_HEADER *) (ctlh + 1);
+
+	len = ntohl(mh->ulLength);
+	if (len < sizeof(*mh) ||
+	    (uint8_t *) mh + len > msg->data + msgb_length(msg))
+		return;
+
+	type_r_cmdid = ntohl(mh->ul_Type_R_CmdId);
+	if (((type_r_cmdid >> cOCTVC1_MSG_TYPE_BIT_OFFSET)
+			& cOCTVC1_MSG_TYPE_BIT_MASK) != cOCTVC1_MSG_TYPE_COMMAND)
+		return;
+	cid = (type_r_cmdid >> cOCTVC1_MSG_ID_BIT_OFFSET)
+			& cOCTVC1_MSG_ID_BIT_MASK;
+	tid = ntohl(mh->ulTransactionId);
+	session = ntohl(mh->ulSessionId);
+
+	emu->stats.rx_cmds++;
+
+	if (chance(rx_loss_pm)) {
+		emu->stats.rx_cmds_lost++;
+		return;
+	}
+
+	/* a restarted BTS opens a new session and starts counting anew */
+	if (!emu->have_session || session != emu->session_id) {
+		emu->have_session = true;
+		emu->session_id = session;
+		emu->expected_tid = tid;
+		emu->reject_sent = false;
+		emu->evt_enabled = false;
+	}
+
+	d = (int32_t) (tid - emu->expected_tid);
+	if (d > 0) {
+		/* an earlier command got lost.  Reject once per gap, the
+		 * BTS then retransmits from the missing one on. */
+		emu->stats.rx_cmds_ooo++;
+		if (!emu->reject_sent)
+			emu_tx_reject(emu, ctlh, mh);
+		emu->reject_sent = true;
+		return;
+	}
+
+	if (d == 0) {
+		emu->expected_tid++;
+		emu->reject_sent = false;
+		emu_exec_cmd(emu, cid, (const uint8_t *) mh, len);
+	} else {
+		/* a retransmission of a command we already executed,
+		 * its response was lost or came too late */
+		emu->stats.rx_cmds_dup++;
+	}
+
+	emu_tx_rsp(emu, ctlh, mh, cid);
+}
+
+static int emu_read_cb(struct osmo_fd *ofd, unsigned int what)
+{
+	struct emu_state *emu = ofd->data;
+	struct sockaddr_ll sll;
+	socklen_t sll_len = sizeof(sll);
+	struct msgb *msg;
+	uint32_t ch, format;
+	int rc;
+
+	msg = emu_msgb_alloc();
+	if (!msg)
+		return -ENOMEM;
+
+	rc = recvfrom(ofd->fd, msg->data, msgb_tailroom(msg), 0,
+		      (struct sockaddr *) &sll, &sll_len);
+	if (rc < 4) {
+		msgb_free(msg);
+		return rc < 0 ? -errno : 0;
+	}
+	msgb_put(msg, rc);
+
+	/* our own packets on the same link */
+	if (sll.sll_pkttype == PACKET_OUTGOING) {
+		msgb_free(msg);
+		return 0;
+	}
+
+	/* answer whoever talks to us */
+	if (!emu->have_bts) {
+		printf("BTS at %s\n", osmo_hexdump_nospc(sll.sll_addr,
+							  sll.sll_halen));
+		emu->have_bts = true;
+	}
+	emu->bts_addr = sll;
+
+	ch = ntohl(*(uint32_t *) msg->data);
+	format = (ch >> cOCTVOCNET_PKT_FORMAT_BIT_OFFSET)
+			& cOCTVOCNET_PKT_FORMAT_BIT_MASK;
+	if (format == cOCTVOCNET_PKT_FORMAT_CTRL)
+		emu_rx_ctrl(emu, msg);
+
+	msgb_free(msg);
+	return 0;
+}
+
+/***********************************************************************
+ * indications at TDMA rate
+ ***********************************************************************/
+
+/* frames between two blocks of a SAPI, 0 for none */
+static unsigned int sapi_period(uint8_t sapi)
+{
+	switch (sapi) {
+	case cOCTVC1_GSM_SAPI_ENUM_FCCH:
+	case cOCTVC1_GSM_SAPI_ENUM_IDLE:
+		return 0;
+	case cOCTVC1_GSM_SAPI_ENUM_SCH:
+		return 10;
+	case cOCTVC1_GSM_SAPI_ENUM_BCCH:
+		return 51;
+	case cOCTVC1_GSM_SAPI_ENUM_SACCH:
+		return 104;
+	case cOCTVC1_GSM_SAPI_ENUM_TCHH:
+	case cOCTVC1_GSM_SAPI_ENUM_FACCHH:
+		return 8;
+	default:
+		return 4;
+	}
+}
+
+static void emu_tx_time_ind(struct emu_state *emu, uint8_t trx)
+{
+	tOCTVC1_GSM_MSG_TRX_TIME_INDICATION_EVT *evt;
+	struct msgb *msg = emu_msgb_alloc();
+
+	if (!msg)
+		return;
+
+	evt = (tOCTVC1_GSM_MSG_TRX_TIME_INDICATION_EVT *)
+		msgb_put(msg, sizeof(*evt));
+	EVT_INIT(evt, cOCTVC1_GSM_MSG_TRX_TIME_INDICATION_EID);
+	evt->TrxId.byTrxId = trx;
+	evt->ulFrameNumber = emu->fn;
+	mOCTVC1_GSM_MSG_TRX_TIME_INDICATION_EVT_SWAP(evt);
+
+	emu_tx_evt(emu, msg);
+}
+
+static void emu_tx_rts_ind(struct emu_state *emu, struct emu_lchan *el)
+{
+	tOCTVC1_GSM_MSG_TRX_LOGICAL_CHANNEL_READY_TO_SEND_INDICATION_EVT *evt;
+	struct msgb *msg = emu_msgb_alloc();
+
+	if (!msg)
+		return;
+
+	evt = (tOCTVC1_GSM_MSG_TRX_LOGICAL_CHANNEL_READY_TO_SEND_INDICATION_EVT *)
+		msgb_put(msg, sizeof(*evt));
+	EVT_INIT(evt,
+		 cOCTVC1_GSM_MSG_TRX_LOGICAL_CHANNEL_READY_TO_SEND_INDICATION_EID);
+	evt->TrxId.byTrxId = el->trx;
+	evt->LchId = el->lch_id;
+	evt->ulFrameNumber = emu->fn;
+	mOCTVC1_GSM_MSG_TRX_LOGICAL_CHANNEL_READY_TO_SEND_INDICATION_EVT_SWAP(evt);
+
+	emu_tx_evt(emu, msg);
+}
+
+static void emu_tx_data_ind(struct emu_state *emu, struct emu_lchan *el)
+{
+	/* idle LAPDm frame and silent speech */
+	static const uint8_t lapdm_idle[] = { 0x01, 0x03, 0x01 };
+	tOCTVC1_GSM_MSG_TRX_LOGICAL_CHANNEL_DATA_INDICATION_EVT *evt;
+	uint8_t ts = el->lch_id.byTimeslotNb;
+	uint8_t *data;
+	struct msgb *msg;
+
+	switch (el->lch_id.bySAPI) {
+	case cOCTVC1_GSM_SAPI_ENUM_SDCCH:
+	case cOCTVC1_GSM_SAPI_ENUM_SACCH:
+	case cOCTVC1_GSM_SAPI_ENUM_FACCHF:
+	case cOCTVC1_GSM_SAPI_ENUM_FACCHH:
+	case cOCTVC1_GSM_SAPI_ENUM_TCHF:
+	case cOCTVC1_GSM_SAPI_ENUM_TCHH:
+		break;
+	default:
+		/* nothing sensible to send to the PCU */
+		return;
+	}
+
+	msg = emu_msgb_alloc();
+	if (!msg)
+		return;
+
+	evt = (tOCTVC1_GSM_MSG_TRX_LOGICAL_CHANNEL_DATA_INDICATION_EVT *)
+		msgb_put(msg, sizeof(*evt));
+	EVT_INIT(evt,
+		 cOCTVC1_GSM_MSG_TRX_LOGICAL_CHANNEL_DATA_INDICATION_EID);
+	evt->TrxId.byTrxId = el->trx;
+	evt->LchId = el->lch_id;
+	evt->Data.ulFrameNumber = emu->fn;
+	evt->MeasurementInfo.sRSSIDbm = -60;
+	evt->MeasurementInfo.sSNRDb = 20;
+	evt->MeasurementInfo.usBERTotalBitCnt = 456;
+
+	data = evt->Data.abyDataContent;
+	switch (el->lch_id.bySAPI) {
+	case cOCTVC1_GSM_SAPI_ENUM_TCHF:
+	case cOCTVC1_GSM_SAPI_ENUM_TCHH:
+		evt->Data.ulPayloadType = emu->trx[el->trx].payload_type[ts];
+		if (evt->Data.ulPayloadType ==
+				cOCTVC1_GSM_PAYLOAD_TYPE_ENUM_HALF_RATE) {
+			evt->Data.ulDataLength = GSM_HR_BYTES;
+		} else {
+			evt->Data.ulDataLength = GSM_FR_BYTES;
+			data[0] = 0xd0;
+		}
+		break;
+	case cOCTVC1_GSM_SAPI_ENUM_SACCH:
+		/* L1 header with MS power and TA in front */
+		evt->Data.ulDataLength = GSM_MACBLOCK_LEN;
+		memset(data, GSM_MACBLOCK_PADDING, GSM_MACBLOCK_LEN);
+		data[0] = data[1] = 0;
+		memcpy(data + 2, lapdm_idle, sizeof(lapdm_idle));
+		break;
+	default:
+		evt->Data.ulDataLength = GSM_MACBLOCK_LEN;
+		memset(data, GSM_MACBLOCK_PADDING, GSM_MACBLOCK_LEN);
+		memcpy(data, lapdm_idle, sizeof(lapdm_idle));
+		break;
+	}
+	mOCTVC1_GSM_MSG_TRX_LOGICAL_CHANNEL_DATA_INDICATION_EVT_SWAP(evt);
+
+	emu_tx_evt(emu, msg);
+}
+
+static void emu_tx_rach_ind(struct emu_state *emu, struct emu_lchan *el)
+{
+	tOCTVC1_GSM_MSG_TRX_LOGICAL_CHANNEL_RACH_INDICATION_EVT *evt;
+	struct msgb *msg = emu_msgb_alloc();
+
+	if (!msg)
+		return;
+
+	evt = (tOCTVC1_GSM_MSG_TRX_LOGICAL_CHANNEL_RACH_INDICATION_EVT *)
+		msgb_put(msg, sizeof(*evt));
+	EVT_INIT(evt,
+		 cOCTVC1_GSM_MSG_TRX_LOGICAL_CHANNEL_RACH_INDICATION_EID);
+	evt->TrxId.byTrxId = el->trx;
+	evt->LchId = el->lch_id;
+	evt->ulFrameNumber = emu->fn;
+	evt->ulMsgLength = 1;
+	evt->abyMsg[0] = rand() & 0xff;
+	evt->MeasurementInfo.sRSSIDbm = -60;
+	evt->MeasurementInfo.sBurstTiming = (rand() % 64) << 2;
+	mOCTVC1_GSM_MSG_TRX_LOGICAL_CHANNEL_RACH_INDICATION_EVT_SWAP(evt);
+
+	emu_tx_evt(emu, msg);
+}
+
+static void emu_frame(struct emu_state *emu)
+{
+	struct emu_lchan *el;
+	unsigned int i, period;
+	/* RACH bursts per frame in per mille */
+	unsigned int rach_pm = rach_per_sec * 120 / 26;
+
+	if (!emu->evt_enabled)
+		return;
+
+	for (i = 0; i < num_trx; i++) {
+		if (emu->trx[i].open)
+			emu_tx_time_ind(emu, i);
+	}
+
+	llist_for_each_entry(el, &emu->lchans, list) {
+		if (el->trx >= EMU_MAX_TRX || !emu->trx[el->trx].open)
+			continue;
+
+		if (el->lch_id.bySAPI == cOCTVC1_GSM_SAPI_ENUM_RACH) {
+			if (el->lch_id.byDirection &
+				cOCTVC1_GSM_DIRECTION_ENUM_RX_BTS_MS &&
+			    chance(rach_pm))
+				emu_tx_rach_ind(emu, el);
+			continue;
+		}
+
+		period = sapi_period(el->lch_id.bySAPI);
+		if (!period || emu->fn % period)
+			continue;
+
+		if (el->lch_id.byDirection & cOCTVC1_GSM_DIRECTION_ENUM_TX_BTS_MS)
+			emu_tx_rts_ind(emu, el);
+		if (el->lch_id.byDirection & cOCTVC1_GSM_DIRECTION_ENUM_RX_BTS_MS)
+			emu_tx_data_ind(emu, el);
+	}
+}
+
+static void fn_timer_cb(void *data)
+{
+	struct emu_state *emu = data;
+	uint64_t now = now_ns();
+	uint64_t next;
+	unsigned int n = 0;
+
+	/* catch up on all frames that are due */
+	while (emu->start_ns + FN_NS(emu->frames + 1) <= now) {
+		emu_frame(emu);
+		emu->fn = (emu->fn + 1) % GSM_HYPERFRAME;
+		emu->frames++;
+		n++;
+	}
+	if (n > 1)
+		emu->stats.fn_late += n - 1;
+
+	next = emu->start_ns + FN_NS(emu->frames + 1) - now;
+	osmo_timer_schedule(&emu->fn_timer, 0, next / 1000 + 1);
+}
+
+/***********************************************************************
+ * statistics and main
+ ***********************************************************************/
+
+static void print_stats(const struct emu_stats *s, const struct emu_stats *l,
+			const char *prefix)
+{
+	printf("%scmds=%u(+%u) lost=%u dup=%u ooo=%u rsps=%u(+%u) "
+	       "rejects=%u evts=%u(+%u) tx_lost=%u reordered=%u late_fn=%u\n",
+	       prefix, s->rx_cmds, s->rx_cmds - l->rx_cmds, s->rx_cmds_lost,
+	       s->rx_cmds_dup, s->rx_cmds_ooo, s->tx_rsps,
+	       s->tx_rsps - l->tx_rsps, s->tx_rejects, s->tx_evts,
+	       s->tx_evts - l->tx_evts, s->tx_lost, s->tx_reordered,
+	       s->fn_late);
+	fflush(stdout);
+}
+
+static void stats_timer_cb(void *data)
+{
+	struct emu_state *emu = data;
+	static const struct emu_stats zero;
+
+	print_stats(&emu->stats, &emu->last, "");
+	emu->last = emu->stats;
+
+	if (duration && emu->frames >= (uint64_t) duration * 1000000000ULL
+						/ FN_NS(1)) {
+		print_stats(&emu->stats, &zero, "Total: ");
+		exit(0);
+	}
+
+	osmo_timer_schedule(&emu->stats_timer, 1, 0);
+}
+
+static void print_help(void)
+{
+	printf("osmo-bts-octphy-emu -i netdev [options]\n");
+	printf("  -i --netdev NAME      network device to the BTS\n");
+	printf("  -t --trx NUM          number of TRX (1)\n");
+	printf("  -l --tx-loss PM       loss of replies and events, per mille\n");
+	printf("  -L --rx-loss PM       loss of commands, per mille\n");
+	printf("  -r --reorder PM       packets swapped with the next one, per mille\n");
+	printf("  -R --rach NUM         RACH bursts per second on each RACH\n");
+	printf("  -d --duration SEC     print totals and exit after SEC seconds\n");
+	printf("  -s --seed NUM         seed of the loss/reorder pattern (1)\n");
+}
+
+static int parse_options(int argc, char **argv)
+{
+	while (1) {
+		int option_idx = 0, c;
+		static const struct option long_options[] = {
+			{ "help", 0, 0, 'h' },
+			{ "netdev", 1, 0, 'i' },
+			{ "trx", 1, 0, 't' },
+			{ "tx-loss", 1, 0, 'l' },
+			{ "rx-loss", 1, 0, 'L' },
+			{ "reorder", 1, 0, 'r' },
+			{ "rach", 1, 0, 'R' },
+			{ "duration", 1, 0, 'd' },
+			{ "seed", 1, 0, 's' },
+			{ 0, 0, 0, 0 }
+		};
+
+		c = getopt_long(argc, argv, "hi:t:l:L:r:R:d:s:",
+				long_options, &option_idx);
+		if (c == -1)
+			break;
+		switch (c) {
+		case 'i':
+			netdev = optarg;
+			break;
+		case 't':
+			num_trx = atoi(optarg);
+			break;
+		case 'l':
+			tx_loss_pm = atoi(optarg);
+			break;
+		case 'L':
+			rx_loss_pm = atoi(optarg);
+			break;
+		case 'r':
+			reorder_pm = atoi(optarg);
+			break;
+		case 'R':
+			rach_per_sec = atoi(optarg);
+			break;
+		case 'd':
+			duration = atoi(optarg);
+			break;
+		case 's':
+			seed = atoi(optarg);
+			break;
+		case 'h':
+		default:
+			print_help();
+			return -1;
+		}
+	}
+
+	if (!netdev || num_trx < 1 || num_trx > EMU_MAX_TRX) {
+		print_help();
+		return -1;
+	}
+
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	struct emu_state *emu;
+	int rc;
+
+	if (parse_options(argc, argv) < 0)
+		return EXIT_FAILURE;
+
+	srand(seed);
+
+	emu = talloc_zero(NULL, struct emu_state);
+	INIT_LLIST_HEAD(&emu->lchans);
+
+	rc = osmo_sock_packet_init(SOCK_DGRAM, cOCTPKT_HDR_ETHERTYPE, netdev, 0);
+	if (rc < 0) {
+		fprintf(stderr, "Cannot open packet socket on %s: %s\n",
+			netdev, strerror(errno));
+		return EXIT_FAILURE;
+	}
+	emu->ofd.fd = rc;
+	emu->ofd.when = BSC_FD_READ;
+	emu->ofd.cb = emu_read_cb;
+	emu->ofd.data = emu;
+	if (osmo_fd_register(&emu->ofd) < 0) {
+		fprintf(stderr, "Cannot register socket\n");
+		return EXIT_FAILURE;
+	}
+
+	emu->start_ns = now_ns();
+	emu->fn_timer.cb = fn_timer_cb;
+	emu->fn_timer.data = emu;
+	osmo_timer_schedule(&emu->fn_timer, 0, FN_NS(1) / 1000);
+
+	emu->stats_timer.cb = stats_timer_cb;
+	emu->stats_timer.data = emu;
+	osmo_timer_schedule(&emu->stats_timer, 1, 0);
+
+	printf("Emulating %u TRX on %s\n", num_trx, netdev);
+
+	while (1) {
+		rc = osmo_select_main(0);
+		if (rc < 0) {
+			perror("select");
+			exit(1);
+		}
+	}
+	exit(0);
+}
@@ -37,9 +37,12 @@
 /* Chapter 12.1 */
 static int get_pcb_info_compl_cb(struct octphy_hdl *fl1, struct msgb *resp, void *data)
 {
-	tOCTVC1_HW_MSG_PCB_INFO_RSP *pir =
-		(tOCTVC1_HW_MSG_PCB_INFO_RSP *) resp->l2h;
+	tOCTVC1_HW_MSG_PCB_INFO_RSP *pir;
 
+	if (!resp)
+		return 0;
+
+	pir = (tOCTVC1_HW_MSG_PCB_INFO_RSP *) resp->l2h;
 	mOCTVC1_HW_MSG_PCB_INFO_RSP_SWAP(pir);
 
 	LOGP(DL1C, LOGL_INFO, "HW-PCB-INFO.resp: Name=%s %s, Serial=%s, "
@@ -72,9 +75,12 @@ int octphy_hw_get_pcb_info(struct octphy_hdl *fl1h)
 static int rf_port_info_compl_cb(struct octphy_hdl *fl1, struct msgb *resp,
 				 void *data)
 {
-	tOCTVC1_HW_MSG_RF_PORT_INFO_RSP *pir =
-		(tOCTVC1_HW_MSG_RF_PORT_INFO_RSP *) resp->l2h;
+	tOCTVC1_HW_MSG_RF_PORT_INFO_RSP *pir;
+
+	if (!resp)
+		return 0;
 
+	pir = (tOCTVC1_HW_MSG_RF_PORT_INFO_RSP *) resp->l2h;
 	mOCTVC1_HW_MSG_RF_PORT_INFO_RSP_SWAP(pir);
 
 	LOGP(DL1C, LOGL_INFO, "RF-PORT-INFO.resp Idx=%u, InService=%u, "
@@ -117,9 +123,12 @@ static const struct value_string radio_std_vals[] = {
 static int rf_port_stats_compl_cb(struct octphy_hdl *fl1, struct msgb *resp,
 				  void *data)
 {
-	tOCTVC1_HW_MSG_RF_PORT_STATS_RSP *psr =
-		(tOCTVC1_HW_MSG_RF_PORT_STATS_RSP *) resp->l2h;
+	tOCTVC1_HW_MSG_RF_PORT_STATS_RSP *psr;
 
+	if (!resp)
+		return 0;
+
+	psr = (tOCTVC1_HW_MSG_RF_PORT_STATS_RSP *) resp->l2h;
 	mOCTVC1_HW_MSG_RF_PORT_STATS_RSP_SWAP(psr);
 
 	LOGP(DL1C, LOGL_INFO, "RF-PORT-STATS.resp Idx=%u RadioStandard=%s, "
@@ -170,9 +179,12 @@ static const struct value_string rx_gain_mode_vals[] = {
 static int rf_ant_rx_compl_cb(struct octphy_hdl *fl1, struct msgb *resp,
 				void *data)
 {
-	tOCTVC1_HW_MSG_RF_PORT_INFO_ANTENNA_RX_CONFIG_RSP *arc =
-		(tOCTVC1_HW_MSG_RF_PORT_INFO_ANTENNA_RX_CONFIG_RSP *) resp->l2h;
+	tOCTVC1_HW_MSG_RF_PORT_INFO_ANTENNA_RX_CONFIG_RSP *arc;
+
+	if (!resp)
+		return 0;
 
+	arc = (tOCTVC1_HW_MSG_RF_PORT_INFO_ANTENNA_RX_CONFIG_RSP *) resp->l2h;
 	mOCTVC1_HW_MSG_RF_PORT_INFO_ANTENNA_RX_CONFIG_RSP_SWAP(arc);
 
 	LOGP(DL1C, LOGL_INFO, "ANT-RX-CONFIG.resp(Port=%u, Ant=%u): %s, "
@@ -212,9 +224,12 @@ int octphy_hw_get_rf_ant_rx_config(struct octphy_hdl *fl1h, uint32_t port_idx,
 static int rf_ant_tx_compl_cb(struct octphy_hdl *fl1, struct msgb *resp,
 				void *data)
 {
-	tOCTVC1_HW_MSG_RF_PORT_INFO_ANTENNA_TX_CONFIG_RSP *atc =
-		(tOCTVC1_HW_MSG_RF_PORT_INFO_ANTENNA_TX_CONFIG_RSP *) resp->l2h;
+	tOCTVC1_HW_MSG_RF_PORT_INFO_ANTENNA_TX_CONFIG_RSP *atc;
 
+	if (!resp)
+		return 0;
+
+	atc = (tOCTVC1_HW_MSG_RF_PORT_INFO_ANTENNA_TX_CONFIG_RSP *) resp->l2h;
 	mOCTVC1_HW_MSG_RF_PORT_INFO_ANTENNA_TX_CONFIG_RSP_SWAP(atc);
 
 	LOGP(DL1C, LOGL_INFO, "ANT-TX-CONFIG.resp(Port=%u, Ant=%u): %s, "
@@ -302,9 +317,12 @@ static const struct value_string clocksync_state_vals[] = {
 static int get_clock_sync_compl_cb(struct octphy_hdl *fl1, struct msgb *resp,
 				   void *data)
 {
-	tOCTVC1_HW_MSG_CLOCK_SYNC_MGR_INFO_RSP *cir =
-		(tOCTVC1_HW_MSG_CLOCK_SYNC_MGR_INFO_RSP *) resp->l2h;
+	tOCTVC1_HW_MSG_CLOCK_SYNC_MGR_INFO_RSP *cir;
+
+	if (!resp)
+		return 0;
 
+	cir = (tOCTVC1_HW_MSG_CLOCK_SYNC_MGR_INFO_RSP *) resp->l2h;
 	mOCTVC1_HW_MSG_CLOCK_SYNC_MGR_INFO_RSP_SWAP(cir);
 
 	LOGP(DL1C, LOGL_INFO, "CLOCK-SYNC-MGR-INFO.resp Reference=%s ",
@@ -336,9 +354,12 @@ int octphy_hw_get_clock_sync_info(struct octphy_hdl *fl1h)
 static int get_clock_sync_stats_cb(struct octphy_hdl *fl1, struct msgb *resp,
 				   void *data)
 {
-	tOCTVC1_HW_MSG_CLOCK_SYNC_MGR_STATS_RSP *csr =
-		(tOCTVC1_HW_MSG_CLOCK_SYNC_MGR_STATS_RSP *) resp->l2h;
+	tOCTVC1_HW_MSG_CLOCK_SYNC_MGR_STATS_RSP *csr;
+
+	if (!resp)
+		return 0;
 
+	csr = (tOCTVC1_HW_MSG_CLOCK_SYNC_MGR_STATS_RSP *) resp->l2h;
 	mOCTVC1_HW_MSG_CLOCK_SYNC_MGR_STATS_RSP_SWAP(csr);
 
 	LOGP(DL1C, LOGL_INFO, "CLOCK-SYNC-MGR-STATS.resp State=%s, "
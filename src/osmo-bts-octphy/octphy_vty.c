@@ -153,6 +153,40 @@ DEFUN(cfg_phy_tx_atten_db, cfg_phy_tx_atten_db_cmd,
 	return CMD_SUCCESS;
 }
 
+DEFUN(cfg_phy_mmap_ring, cfg_phy_mmap_ring_cmd,
+	"octphy mmap-ring",
+	OCT_STR "Use memory mapped RX/TX rings (PACKET_MMAP) on the PHY socket\n")
+{
+	struct phy_link *plink = vty->index;
+
+	if (plink->state != PHY_LINK_SHUTDOWN) {
+		vty_out(vty, "Can only reconfigure a PHY link that is down%s",
+			VTY_NEWLINE);
+		return CMD_WARNING;
+	}
+
+	plink->u.octphy.mmap_ring = true;
+
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_phy_no_mmap_ring, cfg_phy_no_mmap_ring_cmd,
+	"no octphy mmap-ring",
+	NO_STR OCT_STR "Use recvfrom()/sendto() on the PHY socket\n")
+{
+	struct phy_link *plink = vty->index;
+
+	if (plink->state != PHY_LINK_SHUTDOWN) {
+		vty_out(vty, "Can only reconfigure a PHY link that is down%s",
+			VTY_NEWLINE);
+		return CMD_WARNING;
+	}
+
+	plink->u.octphy.mmap_ring = false;
+
+	return CMD_SUCCESS;
+}
+
 DEFUN(show_rf_port_stats, show_rf_port_stats_cmd,
 	"show phy <0-255> rf-port-stats <0-1>",
 	"Show statistics for the RF Port\n"
@@ -186,6 +220,39 @@ DEFUN(show_clk_sync_stats, show_clk_sync_stats_cmd,
 	return CMD_SUCCESS;
 }
 
+DEFUN(show_cmd_window, show_cmd_window_cmd,
+	"show phy <0-255> command-window",
+	SHOW_TRX_STR "Display the state of the PHY command window\n")
+{
+	int phy_nr = atoi(argv[0]);
+	struct phy_link *plink = phy_link_by_num(phy_nr);
+	struct octphy_hdl *fl1h;
+
+	if (!plink || !plink->u.octphy.hdl) {
+		vty_out(vty, "Cannot find PHY number %u%s",
+			phy_nr, VTY_NEWLINE);
+		return CMD_WARNING;
+	}
+	fl1h = plink->u.octphy.hdl;
+
+	vty_out(vty, "Window: %u (threshold %u), in use: %u (max %u), "
+		"postponed: %u%s", fl1h->wlc_wnd.size, fl1h->wlc_wnd.ssthresh,
+		fl1h->wlc_list_len, fl1h->stats.wlc_max_len,
+		fl1h->wlc_postponed_len, VTY_NEWLINE);
+	vty_out(vty, "RTT: %u us (var %u us, min %u us), timeout: %u ms%s",
+		fl1h->wlc_wnd.srtt_us, fl1h->wlc_wnd.rttvar_us,
+		fl1h->wlc_wnd.min_rtt_us, fl1h->wlc_wnd.rto_ms, VTY_NEWLINE);
+	vty_out(vty, "Retransmitted: %u on timeout, %u on sequence error, "
+		"%u on reject%s", fl1h->stats.retrans_cmds_timeout,
+		fl1h->stats.retrans_cmds_trans_id,
+		fl1h->stats.retrans_cmds_supv, VTY_NEWLINE);
+	vty_out(vty, "Commands postponed: %u, failed: %u%s",
+		fl1h->stats.wlc_postponed, fl1h->stats.cmds_failed,
+		VTY_NEWLINE);
+
+	return CMD_SUCCESS;
+}
+
 void bts_model_config_write_phy(struct vty *vty, struct phy_link *plink)
 {
 	if (plink->u.octphy.netdev_name)
@@ -206,6 +273,8 @@ void bts_model_config_write_phy(struct vty *vty, struct phy_link *plink)
 		VTY_NEWLINE);
 	vty_out(vty, "  rf-port-index %u%s", plink->u.octphy.rf_port_index,
 		VTY_NEWLINE);
+	if (plink->u.octphy.mmap_ring)
+		vty_out(vty, "  octphy mmap-ring%s", VTY_NEWLINE);
 }
 
 void bts_model_config_write_bts(struct vty *vty, struct gsm_bts *bts)
@@ -251,10 +320,13 @@ int bts_model_vty_init(struct gsm_bts *bts)
 	install_element(PHY_NODE, &cfg_phy_rf_port_idx_cmd);
 	install_element(PHY_NODE, &cfg_phy_rx_gain_db_cmd);
 	install_element(PHY_NODE, &cfg_phy_tx_atten_db_cmd);
+	install_element(PHY_NODE, &cfg_phy_mmap_ring_cmd);
+	install_element(PHY_NODE, &cfg_phy_no_mmap_ring_cmd);
 
 	install_element_ve(&show_rf_port_stats_cmd);
 	install_element_ve(&show_clk_sync_stats_cmd);
 	install_element_ve(&show_sys_info_cmd);
+	install_element_ve(&show_cmd_window_cmd);
 
 	return 0;
 }
@@ -0,0 +1,246 @@
+/* Memory mapped RX/TX rings of an AF_PACKET socket */
+
+/* (C) 2017 by sysmocom s.f.m.c. GmbH
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <linux/if_packet.h>
+
+#include <osmocom/core/talloc.h>
+
+#include <osmo-bts/logging.h>
+
+#include "packet_ring.h"
+
+#define PKT_RING_BLOCK_SIZE	(1 << 16)
+#define PKT_RING_FRAME_SIZE	2048
+#define PKT_RING_FRAMES_PER_BLOCK (PKT_RING_BLOCK_SIZE / PKT_RING_FRAME_SIZE)
+
+/* offset of the payload in a TX frame, see tpacket_snd() in the kernel */
+#define PKT_RING_TX_DATA_OFF	TPACKET_ALIGN(sizeof(struct tpacket3_hdr))
+
+struct pkt_ring {
+	int fd;
+	uint8_t *map;
+	size_t map_len;
+
+	uint8_t *rx_base;
+	unsigned int rx_block_nr;
+	unsigned int rx_cur;
+
+	uint8_t *tx_base;
+	unsigned int tx_frame_nr;
+	unsigned int tx_cur;
+	unsigned int tx_pending;
+
+	struct pkt_ring_stats stats;
+};
+
+static int pkt_ring_destructor(struct pkt_ring *r)
+{
+	if (r->map)
+		munmap(r->map, r->map_len);
+	return 0;
+}
+
+struct pkt_ring *pkt_ring_alloc(void *ctx, int fd, unsigned int rx_blocks,
+				unsigned int rx_tov_ms, unsigned int tx_frames)
+{
+	struct tpacket_req3 req;
+	struct pkt_ring *r;
+	int ver = TPACKET_V3;
+	size_t rx_len, tx_len;
+	void *map;
+
+	r = talloc_zero(ctx, struct pkt_ring);
+	if (!r)
+		return NULL;
+	r->fd = fd;
+	talloc_set_destructor(r, pkt_ring_destructor);
+
+	if (setsockopt(fd, SOL_PACKET, PACKET_VERSION, &ver, sizeof(ver)) < 0)
+		goto err;
+
+	memset(&req, 0, sizeof(req));
+	req.tp_block_size = PKT_RING_BLOCK_SIZE;
+	req.tp_block_nr = rx_blocks;
+	req.tp_frame_size = PKT_RING_FRAME_SIZE;
+	req.tp_frame_nr = rx_blocks * PKT_RING_FRAMES_PER_BLOCK;
+	req.tp_retire_blk_tov = rx_tov_ms;
+	if (setsockopt(fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) < 0)
+		goto err;
+	r->rx_block_nr = rx_blocks;
+	rx_len = (size_t) rx_blocks * PKT_RING_BLOCK_SIZE;
+
+	/* whole blocks only, the kernel has no other TX feature for V3 */
+	tx_frames = (tx_frames + PKT_RING_FRAMES_PER_BLOCK - 1)
+			& ~(PKT_RING_FRAMES_PER_BLOCK - 1);
+	tx_len = 0;
+	if (tx_frames) {
+		memset(&req, 0, sizeof(req));
+		req.tp_block_size = PKT_RING_BLOCK_SIZE;
+		req.tp_block_nr = tx_frames / PKT_RING_FRAMES_PER_BLOCK;
+		req.tp_frame_size = PKT_RING_FRAME_SIZE;
+		req.tp_frame_nr = tx_frames;
+		if (setsockopt(fd, SOL_PACKET, PACKET_TX_RING, &req,
+			       sizeof(req)) == 0) {
+			r->tx_frame_nr = tx_frames;
+			tx_len = (size_t) tx_frames * PKT_RING_FRAME_SIZE;
+		} else
+			LOGP(DL1C, LOGL_NOTICE, "No TPACKET_V3 TX ring (%s), "
+			     "using sendto()\n", strerror(errno));
+	}
+
+	/* the RX ring comes first in the mapping, then the TX ring */
+	r->map_len = rx_len + tx_len;
+	map = mmap(NULL, r->map_len, PROT_READ | PROT_WRITE,
+		   MAP_SHARED | MAP_LOCKED, fd, 0);
+	if (map == MAP_FAILED)
+		map = mmap(NULL, r->map_len, PROT_READ | PROT_WRITE,
+			   MAP_SHARED, fd, 0);
+	if (map == MAP_FAILED)
+		goto err;
+	r->map = map;
+	r->rx_base = r->map;
+	if (tx_len)
+		r->tx_base = r->map + rx_len;
+
+	return r;
+
+err:
+	LOGP(DL1C, LOGL_ERROR, "Cannot set up TPACKET_V3 ring: %s\n",
+	     strerror(errno));
+	talloc_free(r);
+	return NULL;
+}
+
+void pkt_ring_free(struct pkt_ring *r)
+{
+	talloc_free(r);
+}
+
+int pkt_ring_rx(struct pkt_ring *r, pkt_ring_rx_cb *cb, void *data)
+{
+	struct tpacket_block_desc *bd;
+	struct tpacket3_hdr *ppd;
+	struct sockaddr_ll *sll;
+	unsigned int i, num = 0;
+
+	while (1) {
+		bd = (struct tpacket_block_desc *)
+			(r->rx_base + r->rx_cur * PKT_RING_BLOCK_SIZE);
+		if (!(__atomic_load_n(&bd->hdr.bh1.block_status,
+				      __ATOMIC_ACQUIRE) & TP_STATUS_USER))
+			break;
+
+		ppd = (struct tpacket3_hdr *)
+			((uint8_t *) bd + bd->hdr.bh1.offset_to_first_pkt);
+		for (i = 0; i < bd->hdr.bh1.num_pkts; i++) {
+			sll = (struct sockaddr_ll *) ((uint8_t *) ppd
+				+ TPACKET_ALIGN(sizeof(*ppd)));
+			/* a socket sees the frames of other sockets on the
+			 * same device going out */
+			if (sll->sll_pkttype != PACKET_OUTGOING) {
+				cb((uint8_t *) ppd + ppd->tp_net,
+				   ppd->tp_snaplen, data);
+				num++;
+			}
+			ppd = (struct tpacket3_hdr *)
+				((uint8_t *) ppd + ppd->tp_next_offset);
+		}
+
+		__atomic_store_n(&bd->hdr.bh1.block_status, TP_STATUS_KERNEL,
+				 __ATOMIC_RELEASE);
+		r->rx_cur = (r->rx_cur + 1) % r->rx_block_nr;
+		r->stats.rx_blocks++;
+	}
+
+	r->stats.rx_frames += num;
+	return num;
+}
+
+static struct tpacket3_hdr *tx_frame(struct pkt_ring *r, unsigned int idx)
+{
+	return (struct tpacket3_hdr *) (r->tx_base + idx * PKT_RING_FRAME_SIZE);
+}
+
+uint8_t *pkt_ring_tx_get(struct pkt_ring *r)
+{
+	struct tpacket3_hdr *hdr;
+	uint32_t status;
+
+	if (!r->tx_base)
+		return NULL;
+
+	hdr = tx_frame(r, r->tx_cur);
+	status = __atomic_load_n(&hdr->tp_status, __ATOMIC_ACQUIRE);
+	/* a frame the kernel refused is lost anyway, reuse its slot */
+	if (status != TP_STATUS_AVAILABLE && status != TP_STATUS_WRONG_FORMAT) {
+		r->stats.tx_full++;
+		return NULL;
+	}
+
+	return (uint8_t *) hdr + PKT_RING_TX_DATA_OFF;
+}
+
+void pkt_ring_tx_put(struct pkt_ring *r, unsigned int len)
+{
+	struct tpacket3_hdr *hdr = tx_frame(r, r->tx_cur);
+
+	hdr->tp_len = len;
+	hdr->tp_snaplen = len;
+	hdr->tp_next_offset = 0;
+	__atomic_store_n(&hdr->tp_status, TP_STATUS_SEND_REQUEST,
+			 __ATOMIC_RELEASE);
+
+	r->tx_cur = (r->tx_cur + 1) % r->tx_frame_nr;
+	r->tx_pending++;
+	r->stats.tx_frames++;
+}
+
+int pkt_ring_tx_kick(struct pkt_ring *r, const struct sockaddr_ll *dst)
+{
+	int rc;
+
+	if (!r->tx_pending)
+		return 0;
+
+	r->stats.tx_kicks++;
+	r->tx_pending = 0;
+	rc = sendto(r->fd, NULL, 0, MSG_DONTWAIT,
+		    (const struct sockaddr *) dst, sizeof(*dst));
+	if (rc < 0 && errno != EAGAIN)
+		return -errno;
+
+	return 0;
+}
+
+unsigned int pkt_ring_tx_pending(const struct pkt_ring *r)
+{
+	return r->tx_pending;
+}
+
+const struct pkt_ring_stats *pkt_ring_get_stats(const struct pkt_ring *r)
+{
+	return &r->stats;
+}
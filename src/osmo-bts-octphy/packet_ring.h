@@ -0,0 +1,52 @@
+#pragma once
+
+/* Memory mapped RX/TX rings of an AF_PACKET socket (TPACKET_V3)
+ *
+ * The RX ring hands over whole blocks of frames at once, the frames are
+ * read in place and the block is returned to the kernel afterwards.  TX
+ * frames are written into the TX ring and sent with one sendto() for all
+ * of them.  Kernels before 4.11 have no TPACKET_V3 TX ring, the TX side
+ * is then unavailable and sendto() has to be used per frame.
+ *
+ * To try it without hardware, use a veth pair and run
+ * tests/packet_ring/packet_ring_test with the two device names. */
+
+#include <stdint.h>
+
+struct sockaddr_ll;
+struct pkt_ring;
+
+/* largest frame pkt_ring_tx_get() can take */
+#define PKT_RING_TX_MTU		1536
+
+struct pkt_ring_stats {
+	uint32_t rx_blocks;	/* blocks handed over by the kernel */
+	uint32_t rx_frames;	/* frames passed to the callback */
+	uint32_t tx_frames;	/* frames written to the TX ring */
+	uint32_t tx_kicks;	/* sendto() calls to start the TX ring */
+	uint32_t tx_full;	/* no free slot in the TX ring */
+};
+
+/* called for each received frame, 'buf' is only valid during the call */
+typedef void pkt_ring_rx_cb(const uint8_t *buf, unsigned int len, void *data);
+
+/* set up the rings on the bound packet socket 'fd', which stays owned by
+ * the caller.  'rx_blocks' blocks of 64 KiB, which the kernel hands over
+ * after 'rx_tov_ms' at the latest, even if not full.  'tx_frames' slots
+ * in the TX ring, 0 for none. */
+struct pkt_ring *pkt_ring_alloc(void *ctx, int fd, unsigned int rx_blocks,
+				unsigned int rx_tov_ms, unsigned int tx_frames);
+void pkt_ring_free(struct pkt_ring *r);
+
+/* pass all frames of all complete blocks to 'cb', returns their number */
+int pkt_ring_rx(struct pkt_ring *r, pkt_ring_rx_cb *cb, void *data);
+
+/* next free TX slot, NULL if there is no TX ring or it is full */
+uint8_t *pkt_ring_tx_get(struct pkt_ring *r);
+/* queue the slot returned by pkt_ring_tx_get() with 'len' bytes */
+void pkt_ring_tx_put(struct pkt_ring *r, unsigned int len);
+/* send all queued frames to 'dst' */
+int pkt_ring_tx_kick(struct pkt_ring *r, const struct sockaddr_ll *dst);
+unsigned int pkt_ring_tx_pending(const struct pkt_ring *r);
+
+const struct pkt_ring_stats *pkt_ring_get_stats(const struct pkt_ring *r);
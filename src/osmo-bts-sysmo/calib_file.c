@@ -25,11 +25,16 @@
 #include <fcntl.h>
 #include <limits.h>
 #include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
 #include <osmocom/core/utils.h>
+#include <osmocom/core/talloc.h>
 
 #include <osmo-bts/gsm_data.h>
 #include <osmo-bts/logging.h>
+#include <osmo-bts/bringup.h>
 
 #include <sysmocom/femtobts/superfemto.h>
 #include <sysmocom/femtobts/gsml1const.h>
@@ -379,66 +384,299 @@ static int calib_eeprom_read(const struct calib_file_desc *desc, SuperFemto_Prim
 	return 0;
 }
 
-/* iteratively download the calibration data into the L1 */
+/* The tables of all supported bands are read first, from the cache if
+ * their source did not change, and then sent to the DSP back to back. */
+
+/* SetCalibTbl requests queued to the DSP at once, the SYS write queue
+ * holds 10 messages and is shared with the other system primitives */
+#define CALIB_MAX_INFLIGHT	4
+
+#define CALIB_CACHE_MAGIC	0x43434653	/* "SFCC" */
+#define CALIB_CACHE_VERSION	1
+
+struct calib_table {
+	int file_idx;
+	/* identifies the source of the table, 0 if that is not possible */
+	uint64_t stamp;
+	SuperFemto_Prim_t prim;
+};
+
+/* the cache file is a header followed by an array of struct calib_table */
+struct calib_cache_hdr {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t api_version;
+	uint32_t prim_size;
+	uint32_t src;		/* CRC of the calibration path, 0 for EEPROM */
+	uint32_t num;
+	uint32_t crc;		/* CRC of the tables */
+};
+
+static uint32_t calib_crc32(uint32_t crc, const void *data, size_t len)
+{
+	const uint8_t *p = data;
+	int i;
+
+	crc = ~crc;
+	while (len--) {
+		crc ^= *p++;
+		for (i = 0; i < 8; i++)
+			crc = (crc >> 1) ^ (0xedb88320 & -(crc & 1));
+	}
+	return ~crc;
+}
+
+static unsigned long calib_ms_since(const struct timespec *t)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - t->tv_sec) * 1000
+		+ (now.tv_nsec - t->tv_nsec) / 1000000;
+}
+
+static uint32_t calib_src(struct femtol1_hdl *fl1h)
+{
+	char *calib_path = fl1h->phy_inst->u.sysmobts.calib_path;
+
+	if (!calib_path)
+		return 0;
+	return calib_crc32(0, calib_path, strlen(calib_path));
+}
+
+/* something that changes when the table changes: modification time and
+ * size of a file, section ID, CRC and time of an EEPROM table */
+static uint64_t calib_stamp(struct femtol1_hdl *fl1h,
+			    const struct calib_file_desc *desc)
+{
+	char *calib_path = fl1h->phy_inst->u.sysmobts.calib_path;
+	char fname[PATH_MAX];
+	struct stat st;
+	uint64_t stamp;
+
+	if (!calib_path) {
+		if (eeprom_ReadCalStamp(desc->band, desc->rx, desc->uplink,
+					&stamp) != EEPROM_SUCCESS)
+			return 0;
+		return stamp;
+	}
+
+	snprintf(fname, sizeof(fname), "%s/%s", calib_path, desc->fname);
+	if (stat(fname, &st) < 0)
+		return 0;
+	return ((uint64_t) st.st_mtime << 32) | (uint32_t) st.st_size;
+}
+
+static struct calib_table *calib_cache_read(void *ctx, const char *fname,
+					    uint32_t src, unsigned int *num)
+{
+	struct calib_cache_hdr hdr;
+	struct calib_table *tbl = NULL;
+	FILE *in;
+
+	in = fopen(fname, "r");
+	if (!in)
+		return NULL;
+
+	if (fread(&hdr, sizeof(hdr), 1, in) != 1
+	    || hdr.magic != CALIB_CACHE_MAGIC
+	    || hdr.version != CALIB_CACHE_VERSION
+	    || hdr.api_version != SUPERFEMTO_API_VERSION
+	    || hdr.prim_size != sizeof(SuperFemto_Prim_t)
+	    || hdr.src != src || hdr.num > ARRAY_SIZE(calib_files))
+		goto out;
+
+	tbl = talloc_array(ctx, struct calib_table, hdr.num);
+	if (!tbl)
+		goto out;
+	if (fread(tbl, sizeof(*tbl), hdr.num, in) != hdr.num
+	    || calib_crc32(0, tbl, sizeof(*tbl) * hdr.num) != hdr.crc) {
+		LOGP(DL1C, LOGL_NOTICE, "Ignoring corrupt calibration "
+		     "cache '%s'\n", fname);
+		talloc_free(tbl);
+		tbl = NULL;
+		goto out;
+	}
+	*num = hdr.num;
+out:
+	fclose(in);
+	return tbl;
+}
+
+/* write to a temporary file first, a cut off cache is never used */
+static void calib_cache_write(struct femtol1_hdl *fl1h, const char *fname)
+{
+	struct calib_send_state *st = &fl1h->st;
+	struct calib_cache_hdr hdr;
+	struct calib_table *tbl;
+	char tmp[PATH_MAX];
+	unsigned int i, num = 0;
+	FILE *out;
+
+	/* tables without a stamp cannot be validated, leave them out */
+	tbl = talloc_array(fl1h, struct calib_table, st->num_tables);
+	if (!tbl)
+		return;
+	for (i = 0; i < st->num_tables; i++) {
+		if (st->tables[i].stamp)
+			tbl[num++] = st->tables[i];
+	}
+
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.magic = CALIB_CACHE_MAGIC;
+	hdr.version = CALIB_CACHE_VERSION;
+	hdr.api_version = SUPERFEMTO_API_VERSION;
+	hdr.prim_size = sizeof(SuperFemto_Prim_t);
+	hdr.src = calib_src(fl1h);
+	hdr.num = num;
+	hdr.crc = calib_crc32(0, tbl, sizeof(*tbl) * num);
+
+	snprintf(tmp, sizeof(tmp), "%s.tmp", fname);
+	out = fopen(tmp, "w");
+	if (!out)
+		goto err;
+	if (fwrite(&hdr, sizeof(hdr), 1, out) != 1
+	    || fwrite(tbl, sizeof(*tbl), num, out) != num) {
+		fclose(out);
+		unlink(tmp);
+		goto err;
+	}
+	if (fclose(out) != 0 || rename(tmp, fname) < 0) {
+		unlink(tmp);
+		goto err;
+	}
+	talloc_free(tbl);
+	return;
+
+err:
+	LOGP(DL1C, LOGL_ERROR, "Cannot write calibration cache '%s': %s\n",
+	     fname, strerror(errno));
+	talloc_free(tbl);
+}
+
+/* read the tables of all supported bands */
+static int calib_read_all(struct femtol1_hdl *fl1h)
+{
+	struct calib_send_state *st = &fl1h->st;
+	char *calib_path = fl1h->phy_inst->u.sysmobts.calib_path;
+	char *cache_path = fl1h->phy_inst->u.sysmobts.calib_cache;
+	struct calib_table *cache = NULL, *tbl;
+	unsigned int i, num_cache = 0;
+	int idx, rc;
+
+	talloc_free(st->tables);
+	st->tables = talloc_zero_array(fl1h, struct calib_table,
+				       ARRAY_SIZE(calib_files));
+	if (!st->tables)
+		return -ENOMEM;
+	st->num_tables = 0;
+	st->num_cached = 0;
+	st->cache_dirty = false;
+
+	if (cache_path)
+		cache = calib_cache_read(st->tables, cache_path,
+					 calib_src(fl1h), &num_cache);
+
+	for (idx = next_calib_file_idx(fl1h->hw_info.band_support, -1);
+	     idx >= 0;
+	     idx = next_calib_file_idx(fl1h->hw_info.band_support, idx)) {
+		const struct calib_file_desc *desc = &calib_files[idx];
+
+		tbl = &st->tables[st->num_tables];
+		tbl->file_idx = idx;
+		tbl->stamp = cache_path ? calib_stamp(fl1h, desc) : 0;
+
+		for (i = 0; tbl->stamp && i < num_cache; i++) {
+			if (cache[i].file_idx == idx
+			    && cache[i].stamp == tbl->stamp)
+				break;
+		}
+		if (tbl->stamp && i < num_cache) {
+			tbl->prim = cache[i].prim;
+			st->num_cached++;
+			st->num_tables++;
+			continue;
+		}
+
+		if (calib_path)
+			rc = calib_file_read(calib_path, desc, &tbl->prim);
+		else
+			rc = calib_eeprom_read(desc, &tbl->prim);
+		/* still, we'd like to continue trying to load
+		 * calibration for all other bands */
+		if (rc < 0)
+			continue;
+
+		if (tbl->stamp)
+			st->cache_dirty = true;
+		st->num_tables++;
+	}
+
+	talloc_free(cache);
+
+	return st->num_tables ? 0 : -1;
+}
 
 static int calib_send_compl_cb(struct gsm_bts_trx *trx, struct msgb *l1_msg,
 			       void *data);
 
-/* send the calibration table for a single specified file */
-static int calib_file_send(struct femtol1_hdl *fl1h,
-			   const struct calib_file_desc *desc)
+/* fill the DSP queue up to CALIB_MAX_INFLIGHT requests */
+static int calib_send_next(struct femtol1_hdl *fl1h)
 {
 	struct calib_send_state *st = &fl1h->st;
 	struct msgb *msg;
-	char *calib_path = fl1h->phy_inst->u.sysmobts.calib_path;
 	int rc;
 
-	msg = sysp_msgb_alloc();
-
-	if (calib_path)
-		rc = calib_file_read(calib_path, desc, msgb_sysprim(msg));
-	else
-		rc = calib_eeprom_read(desc, msgb_sysprim(msg));
-	if (rc < 0) {
-		msgb_free(msg);
+	while (st->next_send < st->num_tables
+	       && st->next_send - st->next_conf < CALIB_MAX_INFLIGHT) {
+		msg = sysp_msgb_alloc();
+		memcpy(msgb_sysprim(msg), &st->tables[st->next_send].prim,
+		       sizeof(SuperFemto_Prim_t));
+		calib_fixup_rx(fl1h, msgb_sysprim(msg));
+		st->next_send++;
 
-		/* still, we'd like to continue trying to load
-		 * calibration for all other bands */
-		st->last_file_idx = next_calib_file_idx(fl1h->hw_info.band_support,
-						st->last_file_idx);
-		if (st->last_file_idx >= 0)
-			return calib_file_send(fl1h,
-					       &calib_files[st->last_file_idx]);
-		else
+		rc = l1if_req_compl(fl1h, msg, calib_send_compl_cb, NULL);
+		if (rc < 0)
 			return rc;
 	}
-	calib_fixup_rx(fl1h, msgb_sysprim(msg));
 
-	return l1if_req_compl(fl1h, msg, calib_send_compl_cb, NULL);
+	return 0;
 }
 
-/* completion callback after every SetCalibTbl is confirmed */
+/* completion callback after every SetCalibTbl is confirmed, the DSP
+ * confirms them in the order they were sent */
 static int calib_send_compl_cb(struct gsm_bts_trx *trx, struct msgb *l1_msg,
 				void *data)
 {
 	struct femtol1_hdl *fl1h = trx_femtol1_hdl(trx);
 	struct calib_send_state *st = &fl1h->st;
 	char *calib_path = fl1h->phy_inst->u.sysmobts.calib_path;
+	char *cache_path = fl1h->phy_inst->u.sysmobts.calib_cache;
+	unsigned long total_ms;
 
 	LOGP(DL1C, LOGL_NOTICE, "L1 calibration table %s loaded (src: %s)\n",
-		calib_files[st->last_file_idx].fname,
+		calib_files[st->tables[st->next_conf].file_idx].fname,
 		calib_path ? "file" : "eeprom");
 
 	msgb_free(l1_msg);
 
-	st->last_file_idx = next_calib_file_idx(fl1h->hw_info.band_support,
-						st->last_file_idx);
-	if (st->last_file_idx >= 0)
-		return calib_file_send(fl1h,
-				       &calib_files[st->last_file_idx]);
+	st->next_conf++;
+	if (st->next_conf < st->num_tables)
+		return calib_send_next(fl1h);
 
-	LOGP(DL1C, LOGL_INFO, "L1 calibration table loading complete!\n");
+	if (st->cache_dirty && cache_path)
+		calib_cache_write(fl1h, cache_path);
+
+	total_ms = calib_ms_since(&st->t_start);
+	LOGP(DL1C, LOGL_INFO, "L1 calibration table loading complete! "
+	     "%u tables in %lu ms: read %lu ms (%u from cache), "
+	     "DSP %lu ms\n", st->num_tables, total_ms, st->read_ms,
+	     st->num_cached, total_ms - st->read_ms);
 	eeprom_free_resources();
+	bringup_end("calibration", trx->nr, -1);
+
+	talloc_free(st->tables);
+	st->tables = NULL;
 
 	return 0;
 }
@@ -450,12 +688,28 @@ int calib_load(struct femtol1_hdl *fl1h)
 	LOGP(DL1C, LOGL_ERROR, "L1 calibration is not supported on pre 2.4.0 firmware.\n");
 	return -1;
 #else
-	int idx = next_calib_file_idx(fl1h->hw_info.band_support, -1);
-	if (idx < 0) {
+	struct calib_send_state *st = &fl1h->st;
+	struct gsm_bts_trx *trx = femtol1_hdl_trx(fl1h);
+	int rc;
+
+	if (next_calib_file_idx(fl1h->hw_info.band_support, -1) < 0) {
 		LOGP(DL1C, LOGL_ERROR, "No band_support?!?\n");
 		return -1;
 	}
-	return calib_file_send(fl1h, &calib_files[idx]);
+
+	bringup_begin("calibration", trx->nr, -1);
+	clock_gettime(CLOCK_MONOTONIC, &st->t_start);
+	rc = calib_read_all(fl1h);
+	st->read_ms = calib_ms_since(&st->t_start);
+	if (rc < 0) {
+		bringup_end("calibration", trx->nr, -1);
+		eeprom_free_resources();
+		return rc;
+	}
+
+	st->next_send = 0;
+	st->next_conf = 0;
+	return calib_send_next(fl1h);
 #endif
 }
 
@@ -59,7 +59,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <stddef.h>
 #include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 #include "eeprom.h"
 
@@ -399,10 +403,29 @@ typedef struct
  *                        Private routine prototypes                        *
  ****************************************************************************/
 
+static int eeprom_open( void );
 static int eeprom_read( int addr, int size, char *pBuff );
 static int eeprom_write( int addr, int size, const char *pBuff );
 static uint16_t eeprom_crc( uint8_t *pu8Data, int len );
-static eeprom_Cfg_t *eeprom_cached_config(void);
+static eeprom_Error_t eeprom_image( eeprom_Cfg_t **ppEe, int iWrite );
+static void eeprom_blank( eeprom_Cfg_t *ee );
+static int eeprom_load( const void *pData, int size );
+static void eeprom_dirty( const void *pData, int size );
+static int eeprom_flush( void );
+static void eeprom_drop_expanded( void );
+
+/**
+ * Block size of the config image, the page size of the EEPROM
+ */
+#define EEPROM_BLK_SIZE     32
+#define EEPROM_NUM_BLKS     ((int)((sizeof(eeprom_Cfg_t) + EEPROM_BLK_SIZE - 1) / EEPROM_BLK_SIZE))
+
+static int g_fd = -1;
+static eeprom_Cfg_t *g_cached_cfg;              ///< Image of the config area, read block by block on demand
+static uint8_t g_au8Loaded[EEPROM_NUM_BLKS];    ///< Blocks of the image read from the EEPROM
+static uint8_t g_au8Dirty[EEPROM_NUM_BLKS];     ///< Blocks changed but not written back yet
+static eeprom_TxCal_t *g_pTxCal[4];             ///< Expanded TX tables, per band
+static eeprom_RxCal_t *g_pRxCal[4][2];          ///< Expanded RX tables, per band and uplink flag
 
 
 /****************************************************************************
@@ -421,19 +444,20 @@ static eeprom_Cfg_t *eeprom_cached_config(void);
  ****************************************************************************/
 eeprom_Error_t eeprom_ResetCfg( void )
 {
-    int err;
-    eeprom_Cfg_t ee;
+    eeprom_Error_t err;
+    eeprom_Cfg_t *ee;
 
-    // Clear the structure
-    memset( &ee, 0xFF, sizeof(eeprom_Cfg_t) );
+    err = eeprom_image( &ee, 1 );
+    if ( err != EEPROM_SUCCESS )
+    {
+        return err;
+    }
 
-    // Init the header
-    ee.hdr.u32MagicId = EEPROM_CFG_MAGIC_ID;
-    ee.hdr.u16Version = EEPROM_HDR_V2;
+    // Clear the structure and init the header
+    eeprom_blank( ee );
 
     // Write it to the EEPROM
-    err = eeprom_write( EEPROM_CFG_START_ADDR, sizeof(ee.hdr) + sizeof(ee.cfg.v2), (const char *) &ee );
-    if ( err != sizeof(ee.hdr) + sizeof(ee.cfg.v2) )
+    if ( eeprom_flush() != 0 )
     {
         return EEPROM_ERR_DEVICE;
     }
@@ -471,60 +495,51 @@ eeprom_Error_t eeprom_ReadEthAddr( uint8_t *ethaddr )
  ****************************************************************************/
 eeprom_Error_t eeprom_ReadSysInfo( eeprom_SysInfo_t *pSysInfo )
 {
-    int err;
-    eeprom_Cfg_t ee;
-
-    // Get a copy of the EEPROM header
-    err = eeprom_read( EEPROM_CFG_START_ADDR, sizeof(ee.hdr), (char *) &ee.hdr );
-    if ( err != sizeof(ee.hdr) )
-    {
-        PERROR( "Error while reading the EEPROM content (%d)\n", err );
-        return EEPROM_ERR_DEVICE;
-    }
+    eeprom_Error_t err;
+    eeprom_Cfg_t *ee;
 
-    // Validate the header magic ID
-    if ( ee.hdr.u32MagicId != EEPROM_CFG_MAGIC_ID )
+    // Get the validated EEPROM header
+    err = eeprom_image( &ee, 0 );
+    if ( err != EEPROM_SUCCESS )
     {
-        PERROR( "Invalid EEPROM format\n" );
-        return EEPROM_ERR_INVALID;
+        return err;
     }
 
-    switch ( ee.hdr.u16Version )
+    switch ( ee->hdr.u16Version )
     {
     	case EEPROM_HDR_V1:
         case EEPROM_HDR_V2:
         {
-            // Get a copy of the EEPROM section
-            err = eeprom_read( EEPROM_CFG_START_ADDR + ((uint32_t)&ee.cfg.v1.sysInfo - (uint32_t)&ee), sizeof(ee.cfg.v1.sysInfo), (char *)&ee.cfg.v1.sysInfo );
-            if ( err != sizeof(ee.cfg.v1.sysInfo) )
+            // Get the EEPROM section
+            if ( eeprom_load( &ee->cfg.v1.sysInfo, sizeof(ee->cfg.v1.sysInfo) ) != 0 )
             {
-                PERROR( "Error while reading the EEPROM content (%d)\n", err );
+                PERROR( "Error while reading the EEPROM content\n" );
                 return EEPROM_ERR_DEVICE;
             }
             
             // Validate the ID
-            if ( ee.cfg.v1.sysInfo.u16SectionID != EEPROM_SID_SYSINFO )
+            if ( ee->cfg.v1.sysInfo.u16SectionID != EEPROM_SID_SYSINFO )
             {
                 PERROR( "Uninitialized data section\n" );
                 return EEPROM_ERR_UNAVAILABLE;
             }
 
             // Validate the CRC
-            if ( eeprom_crc( (uint8_t *)&ee.cfg.v1.sysInfo.u32Time, sizeof(ee.cfg.v1.sysInfo) - 2 * sizeof(uint16_t) ) != ee.cfg.v1.sysInfo.u16Crc )
+            if ( eeprom_crc( (uint8_t *)&ee->cfg.v1.sysInfo.u32Time, sizeof(ee->cfg.v1.sysInfo) - 2 * sizeof(uint16_t) ) != ee->cfg.v1.sysInfo.u16Crc )
             {
                 PERROR( "Parity error\n" );
                 return EEPROM_ERR_PARITY;
             }
 
             // Expand the content of the section
-            memcpy( (void *)pSysInfo->szSn, ee.cfg.v1.sysInfo.szSn, sizeof(pSysInfo->szSn) );
-            pSysInfo->u8Rev     = ee.cfg.v1.sysInfo.u8Rev;
-            pSysInfo->u8Tcxo    = ee.cfg.v1.sysInfo.u2Tcxo;
-            pSysInfo->u8Ocxo    = ee.cfg.v1.sysInfo.u2Ocxo;
-            pSysInfo->u8GSM850  = ee.cfg.v1.sysInfo.u2GSM850;
-            pSysInfo->u8GSM900  = ee.cfg.v1.sysInfo.u2GSM900;
-            pSysInfo->u8DCS1800 = ee.cfg.v1.sysInfo.u2DCS1800;
-            pSysInfo->u8PCS1900 = ee.cfg.v1.sysInfo.u2PCS1900;
+            memcpy( (void *)pSysInfo->szSn, ee->cfg.v1.sysInfo.szSn, sizeof(pSysInfo->szSn) );
+            pSysInfo->u8Rev     = ee->cfg.v1.sysInfo.u8Rev;
+            pSysInfo->u8Tcxo    = ee->cfg.v1.sysInfo.u2Tcxo;
+            pSysInfo->u8Ocxo    = ee->cfg.v1.sysInfo.u2Ocxo;
+            pSysInfo->u8GSM850  = ee->cfg.v1.sysInfo.u2GSM850;
+            pSysInfo->u8GSM900  = ee->cfg.v1.sysInfo.u2GSM900;
+            pSysInfo->u8DCS1800 = ee->cfg.v1.sysInfo.u2DCS1800;
+            pSysInfo->u8PCS1900 = ee->cfg.v1.sysInfo.u2PCS1900;
             break;
         }
 
@@ -553,59 +568,48 @@ eeprom_Error_t eeprom_ReadSysInfo( eeprom_SysInfo_t *pSysInfo )
  ****************************************************************************/
 eeprom_Error_t eeprom_WriteSysInfo( const eeprom_SysInfo_t *pSysInfo )
 {
-    int err;
-    eeprom_Cfg_t ee;
+    eeprom_Error_t err;
+    eeprom_Cfg_t *ee;
 
-    // Get a copy of the EEPROM header
-    err = eeprom_read( EEPROM_CFG_START_ADDR, sizeof(ee.hdr), (char *) &ee.hdr );
-    if ( err != sizeof(ee.hdr) )
+    // Get the EEPROM header, a blank config if there is none
+    err = eeprom_image( &ee, 1 );
+    if ( err != EEPROM_SUCCESS )
     {
-        PERROR( "Error while reading the EEPROM content (%d)\n", err );
-        return EEPROM_ERR_DEVICE;
-    }
-
-    // Validate the header magic ID
-    if ( ee.hdr.u32MagicId != EEPROM_CFG_MAGIC_ID )
-    {
-        // Init the header
-        ee.hdr.u32MagicId = EEPROM_CFG_MAGIC_ID;
-        ee.hdr.u16Version = EEPROM_HDR_V2;
-
-        // Write it to the EEPROM
-        err = eeprom_write( EEPROM_CFG_START_ADDR, sizeof(ee.hdr) + sizeof(ee.cfg.v1), (const char *) &ee );
-        if ( err != sizeof(ee.hdr) + sizeof(ee.cfg.v1) )
-        {
-            PERROR( "Error while writing to the EEPROM (%d)\n", err );
-            return EEPROM_ERR_DEVICE;
-        }
+        return err;
     }
 
-    switch ( ee.hdr.u16Version )
+    switch ( ee->hdr.u16Version )
     {
         case EEPROM_HDR_V2:
         {
-            ee.cfg.v1.sysInfo.u16SectionID = EEPROM_SID_SYSINFO;
-            ee.cfg.v1.sysInfo.u16Crc       = 0;
-            ee.cfg.v1.sysInfo.u32Time      = time(NULL);
+            if ( eeprom_load( &ee->cfg.v1.sysInfo, sizeof(ee->cfg.v1.sysInfo) ) != 0 )
+            {
+                PERROR( "Error while reading the EEPROM content\n" );
+                return EEPROM_ERR_DEVICE;
+            }
+
+            ee->cfg.v1.sysInfo.u16SectionID = EEPROM_SID_SYSINFO;
+            ee->cfg.v1.sysInfo.u16Crc       = 0;
+            ee->cfg.v1.sysInfo.u32Time      = time(NULL);
 
             // Compress the info
-            memcpy( ee.cfg.v1.sysInfo.szSn, pSysInfo->szSn, sizeof(ee.cfg.v1.sysInfo.szSn) );
-            ee.cfg.v1.sysInfo.u8Rev     = pSysInfo->u8Rev;
-            ee.cfg.v1.sysInfo.u2Tcxo    = pSysInfo->u8Tcxo;
-            ee.cfg.v1.sysInfo.u2Ocxo    = pSysInfo->u8Ocxo;
-            ee.cfg.v1.sysInfo.u2GSM850  = pSysInfo->u8GSM850;
-            ee.cfg.v1.sysInfo.u2GSM900  = pSysInfo->u8GSM900;
-            ee.cfg.v1.sysInfo.u2DCS1800 = pSysInfo->u8DCS1800;
-            ee.cfg.v1.sysInfo.u2PCS1900 = pSysInfo->u8PCS1900;
+            memcpy( ee->cfg.v1.sysInfo.szSn, pSysInfo->szSn, sizeof(ee->cfg.v1.sysInfo.szSn) );
+            ee->cfg.v1.sysInfo.u8Rev     = pSysInfo->u8Rev;
+            ee->cfg.v1.sysInfo.u2Tcxo    = pSysInfo->u8Tcxo;
+            ee->cfg.v1.sysInfo.u2Ocxo    = pSysInfo->u8Ocxo;
+            ee->cfg.v1.sysInfo.u2GSM850  = pSysInfo->u8GSM850;
+            ee->cfg.v1.sysInfo.u2GSM900  = pSysInfo->u8GSM900;
+            ee->cfg.v1.sysInfo.u2DCS1800 = pSysInfo->u8DCS1800;
+            ee->cfg.v1.sysInfo.u2PCS1900 = pSysInfo->u8PCS1900;
 
             // Add the CRC
-            ee.cfg.v1.sysInfo.u16Crc = eeprom_crc( (uint8_t *)&ee.cfg.v1.sysInfo.u32Time, sizeof(ee.cfg.v1.sysInfo) - 2 * sizeof(uint16_t) );
+            ee->cfg.v1.sysInfo.u16Crc = eeprom_crc( (uint8_t *)&ee->cfg.v1.sysInfo.u32Time, sizeof(ee->cfg.v1.sysInfo) - 2 * sizeof(uint16_t) );
 
-            // Write it to the EEPROM
-            err = eeprom_write( EEPROM_CFG_START_ADDR + ((uint32_t)&ee.cfg.v1.sysInfo - (uint32_t)&ee), sizeof(ee.cfg.v1.sysInfo), (const char *) &ee.cfg.v1.sysInfo );
-            if ( err != sizeof(ee.cfg.v1.sysInfo) )
+            // Write it back to the EEPROM
+            eeprom_dirty( &ee->cfg.v1.sysInfo, sizeof(ee->cfg.v1.sysInfo) );
+            if ( eeprom_flush() != 0 )
             {
-                PERROR( "Error while writing to the EEPROM (%d)\n", err );
+                PERROR( "Error while writing to the EEPROM\n" );
                 return EEPROM_ERR_DEVICE;
             }
             break;
@@ -636,54 +640,45 @@ eeprom_Error_t eeprom_WriteSysInfo( const eeprom_SysInfo_t *pSysInfo )
  ****************************************************************************/
 eeprom_Error_t eeprom_ReadRfClockCal( eeprom_RfClockCal_t *pRfClockCal )
 {
-    int err;
-    eeprom_Cfg_t ee;
-
-    // Get a copy of the EEPROM header
-    err = eeprom_read( EEPROM_CFG_START_ADDR, sizeof(ee), (char *) &ee );
-    if ( err != sizeof(ee) )
-    {
-        PERROR( "Error while reading the EEPROM content (%d)\n", err );
-        return EEPROM_ERR_DEVICE;
-    }
+    eeprom_Error_t err;
+    eeprom_Cfg_t *ee;
 
-    // Validate the header magic ID
-    if ( ee.hdr.u32MagicId != EEPROM_CFG_MAGIC_ID )
+    // Get the validated EEPROM header
+    err = eeprom_image( &ee, 0 );
+    if ( err != EEPROM_SUCCESS )
     {
-        PERROR( "Invalid EEPROM format\n" );
-        return EEPROM_ERR_INVALID;
+        return err;
     }
 
-    switch ( ee.hdr.u16Version )
+    switch ( ee->hdr.u16Version )
     {
 		case EEPROM_HDR_V1:
     	case EEPROM_HDR_V2:
         {
-            // Get a copy of the EEPROM section 
-            err = eeprom_read( EEPROM_CFG_START_ADDR + ((uint32_t)&ee.cfg.v1.rfClk - (uint32_t)&ee), sizeof(ee.cfg.v1.rfClk), (char *)&ee.cfg.v1.rfClk );
-            if ( err != sizeof(ee.cfg.v1.rfClk) )
+            // Get the EEPROM section
+            if ( eeprom_load( &ee->cfg.v1.rfClk, sizeof(ee->cfg.v1.rfClk) ) != 0 )
             {
-                PERROR( "Error while reading the EEPROM content (%d)\n", err );
+                PERROR( "Error while reading the EEPROM content\n" );
                 return EEPROM_ERR_DEVICE;
             }
 
             // Validate the ID
-            if ( ee.cfg.v1.rfClk.u16SectionID != EEPROM_SID_RFCLOCK_CAL )
+            if ( ee->cfg.v1.rfClk.u16SectionID != EEPROM_SID_RFCLOCK_CAL )
             {
                 PERROR( "Uninitialized data section\n" );
                 return EEPROM_ERR_UNAVAILABLE;
             }
 
             // Validate the CRC
-            if ( eeprom_crc( (uint8_t *)&ee.cfg.v1.rfClk.u32Time, sizeof(ee.cfg.v1.rfClk) - 2 * sizeof(uint16_t) ) != ee.cfg.v1.rfClk.u16Crc )
+            if ( eeprom_crc( (uint8_t *)&ee->cfg.v1.rfClk.u32Time, sizeof(ee->cfg.v1.rfClk) - 2 * sizeof(uint16_t) ) != ee->cfg.v1.rfClk.u16Crc )
             {
                 PERROR( "Parity error\n" );
                 return EEPROM_ERR_PARITY;
             }
 
             // Expand the content of the section
-            pRfClockCal->iClkCor  = ee.cfg.v1.rfClk.i24ClkCor;
-            pRfClockCal->u8ClkSrc = ee.cfg.v1.rfClk.u8ClkSrc;
+            pRfClockCal->iClkCor  = ee->cfg.v1.rfClk.i24ClkCor;
+            pRfClockCal->u8ClkSrc = ee->cfg.v1.rfClk.u8ClkSrc;
             break;
         }
 
@@ -712,53 +707,42 @@ eeprom_Error_t eeprom_ReadRfClockCal( eeprom_RfClockCal_t *pRfClockCal )
  ****************************************************************************/
 eeprom_Error_t eeprom_WriteRfClockCal( const eeprom_RfClockCal_t *pRfClockCal )
 {
-    int err;
-    eeprom_Cfg_t ee;
+    eeprom_Error_t err;
+    eeprom_Cfg_t *ee;
 
-    // Get a copy of the EEPROM header
-    err = eeprom_read( EEPROM_CFG_START_ADDR, sizeof(ee.hdr), (char *) &ee.hdr );
-    if ( err != sizeof(ee.hdr) )
+    // Get the EEPROM header, a blank config if there is none
+    err = eeprom_image( &ee, 1 );
+    if ( err != EEPROM_SUCCESS )
     {
-        PERROR( "Error while reading the EEPROM content (%d)\n", err );
-        return EEPROM_ERR_DEVICE;
-    }
-
-    // Validate the header magic ID
-    if ( ee.hdr.u32MagicId != EEPROM_CFG_MAGIC_ID )
-    {
-        // Init the header
-        ee.hdr.u32MagicId = EEPROM_CFG_MAGIC_ID;
-        ee.hdr.u16Version = EEPROM_HDR_V2;
-
-        // Write it to the EEPROM
-        err = eeprom_write( EEPROM_CFG_START_ADDR, sizeof(ee.hdr) + sizeof(ee.cfg.v1), (const char *) &ee );
-        if ( err != sizeof(ee.hdr) + sizeof(ee.cfg.v1) )
-        {
-            PERROR( "Error while writing to the EEPROM (%d)\n", err );
-            return EEPROM_ERR_DEVICE;
-        }
+        return err;
     }
 
-    switch ( ee.hdr.u16Version )
+    switch ( ee->hdr.u16Version )
     {
         case EEPROM_HDR_V2:
         {
-            ee.cfg.v1.rfClk.u16SectionID = EEPROM_SID_RFCLOCK_CAL;
-            ee.cfg.v1.rfClk.u16Crc       = 0;
-            ee.cfg.v1.rfClk.u32Time      = time(NULL);
+            if ( eeprom_load( &ee->cfg.v1.rfClk, sizeof(ee->cfg.v1.rfClk) ) != 0 )
+            {
+                PERROR( "Error while reading the EEPROM content\n" );
+                return EEPROM_ERR_DEVICE;
+            }
+
+            ee->cfg.v1.rfClk.u16SectionID = EEPROM_SID_RFCLOCK_CAL;
+            ee->cfg.v1.rfClk.u16Crc       = 0;
+            ee->cfg.v1.rfClk.u32Time      = time(NULL);
 
             // Compress the info
-            ee.cfg.v1.rfClk.i24ClkCor = pRfClockCal->iClkCor;
-            ee.cfg.v1.rfClk.u8ClkSrc  = pRfClockCal->u8ClkSrc;
+            ee->cfg.v1.rfClk.i24ClkCor = pRfClockCal->iClkCor;
+            ee->cfg.v1.rfClk.u8ClkSrc  = pRfClockCal->u8ClkSrc;
 
             // Add the CRC
-            ee.cfg.v1.rfClk.u16Crc = eeprom_crc( (uint8_t *)&ee.cfg.v1.rfClk.u32Time, sizeof(ee.cfg.v1.rfClk) - 2 * sizeof(uint16_t) );
+            ee->cfg.v1.rfClk.u16Crc = eeprom_crc( (uint8_t *)&ee->cfg.v1.rfClk.u32Time, sizeof(ee->cfg.v1.rfClk) - 2 * sizeof(uint16_t) );
 
-            // Write it to the EEPROM
-            err = eeprom_write( EEPROM_CFG_START_ADDR + ((uint32_t)&ee.cfg.v1.rfClk - (uint32_t)&ee), sizeof(ee.cfg.v1.rfClk), (const char *) &ee.cfg.v1.rfClk );
-            if ( err != sizeof(ee.cfg.v1.rfClk) )
+            // Write it back to the EEPROM
+            eeprom_dirty( &ee->cfg.v1.rfClk, sizeof(ee->cfg.v1.rfClk) );
+            if ( eeprom_flush() != 0 )
             {
-                PERROR( "Error while writing to the EEPROM (%d)\n", err );
+                PERROR( "Error while writing to the EEPROM\n" );
                 return EEPROM_ERR_DEVICE;
             }
             break;
@@ -775,11 +759,11 @@ eeprom_Error_t eeprom_WriteRfClockCal( const eeprom_RfClockCal_t *pRfClockCal )
 
 
 /****************************************************************************
- * Function : eeprom_ReadTxCal
+ * Function : eeprom_ExpandTxCal
  ************************************************************************//**
  *
- * This function reads the TX calibration tables for the specified band from
- * the EEPROM.
+ * This function validates the TX calibration tables for the specified band
+ * in the config image and expands them.
  *
  * @param [in] iBand
  *    GSM band (0:GSM-850, 1:GSM-900, 2:DCS-1800, 3:PCS-1900).
@@ -791,21 +775,22 @@ eeprom_Error_t eeprom_WriteRfClockCal( const eeprom_RfClockCal_t *pRfClockCal )
  *    0 if or an error core.
  *
  ****************************************************************************/
-eeprom_Error_t eeprom_ReadTxCal( int iBand, eeprom_TxCal_t *pTxCal )
+static eeprom_Error_t eeprom_ExpandTxCal( int iBand, eeprom_TxCal_t *pTxCal )
 {
     int i;
     int size;
     int nArfcn;
-    eeprom_Cfg_t *ee = eeprom_cached_config();
+    eeprom_Error_t err;
+    eeprom_Cfg_t *ee;
     eeprom_SID_t sId;
     eeprom_CfgTxCal_t *pCfgTxCal = NULL;
     eeprom_CfgTxCalV2_t *pCfgTxCalV2 = NULL;
 
-    // Get a copy of the EEPROM header
-    if (!ee)
+    // Get the validated EEPROM header
+    err = eeprom_image( &ee, 0 );
+    if ( err != EEPROM_SUCCESS )
     {
-        PERROR( "Reading cached content failed.\n" );
-        return EEPROM_ERR_DEVICE;
+        return err;
     }
 
     switch ( ee->hdr.u16Version )
@@ -843,6 +828,13 @@ eeprom_Error_t eeprom_ReadTxCal( int iBand, eeprom_TxCal_t *pTxCal )
                     return EEPROM_ERR_INVALID;
             }
 
+            // Get the EEPROM section
+            if ( eeprom_load( pCfgTxCal, size ) != 0 )
+            {
+                PERROR( "Error while reading the EEPROM content\n" );
+                return EEPROM_ERR_DEVICE;
+            }
+
             // Validate the ID
             if ( pCfgTxCal->u16SectionID != sId )
             {
@@ -918,6 +910,13 @@ eeprom_Error_t eeprom_ReadTxCal( int iBand, eeprom_TxCal_t *pTxCal )
 			}
 
 
+			// Get the EEPROM section
+			if ( eeprom_load( pCfgTxCalV2, size ) != 0 )
+			{
+				PERROR( "Error while reading the EEPROM content\n" );
+				return EEPROM_ERR_DEVICE;
+			}
+
 			// Validate the ID
 			if ( pCfgTxCalV2->u16SectionID != sId )
 			{
@@ -968,6 +967,57 @@ eeprom_Error_t eeprom_ReadTxCal( int iBand, eeprom_TxCal_t *pTxCal )
 }
 
 
+/****************************************************************************
+ * Function : eeprom_ReadTxCal
+ ************************************************************************//**
+ *
+ * This function reads the TX calibration tables for the specified band from
+ * the EEPROM.  The tables are expanded on the first read only, later reads
+ * return a copy of them.
+ *
+ * @param [in] iBand
+ *    GSM band (0:GSM-850, 1:GSM-900, 2:DCS-1800, 3:PCS-1900).
+ *
+ * @param [inout] pTxCal
+ *    Pointer to a TX calibration table structure.
+ *
+ * @return
+ *    0 if or an error core.
+ *
+ ****************************************************************************/
+eeprom_Error_t eeprom_ReadTxCal( int iBand, eeprom_TxCal_t *pTxCal )
+{
+    eeprom_Error_t err;
+    eeprom_TxCal_t *pCal;
+
+    if ( iBand < 0 || iBand > 3 )
+    {
+        PERROR( "Invalid GSM band specified (%d)\n", iBand );
+        return EEPROM_ERR_INVALID;
+    }
+
+    if ( !g_pTxCal[iBand] )
+    {
+        pCal = calloc( 1, sizeof(*pCal) );
+        if ( !pCal )
+        {
+            return EEPROM_ERR_DEVICE;
+        }
+
+        err = eeprom_ExpandTxCal( iBand, pCal );
+        if ( err != EEPROM_SUCCESS )
+        {
+            free( pCal );
+            return err;
+        }
+        g_pTxCal[iBand] = pCal;
+    }
+
+    memcpy( pTxCal, g_pTxCal[iBand], sizeof(*pTxCal) );
+    return EEPROM_SUCCESS;
+}
+
+
 /****************************************************************************
  * Function : eeprom_WriteTxCal
  ************************************************************************//**
@@ -988,38 +1038,21 @@ eeprom_Error_t eeprom_ReadTxCal( int iBand, eeprom_TxCal_t *pTxCal )
 eeprom_Error_t eeprom_WriteTxCal( int iBand, const eeprom_TxCal_t *pTxCal )
 {
     int i;
-    int err;
+    eeprom_Error_t err;
     int size;
     int nArfcn;
-    eeprom_Cfg_t ee;
+    eeprom_Cfg_t *ee;
     eeprom_SID_t sId;
     eeprom_CfgTxCalV2_t *pCfgTxCal = NULL;
 
-    // Get a copy of the EEPROM header
-    err = eeprom_read( EEPROM_CFG_START_ADDR, sizeof(ee.hdr), (char *) &ee.hdr );
-    if ( err != sizeof(ee.hdr) )
+    // Get the EEPROM header, a blank config if there is none
+    err = eeprom_image( &ee, 1 );
+    if ( err != EEPROM_SUCCESS )
     {
-        PERROR( "Error while reading the EEPROM content (%d)\n", err );
-        return EEPROM_ERR_DEVICE;
+        return err;
     }
 
-    // Validate the header magic ID
-    if ( ee.hdr.u32MagicId != EEPROM_CFG_MAGIC_ID )
-    {
-        // Init the header
-        ee.hdr.u32MagicId = EEPROM_CFG_MAGIC_ID;
-        ee.hdr.u16Version = EEPROM_HDR_V2;
-
-        // Write it to the EEPROM
-        err = eeprom_write( EEPROM_CFG_START_ADDR, sizeof(ee.hdr) + sizeof(ee.cfg.v2), (const char *) &ee );
-        if ( err != sizeof(ee.hdr) + sizeof(ee.cfg.v2) )
-        {
-            PERROR( "Error while writing to the EEPROM (%d)\n", err );
-            return EEPROM_ERR_DEVICE;
-        }
-    }
-
-    switch ( ee.hdr.u16Version )
+    switch ( ee->hdr.u16Version )
     {
         case EEPROM_HDR_V2:
         {
@@ -1030,32 +1063,38 @@ eeprom_Error_t eeprom_WriteTxCal( int iBand, const eeprom_TxCal_t *pTxCal )
                 case 0:
 			nArfcn = 124;
 			sId = EEPROM_SID_GSM850_TXCAL;
-			pCfgTxCal = &ee.cfg.v2.gsm850TxCalV2;
-			size = sizeof(ee.cfg.v2.gsm850TxCalV2) + sizeof(ee.cfg.v2.__gsm850TxCalMemV2);
+			pCfgTxCal = &ee->cfg.v2.gsm850TxCalV2;
+			size = sizeof(ee->cfg.v2.gsm850TxCalV2) + sizeof(ee->cfg.v2.__gsm850TxCalMemV2);
 			break;
                 case 1:
                 	nArfcn = 194;
 					sId = EEPROM_SID_GSM900_TXCAL;
-					pCfgTxCal = &ee.cfg.v2.gsm900TxCalV2;
-					size = sizeof(ee.cfg.v2.gsm900TxCalV2) + sizeof(ee.cfg.v2.__gsm900TxCalMemV2);
+					pCfgTxCal = &ee->cfg.v2.gsm900TxCalV2;
+					size = sizeof(ee->cfg.v2.gsm900TxCalV2) + sizeof(ee->cfg.v2.__gsm900TxCalMemV2);
 					break;
                 case 2:
                 	nArfcn = 374;
 					sId = EEPROM_SID_DCS1800_TXCAL;
-					pCfgTxCal = &ee.cfg.v2.dcs1800TxCalV2;
-					size = sizeof(ee.cfg.v2.dcs1800TxCalV2) + sizeof(ee.cfg.v2.__dcs1800TxCalMemV2);
+					pCfgTxCal = &ee->cfg.v2.dcs1800TxCalV2;
+					size = sizeof(ee->cfg.v2.dcs1800TxCalV2) + sizeof(ee->cfg.v2.__dcs1800TxCalMemV2);
 					break;
                 case 3:
                 	nArfcn = 299;
 					sId = EEPROM_SID_PCS1900_TXCAL;
-					pCfgTxCal = &ee.cfg.v2.pcs1900TxCalV2;
-					size = sizeof(ee.cfg.v2.pcs1900TxCalV2) + sizeof(ee.cfg.v2.__pcs1900TxCalMemV2);
+					pCfgTxCal = &ee->cfg.v2.pcs1900TxCalV2;
+					size = sizeof(ee->cfg.v2.pcs1900TxCalV2) + sizeof(ee->cfg.v2.__pcs1900TxCalMemV2);
 					break;
                 default:
                     PERROR( "Invalid GSM band specified (%d)\n", iBand );
                     return EEPROM_ERR_INVALID;
             }
 
+            if ( eeprom_load( pCfgTxCal, size ) != 0 )
+            {
+                PERROR( "Error while reading the EEPROM content\n" );
+                return EEPROM_ERR_DEVICE;
+            }
+
             pCfgTxCal->u16SectionID = sId;
             pCfgTxCal->u16Crc       = 0;
             pCfgTxCal->u32Time      = time(NULL);
@@ -1098,13 +1137,17 @@ eeprom_Error_t eeprom_WriteTxCal( int iBand, const eeprom_TxCal_t *pTxCal )
             // Add the CRC
             pCfgTxCal->u16Crc = eeprom_crc( (uint8_t *)&pCfgTxCal->u32Time, size - 2 * sizeof(uint16_t) );
 
-            // Write it to the EEPROM
-            err = eeprom_write( EEPROM_CFG_START_ADDR + ((uint32_t)pCfgTxCal - (uint32_t)&ee), size, (const char *)pCfgTxCal );
-            if ( err != size )
+            // Write it back to the EEPROM
+            eeprom_dirty( pCfgTxCal, size );
+            if ( eeprom_flush() != 0 )
             {
-                PERROR( "Error while writing to the EEPROM (%d)\n", err );
+                PERROR( "Error while writing to the EEPROM\n" );
                 return EEPROM_ERR_DEVICE;
             }
+
+            // Expand it again on the next read
+            free( g_pTxCal[iBand] );
+            g_pTxCal[iBand] = NULL;
             break;
         }
 
@@ -1119,11 +1162,11 @@ eeprom_Error_t eeprom_WriteTxCal( int iBand, const eeprom_TxCal_t *pTxCal )
 
 
 /****************************************************************************
- * Function : eeprom_ReadRxCal
+ * Function : eeprom_ExpandRxCal
  ************************************************************************//**
  *
- * This function reads the RX calibration tables for the specified band from
- * the EEPROM.
+ * This function validates the RX calibration tables for the specified band
+ * in the config image and expands them.
  *
  * @param [in] iBand
  *    GSM band (0:GSM-850, 1:GSM-900, 2:DCS-1800, 3:PCS-1900).
@@ -1138,21 +1181,23 @@ eeprom_Error_t eeprom_WriteTxCal( int iBand, const eeprom_TxCal_t *pTxCal )
  *    0 if or an error core.
  *
  ****************************************************************************/
-eeprom_Error_t eeprom_ReadRxCal( int iBand, int iUplink, eeprom_RxCal_t *pRxCal )
+static eeprom_Error_t eeprom_ExpandRxCal( int iBand, int iUplink, eeprom_RxCal_t *pRxCal )
 {
     int i;
     int size;
     int nArfcn;
-    eeprom_Cfg_t *ee = eeprom_cached_config();
+    eeprom_Error_t err;
+    eeprom_Cfg_t *ee;
     eeprom_SID_t sId;
     eeprom_CfgRxCal_t *pCfgRxCal = NULL;
     eeprom_CfgRxCalV2_t *pCfgRxCalV2 = NULL;
 
 
-    if (!ee)
+    // Get the validated EEPROM header
+    err = eeprom_image( &ee, 0 );
+    if ( err != EEPROM_SUCCESS )
     {
-        PERROR( "Reading cached content failed.\n" );
-        return EEPROM_ERR_DEVICE;
+        return err;
     }
 
     switch ( ee->hdr.u16Version )
@@ -1226,6 +1271,13 @@ eeprom_Error_t eeprom_ReadRxCal( int iBand, int iUplink, eeprom_RxCal_t *pRxCal
                     return EEPROM_ERR_INVALID;
             }
 
+            // Get the EEPROM section
+            if ( eeprom_load( pCfgRxCal, size ) != 0 )
+            {
+                PERROR( "Error while reading the EEPROM content\n" );
+                return EEPROM_ERR_DEVICE;
+            }
+
             // Validate the ID
             if ( pCfgRxCal->u16SectionID != sId )
             {
@@ -1348,6 +1400,13 @@ eeprom_Error_t eeprom_ReadRxCal( int iBand, int iUplink, eeprom_RxCal_t *pRxCal
 					return EEPROM_ERR_INVALID;
 			}
 
+		    // Get the EEPROM section
+		    if ( eeprom_load( pCfgRxCalV2, size ) != 0 )
+		    {
+		        PERROR( "Error while reading the EEPROM content\n" );
+		        return EEPROM_ERR_DEVICE;
+		    }
+
 		    // Validate the ID
 			if ( pCfgRxCalV2->u16SectionID != sId )
 			{
@@ -1410,6 +1469,62 @@ eeprom_Error_t eeprom_ReadRxCal( int iBand, int iUplink, eeprom_RxCal_t *pRxCal
 }
 
 
+/****************************************************************************
+ * Function : eeprom_ReadRxCal
+ ************************************************************************//**
+ *
+ * This function reads the RX calibration tables for the specified band from
+ * the EEPROM.  The tables are expanded on the first read only, later reads
+ * return a copy of them.
+ *
+ * @param [in] iBand
+ *    GSM band (0:GSM-850, 1:GSM-900, 2:DCS-1800, 3:PCS-1900).
+ *
+ * @param [in] iUplink
+ *    Uplink flag (0:downlink, X:downlink).
+ *
+ * @param [inout] pRxCal
+ *    Pointer to a RX calibration table structure.
+ *
+ * @return
+ *    0 if or an error core.
+ *
+ ****************************************************************************/
+eeprom_Error_t eeprom_ReadRxCal( int iBand, int iUplink, eeprom_RxCal_t *pRxCal )
+{
+    eeprom_Error_t err;
+    eeprom_RxCal_t *pCal;
+    eeprom_RxCal_t **ppCal;
+
+    if ( iBand < 0 || iBand > 3 )
+    {
+        PERROR( "Invalid GSM band specified (%d)\n", iBand );
+        return EEPROM_ERR_INVALID;
+    }
+
+    ppCal = &g_pRxCal[iBand][!!iUplink];
+    if ( !*ppCal )
+    {
+        pCal = calloc( 1, sizeof(*pCal) );
+        if ( !pCal )
+        {
+            return EEPROM_ERR_DEVICE;
+        }
+
+        err = eeprom_ExpandRxCal( iBand, iUplink, pCal );
+        if ( err != EEPROM_SUCCESS )
+        {
+            free( pCal );
+            return err;
+        }
+        *ppCal = pCal;
+    }
+
+    memcpy( pRxCal, *ppCal, sizeof(*pRxCal) );
+    return EEPROM_SUCCESS;
+}
+
+
 /****************************************************************************
  * Function : eeprom_WriteRxCal
  ************************************************************************//**
@@ -1433,38 +1548,21 @@ eeprom_Error_t eeprom_ReadRxCal( int iBand, int iUplink, eeprom_RxCal_t *pRxCal
 eeprom_Error_t eeprom_WriteRxCal( int iBand, int iUplink, const eeprom_RxCal_t *pRxCal )
 {
     int i;
-    int err;
+    eeprom_Error_t err;
     int size;
     int nArfcn;
-    eeprom_Cfg_t ee;
+    eeprom_Cfg_t *ee;
     eeprom_SID_t sId;
     eeprom_CfgRxCalV2_t *pCfgRxCal = NULL;
 
-    // Get a copy of the EEPROM header
-    err = eeprom_read( EEPROM_CFG_START_ADDR, sizeof(ee.hdr), (char *) &ee.hdr );
-    if ( err != sizeof(ee.hdr) )
-    {
-        PERROR( "Error while reading the EEPROM content (%d)\n", err );
-        return EEPROM_ERR_DEVICE;
-    }
-
-    // Validate the header magic ID
-    if ( ee.hdr.u32MagicId != EEPROM_CFG_MAGIC_ID )
+    // Get the EEPROM header, a blank config if there is none
+    err = eeprom_image( &ee, 1 );
+    if ( err != EEPROM_SUCCESS )
     {
-        // Init the header
-        ee.hdr.u32MagicId = EEPROM_CFG_MAGIC_ID;
-        ee.hdr.u16Version = EEPROM_HDR_V2;
-
-        // Write it to the EEPROM
-        err = eeprom_write( EEPROM_CFG_START_ADDR, sizeof(ee.hdr) + sizeof(ee.cfg.v2), (const char *) &ee );
-        if ( err != sizeof(ee.hdr) + sizeof(ee.cfg.v2) )
-        {
-            PERROR( "Error while writing to the EEPROM (%d)\n", err );
-            return EEPROM_ERR_DEVICE;
-        }
+        return err;
     }
 
-    switch ( ee.hdr.u16Version )
+    switch ( ee->hdr.u16Version )
     {
     	case EEPROM_HDR_V2:
         {
@@ -1477,14 +1575,14 @@ eeprom_Error_t eeprom_WriteRxCal( int iBand, int iUplink, const eeprom_RxCal_t *
                     if ( iUplink )
                     {
                     	sId = EEPROM_SID_GSM850_RXUCAL;
-						pCfgRxCal = &ee.cfg.v2.gsm850RxuCalV2;
-						size = sizeof(ee.cfg.v2.gsm850RxuCalV2) + sizeof(ee.cfg.v2.__gsm850RxuCalMemV2);
+						pCfgRxCal = &ee->cfg.v2.gsm850RxuCalV2;
+						size = sizeof(ee->cfg.v2.gsm850RxuCalV2) + sizeof(ee->cfg.v2.__gsm850RxuCalMemV2);
                     }
                     else
                     {
                         sId = EEPROM_SID_GSM850_RXDCAL;
-                        pCfgRxCal = &ee.cfg.v2.gsm850RxdCalV2;
-                        size = sizeof(ee.cfg.v2.gsm850RxdCalV2) + sizeof(ee.cfg.v2.__gsm850RxdCalMemV2);
+                        pCfgRxCal = &ee->cfg.v2.gsm850RxdCalV2;
+                        size = sizeof(ee->cfg.v2.gsm850RxdCalV2) + sizeof(ee->cfg.v2.__gsm850RxdCalMemV2);
                     }
                     break;
                 case 1:
@@ -1492,14 +1590,14 @@ eeprom_Error_t eeprom_WriteRxCal( int iBand, int iUplink, const eeprom_RxCal_t *
                     if ( iUplink )
                     {
                         sId = EEPROM_SID_GSM900_RXUCAL;
-                        pCfgRxCal = &ee.cfg.v2.gsm900RxuCalV2;
-                        size = sizeof(ee.cfg.v2.gsm900RxuCalV2) + sizeof(ee.cfg.v2.__gsm900RxuCalMemV2);
+                        pCfgRxCal = &ee->cfg.v2.gsm900RxuCalV2;
+                        size = sizeof(ee->cfg.v2.gsm900RxuCalV2) + sizeof(ee->cfg.v2.__gsm900RxuCalMemV2);
                     }
                     else
                     {
                         sId = EEPROM_SID_GSM900_RXDCAL;
-                        pCfgRxCal = &ee.cfg.v2.gsm900RxdCalV2;
-                        size = sizeof(ee.cfg.v2.gsm900RxdCalV2) + sizeof(ee.cfg.v2.__gsm900RxdCalMemV2);
+                        pCfgRxCal = &ee->cfg.v2.gsm900RxdCalV2;
+                        size = sizeof(ee->cfg.v2.gsm900RxdCalV2) + sizeof(ee->cfg.v2.__gsm900RxdCalMemV2);
                     }
                     break;
                 case 2:
@@ -1507,14 +1605,14 @@ eeprom_Error_t eeprom_WriteRxCal( int iBand, int iUplink, const eeprom_RxCal_t *
                     if ( iUplink )
                     {
                         sId = EEPROM_SID_DCS1800_RXUCAL;
-                        pCfgRxCal = &ee.cfg.v2.dcs1800RxuCalV2;
-                        size = sizeof(ee.cfg.v2.dcs1800RxuCalV2) + sizeof(ee.cfg.v2.__dcs1800RxuCalMemV2);
+                        pCfgRxCal = &ee->cfg.v2.dcs1800RxuCalV2;
+                        size = sizeof(ee->cfg.v2.dcs1800RxuCalV2) + sizeof(ee->cfg.v2.__dcs1800RxuCalMemV2);
                     }
                     else
                     {
                         sId = EEPROM_SID_DCS1800_RXDCAL;
-                        pCfgRxCal = &ee.cfg.v2.dcs1800RxdCalV2;
-                        size = sizeof(ee.cfg.v2.dcs1800RxdCalV2) + sizeof(ee.cfg.v2.__dcs1800RxdCalMemV2);
+                        pCfgRxCal = &ee->cfg.v2.dcs1800RxdCalV2;
+                        size = sizeof(ee->cfg.v2.dcs1800RxdCalV2) + sizeof(ee->cfg.v2.__dcs1800RxdCalMemV2);
                     }
                     break;
                 case 3:
@@ -1522,14 +1620,14 @@ eeprom_Error_t eeprom_WriteRxCal( int iBand, int iUplink, const eeprom_RxCal_t *
                     if ( iUplink )
                     {
                         sId = EEPROM_SID_PCS1900_RXUCAL;
-                        pCfgRxCal = &ee.cfg.v2.pcs1900RxuCalV2;
-                        size = sizeof(ee.cfg.v2.pcs1900RxuCalV2) + sizeof(ee.cfg.v2.__pcs1900RxuCalMemV2);
+                        pCfgRxCal = &ee->cfg.v2.pcs1900RxuCalV2;
+                        size = sizeof(ee->cfg.v2.pcs1900RxuCalV2) + sizeof(ee->cfg.v2.__pcs1900RxuCalMemV2);
                     }
                     else
                     {
                         sId = EEPROM_SID_PCS1900_RXDCAL;
-                        pCfgRxCal = &ee.cfg.v2.pcs1900RxdCalV2;
-                        size = sizeof(ee.cfg.v2.pcs1900RxdCalV2) + sizeof(ee.cfg.v2.__pcs1900RxdCalMemV2);
+                        pCfgRxCal = &ee->cfg.v2.pcs1900RxdCalV2;
+                        size = sizeof(ee->cfg.v2.pcs1900RxdCalV2) + sizeof(ee->cfg.v2.__pcs1900RxdCalMemV2);
                     }
                     break;
                 default:
@@ -1537,6 +1635,12 @@ eeprom_Error_t eeprom_WriteRxCal( int iBand, int iUplink, const eeprom_RxCal_t *
                     return EEPROM_ERR_INVALID;
             }
 
+            if ( eeprom_load( pCfgRxCal, size ) != 0 )
+            {
+                PERROR( "Error while reading the EEPROM content\n" );
+                return EEPROM_ERR_DEVICE;
+            }
+
             pCfgRxCal->u16SectionID = sId;
             pCfgRxCal->u16Crc       = 0;
             pCfgRxCal->u32Time      = time(NULL);
@@ -1591,13 +1695,17 @@ eeprom_Error_t eeprom_WriteRxCal( int iBand, int iUplink, const eeprom_RxCal_t *
             // Add the CRC
             pCfgRxCal->u16Crc = eeprom_crc( (uint8_t *)&pCfgRxCal->u32Time, size - 2 * sizeof(uint16_t) );
 
-            // Write it to the EEPROM
-            err = eeprom_write( EEPROM_CFG_START_ADDR + ((uint32_t)pCfgRxCal - (uint32_t)&ee), size, (const char *)pCfgRxCal );
-            if ( err != size )
+            // Write it back to the EEPROM
+            eeprom_dirty( pCfgRxCal, size );
+            if ( eeprom_flush() != 0 )
             {
-                PERROR( "Error while writing to the EEPROM (%d)\n", err );
+                PERROR( "Error while writing to the EEPROM\n" );
                 return EEPROM_ERR_DEVICE;
             }
+
+            // Expand it again on the next read
+            free( g_pRxCal[iBand][!!iUplink] );
+            g_pRxCal[iBand][!!iUplink] = NULL;
             break;
         }
 
@@ -1611,6 +1719,103 @@ eeprom_Error_t eeprom_WriteRxCal( int iBand, int iUplink, const eeprom_RxCal_t *
 }
 
 
+/****************************************************************************
+ * Function : eeprom_ReadCalStamp
+ ************************************************************************//**
+ *
+ * This function reads the section header of a calibration table.
+ *
+ * @param [in] iBand
+ *    GSM band (0:GSM-850, 1:GSM-900, 2:DCS-1800, 3:PCS-1900).
+ *
+ * @param [in] iRx
+ *    Table flag (0:TX table, X:RX table).
+ *
+ * @param [in] iUplink
+ *    Uplink flag of a RX table (0:downlink, X:uplink).
+ *
+ * @param [inout] pu64Stamp
+ *    Section ID, CRC and time of the table.
+ *
+ * @return
+ *    0 if or an error core.
+ *
+ ****************************************************************************/
+eeprom_Error_t eeprom_ReadCalStamp( int iBand, int iRx, int iUplink, uint64_t *pu64Stamp )
+{
+#define CAL_OFS(v, b) { offsetof(eeprom_Cfg_t, cfg.v.b##TxCal), \
+                        offsetof(eeprom_Cfg_t, cfg.v.b##RxdCal), \
+                        offsetof(eeprom_Cfg_t, cfg.v.b##RxuCal) }
+    static const int aOfsV1[4][3] = {
+        CAL_OFS(v1, gsm850), CAL_OFS(v1, gsm900),
+        CAL_OFS(v1, dcs1800), CAL_OFS(v1, pcs1900),
+    };
+#undef CAL_OFS
+#define CAL_OFS(v, b) { offsetof(eeprom_Cfg_t, cfg.v.b##TxCalV2), \
+                        offsetof(eeprom_Cfg_t, cfg.v.b##RxdCalV2), \
+                        offsetof(eeprom_Cfg_t, cfg.v.b##RxuCalV2) }
+    static const int aOfsV2[4][3] = {
+        CAL_OFS(v2, gsm850), CAL_OFS(v2, gsm900),
+        CAL_OFS(v2, dcs1800), CAL_OFS(v2, pcs1900),
+    };
+#undef CAL_OFS
+    const struct
+    {
+        uint16_t u16SectionID;
+        uint16_t u16Crc;
+        uint32_t u32Time;
+    } __attribute__((packed)) *pSec;
+    eeprom_Error_t err;
+    eeprom_Cfg_t *ee;
+    int iTbl = iRx ? (iUplink ? 2 : 1) : 0;
+    int ofs;
+
+    if ( iBand < 0 || iBand > 3 )
+    {
+        PERROR( "Invalid GSM band specified (%d)\n", iBand );
+        return EEPROM_ERR_INVALID;
+    }
+
+    // Get the validated EEPROM header
+    err = eeprom_image( &ee, 0 );
+    if ( err != EEPROM_SUCCESS )
+    {
+        return err;
+    }
+
+    switch ( ee->hdr.u16Version )
+    {
+        case EEPROM_HDR_V1:
+            ofs = aOfsV1[iBand][iTbl];
+            break;
+        case EEPROM_HDR_V2:
+            ofs = aOfsV2[iBand][iTbl];
+            break;
+        default:
+            PERROR( "Unsupported header version\n" );
+            return EEPROM_ERR_UNSUPPORTED;
+    }
+
+    // Only the section header is needed, not the table
+    pSec = (const void *)((const uint8_t *)ee + ofs);
+    if ( eeprom_load( pSec, sizeof(*pSec) ) != 0 )
+    {
+        PERROR( "Error while reading the section header\n" );
+        return EEPROM_ERR_DEVICE;
+    }
+
+    // Validate the ID (band n: TX 0x3n00, RX uplink 0x3n10, RX downlink 0x3n20)
+    if ( pSec->u16SectionID != EEPROM_SID_GSM850_TXCAL + (iBand << 8) + (iRx ? (iUplink ? 0x10 : 0x20) : 0) )
+    {
+        PERROR( "Uninitialized data section\n" );
+        return EEPROM_ERR_UNAVAILABLE;
+    }
+
+    *pu64Stamp = ((uint64_t)pSec->u16SectionID << 48) | ((uint64_t)pSec->u16Crc << 32) | pSec->u32Time;
+    return EEPROM_SUCCESS;
+}
+
+
 /****************************************************************************
  *                            Private functions                             *
  ****************************************************************************/
@@ -1670,132 +1875,305 @@ int eeprom_dump( int addr, int size, int hex )
     return 0;
 }
 
-static FILE *g_file;
-static eeprom_Cfg_t *g_cached_cfg;
-
 void eeprom_free_resources(void)
 {
-	if (g_file)
-		fclose(g_file);
-	g_file = NULL;
+	if (g_fd >= 0)
+		close(g_fd);
+	g_fd = -1;
 
-	/* release the header */
+	/* release the image and the expanded tables */
 	free(g_cached_cfg);
 	g_cached_cfg = NULL;
+	eeprom_drop_expanded();
 }
 
 /**
- * Read up to 'size' bytes of data from the EEPROM starting at offset 'addr'.
+ * Open the EEPROM device on first use.
  */
-static int eeprom_read( int addr, int size, char *pBuff )
+static int eeprom_open( void )
 {
-    FILE *f = g_file;
-    int n;
-    
-    if (!f) {
-    	f = fopen( EEPROM_DEV, "r+" );
-    	if ( f == NULL )
+    if ( g_fd < 0 )
+    {
+        g_fd = open( EEPROM_DEV, O_RDWR );
+        if ( g_fd < 0 )
         {
-            perror( "eeprom fopen" );
+            perror( "eeprom open" );
             return -1;
         }
-	g_file = f;
     }
-    if (fseek( f, addr, SEEK_SET ) != 0)
+    return 0;
+}
+
+/**
+ * Read up to 'size' bytes of data from the EEPROM starting at offset 'addr'.
+ * The at24 driver transfers at most a page of memory per call, so this takes
+ * as many calls as needed.  Returns less than 'size' only at the end of the
+ * EEPROM.
+ */
+static int eeprom_read( int addr, int size, char *pBuff )
+{
+    int done = 0;
+    ssize_t n;
+
+    if ( eeprom_open() < 0 )
     {
-        perror( "eeprom fseek" );
         return -1;
     }
 
-    n = fread( pBuff, 1, size, f );
-    return n;
+    while ( done < size )
+    {
+        n = pread( g_fd, pBuff + done, size - done, addr + done );
+        if ( n < 0 )
+        {
+            if ( errno == EINTR )
+            {
+                continue;
+            }
+            perror( "eeprom read" );
+            return -1;
+        }
+        if ( n == 0 )
+        {
+            break;
+        }
+        done += n;
+    }
+    return done;
 }
 
-static void eeprom_cache_cfg(void)
+/**
+ * Get the config image, 'iWrite' starts from a blank config if the EEPROM
+ * holds none.  Only the header is read and validated here, the sections
+ * have to be read with eeprom_load() before they are used.
+ */
+static eeprom_Error_t eeprom_image( eeprom_Cfg_t **ppEe, int iWrite )
 {
-    int err;
-
-    free(g_cached_cfg);
-    g_cached_cfg = malloc(sizeof(*g_cached_cfg));
+    eeprom_Cfg_t *ee = g_cached_cfg;
 
-    if (!g_cached_cfg)
-        return;
+    if ( !ee )
+    {
+        ee = malloc( sizeof(*ee) );
+        if ( !ee )
+        {
+            return EEPROM_ERR_DEVICE;
+        }
+        memset( g_au8Loaded, 0, sizeof(g_au8Loaded) );
+        memset( g_au8Dirty, 0, sizeof(g_au8Dirty) );
+        g_cached_cfg = ee;
+    }
 
-    err = eeprom_read( EEPROM_CFG_START_ADDR, sizeof(*g_cached_cfg), (char *) g_cached_cfg );
-    if ( err != sizeof(*g_cached_cfg) )
+    if ( eeprom_load( &ee->hdr, sizeof(ee->hdr) ) != 0 )
     {
-        PERROR( "Error while reading the EEPROM content (%d)\n", err );
-        goto error;
+        PERROR( "Error while reading the EEPROM header\n" );
+        return EEPROM_ERR_DEVICE;
     }
 
-    if ( g_cached_cfg->hdr.u32MagicId != EEPROM_CFG_MAGIC_ID )
+    if ( ee->hdr.u32MagicId != EEPROM_CFG_MAGIC_ID )
     {
-        PERROR( "Invalid EEPROM format\n" );
-        goto error;
+        if ( !iWrite )
+        {
+            PERROR( "Invalid EEPROM format\n" );
+            return EEPROM_ERR_INVALID;
+        }
+        eeprom_blank( ee );
     }
 
-    return;
+    *ppEe = ee;
+    return EEPROM_SUCCESS;
+}
 
-error:
-    free(g_cached_cfg);
-    g_cached_cfg = NULL;
+/**
+ * Replace the image by an empty V2 config, all of it to be written back.
+ */
+static void eeprom_blank( eeprom_Cfg_t *ee )
+{
+    memset( ee, 0xFF, sizeof(*ee) );
+    ee->hdr.u32MagicId = EEPROM_CFG_MAGIC_ID;
+    ee->hdr.u16Version = EEPROM_HDR_V2;
+
+    memset( g_au8Loaded, 1, sizeof(g_au8Loaded) );
+    eeprom_dirty( ee, sizeof(ee->hdr) + sizeof(ee->cfg.v2) );
+    eeprom_drop_expanded();
 }
 
-static eeprom_Cfg_t *eeprom_cached_config(void)
+/**
+ * Make sure the part of the image at 'pData' has been read from the EEPROM.
+ * Blocks not read yet are read with one access per run of blocks.
+ */
+static int eeprom_load( const void *pData, int size )
 {
-    if (!g_cached_cfg)
-        eeprom_cache_cfg();
-    return g_cached_cfg;
+    int ofs = (const uint8_t *)pData - (const uint8_t *)g_cached_cfg;
+    int blk = ofs / EEPROM_BLK_SIZE;
+    int end = (ofs + size + EEPROM_BLK_SIZE - 1) / EEPROM_BLK_SIZE;
+    int first;
+    int len;
+
+    while ( blk < end )
+    {
+        if ( g_au8Loaded[blk] )
+        {
+            blk++;
+            continue;
+        }
+
+        first = blk;
+        while ( blk < end && !g_au8Loaded[blk] )
+        {
+            blk++;
+        }
+
+        len = (blk - first) * EEPROM_BLK_SIZE;
+        if ( first * EEPROM_BLK_SIZE + len > (int)sizeof(eeprom_Cfg_t) )
+        {
+            len = sizeof(eeprom_Cfg_t) - first * EEPROM_BLK_SIZE;
+        }
+
+        if ( eeprom_read( EEPROM_CFG_START_ADDR + first * EEPROM_BLK_SIZE, len,
+                          (char *)g_cached_cfg + first * EEPROM_BLK_SIZE ) != len )
+        {
+            return -1;
+        }
+        memset( &g_au8Loaded[first], 1, blk - first );
+    }
+    return 0;
 }
-    
+
 /**
- * Write up to 'size' bytes of data to the EEPROM starting at offset 'addr'.
+ * Mark the part of the image at 'pData' as changed, it has to be loaded.
  */
-static int eeprom_write( int addr, int size, const char *pBuff )
+static void eeprom_dirty( const void *pData, int size )
 {
-    FILE *f = g_file;
-    int n;
+    int ofs = (const uint8_t *)pData - (const uint8_t *)g_cached_cfg;
+    int blk = ofs / EEPROM_BLK_SIZE;
+    int end = (ofs + size + EEPROM_BLK_SIZE - 1) / EEPROM_BLK_SIZE;
+
+    memset( &g_au8Dirty[blk], 1, end - blk );
+}
+
+/**
+ * Write the changed blocks of the image back to the EEPROM.  After a failed
+ * write the content of the EEPROM is unknown, the image is dropped then.
+ */
+static int eeprom_flush( void )
+{
+    int blk = 0;
+    int first;
+    int len;
+
+    while ( blk < EEPROM_NUM_BLKS )
+    {
+        if ( !g_au8Dirty[blk] )
+        {
+            blk++;
+            continue;
+        }
+
+        first = blk;
+        while ( blk < EEPROM_NUM_BLKS && g_au8Dirty[blk] )
+        {
+            blk++;
+        }
 
-    if (!f) {
-        f = fopen( EEPROM_DEV, "r+" );
-        if ( f == NULL )
+        len = (blk - first) * EEPROM_BLK_SIZE;
+        if ( first * EEPROM_BLK_SIZE + len > (int)sizeof(eeprom_Cfg_t) )
         {
-            perror( "eeprom fopen" );
+            len = sizeof(eeprom_Cfg_t) - first * EEPROM_BLK_SIZE;
+        }
+
+        if ( eeprom_write( EEPROM_CFG_START_ADDR + first * EEPROM_BLK_SIZE, len,
+                           (const char *)g_cached_cfg + first * EEPROM_BLK_SIZE ) != len )
+        {
+            eeprom_free_resources();
             return -1;
         }
-	g_file = f;
+        memset( &g_au8Dirty[first], 0, blk - first );
     }
-    if (fseek( f, addr, SEEK_SET ) != 0)
+    return 0;
+}
+
+/**
+ * Forget the expanded calibration tables.
+ */
+static void eeprom_drop_expanded( void )
+{
+    int i;
+
+    for ( i = 0; i < 4; i++ )
     {
-        perror( "eeprom fseek" );
-        n = -1;
-        goto error;
+        free( g_pTxCal[i] );
+        g_pTxCal[i] = NULL;
+        free( g_pRxCal[i][0] );
+        g_pRxCal[i][0] = NULL;
+        free( g_pRxCal[i][1] );
+        g_pRxCal[i][1] = NULL;
     }
+}
+    
+/**
+ * Write up to 'size' bytes of data to the EEPROM starting at offset 'addr',
+ * in as many calls as the driver needs, see eeprom_read().
+ */
+static int eeprom_write( int addr, int size, const char *pBuff )
+{
+    int done = 0;
+    ssize_t n;
 
-    n = fwrite( pBuff, 1, size, f );
+    if ( eeprom_open() < 0 )
+    {
+        return -1;
+    }
 
-error:
-    fclose( f );
-    g_file = NULL;
-    return n;
+    while ( done < size )
+    {
+        n = pwrite( g_fd, pBuff + done, size - done, addr + done );
+        if ( n < 0 )
+        {
+            if ( errno == EINTR )
+            {
+                continue;
+            }
+            perror( "eeprom write" );
+            return -1;
+        }
+        if ( n == 0 )
+        {
+            break;
+        }
+        done += n;
+    }
+    return done;
 }
 
 
 /**
- * EEPROM CRC.
+ * EEPROM CRC, CRC-16/X.25 (reflected polynomial 0x8408), one table lookup
+ * per byte instead of eight shifts.
  */
 static uint16_t eeprom_crc( uint8_t *pu8Data, int len )
 {
-    int i;
+    static uint16_t au16Table[256];
+    static int iInit;
     uint16_t crc = 0xFFFF;
+    int i, j;
 
-    while (len--) {
-        crc ^= (uint16_t)*pu8Data++;
-
-        for (i=0; i<8; i++) {
-            if (crc & 1) crc = (crc >> 1) ^ 0x8408;
-            else         crc = (crc >> 1);
+    if ( !iInit )
+    {
+        for ( i = 0; i < 256; i++ )
+        {
+            crc = i;
+            for ( j = 0; j < 8; j++ )
+            {
+                if (crc & 1) crc = (crc >> 1) ^ 0x8408;
+                else         crc = (crc >> 1);
+            }
+            au16Table[i] = crc;
         }
+        iInit = 1;
+        crc = 0xFFFF;
+    }
+
+    while (len--) {
+        crc = (crc >> 8) ^ au16Table[(crc ^ *pu8Data++) & 0xFF];
     }
 
     crc = ~crc;
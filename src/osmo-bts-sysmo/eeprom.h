@@ -299,6 +299,32 @@ eeprom_Error_t eeprom_ReadRxCal( int iBand, int iUplink, eeprom_RxCal_t *pRxCal
  ****************************************************************************/
 eeprom_Error_t eeprom_WriteRxCal( int iBand, int iUplink, const eeprom_RxCal_t *pRxCal );
 
+/****************************************************************************
+ * Function : eeprom_ReadCalStamp
+ ************************************************************************//**
+ *
+ * This function reads only the section header (ID, CRC, time) of a TX or
+ * RX calibration table, which identifies the content of the table without
+ * reading and expanding all of it.
+ *
+ * @param [in] iBand
+ *    GSM band (0:GSM-850, 1:GSM-900, 2:DCS-1800, 3:PCS-1900).
+ *
+ * @param [in] iRx
+ *    Table flag (0:TX table, X:RX table).
+ *
+ * @param [in] iUplink
+ *    Uplink flag of a RX table (0:downlink, X:uplink).
+ *
+ * @param [inout] pu64Stamp
+ *    Section ID, CRC and time of the table.
+ *
+ * @return
+ *    0 if or an error core.
+ *
+ ****************************************************************************/
+eeprom_Error_t eeprom_ReadCalStamp( int iBand, int iRx, int iUplink, uint64_t *pu64Stamp );
+
 void eeprom_free_resources(void);
 
 #endif  // EEPROM_H__
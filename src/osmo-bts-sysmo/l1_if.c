@@ -51,6 +51,8 @@
 #include <osmo-bts/l1sap.h>
 #include <osmo-bts/msg_utils.h>
 #include <osmo-bts/dtx_dl_amr_fsm.h>
+#include <osmo-bts/hotlog.h>
+#include <osmo-bts/bringup.h>
 
 #include <sysmocom/femtobts/superfemto.h>
 #include <sysmocom/femtobts/gsml1prim.h>
@@ -201,7 +203,7 @@ static int _l1if_req_compl(struct femtol1_hdl *fl1h, struct msgb *msg,
 			is_system_prim ? "system primitive" : "gsm");
 		msgb_free(msg);
 	}
-	llist_add(&wlc->list, &fl1h->wlc_list);
+	llist_add_tail(&wlc->list, &fl1h->wlc_list);
 
 	/* schedule a timer for timeout_secs seconds. If DSP fails to respond, we terminate */
 	wlc->timer.data = wlc;
@@ -354,7 +356,7 @@ static int ph_data_req(struct gsm_bts_trx *trx, struct msgb *msg,
 	if (L1SAP_IS_LINK_SACCH(link_id)) {
 		sapi = GsmL1_Sapi_Sacch;
 		if (!L1SAP_IS_CHAN_TCHF(chan_nr))
-			subCh = l1sap_chan2ss(chan_nr);
+			subCh = trx_chan_nr_map(trx, chan_nr)->ss;
 	} else if (L1SAP_IS_CHAN_TCHF(chan_nr)) {
 		if (ts_is_pdch(&trx->ts[u8Tn])) {
 			if (L1SAP_IS_PTCCH(u32Fn)) {
@@ -943,10 +945,8 @@ static int handle_ph_data_ind(struct femtol1_hdl *fl1, GsmL1_PhDataInd_t *data_i
 	/* check for TCH */
 	if (data_ind->sapi == GsmL1_Sapi_TchF
 	 || data_ind->sapi == GsmL1_Sapi_TchH) {
-		/* TCH speech frame handling */
-		rc = l1if_tch_rx(trx, chan_nr, l1p_msg);
-		msgb_free(l1p_msg);
-		return rc;
+		/* TCH speech frame handling, consumes l1p_msg */
+		return l1if_tch_rx(trx, chan_nr, l1p_msg);
 	}
 
 	/* fill L1SAP header */
@@ -1123,8 +1123,10 @@ int l1if_handle_l1prim(int wq, struct femtol1_hdl *fl1h, struct msgb *msg)
 		/* silent, don't clog the log file */
 		break;
 	default:
-		LOGP(DL1P, LOGL_DEBUG, "Rx L1 prim %s on queue %d\n",
-			get_value_string(femtobts_l1prim_names, l1p->id), wq);
+		HOTTRACE(DL1P, LOGL_DEBUG, "Rx L1 prim %u on queue %d\n",
+			 l1p->id, wq, 0, 0);
+		LOGP_HOT(DL1P, LOGL_DEBUG, "Rx L1 prim %s on queue %d\n",
+			 get_value_string(femtobts_l1prim_names, l1p->id), wq);
 	}
 
 	/* check if this is a resposne to a sync-waiting request */
@@ -1409,6 +1411,8 @@ static int info_compl_cb(struct gsm_bts_trx *trx, struct msgb *resp,
 	struct femtol1_hdl *fl1h = trx_femtol1_hdl(trx);
 	int rc;
 
+	bringup_end("l1_info", trx->nr, -1);
+
 	fl1h->hw_info.dsp_version[0] = sic->dspVersion.major;
 	fl1h->hw_info.dsp_version[1] = sic->dspVersion.minor;
 	fl1h->hw_info.dsp_version[2] = sic->dspVersion.build;
@@ -1470,6 +1474,7 @@ static int l1if_get_info(struct femtol1_hdl *hdl)
 
 	sysp->id = SuperFemto_PrimId_SystemInfoReq;
 
+	bringup_begin("l1_info", hdl->phy_inst->trx->nr, -1);
 	return l1if_req_compl(hdl, msg, info_compl_cb, NULL);
 }
 
@@ -1480,6 +1485,8 @@ static int reset_compl_cb(struct gsm_bts_trx *trx, struct msgb *resp,
 	SuperFemto_Prim_t *sysp = msgb_sysprim(resp);
 	GsmL1_Status_t status = sysp->u.layer1ResetCnf.status;
 
+	bringup_end("l1_reset", trx->nr, -1);
+
 	LOGP(DL1C, LOGL_NOTICE, "Rx L1-RESET.conf (status=%s)\n",
 		get_value_string(femtobts_l1status_names, status));
 
@@ -1508,6 +1515,7 @@ int l1if_reset(struct femtol1_hdl *hdl)
 	SuperFemto_Prim_t *sysp = msgb_sysprim(msg);
 	sysp->id = SuperFemto_PrimId_Layer1ResetReq;
 
+	bringup_begin("l1_reset", hdl->phy_inst->trx->nr, -1);
 	return l1if_req_compl(hdl, msg, reset_compl_cb, NULL);
 }
 
@@ -1810,6 +1818,7 @@ int bts_model_phy_link_open(struct phy_link *plink)
 		}
 		bts->c0->nominal_power = rc;
 		bts->c0->power_params.trx_p_max_out_mdBm = to_mdB(rc);
+		power_tables_update(bts->c0);
 	}
 
 	phy_link_state_set(plink, PHY_LINK_CONNECTED);
@@ -12,6 +12,7 @@
 #include <sysmocom/femtobts/gsml1prim.h>
 
 #include <stdbool.h>
+#include <time.h>
 
 enum {
 	MQ_SYS_READ,
@@ -33,9 +34,19 @@ enum {
 	_NUM_MQ_WRITE
 };
 
+struct calib_table;
+
 struct calib_send_state {
 	const char *path;
-	int last_file_idx;
+	/* tables read for all supported bands, see calib_file.c */
+	struct calib_table *tables;
+	unsigned int num_tables;
+	unsigned int num_cached;	/* of which taken from the cache */
+	bool cache_dirty;		/* some were read from the source */
+	unsigned int next_send;		/* next table to send to the DSP */
+	unsigned int next_conf;		/* next table to be confirmed */
+	struct timespec t_start;
+	unsigned long read_ms;		/* time spent reading the tables */
 };
 
 enum {
@@ -109,10 +120,17 @@ uint32_t l1if_lchan_to_hLayer(struct gsm_lchan *lchan);
 struct gsm_lchan *l1if_hLayer_to_lchan(struct gsm_bts_trx *trx, uint32_t hLayer);
 
 /* tch.c */
+
+/* size of the buffer for one uplink RTP payload, AMR 12.2 being the largest */
+#define TCH_RTP_PL_MAX	64
+
 int l1if_tch_encode(struct gsm_lchan *lchan, uint8_t *data, uint8_t *len,
 		    const uint8_t *rtp_pl, unsigned int rtp_pl_len, uint32_t fn,
 		    bool use_cache, bool marker);
 int l1if_tch_rx(struct gsm_bts_trx *trx, uint8_t chan_nr, struct msgb *l1p_msg);
+int l1if_tch_ul_to_rtp(struct gsm_lchan *lchan, uint8_t payload_type,
+		       uint8_t *l1_payload, uint8_t payload_len,
+		       uint8_t *rtp_pl);
 int l1if_tch_fill(struct gsm_lchan *lchan, uint8_t *l1_buffer);
 struct msgb *gen_empty_tch_msg(struct gsm_lchan *lchan, uint32_t fn);
 
@@ -7,6 +7,8 @@
 #include <osmocom/core/select.h>
 #include <osmocom/core/timer.h>
 
+#include <osmo-bts/hwmon.h>
+
 #include <gps.h>
 
 #include <stdint.h>
@@ -55,6 +57,18 @@ struct sysmobts_temp_limit {
 	int thresh_crit;
 };
 
+/* temperatures kept in the history */
+enum sysmobts_mgr_temp_sensor {
+	MGR_TEMP_DIGITAL,
+	MGR_TEMP_RF,
+	MGR_TEMP_BOARD,		/* sysmoBTS 2050 only */
+	MGR_TEMP_PA,		/* sysmoBTS 2050 only */
+	_NUM_MGR_TEMP
+};
+
+/* number of temperature checks kept per sensor */
+#define TEMP_HIST_LEN		64
+
 enum mgr_vty_node {
 	MGR_NODE = _LAST_OSMOVTY_NODE + 1,
 
@@ -83,6 +97,9 @@ struct sysmobts_mgr_instance {
 
 	enum sysmobts_temp_state state;
 
+	struct hwmon_interval temp_interval;
+	struct hwmon_hist temp_hist[_NUM_MGR_TEMP];
+
 	struct {
 		int initial_calib_started;
 		int is_up;
@@ -110,6 +127,7 @@ int sysmobts_mgr_parse_config(struct sysmobts_mgr_instance *mgr);
 int sysmobts_mgr_nl_init(void);
 int sysmobts_mgr_temp_init(struct sysmobts_mgr_instance *mgr);
 const char *sysmobts_mgr_temp_get_state(enum sysmobts_temp_state state);
+const char *sysmobts_mgr_temp_get_name(enum sysmobts_mgr_temp_sensor sensor);
 
 
 int sysmobts_mgr_calib_init(struct sysmobts_mgr_instance *mgr);
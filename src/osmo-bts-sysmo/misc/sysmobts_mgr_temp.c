@@ -20,16 +20,28 @@
  *
  */
 
+#include <stdint.h>
+#include <time.h>
+
 #include "misc/sysmobts_mgr.h"
 #include "misc/sysmobts_misc.h"
 
 #include <osmo-bts/logging.h>
+#include <osmo-bts/hwmon.h>
 
 #include <osmocom/core/timer.h>
 #include <osmocom/core/utils.h>
 
+/* check interval in seconds, see hwmon_interval_next() */
+#define TEMP_CHECK_MIN		10
+#define TEMP_CHECK_MAX		(2 * 60)
+/* degrees below a warning limit that count as near the limit */
+#define TEMP_NEAR_MARGIN	5
+
 static struct sysmobts_mgr_instance *s_mgr;
 static struct osmo_timer_list temp_ctrl_timer;
+/* max and crit alarm of the digital and the RF sensor */
+static struct hwmon_alarm temp_alarms[4];
 
 static const struct value_string state_names[] = {
 	{ STATE_NORMAL,			"NORMAL" },
@@ -213,11 +225,42 @@ static void sysmobts_mgr_temp_handle(struct sysmobts_mgr_instance *manager,
 	};
 } 
 
-static void temp_ctrl_check()
+static const struct value_string temp_names[] = {
+	{ MGR_TEMP_DIGITAL,	"Digital" },
+	{ MGR_TEMP_RF,		"RF" },
+	{ MGR_TEMP_BOARD,	"sysmoBTS 2050 board" },
+	{ MGR_TEMP_PA,		"sysmoBTS 2050 PA" },
+	{ 0, NULL }
+};
+
+const char *sysmobts_mgr_temp_get_name(enum sysmobts_mgr_temp_sensor sensor)
+{
+	return get_value_string(temp_names, sensor);
+}
+
+/* account for one temperature in degrees, returns 1 if it is near or
+ * above the warning limit */
+static int temp_ctrl_account(enum sysmobts_mgr_temp_sensor sensor, time_t now,
+			     int temp, const struct sysmobts_temp_limit *limit,
+			     int *warn_thresh_passed, int *crit_thresh_passed)
 {
+	hwmon_hist_add(&s_mgr->temp_hist[sensor], now, temp * 1000);
+
+	if (temp > limit->thresh_warn)
+		*warn_thresh_passed = 1;
+	if (temp > limit->thresh_crit)
+		*crit_thresh_passed = 1;
+	return temp > limit->thresh_warn - TEMP_NEAR_MARGIN;
+}
+
+/* returns 1 if a temperature is near or above its warning limit */
+static int temp_ctrl_check(void)
+{
+	time_t now = time(NULL);
 	int rc;
 	int warn_thresh_passed = 0;
 	int crit_thresh_passed = 0;
+	int near = 0;
 
 	LOGP(DTEMP, LOGL_DEBUG, "Going to check the temperature.\n");
 
@@ -229,10 +272,10 @@ static void temp_ctrl_check()
 		warn_thresh_passed = crit_thresh_passed = 1;
 	} else {
 		int temp = rc / 1000;
-		if (temp > s_mgr->digital_limit.thresh_warn)
-			warn_thresh_passed = 1;
-		if (temp > s_mgr->digital_limit.thresh_crit)
-			crit_thresh_passed = 1;
+		near |= temp_ctrl_account(MGR_TEMP_DIGITAL, now, temp,
+					  &s_mgr->digital_limit,
+					  &warn_thresh_passed,
+					  &crit_thresh_passed);
 		LOGP(DTEMP, LOGL_DEBUG, "Digital temperature is: %d\n", temp);
 	}
 
@@ -244,10 +287,10 @@ static void temp_ctrl_check()
 		warn_thresh_passed = crit_thresh_passed = 1;
 	} else {
 		int temp = rc / 1000;
-		if (temp > s_mgr->rf_limit.thresh_warn)
-			warn_thresh_passed = 1;
-		if (temp > s_mgr->rf_limit.thresh_crit)
-			crit_thresh_passed = 1;
+		near |= temp_ctrl_account(MGR_TEMP_RF, now, temp,
+					  &s_mgr->rf_limit,
+					  &warn_thresh_passed,
+					  &crit_thresh_passed);
 		LOGP(DTEMP, LOGL_DEBUG, "RF temperature is: %d\n", temp);
 	}
 
@@ -264,30 +307,76 @@ static void temp_ctrl_check()
 		} else {
 			LOGP(DTEMP, LOGL_DEBUG, "SBTS2050 board(%d) PA(%d)\n",
 				temp_board, temp_pa);
-			if (temp_pa > s_mgr->pa_limit.thresh_warn)
-				warn_thresh_passed = 1;
-			if (temp_pa > s_mgr->pa_limit.thresh_crit)
-				crit_thresh_passed = 1;
-			if (temp_board > s_mgr->board_limit.thresh_warn)
-				warn_thresh_passed = 1;
-			if (temp_board > s_mgr->board_limit.thresh_crit)
-				crit_thresh_passed = 1;
+			near |= temp_ctrl_account(MGR_TEMP_PA, now, temp_pa,
+						  &s_mgr->pa_limit,
+						  &warn_thresh_passed,
+						  &crit_thresh_passed);
+			near |= temp_ctrl_account(MGR_TEMP_BOARD, now,
+						  temp_board,
+						  &s_mgr->board_limit,
+						  &warn_thresh_passed,
+						  &crit_thresh_passed);
 		}
 	}
 
-	sysmobts_mgr_temp_handle(s_mgr, crit_thresh_passed, warn_thresh_passed);	
+	sysmobts_mgr_temp_handle(s_mgr, crit_thresh_passed, warn_thresh_passed);
+
+	return near || warn_thresh_passed || s_mgr->state != STATE_NORMAL;
 }
 
 static void temp_ctrl_check_cb(void *unused)
 {
-	temp_ctrl_check();
-	/* Check every two minutes? XXX make it configurable! */
-	osmo_timer_schedule(&temp_ctrl_timer, 2 * 60, 0);
+	unsigned int interval;
+
+	interval = hwmon_interval_next(&s_mgr->temp_interval,
+				       temp_ctrl_check());
+	osmo_timer_schedule(&temp_ctrl_timer, interval, 0);
+}
+
+/* the driver raised or cleared an alarm, check right away */
+static void temp_alarm_cb(struct hwmon_alarm *alarm, int val)
+{
+	LOGP(DTEMP, LOGL_NOTICE, "%s temperature alarm %s.\n",
+		sysmobts_mgr_temp_get_name((intptr_t) alarm->data),
+		val ? "raised" : "cleared");
+
+	osmo_timer_del(&temp_ctrl_timer);
+	temp_ctrl_check_cb(NULL);
+}
+
+static void temp_alarm_open(struct hwmon_alarm *alarm,
+			    enum sysmobts_temp_sensor sensor,
+			    enum sysmobts_temp_type type,
+			    enum sysmobts_mgr_temp_sensor name)
+{
+	if (sysmobts_temp_alarm_open(alarm, sensor, type, temp_alarm_cb,
+				     (void *) (intptr_t) name) < 0)
+		LOGP(DTEMP, LOGL_INFO, "No %s temperature alarm, "
+			"relying on the periodic check.\n",
+			sysmobts_mgr_temp_get_name(name));
 }
 
 int sysmobts_mgr_temp_init(struct sysmobts_mgr_instance *mgr)
 {
+	int i;
+
 	s_mgr = mgr;
+
+	for (i = 0; i < _NUM_MGR_TEMP; i++)
+		hwmon_hist_init(tall_mgr_ctx, &s_mgr->temp_hist[i],
+				TEMP_HIST_LEN);
+	s_mgr->temp_interval.min = TEMP_CHECK_MIN;
+	s_mgr->temp_interval.max = TEMP_CHECK_MAX;
+
+	temp_alarm_open(&temp_alarms[0], SYSMOBTS_TEMP_DIGITAL,
+			SYSMOBTS_TEMP_MAX_ALARM, MGR_TEMP_DIGITAL);
+	temp_alarm_open(&temp_alarms[1], SYSMOBTS_TEMP_DIGITAL,
+			SYSMOBTS_TEMP_CRIT_ALARM, MGR_TEMP_DIGITAL);
+	temp_alarm_open(&temp_alarms[2], SYSMOBTS_TEMP_RF,
+			SYSMOBTS_TEMP_MAX_ALARM, MGR_TEMP_RF);
+	temp_alarm_open(&temp_alarms[3], SYSMOBTS_TEMP_RF,
+			SYSMOBTS_TEMP_CRIT_ALARM, MGR_TEMP_RF);
+
 	temp_ctrl_timer.cb = temp_ctrl_check_cb;
 	temp_ctrl_check_cb(NULL);
 	return 0;
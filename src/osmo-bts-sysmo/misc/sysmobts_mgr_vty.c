@@ -25,6 +25,7 @@
 #include <stdint.h>
 #include <ctype.h>
 #include <string.h>
+#include <time.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
@@ -424,6 +425,37 @@ DEFUN(show_mgr, show_mgr_cmd, "show manager",
 	return CMD_SUCCESS;
 }
 
+DEFUN(show_temp_hist, show_temp_hist_cmd, "show temperature history",
+      SHOW_STR "Display temperature information\n"
+      "Values of the last temperature checks\n")
+{
+	int i, j;
+
+	vty_out(vty, "Check interval: %u seconds%s",
+		s_mgr->temp_interval.cur, VTY_NEWLINE);
+
+	for (i = 0; i < _NUM_MGR_TEMP; i++) {
+		const struct hwmon_hist *hist = &s_mgr->temp_hist[i];
+		const struct hwmon_sample *sample;
+
+		if (!hist->num)
+			continue;
+
+		vty_out(vty, "%s:%s", sysmobts_mgr_temp_get_name(i),
+			VTY_NEWLINE);
+		for (j = 0; (sample = hwmon_hist_get(hist, j)); j++) {
+			char buf[16];
+
+			strftime(buf, sizeof(buf), "%H:%M:%S",
+				 localtime(&sample->time));
+			vty_out(vty, " %s %f Celcius%s", buf,
+				sample->val / 1000.0f, VTY_NEWLINE);
+		}
+	}
+
+	return CMD_SUCCESS;
+}
+
 DEFUN(calibrate_trx, calibrate_trx_cmd,
       "trx 0 calibrate-clock",
       "Transceiver commands\n" "Transceiver 0\n"
@@ -475,6 +507,7 @@ int sysmobts_mgr_vty_init(void)
 	vty_init(&vty_info);
 
 	install_element_ve(&show_mgr_cmd);
+	install_element_ve(&show_temp_hist_cmd);
 
 	install_element(ENABLE_NODE, &calibrate_trx_cmd);
 
@@ -37,6 +37,8 @@
 #include <osmocom/vty/telnet_interface.h>
 #include <osmocom/vty/logging.h>
 
+#include <osmo-bts/hwmon.h>
+
 #include "btsconfig.h"
 #include "sysmobts_misc.h"
 #include "sysmobts_par.h"
@@ -52,14 +54,20 @@ static const char *temp_type_str[_NUM_TEMP_TYPES] = {
 	[SYSMOBTS_TEMP_INPUT] = "input",
 	[SYSMOBTS_TEMP_LOWEST] = "lowest",
 	[SYSMOBTS_TEMP_HIGHEST] = "highest",
+	[SYSMOBTS_TEMP_MAX_ALARM] = "max_alarm",
+	[SYSMOBTS_TEMP_CRIT_ALARM] = "crit_alarm",
+};
+
+/* kept open, see hwmon_read_int() */
+static int temp_fds[SYSMOBTS_TEMP_RF + 1][_NUM_TEMP_TYPES] = {
+	[0 ... SYSMOBTS_TEMP_RF] = { [0 ... _NUM_TEMP_TYPES-1] = -1 }
 };
 
 int sysmobts_temp_get(enum sysmobts_temp_sensor sensor,
 		      enum sysmobts_temp_type type)
 {
 	char buf[PATH_MAX];
-	char tempstr[8];
-	int fd, rc;
+	int temp, rc;
 
 	if (sensor < SYSMOBTS_TEMP_DIGITAL ||
 	    sensor > SYSMOBTS_TEMP_RF)
@@ -71,24 +79,32 @@ int sysmobts_temp_get(enum sysmobts_temp_sensor sensor,
 	snprintf(buf, sizeof(buf)-1, TEMP_PATH, sensor, temp_type_str[type]);
 	buf[sizeof(buf)-1] = '\0';
 
-	fd = open(buf, O_RDONLY);
-	if (fd < 0)
-		return fd;
-
-	rc = read(fd, tempstr, sizeof(tempstr));
-	tempstr[sizeof(tempstr)-1] = '\0';
-	if (rc < 0) {
-		close(fd);
+	rc = hwmon_read_int(&temp_fds[sensor][type], buf, &temp);
+	if (rc < 0)
 		return rc;
-	}
-	if (rc == 0) {
-		close(fd);
-		return -EIO;
-	}
 
-	close(fd);
+	return temp;
+}
+
+int sysmobts_temp_alarm_open(struct hwmon_alarm *alarm,
+			     enum sysmobts_temp_sensor sensor,
+			     enum sysmobts_temp_type type,
+			     hwmon_alarm_cb *cb, void *data)
+{
+	char buf[PATH_MAX];
+
+	if (sensor < SYSMOBTS_TEMP_DIGITAL ||
+	    sensor > SYSMOBTS_TEMP_RF)
+		return -EINVAL;
+
+	if (type != SYSMOBTS_TEMP_MAX_ALARM &&
+	    type != SYSMOBTS_TEMP_CRIT_ALARM)
+		return -EINVAL;
+
+	snprintf(buf, sizeof(buf)-1, TEMP_PATH, sensor, temp_type_str[type]);
+	buf[sizeof(buf)-1] = '\0';
 
-	return atoi(tempstr);
+	return hwmon_alarm_open(alarm, buf, cb, data);
 }
 
 static const struct {
@@ -12,11 +12,21 @@ enum sysmobts_temp_type {
 	SYSMOBTS_TEMP_INPUT,
 	SYSMOBTS_TEMP_LOWEST,
 	SYSMOBTS_TEMP_HIGHEST,
+	SYSMOBTS_TEMP_MAX_ALARM,
+	SYSMOBTS_TEMP_CRIT_ALARM,
 	_NUM_TEMP_TYPES
 };
 
+struct hwmon_alarm;
+
 int sysmobts_temp_get(enum sysmobts_temp_sensor sensor,
 		      enum sysmobts_temp_type type);
+/* watch one of the *_ALARM attributes, fails if the driver has none */
+int sysmobts_temp_alarm_open(struct hwmon_alarm *alarm,
+			     enum sysmobts_temp_sensor sensor,
+			     enum sysmobts_temp_type type,
+			     void (*cb)(struct hwmon_alarm *alarm, int val),
+			     void *data);
 
 void sysmobts_check_temp(int no_eeprom_write);
 
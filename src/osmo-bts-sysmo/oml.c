@@ -414,7 +414,7 @@ static int trx_init(struct gsm_bts_trx *trx)
 	dev_par->u16BcchArfcn = trx->bts->c0->arfcn;
 	dev_par->u8NbTsc = trx->bts->bsic & 7;
 	dev_par->fRxPowerLevel = trx_ms_pwr_ctrl_is_osmo(trx)
-					? 0.0 : btsb->ul_power_target;
+					? 0.0 : btsb->ul_power_ctrl.target;
 
 	dev_par->fTxPowerLevel = 0.0;
 	LOGP(DL1C, LOGL_NOTICE, "Init TRX (ARFCN %u, TSC %u, RxPower % 2f dBm, "
@@ -521,6 +521,7 @@ static int ts_opstart(struct gsm_bts_trx_ts *ts)
 	switch (pchan) {
 	case GSM_PCHAN_TCH_F_TCH_H_PDCH:
 		ts->dyn.pchan_is = ts->dyn.pchan_want = GSM_PCHAN_NONE;
+		ts_chan_nr_map_update(ts);
 		/* First connect as NONE, until first RSL CHAN ACT. */
 		pchan = GSM_PCHAN_NONE;
 		break;
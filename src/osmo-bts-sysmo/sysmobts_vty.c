@@ -147,6 +147,33 @@ DEFUN(cfg_phy_cal_path, cfg_phy_cal_path_cmd,
 	return CMD_SUCCESS;
 }
 
+DEFUN(cfg_phy_cal_cache, cfg_phy_cal_cache_cmd,
+	"trx-calibration-cache PATH",
+	"Keep the parsed TRX calibration tables in a cache file\n"
+	"File name\n")
+{
+	struct phy_instance *pinst = vty->index;
+
+	if (pinst->u.sysmobts.calib_cache)
+		talloc_free(pinst->u.sysmobts.calib_cache);
+
+	pinst->u.sysmobts.calib_cache = talloc_strdup(pinst, argv[0]);
+
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_phy_no_cal_cache, cfg_phy_no_cal_cache_cmd,
+	"no trx-calibration-cache",
+	NO_STR "Keep the parsed TRX calibration tables in a cache file\n")
+{
+	struct phy_instance *pinst = vty->index;
+
+	talloc_free(pinst->u.sysmobts.calib_cache);
+	pinst->u.sysmobts.calib_cache = NULL;
+
+	return CMD_SUCCESS;
+}
+
 DEFUN_DEPRECATED(cfg_trx_ul_power_target, cfg_trx_ul_power_target_cmd,
 	"uplink-power-target <-110-0>",
 	"Obsolete alias for bts uplink-power-target\n"
@@ -155,7 +182,7 @@ DEFUN_DEPRECATED(cfg_trx_ul_power_target, cfg_trx_ul_power_target_cmd,
 	struct gsm_bts_trx *trx = vty->index;
 	struct gsm_bts_role_bts *btsb = bts_role_bts(trx->bts);
 
-	btsb->ul_power_target = atoi(argv[0]);
+	btsb->ul_power_ctrl.target = atoi(argv[0]);
 
 	return CMD_SUCCESS;
 }
@@ -464,6 +491,9 @@ static void write_phy_inst(struct vty *vty, struct phy_instance *pinst)
 	if (pinst->u.sysmobts.calib_path)
 		vty_out(vty, "  trx-calibration-path %s%s",
 			pinst->u.sysmobts.calib_path, VTY_NEWLINE);
+	if (pinst->u.sysmobts.calib_cache)
+		vty_out(vty, "  trx-calibration-cache %s%s",
+			pinst->u.sysmobts.calib_cache, VTY_NEWLINE);
 	vty_out(vty, "  clock-source %s%s",
 		get_value_string(femtobts_clksrc_names,
 				 pinst->u.sysmobts.clk_src), VTY_NEWLINE);
@@ -540,6 +570,8 @@ int bts_model_vty_init(struct gsm_bts *bts)
 	install_element(PHY_INST_NODE, &cfg_phy_clkcal_def_cmd);
 	install_element(PHY_INST_NODE, &cfg_phy_clksrc_cmd);
 	install_element(PHY_INST_NODE, &cfg_phy_cal_path_cmd);
+	install_element(PHY_INST_NODE, &cfg_phy_cal_cache_cmd);
+	install_element(PHY_INST_NODE, &cfg_phy_no_cal_cache_cmd);
 
 	return 0;
 }
@@ -52,35 +52,31 @@
 #include "femtobts.h"
 #include "l1_if.h"
 
-static struct msgb *l1_to_rtppayload_fr(uint8_t *l1_payload, uint8_t payload_len,
-					struct gsm_lchan *lchan)
+/*! \brief convert GSM-FR from L1 format to RTP payload
+ *  \param[out] rtp_pl RTP payload buffer (TCH_RTP_PL_MAX bytes)
+ *  \param[in] l1_payload payload part of L1 buffer (modified in place)
+ *  \param[in] payload_len length of \a l1_payload
+ *  \returns number of \a rtp_pl bytes filled
+ */
+static int l1_to_rtppayload_fr(uint8_t *rtp_pl, uint8_t *l1_payload,
+			       uint8_t payload_len, struct gsm_lchan *lchan)
 {
-	struct msgb *msg;
-	uint8_t *cur;
-
-	msg = msgb_alloc_headroom(1024, 128, "L1C-to-RTP");
-	if (!msg)
-		return NULL;
-
 #ifdef USE_L1_RTP_MODE
 	/* new L1 can deliver bits like we need them */
-	cur = msgb_put(msg, GSM_FR_BYTES);
-	memcpy(cur, l1_payload, GSM_FR_BYTES);
+	memcpy(rtp_pl, l1_payload, GSM_FR_BYTES);
 #else
 	/* step1: reverse the bit-order of each payload byte */
 	osmo_revbytebits_buf(l1_payload, payload_len);
 
-	cur = msgb_put(msg, GSM_FR_BYTES);
-
 	/* step2: we need to shift the entire L1 payload by 4 bits right */
-	osmo_nibble_shift_right(cur, l1_payload, GSM_FR_BITS/4);
+	osmo_nibble_shift_right(rtp_pl, l1_payload, GSM_FR_BITS/4);
 
-	cur[0] |= 0xD0;
+	rtp_pl[0] |= 0xD0;
 #endif /* USE_L1_RTP_MODE */
 
 	lchan_set_marker(osmo_fr_check_sid(l1_payload, payload_len), lchan);
 
-	return msg;
+	return GSM_FR_BYTES;
 }
 
 /*! \brief convert GSM-FR from RTP payload to L1 format
@@ -106,40 +102,30 @@ static int rtppayload_to_l1_fr(uint8_t *l1_payload, const uint8_t *rtp_payload,
 }
 
 #if defined(L1_HAS_EFR) && defined(USE_L1_RTP_MODE)
-static struct msgb *l1_to_rtppayload_efr(uint8_t *l1_payload,
-					 uint8_t payload_len,
-					 struct gsm_lchan *lchan)
+static int l1_to_rtppayload_efr(uint8_t *rtp_pl, uint8_t *l1_payload,
+				uint8_t payload_len, struct gsm_lchan *lchan)
 {
-	struct msgb *msg;
-	uint8_t *cur;
-
-	msg = msgb_alloc_headroom(1024, 128, "L1C-to-RTP");
-	if (!msg)
-		return NULL;
+	enum osmo_amr_type ft;
+	enum osmo_amr_quality bfi;
+	uint8_t cmr;
+	int8_t sti, cmi;
 
 #ifdef USE_L1_RTP_MODE
 	/* new L1 can deliver bits like we need them */
-	cur = msgb_put(msg, GSM_EFR_BYTES);
-	memcpy(cur, l1_payload, GSM_EFR_BYTES);
+	memcpy(rtp_pl, l1_payload, GSM_EFR_BYTES);
 #else
 	/* step1: reverse the bit-order of each payload byte */
 	osmo_revbytebits_buf(l1_payload, payload_len);
 
-	cur = msgb_put(msg, GSM_EFR_BYTES);
-
 	/* step 2: we need to shift the entire L1 payload by 4 bits right */
-	osmo_nibble_shift_right(cur, l1_payload, GSM_EFR_BITS/4);
+	osmo_nibble_shift_right(rtp_pl, l1_payload, GSM_EFR_BITS/4);
 
-	cur[0] |= 0xC0;
+	rtp_pl[0] |= 0xC0;
 #endif /* USE_L1_RTP_MODE */
-	enum osmo_amr_type ft;
-	enum osmo_amr_quality bfi;
-	uint8_t cmr;
-	int8_t sti, cmi;
 	osmo_amr_rtp_dec(l1_payload, payload_len, &cmr, &cmi, &ft, &bfi, &sti);
 	lchan_set_marker(ft == AMR_GSM_EFR_SID, lchan);
 
-	return msg;
+	return GSM_EFR_BYTES;
 }
 
 static int rtppayload_to_l1_efr(uint8_t *l1_payload, const uint8_t *rtp_payload,
@@ -157,33 +143,25 @@ static int rtppayload_to_l1_efr(uint8_t *l1_payload, const uint8_t *rtp_payload,
 #warning No EFR support in L1
 #endif /* L1_HAS_EFR */
 
-static struct msgb *l1_to_rtppayload_hr(uint8_t *l1_payload, uint8_t payload_len,
-					struct gsm_lchan *lchan)
+static int l1_to_rtppayload_hr(uint8_t *rtp_pl, uint8_t *l1_payload,
+			       uint8_t payload_len, struct gsm_lchan *lchan)
 {
-	struct msgb *msg;
-	uint8_t *cur;
-
-	msg = msgb_alloc_headroom(1024, 128, "L1C-to-RTP");
-	if (!msg)
-		return NULL;
-
 	if (payload_len != GSM_HR_BYTES) {
 		LOGP(DL1C, LOGL_ERROR, "L1 HR frame length %u != expected %u\n",
 			payload_len, GSM_HR_BYTES);
-		return NULL;
+		return -EINVAL;
 	}
 
-	cur = msgb_put(msg, GSM_HR_BYTES);
-	memcpy(cur, l1_payload, GSM_HR_BYTES);
+	memcpy(rtp_pl, l1_payload, GSM_HR_BYTES);
 
 #ifndef USE_L1_RTP_MODE
 	/* reverse the bit-order of each payload byte */
-	osmo_revbytebits_buf(cur, GSM_HR_BYTES);
+	osmo_revbytebits_buf(rtp_pl, GSM_HR_BYTES);
 #endif /* USE_L1_RTP_MODE */
 
 	lchan_set_marker(osmo_hr_check_sid(l1_payload, payload_len), lchan);
 
-	return msg;
+	return GSM_HR_BYTES;
 }
 
 /*! \brief convert GSM-FR from RTP payload to L1 format
@@ -212,33 +190,36 @@ static int rtppayload_to_l1_hr(uint8_t *l1_payload, const uint8_t *rtp_payload,
 	return GSM_HR_BYTES;
 }
 
-static struct msgb *l1_to_rtppayload_amr(uint8_t *l1_payload, uint8_t payload_len,
-					 struct gsm_lchan *lchan)
+static int l1_to_rtppayload_amr(uint8_t *rtp_pl, uint8_t *l1_payload,
+				uint8_t payload_len, struct gsm_lchan *lchan)
 {
 #ifndef USE_L1_RTP_MODE
 	struct amr_multirate_conf *amr_mrc = &lchan->tch.amr_mr;
 #endif
-	struct msgb *msg;
-	uint8_t amr_if2_len = payload_len - 2;
-	uint8_t *cur;
+	uint8_t amr_if2_len;
 
-	msg = msgb_alloc_headroom(1024, 128, "L1C-to-RTP");
-	if (!msg)
-		return NULL;
+	/* two bytes of L1 header, plus IF2 frame not exceeding the buffer */
+	if (payload_len < 2 || payload_len > TCH_RTP_PL_MAX) {
+		LOGP(DL1C, LOGL_ERROR, "L1 AMR frame length %u invalid\n",
+			payload_len);
+		return -EINVAL;
+	}
+	amr_if2_len = payload_len - 2;
 
 #ifdef USE_L1_RTP_MODE
-	cur = msgb_put(msg, amr_if2_len);
-	memcpy(cur, l1_payload+2, amr_if2_len);
+	memcpy(rtp_pl, l1_payload+2, amr_if2_len);
 
 	/*
 	 * Audiocode's MGW doesn't like receiving CMRs that are not
 	 * the same as the previous one. This means we need to patch
 	 * the content here.
 	 */
-	if ((cur[0] & 0xF0) == 0xF0)
-		cur[0]= lchan->tch.last_cmr << 4;
+	if ((rtp_pl[0] & 0xF0) == 0xF0)
+		rtp_pl[0]= lchan->tch.last_cmr << 4;
 	else
-		lchan->tch.last_cmr = cur[0] >> 4;
+		lchan->tch.last_cmr = rtp_pl[0] >> 4;
+
+	return amr_if2_len;
 #else
 	u_int8_t cmr;
 	uint8_t ft = l1_payload[2] & 0xF;
@@ -257,22 +238,19 @@ static struct msgb *l1_to_rtppayload_amr(uint8_t *l1_payload, uint8_t payload_le
 	}
 
 	/* RFC 3267  4.4.1 Payload Header */
-	msgb_put_u8(msg, (cmr << 4));
+	rtp_pl[0] = cmr << 4;
 
 	/* RFC 3267  AMR TOC */
-	msgb_put_u8(msg, AMR_TOC_QBIT | (ft << 3));
-
-	cur = msgb_put(msg, amr_if2_len-1);
+	rtp_pl[1] = AMR_TOC_QBIT | (ft << 3);
 
 	/* step1: reverse the bit-order within every byte */
 	osmo_revbytebits_buf(l1_payload+2, amr_if2_len);
 
 	/* step2: shift everything left by one nibble */
-	osmo_nibble_shift_left_unal(cur, l1_payload+2, amr_if2_len*2 -1);
+	osmo_nibble_shift_left_unal(rtp_pl+2, l1_payload+2, amr_if2_len*2 -1);
 
+	return amr_if2_len + 1;
 #endif /* USE_L1_RTP_MODE */
-
-	return msg;
 }
 
 /*! \brief convert AMR from RTP payload to L1 format
@@ -454,24 +432,78 @@ static int is_recv_only(uint8_t speech_mode)
 	return (speech_mode & 0xF0) == (1 << 4);
 }
 
-/*! \brief receive a traffic L1 primitive for a given lchan */
+/*! \brief convert an uplink TCH frame from L1 to RTP payload format
+ *  \param[in] lchan logical channel the frame was received on
+ *  \param[in] payload_type L1 TCH payload type (GsmL1_TchPlType_*)
+ *  \param[in] l1_payload L1 payload, may be modified in place
+ *  \param[in] payload_len length of \a l1_payload
+ *  \param[out] rtp_pl RTP payload buffer of TCH_RTP_PL_MAX bytes
+ *  \returns number of \a rtp_pl bytes filled; 0 if there's nothing to
+ *	      send; negative on error
+ */
+int l1if_tch_ul_to_rtp(struct gsm_lchan *lchan, uint8_t payload_type,
+		       uint8_t *l1_payload, uint8_t payload_len,
+		       uint8_t *rtp_pl)
+{
+	uint8_t sid_first[9] = { 0 };
+	int len;
+
+	switch (payload_type) {
+	case GsmL1_TchPlType_Fr:
+		return l1_to_rtppayload_fr(rtp_pl, l1_payload, payload_len,
+					   lchan);
+	case GsmL1_TchPlType_Hr:
+		return l1_to_rtppayload_hr(rtp_pl, l1_payload, payload_len,
+					   lchan);
+#if defined(L1_HAS_EFR) && defined(USE_L1_RTP_MODE)
+	case GsmL1_TchPlType_Efr:
+		return l1_to_rtppayload_efr(rtp_pl, l1_payload, payload_len,
+					    lchan);
+#endif
+	case GsmL1_TchPlType_Amr:
+		return l1_to_rtppayload_amr(rtp_pl, l1_payload, payload_len,
+					    lchan);
+	case GsmL1_TchPlType_Amr_SidFirstP1:
+		if (payload_len > sizeof(sid_first))
+			return -EINVAL;
+		memcpy(sid_first, l1_payload, payload_len);
+		len = osmo_amr_rtp_enc(sid_first, 0, AMR_SID, AMR_GOOD);
+		if (len < 0)
+			return 0;
+		return l1_to_rtppayload_amr(rtp_pl, sid_first, len, lchan);
+	}
+
+	return 0;
+}
+
+/*! \brief receive a traffic L1 primitive for a given lchan
+ *
+ * Takes ownership of \a l1p_msg.  The converted RTP payload is written
+ * back into the buffer of \a l1p_msg, which is then passed up as the
+ * L1SAP TCH.ind, so there is no allocation per speech frame.
+ */
 int l1if_tch_rx(struct gsm_bts_trx *trx, uint8_t chan_nr, struct msgb *l1p_msg)
 {
 	GsmL1_Prim_t *l1p = msgb_l1prim(l1p_msg);
 	GsmL1_PhDataInd_t *data_ind = &l1p->u.phDataInd;
 	uint8_t payload_type = data_ind->msgUnitParam.u8Buffer[0];
 	uint8_t *payload = data_ind->msgUnitParam.u8Buffer + 1;
-	uint8_t payload_len, sid_first[9] = { 0 };
-	struct msgb *rmsg = NULL;
-	struct gsm_lchan *lchan = &trx->ts[L1SAP_CHAN2TS(chan_nr)].lchan[l1sap_chan2ss(chan_nr)];
+	uint32_t fn = data_ind->u32Fn;
+	uint8_t payload_len;
+	uint8_t rtp_pl[TCH_RTP_PL_MAX];
+	struct gsm_lchan *lchan = get_lchan_by_chan_nr(trx, chan_nr);
+	int rc;
 
-	if (is_recv_only(lchan->abis_ip.speech_mode))
-		return -EAGAIN;
+	if (is_recv_only(lchan->abis_ip.speech_mode)) {
+		rc = -EAGAIN;
+		goto out_free;
+	}
 
 	if (data_ind->msgUnitParam.u8Size < 1) {
 		LOGP(DL1C, LOGL_ERROR, "chan_nr %d Rx Payload size 0\n",
 			chan_nr);
-		return -EINVAL;
+		rc = -EINVAL;
+		goto out_free;
 	}
 	payload_len = data_ind->msgUnitParam.u8Size - 1;
 
@@ -534,42 +566,31 @@ int l1if_tch_rx(struct gsm_bts_trx *trx, uint8_t chan_nr, struct msgb *l1p_msg)
 		break;
 	}
 
+	rc = l1if_tch_ul_to_rtp(lchan, payload_type, payload, payload_len,
+				rtp_pl);
+	if (rc <= 0)
+		goto out_free;
 
-	switch (payload_type) {
-	case GsmL1_TchPlType_Fr:
-		rmsg = l1_to_rtppayload_fr(payload, payload_len, lchan);
-		break;
-	case GsmL1_TchPlType_Hr:
-		rmsg = l1_to_rtppayload_hr(payload, payload_len, lchan);
-		break;
-#if defined(L1_HAS_EFR) && defined(USE_L1_RTP_MODE)
-	case GsmL1_TchPlType_Efr:
-		rmsg = l1_to_rtppayload_efr(payload, payload_len, lchan);
-		break;
-#endif
-	case GsmL1_TchPlType_Amr:
-		rmsg = l1_to_rtppayload_amr(payload, payload_len, lchan);
-		break;
-	case GsmL1_TchPlType_Amr_SidFirstP1:
-		memcpy(sid_first, payload, payload_len);
-		int len = osmo_amr_rtp_enc(sid_first, 0, AMR_SID, AMR_GOOD);
-		if (len < 0)
-			return 0;
-		rmsg = l1_to_rtppayload_amr(sid_first, len, lchan);
-		break;
+	/* re-use the L1 primitive buffer for the L1SAP primitive, the
+	 * payload is small enough to be staged on the stack meanwhile */
+	if (l1p_msg->data_len < sizeof(struct osmo_phsap_prim) + rc) {
+		rc = -ENOMEM;
+		goto out_free;
 	}
+	msgb_reset(l1p_msg);
+	msgb_reserve(l1p_msg, sizeof(struct osmo_phsap_prim));
+	memcpy(msgb_put(l1p_msg, rc), rtp_pl, rc);
 
-	if (rmsg)
-		return add_l1sap_header(trx, rmsg, lchan, chan_nr,
-					data_ind->u32Fn);
-
-	return 0;
+	return add_l1sap_header(trx, l1p_msg, lchan, chan_nr, fn);
 
 err_payload_match:
 	LOGP(DL1C, LOGL_ERROR, "%s Rx Payload Type %s incompatible with lchan\n",
 		gsm_lchan_name(lchan),
 		get_value_string(femtobts_tch_pl_names, payload_type));
-	return -EINVAL;
+	rc = -EINVAL;
+out_free:
+	msgb_free(l1p_msg);
+	return rc;
 }
 
 struct msgb *gen_empty_tch_msg(struct gsm_lchan *lchan, uint32_t fn)
@@ -41,6 +41,7 @@
 #include "gsm0503_mapping.h"
 #include "gsm0503_interleaving.h"
 #include "gsm0503_tables.h"
+#include "gsm0503_tch_order.h"
 #include "gsm0503_coding.h"
 
 /*
@@ -1364,219 +1365,6 @@ int pdtch_encode(ubit_t *bursts, uint8_t *l2_data, uint8_t l2_len)
  * GSM TCH/F FR/EFR transcoding
  */
 
-static void tch_fr_reassemble(uint8_t *tch_data, ubit_t *b_bits, int net_order)
-{
-	int i, j, k, l, o;
-
-	tch_data[0] = 0xd << 4;
-	memset(tch_data + 1, 0, 32);
-
-	if (net_order) {
-		i = 0; /* counts bits */
-		j = 4; /* counts output bits */
-		while (i < 260) {
-			tch_data[j>>3] |= (b_bits[i] << (7-(j&7)));
-			i++;
-			j++;
-		}
-		return;
-	}
-
-	/* reassemble d-bits */
-	i = 0; /* counts bits */
-	j = 4; /* counts output bits */
-	k = gsm0503_gsm_fr_map[0]-1; /* current number bit in element */
-	l = 0; /* counts element bits */
-	o = 0; /* offset input bits */
-	while (i < 260) {
-		tch_data[j>>3] |= (b_bits[k+o] << (7-(j&7)));
-		if (--k < 0) {
-			o += gsm0503_gsm_fr_map[l];
-			k = gsm0503_gsm_fr_map[++l]-1;
-		}
-		i++;
-		j++;
-	}
-}
-
-static void tch_fr_disassemble(ubit_t *b_bits, uint8_t *tch_data, int net_order)
-{
-	int i, j, k, l, o;
-
-	if (net_order) {
-		i = 0; /* counts bits */
-		j = 4; /* counts output bits */
-		while (i < 260) {
-			b_bits[i] = (tch_data[j>>3] >> (7-(j&7))) & 1;
-			i++;
-			j++;
-		}
-		return;
-	}
-
-	i = 0; /* counts bits */
-	j = 4; /* counts input bits */
-	k = gsm0503_gsm_fr_map[0]-1; /* current number bit in element */
-	l = 0; /* counts element bits */
-	o = 0; /* offset output bits */
-	while (i < 260) {
-		b_bits[k+o] = (tch_data[j>>3] >> (7-(j&7))) & 1;
-		if (--k < 0) {
-			o += gsm0503_gsm_fr_map[l];
-			k = gsm0503_gsm_fr_map[++l]-1;
-		}
-		i++;
-		j++;
-	}
-}
-
-static void tch_hr_reassemble(uint8_t *tch_data, ubit_t *b_bits)
-{
-	int i, j;
-
-	tch_data[0] = 0x00; /* F = 0, FT = 000 */
-	memset(tch_data + 1, 0, 14);
-
-	i = 0; /* counts bits */
-	j = 8; /* counts output bits */
-	while (i < 112) {
-		tch_data[j>>3] |= (b_bits[i] << (7-(j&7)));
-		i++;
-		j++;
-	}
-}
-
-static void tch_hr_disassemble(ubit_t *b_bits, uint8_t *tch_data)
-{
-	int i, j;
-
-	i = 0; /* counts bits */
-	j = 8; /* counts output bits */
-	while (i < 112) {
-		b_bits[i] = (tch_data[j>>3] >> (7-(j&7))) & 1;
-		i++;
-		j++;
-	}
-}
-
-static void tch_efr_reassemble(uint8_t *tch_data, ubit_t *b_bits)
-{
-	int i, j;
-
-	tch_data[0] = 0xc << 4;
-	memset(tch_data + 1, 0, 30);
-
-	i = 0; /* counts bits */
-	j = 4; /* counts output bits */
-	while (i < 244) {
-		tch_data[j>>3] |= (b_bits[i] << (7-(j&7)));
-		i++;
-		j++;
-	}
-}
-
-static void tch_efr_disassemble(ubit_t *b_bits, uint8_t *tch_data)
-{
-	int i, j;
-
-	i = 0; /* counts bits */
-	j = 4; /* counts output bits */
-	while (i < 244) {
-		b_bits[i] = (tch_data[j>>3] >> (7-(j&7))) & 1;
-		i++;
-		j++;
-	}
-}
-
-static void tch_amr_reassemble(uint8_t *tch_data, ubit_t *d_bits, int len)
-{
-	int i, j;
-
-	memset(tch_data, 0, (len + 7) >> 3);
-
-	i = 0; /* counts bits */
-	j = 0; /* counts output bits */
-	while (i < len) {
-		tch_data[j>>3] |= (d_bits[i] << (7-(j&7)));
-		i++;
-		j++;
-	}
-}
-
-static void tch_amr_disassemble(ubit_t *d_bits, uint8_t *tch_data, int len)
-{
-	int i, j;
-
-	i = 0; /* counts bits */
-	j = 0; /* counts output bits */
-	while (i < len) {
-		d_bits[i] = (tch_data[j>>3] >> (7-(j&7))) & 1;
-		i++;
-		j++;
-	}
-}
-
-static void tch_fr_d_to_b(ubit_t *b_bits, ubit_t *d_bits)
-{
-	int i;
-
-	for (i = 0; i < 260; i++)
-		b_bits[gsm610_bitorder[i]] = d_bits[i];
-}
-
-static void tch_fr_b_to_d(ubit_t *d_bits, ubit_t *b_bits)
-{
-	int i;
-
-	for (i = 0; i < 260; i++)
-		d_bits[i] = b_bits[gsm610_bitorder[i]];
-}
-
-static void tch_hr_d_to_b(ubit_t *b_bits, ubit_t *d_bits)
-{
-	int i;
-
-	const uint16_t *map;
-
-	if (!d_bits[93] && !d_bits[94])
-		map = gsm620_unvoiced_bitorder;
-	else
-		map = gsm620_voiced_bitorder;
-
-	for (i = 0; i < 112; i++)
-		b_bits[map[i]] = d_bits[i];
-}
-
-static void tch_hr_b_to_d(ubit_t *d_bits, ubit_t *b_bits)
-{
-	int i;
-	const uint16_t *map;
-
-	if (!b_bits[34] && !b_bits[35])
-		map = gsm620_unvoiced_bitorder;
-	else
-		map = gsm620_voiced_bitorder;
-
-	for (i = 0; i < 112; i++)
-		d_bits[i] = b_bits[map[i]];
-}
-
-static void tch_efr_d_to_w(ubit_t *b_bits, ubit_t *d_bits)
-{
-	int i;
-
-	for (i = 0; i < 260; i++)
-		b_bits[gsm660_bitorder[i]] = d_bits[i];
-}
-
-static void tch_efr_w_to_d(ubit_t *d_bits, ubit_t *b_bits)
-{
-	int i;
-
-	for (i = 0; i < 260; i++)
-		d_bits[i] = b_bits[gsm660_bitorder[i]];
-}
-
 static void tch_efr_protected(ubit_t *s_bits, ubit_t *b_bits)
 {
 	int i;
@@ -1621,40 +1409,6 @@ static void tch_hr_reorder(ubit_t *u, ubit_t *d, ubit_t *p)
 	memcpy(u+95, p, 3);
 }
 
-static void tch_efr_reorder(ubit_t *w, ubit_t *s, ubit_t *p)
-{
-	memcpy(w, s, 71);
-	w[71] = w[72] = s[69];
-	memcpy(w+73, s+71, 50);
-	w[123] = w[124] = s[119];
-	memcpy(w+125, s+121, 53);
-	w[178] = w[179] = s[172];
-	memcpy(w+180, s+174, 50);
-	w[230] = w[231] = s[222];
-	memcpy(w+232, s+224, 20);
-	memcpy(w+252, p, 8);
-}
-
-static void tch_efr_unreorder(ubit_t *s, ubit_t *p, ubit_t *w)
-{
-	int sum;
-
-	memcpy(s, w, 71);
-	sum = s[69] + w[71] + w[72];
-	s[69] = (sum > 2);
-	memcpy(s+71, w+73, 50);
-	sum = s[119] + w[123] + w[124];
-	s[119] = (sum > 2);
-	memcpy(s+121, w+125, 53);
-	sum = s[172] + w[178] + w[179];
-	s[172] = (sum > 2);
-	memcpy(s+174, w+180, 50);
-	sum = s[220] + w[230] + w[231];
-	s[222] = (sum > 2);
-	memcpy(s+224, w+232, 20);
-	memcpy(p, w+252, 8);
-}
-
 static void tch_amr_merge(ubit_t *u, ubit_t *d, ubit_t *p, int len, int prot)
 {
 	memcpy(u, d, prot);
@@ -1673,7 +1427,7 @@ int tch_fr_decode(uint8_t *tch_data, sbit_t *bursts, int net_order, int efr,
 	int *n_errors, int *n_bits_total)
 {
 	sbit_t iB[912], cB[456], h;
-	ubit_t conv[185], s[244], w[260], b[65], d[260], p[8];
+	ubit_t conv[185], s[244], b[65], d[260], p[8];
 	int i, rv, len, steal = 0;
 
 	for (i=0; i<8; i++) {
@@ -1709,9 +1463,7 @@ int tch_fr_decode(uint8_t *tch_data, sbit_t *bursts, int net_order, int efr,
 
 
 	if (efr) {
-		tch_efr_d_to_w(w, d);
-
-		tch_efr_unreorder(s, p, w);
+		gsm0503_tch_efr_d_to_s(s, p, d);
 
 		tch_efr_protected(s, b);
 
@@ -1722,13 +1474,11 @@ int tch_fr_decode(uint8_t *tch_data, sbit_t *bursts, int net_order, int efr,
 			return -1;
 		}
 
-		tch_efr_reassemble(tch_data, s);
+		gsm0503_tch_efr_s_to_payload(tch_data, s);
 
 		len = GSM_EFR_BYTES;
 	} else {
-		tch_fr_d_to_b(w, d);
-
-		tch_fr_reassemble(tch_data, w, net_order);
+		gsm0503_tch_fr_d_to_payload(tch_data, d, net_order);
 
 		len = GSM_FR_BYTES;
 	}
@@ -1739,27 +1489,21 @@ int tch_fr_decode(uint8_t *tch_data, sbit_t *bursts, int net_order, int efr,
 int tch_fr_encode(ubit_t *bursts, uint8_t *tch_data, int len, int net_order)
 {
 	ubit_t iB[912], cB[456], h;
-	ubit_t conv[185], w[260], b[65], s[244], d[260], p[8];
+	ubit_t conv[185], b[65], d[260], p[8];
 	int i;
 
 	switch (len) {
 	case GSM_EFR_BYTES: /* TCH EFR */
 
-		tch_efr_disassemble(s, tch_data);
-
-		tch_efr_protected(s, b);
+		gsm0503_tch_efr_payload_protected(b, tch_data);
 
 		osmo_crc8gen_set_bits(&gsm0503_tch_efr_crc8, b, 65, p);
 
-		tch_efr_reorder(w, s, p);
-
-		tch_efr_w_to_d(d, w);
+		gsm0503_tch_efr_payload_to_d(d, tch_data, p);
 
 		goto coding_efr_fr;
 	case GSM_FR_BYTES: /* TCH FR */
-		tch_fr_disassemble(w, tch_data, net_order);
-
-		tch_fr_b_to_d(d, w);
+		gsm0503_tch_fr_payload_to_d(d, tch_data, net_order);
 
 coding_efr_fr:
 		osmo_crc8gen_set_bits(&gsm0503_tch_fr_crc3, d, 50, p);
@@ -1795,7 +1539,7 @@ int tch_hr_decode(uint8_t *tch_data, sbit_t *bursts, int odd,
 	int *n_errors, int *n_bits_total)
 {
 	sbit_t iB[912], cB[456], h;
-	ubit_t conv[98], b[112], d[112], p[3];
+	ubit_t conv[98], d[112], p[3];
 	int i, rv, steal = 0;
 
 	/* only unmap the stealing bits */
@@ -1849,9 +1593,7 @@ int tch_hr_decode(uint8_t *tch_data, sbit_t *bursts, int odd,
 		return -1;
 	}
 
-	tch_hr_d_to_b(b, d);
-
-	tch_hr_reassemble(tch_data, b);
+	gsm0503_tch_hr_d_to_payload(tch_data, d);
 
 	return 15;
 }
@@ -1859,14 +1601,12 @@ int tch_hr_decode(uint8_t *tch_data, sbit_t *bursts, int odd,
 int tch_hr_encode(ubit_t *bursts, uint8_t *tch_data, int len)
 {
 	ubit_t iB[912], cB[456], h;
-	ubit_t conv[98], b[112], d[112], p[3];
+	ubit_t conv[98], d[112], p[3];
 	int i;
 
 	switch (len) {
 	case 15: /* TCH HR */
-		tch_hr_disassemble(b, tch_data);
-
-		tch_hr_b_to_d(d, b);
+		gsm0503_tch_hr_payload_to_d(d, tch_data);
 
 		osmo_crc8gen_set_bits(&gsm0503_tch_fr_crc3, d + 73, 22, p);
 
@@ -1907,13 +1647,118 @@ int tch_hr_encode(ubit_t *bursts, uint8_t *tch_data, int len)
 	return 0;
 }
 
+/* AMR speech modes, indexed by codec number.  'len' bits are protected
+ * by the convolutional code, the first 'prot' of them by the CRC.  The
+ * remaining bits of TCH/AHS modes are sent unprotected at 'unprot' in
+ * cB.  Mode search only takes a frame of this mode if the decoder saw
+ * less than 'ber_max' per mille bit errors.  Decoding noise or another
+ * mode's frame gives about 1/0.6 times that, the higher the code rate
+ * the lower. */
+struct tch_amr_mode {
+	const char *name;
+	const struct osmo_conv_code *conv;
+	int len;
+	int prot;
+	int bits;
+	int unprot;
+	int bytes;
+	int ber_max;
+};
+
+static const struct tch_amr_mode tch_afs_modes[] = {
+	{ "4.75", &gsm0503_conv_tch_afs_4_75, 95, 39, 95, 0, 12, 153 },
+	{ "5.15", &gsm0503_conv_tch_afs_5_15, 103, 49, 103, 0, 13, 149 },
+	{ "5.9", &gsm0503_conv_tch_afs_5_9, 118, 55, 118, 0, 15, 134 },
+	{ "6.7", &gsm0503_conv_tch_afs_6_7, 134, 55, 134, 0, 17, 127 },
+	{ "7.4", &gsm0503_conv_tch_afs_7_4, 148, 61, 148, 0, 19, 116 },
+	{ "7.95", &gsm0503_conv_tch_afs_7_95, 159, 75, 159, 0, 20, 106 },
+	{ "10.2", &gsm0503_conv_tch_afs_10_2, 204, 65, 204, 0, 26, 86 },
+	{ "12.2", &gsm0503_conv_tch_afs_12_2, 244, 81, 244, 0, 31, 68 },
+};
+
+static const struct tch_amr_mode tch_ahs_modes[] = {
+	{ "4.75", &gsm0503_conv_tch_ahs_4_75, 83, 39, 95, 216, 12, 94 },
+	{ "5.15", &gsm0503_conv_tch_ahs_5_15, 91, 49, 103, 216, 13, 89 },
+	{ "5.9", &gsm0503_conv_tch_ahs_5_9, 102, 55, 118, 212, 15, 76 },
+	{ "6.7", &gsm0503_conv_tch_ahs_6_7, 110, 55, 134, 204, 17, 64 },
+	{ "7.4", &gsm0503_conv_tch_ahs_7_4, 120, 61, 148, 200, 19, 53 },
+	{ "7.95", &gsm0503_conv_tch_ahs_7_95, 123, 67, 159, 192, 20, 46 },
+};
+
+int gsm0503_amr_mode_search = 0;
+
+/* decode the protected bits of mode 'm' from 'c', returns 0 if the CRC
+ * matches */
+static int tch_amr_decode_mode(ubit_t *d, const struct tch_amr_mode *m,
+	sbit_t *c, int *n_errors, int *n_bits_total)
+{
+	ubit_t p[6], conv[250];
+
+	osmo_conv_decode_ber(m->conv, c, conv, n_errors, n_bits_total);
+
+	tch_amr_unmerge(d, p, conv, m->len, m->prot);
+
+	return osmo_crc8gen_check_bits(&gsm0503_amr_crc6, d, m->prot, p);
+}
+
+/* decode the speech frame 'c' with the codec 'primary' (index into codec[],
+ * -1 if unknown).  If its CRC fails and mode search is enabled, decode
+ * with all other active codecs and take the one whose CRC matches with the
+ * lowest bit error rate.  The CRC of a wrong mode still matches in one of
+ * 64 cases, so a mode is only taken below its 'ber_max'.  Returns the index
+ * of the codec or -1. */
+static int tch_amr_decode_search(ubit_t *d, const char *func,
+	const struct tch_amr_mode *modes, int num_modes, sbit_t *c,
+	uint8_t *codec, int codecs, int primary,
+	int *n_errors, int *n_bits_total)
+{
+	ubit_t d_try[244];
+	int i, e, t, best = -1, best_e = 0, best_t = 0;
+
+	if (primary >= 0) {
+		if (!tch_amr_decode_mode(d, &modes[codec[primary]], c,
+				n_errors, n_bits_total))
+			return primary;
+		LOGP(DL1C, LOGL_NOTICE, "%s(): error checking CRC8 for an AMR "
+			"%s frame\n", func, modes[codec[primary]].name);
+	}
+
+	if (!gsm0503_amr_mode_search)
+		return -1;
+
+	for (i = 0; i < codecs; i++) {
+		if (i == primary || codec[i] >= num_modes)
+			continue;
+		if (tch_amr_decode_mode(d_try, &modes[codec[i]], c, &e, &t))
+			continue;
+		if (e * 1000 >= t * modes[codec[i]].ber_max)
+			continue;
+		if (best < 0 || e * best_t < best_e * t) {
+			best = i;
+			best_e = e;
+			best_t = t;
+			memcpy(d, d_try, modes[codec[i]].len);
+		}
+	}
+
+	if (best < 0)
+		return -1;
+
+	LOGP(DL1C, LOGL_INFO, "%s(): found AMR %s frame by mode search\n",
+		func, modes[codec[best]].name);
+	*n_errors = best_e;
+	*n_bits_total = best_t;
+
+	return best;
+}
+
 int tch_afs_decode(uint8_t *tch_data, sbit_t *bursts, int codec_mode_req,
 	uint8_t *codec, int codecs, uint8_t *ft, uint8_t *cmr,
 	int *n_errors, int *n_bits_total)
 {
 	sbit_t iB[912], cB[456], h;
-	ubit_t d[244], p[6], conv[250];
-	int i, j, k, best = 0, rv, len, steal = 0, id = 0;
+	ubit_t d[244];
+	int i, j, k, best = 0, rv, steal = 0, id = 0, primary;
 	*n_errors = 0; *n_bits_total = 0;
 
 	for (i=0; i<8; i++) {
@@ -1944,142 +1789,19 @@ int tch_afs_decode(uint8_t *tch_data, sbit_t *bursts, int codec_mode_req,
 		}
 	}
 
-	/* check if indicated codec fits into range of codecs */
-	if (id >= codecs) {
+	/* check if indicated codec fits into range of codecs, mode search
+	 * may still find the frame */
+	if (id >= codecs && !gsm0503_amr_mode_search) {
 		/* codec mode out of range, return id */
 		return id;
 	}
 
-	switch ((codec_mode_req) ? codec[*ft] : codec[id]) {
-	case 7: /* TCH/AFS12.2 */
-		osmo_conv_decode_ber(&gsm0503_conv_tch_afs_12_2, cB+8, conv, n_errors, n_bits_total);
-
-		tch_amr_unmerge(d, p, conv, 244, 81);
-
-		rv = osmo_crc8gen_check_bits(&gsm0503_amr_crc6, d, 81, p);
-		if (rv) {
-			LOGP(DL1C, LOGL_NOTICE, "tch_afs_decode(): error checking CRC8 for an AMR 12.2 frame\n");
-			return -1;
-		}
-
-		tch_amr_reassemble(tch_data, d, 244);
-
-		len = 31;
-
-		break;
-	case 6: /* TCH/AFS10.2 */
-		osmo_conv_decode_ber(&gsm0503_conv_tch_afs_10_2, cB+8, conv, n_errors, n_bits_total);
-
-		tch_amr_unmerge(d, p, conv, 204, 65);
-
-		rv = osmo_crc8gen_check_bits(&gsm0503_amr_crc6, d, 65, p);
-		if (rv) {
-			LOGP(DL1C, LOGL_NOTICE, "tch_afs_decode(): error checking CRC8 for an AMR 10.2 frame\n");
-			return -1;
-		}
-
-		tch_amr_reassemble(tch_data, d, 204);
-
-		len = 26;
-
-		break;
-	case 5: /* TCH/AFS7.95 */
-		osmo_conv_decode_ber(&gsm0503_conv_tch_afs_7_95, cB+8, conv, n_errors, n_bits_total);
-
-		tch_amr_unmerge(d, p, conv, 159, 75);
-
-		rv = osmo_crc8gen_check_bits(&gsm0503_amr_crc6, d, 75, p);
-		if (rv) {
-			LOGP(DL1C, LOGL_NOTICE, "tch_afs_decode(): error checking CRC8 for an AMR 7.95 frame\n");
-			return -1;
-		}
-
-		tch_amr_reassemble(tch_data, d, 159);
-
-		len = 20;
-
-		break;
-	case 4: /* TCH/AFS7.4 */
-		osmo_conv_decode_ber(&gsm0503_conv_tch_afs_7_4, cB+8, conv, n_errors, n_bits_total);
-
-		tch_amr_unmerge(d, p, conv, 148, 61);
-
-		rv = osmo_crc8gen_check_bits(&gsm0503_amr_crc6, d, 61, p);
-		if (rv) {
-			LOGP(DL1C, LOGL_NOTICE, "tch_afs_decode(): error checking CRC8 for an AMR 7.4 frame\n");
-			return -1;
-		}
-
-		tch_amr_reassemble(tch_data, d, 148);
-
-		len = 19;
-
-		break;
-	case 3: /* TCH/AFS6.7 */
-		osmo_conv_decode_ber(&gsm0503_conv_tch_afs_6_7, cB+8, conv, n_errors, n_bits_total);
-
-		tch_amr_unmerge(d, p, conv, 134, 55);
-
-		rv = osmo_crc8gen_check_bits(&gsm0503_amr_crc6, d, 55, p);
-		if (rv) {
-			LOGP(DL1C, LOGL_NOTICE, "tch_afs_decode(): error checking CRC8 for an AMR 6.7 frame\n");
-			return -1;
-		}
-
-		tch_amr_reassemble(tch_data, d, 134);
-
-		len = 17;
-
-		break;
-	case 2: /* TCH/AFS5.9 */
-		osmo_conv_decode_ber(&gsm0503_conv_tch_afs_5_9, cB+8, conv, n_errors, n_bits_total);
-
-		tch_amr_unmerge(d, p, conv, 118, 55);
-
-		rv = osmo_crc8gen_check_bits(&gsm0503_amr_crc6, d, 55, p);
-		if (rv) {
-			LOGP(DL1C, LOGL_NOTICE, "tch_afs_decode(): error checking CRC8 for an AMR 5.9 frame\n");
-			return -1;
-		}
-
-		tch_amr_reassemble(tch_data, d, 118);
-
-		len = 15;
-
-		break;
-	case 1: /* TCH/AFS5.15 */
-		osmo_conv_decode_ber(&gsm0503_conv_tch_afs_5_15, cB+8, conv, n_errors, n_bits_total);
-
-		tch_amr_unmerge(d, p, conv, 103, 49);
-
-		rv = osmo_crc8gen_check_bits(&gsm0503_amr_crc6, d, 49, p);
-		if (rv) {
-			LOGP(DL1C, LOGL_NOTICE, "tch_afs_decode(): error checking CRC8 for an AMR 5.15 frame\n");
-			return -1;
-		}
-
-		tch_amr_reassemble(tch_data, d, 103);
-
-		len = 13;
-
-		break;
-	case 0: /* TCH/AFS4.75 */
-		osmo_conv_decode_ber(&gsm0503_conv_tch_afs_4_75, cB+8, conv, n_errors, n_bits_total);
-
-		tch_amr_unmerge(d, p, conv, 95, 39);
-
-		rv = osmo_crc8gen_check_bits(&gsm0503_amr_crc6, d, 39, p);
-		if (rv) {
-			LOGP(DL1C, LOGL_NOTICE, "tch_afs_decode(): error checking CRC8 for an AMR 4.75 frame\n");
-			return -1;
-		}
-
-		tch_amr_reassemble(tch_data, d, 95);
-
-		len = 12;
+	if (codec_mode_req)
+		primary = *ft;
+	else
+		primary = (id < codecs) ? id : -1;
 
-		break;
-	default:
+	if (primary >= 0 && codec[primary] >= ARRAY_SIZE(tch_afs_modes)) {
 		LOGP(DL1C, LOGL_ERROR, "tch_afs_decode(): Unknown frame type\n");
 		fprintf(stderr, "FIXME: FT %d not supported!\n", *ft);
 		*n_bits_total = 448;
@@ -2087,13 +1809,27 @@ int tch_afs_decode(uint8_t *tch_data, sbit_t *bursts, int codec_mode_req,
 		return -1;
 	}
 
+	rv = tch_amr_decode_search(d, "tch_afs_decode", tch_afs_modes,
+		ARRAY_SIZE(tch_afs_modes), cB+8, codec, codecs, primary,
+		n_errors, n_bits_total);
+	if (rv < 0) {
+		if (primary < 0) {
+			*n_bits_total = 448;
+			*n_errors = *n_bits_total;
+		}
+		return -1;
+	}
+
+	gsm0503_tch_amr_d_to_payload(tch_data, d, tch_afs_modes[codec[rv]].bits);
+
 	/* change codec request / indication, if frame is valid */
-	if (codec_mode_req)
-		*cmr = id;
-	else
-		*ft = id;
+	if (codec_mode_req) {
+		if (id < codecs)
+			*cmr = id;
+	}
+	*ft = rv;
 
-	return len;
+	return tch_afs_modes[codec[rv]].bytes;
 }
 
 int tch_afs_encode(ubit_t *bursts, uint8_t *tch_data, int len,
@@ -2140,7 +1876,7 @@ invalid_length:
 			return -1;
 		}
 
-		tch_amr_disassemble(d, tch_data, 244);
+		gsm0503_tch_amr_payload_to_d(d, tch_data, 244);
 
 		osmo_crc8gen_set_bits(&gsm0503_amr_crc6, d, 81, p);
 
@@ -2153,7 +1889,7 @@ invalid_length:
 		if (len != 26)
 			goto invalid_length;
 
-		tch_amr_disassemble(d, tch_data, 204);
+		gsm0503_tch_amr_payload_to_d(d, tch_data, 204);
 
 		osmo_crc8gen_set_bits(&gsm0503_amr_crc6, d, 65, p);
 
@@ -2166,7 +1902,7 @@ invalid_length:
 		if (len != 20)
 			goto invalid_length;
 
-		tch_amr_disassemble(d, tch_data, 159);
+		gsm0503_tch_amr_payload_to_d(d, tch_data, 159);
 
 		osmo_crc8gen_set_bits(&gsm0503_amr_crc6, d, 75, p);
 
@@ -2179,7 +1915,7 @@ invalid_length:
 		if (len != 19)
 			goto invalid_length;
 
-		tch_amr_disassemble(d, tch_data, 148);
+		gsm0503_tch_amr_payload_to_d(d, tch_data, 148);
 
 		osmo_crc8gen_set_bits(&gsm0503_amr_crc6, d, 61, p);
 
@@ -2192,7 +1928,7 @@ invalid_length:
 		if (len != 17)
 			goto invalid_length;
 
-		tch_amr_disassemble(d, tch_data, 134);
+		gsm0503_tch_amr_payload_to_d(d, tch_data, 134);
 
 		osmo_crc8gen_set_bits(&gsm0503_amr_crc6, d, 55, p);
 
@@ -2205,7 +1941,7 @@ invalid_length:
 		if (len != 15)
 			goto invalid_length;
 
-		tch_amr_disassemble(d, tch_data, 118);
+		gsm0503_tch_amr_payload_to_d(d, tch_data, 118);
 
 		osmo_crc8gen_set_bits(&gsm0503_amr_crc6, d, 55, p);
 
@@ -2218,7 +1954,7 @@ invalid_length:
 		if (len != 13)
 			goto invalid_length;
 
-		tch_amr_disassemble(d, tch_data, 103);
+		gsm0503_tch_amr_payload_to_d(d, tch_data, 103);
 
 		osmo_crc8gen_set_bits(&gsm0503_amr_crc6, d, 49, p);
 
@@ -2231,7 +1967,7 @@ invalid_length:
 		if (len != 12)
 			goto invalid_length;
 
-		tch_amr_disassemble(d, tch_data, 95);
+		gsm0503_tch_amr_payload_to_d(d, tch_data, 95);
 
 		osmo_crc8gen_set_bits(&gsm0503_amr_crc6, d, 39, p);
 
@@ -2261,9 +1997,10 @@ int tch_ahs_decode(uint8_t *tch_data, sbit_t *bursts, int odd,
 	int codec_mode_req, uint8_t *codec, int codecs, uint8_t *ft,
 	uint8_t *cmr, int *n_errors, int *n_bits_total)
 {
+	const struct tch_amr_mode *m;
 	sbit_t iB[912], cB[456], h;
-	ubit_t d[244], p[6], conv[135];
-	int i, j, k, best = 0, rv, len, steal = 0, id = 0;
+	ubit_t d[244];
+	int i, j, k, best = 0, rv, steal = 0, id = 0, primary;
 
 	/* only unmap the stealing bits */
 	if (!odd) {
@@ -2313,142 +2050,51 @@ int tch_ahs_decode(uint8_t *tch_data, sbit_t *bursts, int odd,
 		}
 	}
 
-	/* check if indicated codec fits into range of codecs */
-	if (id >= codecs) {
+	/* check if indicated codec fits into range of codecs, mode search
+	 * may still find the frame */
+	if (id >= codecs && !gsm0503_amr_mode_search) {
 		/* codec mode out of range, return id */
 		return id;
 	}
 
-	switch ((codec_mode_req) ? codec[*ft] : codec[id]) {
-	case 5: /* TCH/AHS7.95 */
-		osmo_conv_decode_ber(&gsm0503_conv_tch_ahs_7_95, cB+4, conv, n_errors, n_bits_total);
-
-		tch_amr_unmerge(d, p, conv, 123, 67);
-
-		rv = osmo_crc8gen_check_bits(&gsm0503_amr_crc6, d, 67, p);
-		if (rv) {
-			LOGP(DL1C, LOGL_NOTICE, "tch_ahs_decode(): error checking CRC8 for an AMR 7.95 frame\n");
-			return -1;
-		}
-
-		for (i=0; i<36;i++)
-			d[i+123] = (cB[i+192] < 0) ? 1:0;
-
-		tch_amr_reassemble(tch_data, d, 159);
-
-		len = 20;
-
-		break;
-	case 4: /* TCH/AHS7.4 */
-		osmo_conv_decode_ber(&gsm0503_conv_tch_ahs_7_4, cB+4, conv, n_errors, n_bits_total);
-
-		tch_amr_unmerge(d, p, conv, 120, 61);
-
-		rv = osmo_crc8gen_check_bits(&gsm0503_amr_crc6, d, 61, p);
-		if (rv) {
-			LOGP(DL1C, LOGL_NOTICE, "tch_ahs_decode(): error checking CRC8 for an AMR 7.4 frame\n");
-			return -1;
-		}
-
-		for (i=0; i<28;i++)
-			d[i+120] = (cB[i+200] < 0) ? 1:0;
-
-		tch_amr_reassemble(tch_data, d, 148);
-
-		len = 19;
-
-		break;
-	case 3: /* TCH/AHS6.7 */
-		osmo_conv_decode_ber(&gsm0503_conv_tch_ahs_6_7, cB+4, conv, n_errors, n_bits_total);
-
-		tch_amr_unmerge(d, p, conv, 110, 55);
-
-		rv = osmo_crc8gen_check_bits(&gsm0503_amr_crc6, d, 55, p);
-		if (rv) {
-			LOGP(DL1C, LOGL_NOTICE, "tch_ahs_decode(): error checking CRC8 for an AMR 6.7 frame\n");
-			return -1;
-		}
-
-		for (i=0; i<24;i++)
-			d[i+110] = (cB[i+204] < 0) ? 1:0;
-
-		tch_amr_reassemble(tch_data, d, 134);
-
-		len = 17;
-
-		break;
-	case 2: /* TCH/AHS5.9 */
-		osmo_conv_decode_ber(&gsm0503_conv_tch_ahs_5_9, cB+4, conv, n_errors, n_bits_total);
-
-		tch_amr_unmerge(d, p, conv, 102, 55);
-
-		rv = osmo_crc8gen_check_bits(&gsm0503_amr_crc6, d, 55, p);
-		if (rv) {
-			LOGP(DL1C, LOGL_NOTICE, "tch_ahs_decode(): error checking CRC8 for an AMR 5.9 frame\n");
-			return -1;
-		}
-
-		for (i=0; i<16;i++)
-			d[i+102] = (cB[i+212] < 0) ? 1:0;
-
-		tch_amr_reassemble(tch_data, d, 118);
-
-		len = 15;
-
-		break;
-	case 1: /* TCH/AHS5.15 */
-		osmo_conv_decode_ber(&gsm0503_conv_tch_ahs_5_15, cB+4, conv, n_errors, n_bits_total);
-
-		tch_amr_unmerge(d, p, conv, 91, 49);
-
-		rv = osmo_crc8gen_check_bits(&gsm0503_amr_crc6, d, 49, p);
-		if (rv) {
-			LOGP(DL1C, LOGL_NOTICE, "tch_ahs_decode(): error checking CRC8 for an AMR 5.15 frame\n");
-			return -1;
-		}
-
-		for (i=0; i<12;i++)
-			d[i+91] = (cB[i+216] < 0) ? 1:0;
-
-		tch_amr_reassemble(tch_data, d, 103);
-
-		len = 13;
-
-		break;
-	case 0: /* TCH/AHS4.75 */
-		osmo_conv_decode_ber(&gsm0503_conv_tch_ahs_4_75, cB+4, conv, n_errors, n_bits_total);
-
-		tch_amr_unmerge(d, p, conv, 83, 39);
-
-		rv = osmo_crc8gen_check_bits(&gsm0503_amr_crc6, d, 39, p);
-		if (rv) {
-			LOGP(DL1C, LOGL_NOTICE, "tch_ahs_decode(): error checking CRC8 for an AMR 4.75 frame\n");
-			return -1;
-		}
-
-		for (i=0; i<12;i++)
-			d[i+83] = (cB[i+216] < 0) ? 1:0;
-
-		tch_amr_reassemble(tch_data, d, 95);
-
-		len = 12;
+	if (codec_mode_req)
+		primary = *ft;
+	else
+		primary = (id < codecs) ? id : -1;
 
-		break;
-	default:
-		LOGP(DL1C, LOGL_ERROR, "tch_afs_decode(): Unknown frame type\n");
+	if (primary >= 0 && codec[primary] >= ARRAY_SIZE(tch_ahs_modes)) {
+		LOGP(DL1C, LOGL_ERROR, "tch_ahs_decode(): Unknown frame type\n");
 		fprintf(stderr, "FIXME: FT %d not supported!\n", *ft);
 		*n_bits_total = 159;
 		*n_errors = *n_bits_total;
 		return -1;
 	}
 
+	rv = tch_amr_decode_search(d, "tch_ahs_decode", tch_ahs_modes,
+		ARRAY_SIZE(tch_ahs_modes), cB+4, codec, codecs, primary,
+		n_errors, n_bits_total);
+	if (rv < 0) {
+		if (primary < 0) {
+			*n_bits_total = 159;
+			*n_errors = *n_bits_total;
+		}
+		return -1;
+	}
+
+	m = &tch_ahs_modes[codec[rv]];
+	for (i=0; i<m->bits-m->len; i++)
+		d[i+m->len] = (cB[i+m->unprot] < 0) ? 1:0;
+
+	gsm0503_tch_amr_d_to_payload(tch_data, d, m->bits);
+
 	/* change codec request / indication, if frame is valid */
-	if (codec_mode_req)
-		*cmr = id;
-	else
-		*ft = id;
+	if (codec_mode_req) {
+		if (id < codecs)
+			*cmr = id;
+	}
+	*ft = rv;
 
-	return len;
+	return m->bytes;
 }
 
 int tch_ahs_encode(ubit_t *bursts, uint8_t *tch_data, int len,
@@ -2504,7 +2150,7 @@ invalid_length:
 			return -1;
 		}
 
-		tch_amr_disassemble(d, tch_data, 159);
+		gsm0503_tch_amr_payload_to_d(d, tch_data, 159);
 
 		osmo_crc8gen_set_bits(&gsm0503_amr_crc6, d, 67, p);
 
@@ -2519,7 +2165,7 @@ invalid_length:
 		if (len != 19)
 			goto invalid_length;
 
-		tch_amr_disassemble(d, tch_data, 148);
+		gsm0503_tch_amr_payload_to_d(d, tch_data, 148);
 
 		osmo_crc8gen_set_bits(&gsm0503_amr_crc6, d, 61, p);
 
@@ -2534,7 +2180,7 @@ invalid_length:
 		if (len != 17)
 			goto invalid_length;
 
-		tch_amr_disassemble(d, tch_data, 134);
+		gsm0503_tch_amr_payload_to_d(d, tch_data, 134);
 
 		osmo_crc8gen_set_bits(&gsm0503_amr_crc6, d, 55, p);
 
@@ -2549,7 +2195,7 @@ invalid_length:
 		if (len != 15)
 			goto invalid_length;
 
-		tch_amr_disassemble(d, tch_data, 118);
+		gsm0503_tch_amr_payload_to_d(d, tch_data, 118);
 
 		osmo_crc8gen_set_bits(&gsm0503_amr_crc6, d, 55, p);
 
@@ -2564,7 +2210,7 @@ invalid_length:
 		if (len != 13)
 			goto invalid_length;
 
-		tch_amr_disassemble(d, tch_data, 103);
+		gsm0503_tch_amr_payload_to_d(d, tch_data, 103);
 
 		osmo_crc8gen_set_bits(&gsm0503_amr_crc6, d, 49, p);
 
@@ -2579,7 +2225,7 @@ invalid_length:
 		if (len != 12)
 			goto invalid_length;
 
-		tch_amr_disassemble(d, tch_data, 95);
+		gsm0503_tch_amr_payload_to_d(d, tch_data, 95);
 
 		osmo_crc8gen_set_bits(&gsm0503_amr_crc6, d, 39, p);
 
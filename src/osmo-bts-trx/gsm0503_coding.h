@@ -55,6 +55,10 @@ int tch_fr_encode(ubit_t *bursts, uint8_t *tch_data, int len, int net_order);
 int tch_hr_decode(uint8_t *tch_data, sbit_t *bursts, int odd,
 	int *n_errors, int *n_bits_total);
 int tch_hr_encode(ubit_t *bursts, uint8_t *tch_data, int len);
+/* if the CRC of an AMR speech frame fails for the mode indicated in band,
+ * try all other active modes */
+extern int gsm0503_amr_mode_search;
+
 int tch_afs_decode(uint8_t *tch_data, sbit_t *bursts, int codec_mode_req,
 	uint8_t *codec, int codecs, uint8_t *ft, uint8_t *cmr,
 	int *n_errors, int *n_bits_total);
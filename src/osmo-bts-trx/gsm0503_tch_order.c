@@ -0,0 +1,311 @@
+/* Bit order conversion between TCH speech payloads and coder input */
+
+/* (C) 2017 by sysmocom s.f.m.c. GmbH
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include <osmocom/core/bits.h>
+#include <osmocom/codec/codec.h>
+
+#include "gsm0503_tables.h"
+#include "gsm0503_tch_order.h"
+
+/* The payload is handled a byte at a time: a byte is unpacked into
+ * eight ubits with one table lookup, and packed from eight ubits that
+ * are gathered through an index table.  The index tables fold all
+ * permutations between the payload and the coder input (e.g. the
+ * GSM 06.10 bit order and the RTP order of FR) into one, they are
+ * built on first use from the tables they replace. */
+
+#define U1(b)	{ ((b) >> 7) & 1, ((b) >> 6) & 1, ((b) >> 5) & 1, \
+		  ((b) >> 4) & 1, ((b) >> 3) & 1, ((b) >> 2) & 1, \
+		  ((b) >> 1) & 1, (b) & 1 }
+#define U4(b)	U1(b), U1((b) + 1), U1((b) + 2), U1((b) + 3)
+#define U16(b)	U4(b), U4((b) + 4), U4((b) + 8), U4((b) + 12)
+#define U64(b)	U16(b), U16((b) + 16), U16((b) + 32), U16((b) + 48)
+
+static const ubit_t byte_ubits[256][8] = {
+	U64(0), U64(64), U64(128), U64(192)
+};
+
+/* EFR CRC bit in efr_d_pos[] */
+#define EFR_P	0x8000
+
+/* payload bit position of each FR d-bit, [0] in GSM 06.10 order and [1]
+ * in RTP (network) order, and the d-bit of each payload bit after the
+ * 4 bit header */
+static uint16_t fr_d_pos[2][260];
+static uint16_t fr_pos_d[2][260];
+/* payload bit position (or EFR_P | CRC bit) of each EFR d-bit */
+static uint16_t efr_d_pos[260];
+/* d-bit of each EFR s-bit, followed by the 8 CRC bits */
+static uint16_t efr_s_d[244 + 8];
+/* s-bits repeated in the d-bits, the d-bits of the two repetitions and
+ * the s-bit they are voted with */
+static const uint16_t efr_rep_s[4] = { 69, 119, 172, 222 };
+static const uint16_t efr_rep_w[4] = { 71, 123, 178, 230 };
+static const uint16_t efr_vote_s[4] = { 69, 119, 172, 220 };
+static uint16_t efr_rep_d[4][2];
+/* d-bit of each HR b-bit, [0] unvoiced and [1] voiced */
+static uint16_t hr_b_d[2][112];
+
+static int tables_initialized;
+
+/* index of each w-bit in the s-bits followed by the CRC bits, see
+ * TS 05.03 3.1.1.3 */
+static int efr_w_to_s(int w)
+{
+	int i;
+
+	if (w >= 252)
+		return 244 + w - 252;
+	for (i = 3; i >= 0; i--) {
+		if (w >= efr_rep_w[i] + 2)
+			return w - 2 * (i + 1);
+		if (w >= efr_rep_w[i])
+			return efr_rep_s[i];
+	}
+	return w;
+}
+
+static void tables_init(void)
+{
+	uint16_t fr_w_pos[260];
+	int i, j, k, l, o;
+
+	/* FR b-bit of each payload bit in GSM 06.10 order, as walked by
+	 * the former tch_fr_reassemble() */
+	k = gsm0503_gsm_fr_map[0] - 1;
+	l = 0;
+	o = 0;
+	for (j = 0; j < 260; j++) {
+		fr_w_pos[k + o] = 4 + j;
+		if (--k < 0) {
+			o += gsm0503_gsm_fr_map[l];
+			k = gsm0503_gsm_fr_map[++l] - 1;
+		}
+	}
+
+	for (i = 0; i < 260; i++) {
+		fr_d_pos[0][i] = fr_w_pos[gsm610_bitorder[i]];
+		fr_d_pos[1][i] = 4 + gsm610_bitorder[i];
+		fr_pos_d[0][fr_d_pos[0][i] - 4] = i;
+		fr_pos_d[1][fr_d_pos[1][i] - 4] = i;
+	}
+
+	for (i = 0; i < 260; i++) {
+		j = efr_w_to_s(gsm660_bitorder[i]);
+		if (j >= 244)
+			efr_d_pos[i] = EFR_P | (j - 244);
+		else
+			efr_d_pos[i] = 4 + j;
+	}
+	/* on reception the s-bit is taken from its first copy */
+	for (i = 0; i < 260; i++) {
+		int w = gsm660_bitorder[i];
+
+		for (k = 0; k < 4; k++) {
+			if (w == efr_rep_w[k])
+				efr_rep_d[k][0] = i;
+			if (w == efr_rep_w[k] + 1)
+				efr_rep_d[k][1] = i;
+		}
+		if (w == efr_rep_w[0] || w == efr_rep_w[0] + 1
+		 || w == efr_rep_w[1] || w == efr_rep_w[1] + 1
+		 || w == efr_rep_w[2] || w == efr_rep_w[2] + 1
+		 || w == efr_rep_w[3] || w == efr_rep_w[3] + 1)
+			continue;
+		efr_s_d[efr_w_to_s(w)] = i;
+	}
+
+	for (i = 0; i < 112; i++) {
+		hr_b_d[0][gsm620_unvoiced_bitorder[i]] = i;
+		hr_b_d[1][gsm620_voiced_bitorder[i]] = i;
+	}
+
+	tables_initialized = 1;
+}
+
+static inline ubit_t pbit(const uint8_t *data, unsigned int pos)
+{
+	return (data[pos >> 3] >> (~pos & 7)) & 1;
+}
+
+static inline uint8_t pack8(const ubit_t *in)
+{
+	return in[0] << 7 | in[1] << 6 | in[2] << 5 | in[3] << 4
+		| in[4] << 3 | in[5] << 2 | in[6] << 1 | in[7];
+}
+
+static inline uint8_t gather8(const ubit_t *in, const uint16_t *idx)
+{
+	return in[idx[0]] << 7 | in[idx[1]] << 6 | in[idx[2]] << 5
+		| in[idx[3]] << 4 | in[idx[4]] << 3 | in[idx[5]] << 2
+		| in[idx[6]] << 1 | in[idx[7]];
+}
+
+static inline uint8_t gather4(const ubit_t *in, const uint16_t *idx)
+{
+	return in[idx[0]] << 3 | in[idx[1]] << 2 | in[idx[2]] << 1
+		| in[idx[3]];
+}
+
+void gsm0503_tch_fr_payload_to_d(ubit_t *d, const uint8_t *tch_data,
+				 int net_order)
+{
+	const uint16_t *pos;
+	int i;
+
+	if (!tables_initialized)
+		tables_init();
+
+	pos = fr_d_pos[!!net_order];
+	for (i = 0; i < 260; i++)
+		d[i] = pbit(tch_data, pos[i]);
+}
+
+void gsm0503_tch_fr_d_to_payload(uint8_t *tch_data, const ubit_t *d,
+				 int net_order)
+{
+	const uint16_t *idx;
+	int i;
+
+	if (!tables_initialized)
+		tables_init();
+
+	idx = fr_pos_d[!!net_order];
+	tch_data[0] = 0xd << 4 | gather4(d, idx);
+	for (i = 1; i < GSM_FR_BYTES; i++)
+		tch_data[i] = gather8(d, idx + 8 * i - 4);
+}
+
+void gsm0503_tch_efr_payload_protected(ubit_t *b, const uint8_t *tch_data)
+{
+	int i;
+
+	for (i = 0; i < 65; i++)
+		b[i] = pbit(tch_data, 4 + gsm0503_gsm_efr_protected_bits[i] - 1);
+}
+
+void gsm0503_tch_efr_payload_to_d(ubit_t *d, const uint8_t *tch_data,
+				  const ubit_t *p)
+{
+	int i;
+
+	if (!tables_initialized)
+		tables_init();
+
+	for (i = 0; i < 260; i++) {
+		if (efr_d_pos[i] & EFR_P)
+			d[i] = p[efr_d_pos[i] & ~EFR_P];
+		else
+			d[i] = pbit(tch_data, efr_d_pos[i]);
+	}
+}
+
+void gsm0503_tch_efr_d_to_s(ubit_t *s, ubit_t *p, const ubit_t *d)
+{
+	int i, sum;
+
+	if (!tables_initialized)
+		tables_init();
+
+	for (i = 0; i < 244; i++)
+		s[i] = d[efr_s_d[i]];
+	for (i = 0; i < 8; i++)
+		p[i] = d[efr_s_d[244 + i]];
+
+	/* all three copies have to agree on a 1.  The last one is voted
+	 * with s-bit 220, like the former tch_efr_unreorder() did. */
+	for (i = 0; i < 4; i++) {
+		sum = s[efr_vote_s[i]] + d[efr_rep_d[i][0]]
+			+ d[efr_rep_d[i][1]];
+		s[efr_rep_s[i]] = (sum > 2);
+	}
+}
+
+void gsm0503_tch_efr_s_to_payload(uint8_t *tch_data, const ubit_t *s)
+{
+	int i;
+
+	tch_data[0] = 0xc << 4 | s[0] << 3 | s[1] << 2 | s[2] << 1 | s[3];
+	for (i = 1; i < GSM_EFR_BYTES; i++)
+		tch_data[i] = pack8(s + 8 * i - 4);
+}
+
+void gsm0503_tch_hr_payload_to_d(ubit_t *d, const uint8_t *tch_data)
+{
+	const uint16_t *map;
+	int i;
+
+	/* b-bits 34 and 35 are the mode */
+	if (!pbit(tch_data, 8 + 34) && !pbit(tch_data, 8 + 35))
+		map = gsm620_unvoiced_bitorder;
+	else
+		map = gsm620_voiced_bitorder;
+
+	for (i = 0; i < 112; i++)
+		d[i] = pbit(tch_data, 8 + map[i]);
+}
+
+void gsm0503_tch_hr_d_to_payload(uint8_t *tch_data, const ubit_t *d)
+{
+	const uint16_t *idx;
+	int i;
+
+	if (!tables_initialized)
+		tables_init();
+
+	if (!d[93] && !d[94])
+		idx = hr_b_d[0];
+	else
+		idx = hr_b_d[1];
+
+	tch_data[0] = 0x00; /* F = 0, FT = 000 */
+	for (i = 0; i < 14; i++)
+		tch_data[1 + i] = gather8(d, idx + 8 * i);
+}
+
+void gsm0503_tch_amr_payload_to_d(ubit_t *d, const uint8_t *tch_data,
+				  int len)
+{
+	int i;
+
+	for (i = 0; i < len >> 3; i++)
+		memcpy(d + 8 * i, byte_ubits[tch_data[i]], 8);
+	if (len & 7)
+		memcpy(d + 8 * i, byte_ubits[tch_data[i]], len & 7);
+}
+
+void gsm0503_tch_amr_d_to_payload(uint8_t *tch_data, const ubit_t *d,
+				  int len)
+{
+	ubit_t tail[8];
+	int i;
+
+	for (i = 0; i < len >> 3; i++)
+		tch_data[i] = pack8(d + 8 * i);
+	if (len & 7) {
+		memset(tail, 0, sizeof(tail));
+		memcpy(tail, d + 8 * i, len & 7);
+		tch_data[i] = pack8(tail);
+	}
+}
@@ -0,0 +1,28 @@
+#ifndef _0503_TCH_ORDER_H
+#define _0503_TCH_ORDER_H
+
+/* Conversion between the packed TCH speech payload (RTP format) and the
+ * class ordered d-bits the channel coder works on, see TS 05.03 3.1 */
+
+void gsm0503_tch_fr_payload_to_d(ubit_t *d, const uint8_t *tch_data,
+				 int net_order);
+void gsm0503_tch_fr_d_to_payload(uint8_t *tch_data, const ubit_t *d,
+				 int net_order);
+
+/* the 65 bits protected by the EFR CRC */
+void gsm0503_tch_efr_payload_protected(ubit_t *b, const uint8_t *tch_data);
+/* 'p' are the 8 bits of the EFR CRC */
+void gsm0503_tch_efr_payload_to_d(ubit_t *d, const uint8_t *tch_data,
+				  const ubit_t *p);
+void gsm0503_tch_efr_d_to_s(ubit_t *s, ubit_t *p, const ubit_t *d);
+void gsm0503_tch_efr_s_to_payload(uint8_t *tch_data, const ubit_t *s);
+
+void gsm0503_tch_hr_payload_to_d(ubit_t *d, const uint8_t *tch_data);
+void gsm0503_tch_hr_d_to_payload(uint8_t *tch_data, const ubit_t *d);
+
+void gsm0503_tch_amr_payload_to_d(ubit_t *d, const uint8_t *tch_data,
+				  int len);
+void gsm0503_tch_amr_d_to_payload(uint8_t *tch_data, const ubit_t *d,
+				  int len);
+
+#endif /* _0503_TCH_ORDER_H */
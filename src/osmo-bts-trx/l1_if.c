@@ -39,6 +39,7 @@
 #include <osmo-bts/amr.h>
 #include <osmo-bts/abis.h>
 #include <osmo-bts/scheduler.h>
+#include <osmo-bts/bringup.h>
 
 #include "l1_if.h"
 #include "trx_if.h"
@@ -288,6 +289,8 @@ static int trx_init(struct gsm_bts_trx *trx)
 
 	/* power on transceiver, if not already */
 	if (!l1h->config.poweron) {
+		/* ends when all control commands are answered */
+		bringup_begin("trx_provision", trx->nr, -1);
 		l1h->config.poweron = 1;
 		l1h->config.poweron_sent = 0;
 		l1if_provision_transceiver_trx(l1h);
@@ -559,14 +562,14 @@ void l1if_fill_meas_res(struct osmo_phsap_prim *l1sap, uint8_t chan_nr, float ta
 int l1if_process_meas_res(struct gsm_bts_trx *trx, uint8_t tn, uint32_t fn, uint8_t chan_nr,
 	int n_errors, int n_bits_total, float rssi, float toa)
 {
-	struct gsm_lchan *lchan = &trx->ts[tn].lchan[l1sap_chan2ss(chan_nr)];
+	struct gsm_lchan *lchan = get_lchan_by_chan_nr(trx, chan_nr);
 	struct osmo_phsap_prim l1sap;
 	/* 100% BER is n_bits_total is 0 */
 	float ber = n_bits_total==0 ? 1.0 : (float)n_errors / (float)n_bits_total;
 
 	LOGP(DMEAS, LOGL_DEBUG, "RX L1 frame %s fn=%u chan_nr=0x%02x MS pwr=%ddBm rssi=%.1f dBFS "
 		"ber=%.2f%% (%d/%d bits) L1_ta=%d rqd_ta=%d toa=%.2f\n",
-		gsm_lchan_name(lchan), fn, chan_nr, ms_pwr_dbm(lchan->ts->trx->bts->band, lchan->ms_power),
+		gsm_lchan_name(lchan), fn, chan_nr, ms_pwr_dbm(lchan->ts->trx->bts->band, lchan->ms_power_ctrl.current),
 		rssi, ber*100, n_errors, n_bits_total, lchan->meas.l1_info[1], lchan->rqd_ta, toa);
 
 	l1if_fill_meas_res(&l1sap, chan_nr, lchan->rqd_ta + toa, ber, rssi);
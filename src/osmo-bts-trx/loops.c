@@ -25,16 +25,16 @@
 #include <errno.h>
 
 #include <osmo-bts/gsm_data.h>
+#include <osmo-bts/bts.h>
 #include <osmo-bts/logging.h>
 #include <osmo-bts/l1sap.h>
+#include <osmo-bts/power_control.h>
 #include <osmocom/core/bits.h>
 
 #include "trx_if.h"
 #include "l1_if.h"
 #include "loops.h"
 
-#define MS_PWR_DBM(arfcn, lvl) ms_pwr_dbm(gsm_arfcn2band(arfcn), lvl)
-
 /*
  * MS Power loop
  */
@@ -42,56 +42,6 @@
 int trx_ms_power_loop = 0;
 int8_t trx_target_rssi = -10;
 
-static int ms_power_diff(struct gsm_lchan *lchan, uint8_t chan_nr, int8_t diff)
-{
-	struct gsm_bts_trx *trx = lchan->ts->trx;
-	uint16_t arfcn = trx->arfcn;
-	int8_t new_power;
-
-	new_power = lchan->ms_power - (diff >> 1);
-
-	if (diff == 0)
-		return 0;
-
-	if (new_power < 0)
-		new_power = 0;
-
-	// FIXME: to go above 1W, we need to know classmark of MS
-	if (arfcn >= 512 && arfcn <= 885) {
-		if (new_power > 15)
-			new_power = 15;
-	} else {
-		if (new_power > 19)
-			new_power = 19;
-	}
-
-	/* a higher value means a lower level (and vice versa) */
-	if (new_power > lchan->ms_power + MS_LOWER_MAX)
-		new_power = lchan->ms_power + MS_LOWER_MAX;
-	else if (new_power < lchan->ms_power - MS_RAISE_MAX)
-		new_power = lchan->ms_power - MS_RAISE_MAX;
-
-	if (lchan->ms_power == new_power) {
-		LOGP(DLOOP, LOGL_INFO, "Keeping MS new_power of trx=%u "
-			"chan_nr=0x%02x at control level %d (%d dBm)\n",
-			trx->nr, chan_nr, new_power,
-			MS_PWR_DBM(arfcn, new_power));
-
-		return 0;
-	}
-
-	LOGP(DLOOP, LOGL_INFO, "%s MS new_power of trx=%u chan_nr=0x%02x from "
-		"control level %d (%d dBm) to %d (%d dBm)\n",
-		(diff > 0) ? "Raising" : "Lowering",
-		trx->nr, chan_nr, lchan->ms_power,
-		MS_PWR_DBM(arfcn, lchan->ms_power), new_power,
-		MS_PWR_DBM(arfcn, new_power));
-
-	lchan->ms_power = new_power;
-
-	return 0;
-}
-
 static int ms_power_val(struct l1sched_chan_state *chan_state, int8_t rssi)
 {
 	/* ignore inserted dummy frames, treat as lost frames */
@@ -100,16 +50,10 @@ static int ms_power_val(struct l1sched_chan_state *chan_state, int8_t rssi)
 
 	LOGP(DLOOP, LOGL_DEBUG, "Got RSSI value of %d\n", rssi);
 
-	chan_state->meas.rssi_count++;
-
 	chan_state->meas.rssi_got_burst = 1;
 
-	/* store and process RSSI */
-	if (chan_state->meas.rssi_valid_count
-					== ARRAY_SIZE(chan_state->meas.rssi))
-		return 0;
-	chan_state->meas.rssi[chan_state->meas.rssi_valid_count++] = rssi;
-	chan_state->meas.rssi_valid_count++;
+	/* only the lowest RSSI is used, see ms_power_clock() */
+	meas_acc_add(&chan_state->meas.rssi, rssi);
 
 	return 0;
 }
@@ -118,53 +62,50 @@ static int ms_power_clock(struct gsm_lchan *lchan,
 	uint8_t chan_nr, struct l1sched_chan_state *chan_state)
 {
 	struct gsm_bts_trx *trx = lchan->ts->trx;
-	int rssi;
-	int i;
+	struct gsm_bts_role_bts *btsb = bts_role_bts(trx->bts);
+	int rssi, delta;
 
 	/* skip every second clock, to prevent oscillating due to roundtrip
 	 * delay */
 	if (!(chan_state->meas.clock & 1))
 		return 0;
 
-	LOGP(DLOOP, LOGL_DEBUG, "Got SACCH master clock at RSSI count %d\n",
-		chan_state->meas.rssi_count);
+	LOGP(DLOOP, LOGL_DEBUG, "Got SACCH master clock at RSSI count %u\n",
+		chan_state->meas.rssi.num);
 
 	/* wait for initial burst */
 	if (!chan_state->meas.rssi_got_burst)
 		return 0;
 
 	/* if no burst was received from MS at clock */
-	if (chan_state->meas.rssi_count == 0) {
+	if (chan_state->meas.rssi.num == 0) {
 		LOGP(DLOOP, LOGL_NOTICE, "LOST SACCH frame of trx=%u "
 			"chan_nr=0x%02x, so we raise MS power\n",
 			trx->nr, chan_nr);
-		return ms_power_diff(lchan, chan_nr, MS_RAISE_MAX);
+		return lchan_ms_pwr_change(lchan, 2 * MS_RAISE_MAX);
 	}
 
-	/* reset total counter */
-	chan_state->meas.rssi_count = 0;
-
-	/* check the minimum level received after MS acknowledged the ordered
-	 * power level */
-	if (chan_state->meas.rssi_valid_count == 0)
-		return 0;
-	for (rssi = 999, i = 0; i < chan_state->meas.rssi_valid_count; i++) {
-		if (rssi > chan_state->meas.rssi[i])
-			rssi = chan_state->meas.rssi[i];
-	}
+	/* check the minimum level received since the last clock */
+	rssi = meas_acc_min(&chan_state->meas.rssi);
+	meas_acc_reset(&chan_state->meas.rssi);
 
-	/* reset valid counter */
-	chan_state->meas.rssi_valid_count = 0;
+	/* change RSSI, the common loop filters, the step limits of this
+	 * loop come on top */
+	delta = power_ctrl_step(&btsb->ul_power_ctrl,
+				&lchan_role_bts(lchan)->ul_pwr,
+				trx_target_rssi, rssi, 0);
+	if (delta > 2 * MS_RAISE_MAX)
+		delta = 2 * MS_RAISE_MAX;
+	else if (delta < -2 * MS_LOWER_MAX)
+		delta = -2 * MS_LOWER_MAX;
 
-	/* change RSSI */
 	LOGP(DLOOP, LOGL_DEBUG, "Lowest RSSI: %d Target RSSI: %d Current "
 		"MS power: %d (%d dBm) of trx=%u chan_nr=0x%02x\n", rssi,
-		trx_target_rssi, lchan->ms_power,
-		MS_PWR_DBM(trx->arfcn, lchan->ms_power),
+		trx_target_rssi, lchan->ms_power_ctrl.current,
+		ms_pwr_dbm(trx->bts->band, lchan->ms_power_ctrl.current),
 		trx->nr, chan_nr);
-	ms_power_diff(lchan, chan_nr, trx_target_rssi - rssi);
 
-	return 0;
+	return lchan_ms_pwr_change(lchan, delta);
 }
 
 
@@ -178,27 +119,31 @@ int ta_val(struct gsm_lchan *lchan, uint8_t chan_nr,
 	struct l1sched_chan_state *chan_state, float toa)
 {
 	struct gsm_bts_trx *trx = lchan->ts->trx;
+	int32_t toa256;
 
 	/* check if the current L1 header acks to the current ordered TA */
 	if (lchan->meas.l1_info[1] != lchan->rqd_ta)
 		return 0;
 
 	/* sum measurement */
-	chan_state->meas.toa_sum += toa;
-	if (++(chan_state->meas.toa_num) < 16)
+	meas_acc_add(&chan_state->meas.toa,
+		     meas_acc_fix(toa, MEAS_ACC_TOA_SHIFT));
+	if (chan_state->meas.toa.num < 16)
 		return 0;
 
-	/* complete set */
-	toa = chan_state->meas.toa_sum / chan_state->meas.toa_num;
+	/* complete set, +/- 0.9 symbols are 230/256 */
+	toa256 = meas_acc_avg(&chan_state->meas.toa);
+	toa = meas_acc_float(toa256, MEAS_ACC_TOA_SHIFT);
+	meas_acc_reset(&chan_state->meas.toa);
 
 	/* check for change of TOA */
-	if (toa < -0.9F && lchan->rqd_ta > 0) {
+	if (toa256 < -230 && lchan->rqd_ta > 0) {
 		LOGP(DLOOP, LOGL_INFO, "TOA of trx=%u chan_nr=0x%02x is too "
 			"early (%.2f), now lowering TA from %d to %d\n",
 			trx->nr, chan_nr, toa, lchan->rqd_ta,
 			lchan->rqd_ta - 1);
 		lchan->rqd_ta--;
-	} else if (toa > 0.9F && lchan->rqd_ta < 63) {
+	} else if (toa256 > 230 && lchan->rqd_ta < 63) {
 		LOGP(DLOOP, LOGL_INFO, "TOA of trx=%u chan_nr=0x%02x is too "
 			"late (%.2f), now raising TA from %d to %d\n",
 			trx->nr, chan_nr, toa, lchan->rqd_ta,
@@ -209,19 +154,15 @@ int ta_val(struct gsm_lchan *lchan, uint8_t chan_nr,
 			"correct (%.2f), keeping current TA of %d\n",
 			trx->nr, chan_nr, toa, lchan->rqd_ta);
 
-	chan_state->meas.toa_num = 0;
-	chan_state->meas.toa_sum = 0;
-
 	return 0;
 }
 
 int trx_loop_sacch_input(struct l1sched_trx *l1t, uint8_t chan_nr,
 	struct l1sched_chan_state *chan_state, int8_t rssi, float toa)
 {
-	struct gsm_lchan *lchan = &l1t->trx->ts[L1SAP_CHAN2TS(chan_nr)]
-					.lchan[l1sap_chan2ss(chan_nr)];
+	struct gsm_lchan *lchan = get_lchan_by_chan_nr(l1t->trx, chan_nr);
 
-	if (trx_ms_power_loop)
+	if (trx_ms_power_loop && !trx_ms_pwr_ctrl_is_osmo(l1t->trx))
 		ms_power_val(chan_state, rssi);
 
 	if (trx_ta_loop)
@@ -233,10 +174,9 @@ int trx_loop_sacch_input(struct l1sched_trx *l1t, uint8_t chan_nr,
 int trx_loop_sacch_clock(struct l1sched_trx *l1t, uint8_t chan_nr,
 	struct l1sched_chan_state *chan_state)
 {
-	struct gsm_lchan *lchan = &l1t->trx->ts[L1SAP_CHAN2TS(chan_nr)]
-					.lchan[l1sap_chan2ss(chan_nr)];
+	struct gsm_lchan *lchan = get_lchan_by_chan_nr(l1t->trx, chan_nr);
 
-	if (trx_ms_power_loop)
+	if (trx_ms_power_loop && !trx_ms_pwr_ctrl_is_osmo(l1t->trx))
 		ms_power_clock(lchan, chan_nr, chan_state);
 
 	/* count the number of SACCH clocks */
@@ -249,8 +189,7 @@ int trx_loop_amr_input(struct l1sched_trx *l1t, uint8_t chan_nr,
 	struct l1sched_chan_state *chan_state, float ber)
 {
 	struct gsm_bts_trx *trx = l1t->trx;
-	struct gsm_lchan *lchan = &trx->ts[L1SAP_CHAN2TS(chan_nr)]
-					.lchan[l1sap_chan2ss(chan_nr)];
+	struct gsm_lchan *lchan = get_lchan_by_chan_nr(trx, chan_nr);
 	int c_i;
 
 	/* check if loop is enabled */
@@ -261,28 +200,23 @@ int trx_loop_amr_input(struct l1sched_trx *l1t, uint8_t chan_nr,
 	if (chan_state->ul_ft != chan_state->dl_cmr)
 		return 0;
 
-	/* count bit errors */
-	if (L1SAP_IS_CHAN_TCHH(chan_nr)) {
-		chan_state->ber_num += 2;
-		chan_state->ber_sum += (ber + ber);
-	} else {
-		chan_state->ber_num++;
-		chan_state->ber_sum += ber;
-	}
+	/* count bit errors, a TCH/H frame counts twice */
+	meas_acc_add_n(&chan_state->ber, meas_acc_fix(ber, MEAS_ACC_BER_SHIFT),
+		       L1SAP_IS_CHAN_TCHH(chan_nr) ? 2 : 1);
 
 	/* count frames */
-	if (chan_state->ber_num < 48)
+	if (chan_state->ber.num < 48)
 		return 0;
 
 	/* calculate average (reuse ber variable) */
-	ber = chan_state->ber_sum / chan_state->ber_num;
+	ber = meas_acc_float(meas_acc_avg(&chan_state->ber),
+			     MEAS_ACC_BER_SHIFT);
 
 	/* FIXME: calculate C/I from BER */
 	c_i = ber * 100;
 
 	/* reset bit errors */
-	chan_state->ber_num = 0;
-	chan_state->ber_sum = 0;
+	meas_acc_reset(&chan_state->ber);
 
 	LOGP(DLOOP, LOGL_DEBUG, "Current bit error rate (BER) %.6f "
 		"codec id %d of trx=%u chan_nr=0x%02x\n", ber,
@@ -334,8 +268,7 @@ int trx_loop_amr_set(struct l1sched_chan_state *chan_state, int loop)
 		chan_state->amr_loop = 1;
 
 		/* reset bit errors */
-		chan_state->ber_num = 0;
-		chan_state->ber_sum = 0;
+		meas_acc_reset(&chan_state->ber);
 
 		return 0;
 	}
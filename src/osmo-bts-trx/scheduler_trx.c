@@ -39,6 +39,7 @@
 #include <osmo-bts/msg_utils.h>
 #include <osmo-bts/scheduler.h>
 #include <osmo-bts/scheduler_backend.h>
+#include <osmo-bts/hotlog.h>
 
 #include "l1_if.h"
 #include "gsm0503_coding.h"
@@ -164,9 +165,11 @@ ubit_t *tx_data_fn(struct l1sched_trx *l1t, uint8_t tn, uint32_t fn,
 	if (msg)
 		goto got_msg;
 
-	LOGP(DL1C, LOGL_INFO, "%s has not been served !! No prim for "
-		"trx=%u ts=%u at fn=%u to transmit.\n", 
-		trx_chan_desc[chan].name, l1t->trx->nr, tn, fn);
+	HOTTRACE(DL1C, LOGL_INFO, "chan %u not served, no prim for trx=%u "
+		 "ts=%u at fn=%u\n", chan, l1t->trx->nr, tn, fn);
+	LOGP_HOT(DL1C, LOGL_INFO, "%s has not been served !! No prim for "
+		 "trx=%u ts=%u at fn=%u to transmit.\n",
+		 trx_chan_desc[chan].name, l1t->trx->nr, tn, fn);
 
 no_msg:
 	/* free burst memory */
@@ -806,10 +809,6 @@ int rx_data_fn(struct l1sched_trx *l1t, uint8_t tn, uint32_t fn,
 	sbit_t *burst, **bursts_p = &chan_state->ul_bursts;
 	uint32_t *first_fn = &chan_state->ul_first_fn;
 	uint8_t *mask = &chan_state->ul_mask;
-	float *rssi_sum = &chan_state->rssi_sum;
-	uint8_t *rssi_num = &chan_state->rssi_num;
-	float *toa_sum = &chan_state->toa_sum;
-	uint8_t *toa_num = &chan_state->toa_num;
 	uint8_t l2[GSM_MACBLOCK_LEN], l2_len;
 	int n_errors, n_bits_total;
 	int rc;
@@ -833,18 +832,14 @@ int rx_data_fn(struct l1sched_trx *l1t, uint8_t tn, uint32_t fn,
 		memset(*bursts_p, 0, 464);
 		*mask = 0x0;
 		*first_fn = fn;
-		*rssi_sum = 0;
-		*rssi_num = 0;
-		*toa_sum = 0;
-		*toa_num = 0;
+		meas_acc_reset(&chan_state->rssi);
+		meas_acc_reset(&chan_state->toa);
 	}
 
 	/* update mask + rssi */
 	*mask |= (1 << bid);
-	*rssi_sum += rssi;
-	(*rssi_num)++;
-	*toa_sum += toa;
-	(*toa_num)++;
+	meas_acc_add(&chan_state->rssi, rssi);
+	meas_acc_add(&chan_state->toa, meas_acc_fix(toa, MEAS_ACC_TOA_SHIFT));
 
 	/* copy burst to buffer of 4 bursts */
 	burst = *bursts_p + bid * 116;
@@ -888,13 +883,14 @@ int rx_data_fn(struct l1sched_trx *l1t, uint8_t tn, uint32_t fn,
 		l2_len = GSM_MACBLOCK_LEN;
 
 	/* Send uplnk measurement information to L2 */
+	rssi = meas_acc_avg(&chan_state->rssi);
+	toa = meas_acc_float(meas_acc_avg(&chan_state->toa), MEAS_ACC_TOA_SHIFT);
 	l1if_process_meas_res(l1t->trx, tn, fn, trx_chan_desc[chan].chan_nr | tn,
-		n_errors, n_bits_total, *rssi_sum / *rssi_num, *toa_sum / *toa_num);
+		n_errors, n_bits_total, rssi, toa);
 	uint16_t ber10k =
 		(n_bits_total == 0) ? 10000 : 10000 * n_errors / n_bits_total;
 	return _sched_compose_ph_data_ind(l1t, tn, *first_fn, chan, l2, l2_len,
-					  *rssi_sum / *rssi_num,
-					  4 * (*toa_sum) / *toa_num, 0, ber10k,
+					  rssi, 4 * toa, 0, ber10k,
 					  PRES_INFO_UNKNOWN);
 }
 
@@ -906,10 +902,6 @@ int rx_pdtch_fn(struct l1sched_trx *l1t, uint8_t tn, uint32_t fn,
 	struct l1sched_chan_state *chan_state = &l1ts->chan_state[chan];
 	sbit_t *burst, **bursts_p = &chan_state->ul_bursts;
 	uint8_t *mask = &chan_state->ul_mask;
-	float *rssi_sum = &chan_state->rssi_sum;
-	uint8_t *rssi_num = &chan_state->rssi_num;
-	float *toa_sum = &chan_state->toa_sum;
-	uint8_t *toa_num = &chan_state->toa_num;
 	uint8_t l2[EGPRS_0503_MAX_BYTES];
 	int n_errors, n_bursts_bits, n_bits_total;
 	int rc;
@@ -929,18 +921,14 @@ int rx_pdtch_fn(struct l1sched_trx *l1t, uint8_t tn, uint32_t fn,
 	if (bid == 0) {
 		memset(*bursts_p, 0, GSM0503_EGPRS_BURSTS_NBITS);
 		*mask = 0x0;
-		*rssi_sum = 0;
-		*rssi_num = 0;
-		*toa_sum = 0;
-		*toa_num = 0;
+		meas_acc_reset(&chan_state->rssi);
+		meas_acc_reset(&chan_state->toa);
 	}
 
 	/* update mask + rssi */
 	*mask |= (1 << bid);
-	*rssi_sum += rssi;
-	(*rssi_num)++;
-	*toa_sum += toa;
-	(*toa_num)++;
+	meas_acc_add(&chan_state->rssi, rssi);
+	meas_acc_add(&chan_state->toa, meas_acc_fix(toa, MEAS_ACC_TOA_SHIFT));
 
 	/* copy burst to buffer of 4 bursts */
 	if (nbits == EGPRS_BURST_LEN) {
@@ -984,8 +972,10 @@ int rx_pdtch_fn(struct l1sched_trx *l1t, uint8_t tn, uint32_t fn,
 
 
 	/* Send uplnk measurement information to L2 */
+	rssi = meas_acc_avg(&chan_state->rssi);
+	toa = meas_acc_float(meas_acc_avg(&chan_state->toa), MEAS_ACC_TOA_SHIFT);
 	l1if_process_meas_res(l1t->trx, tn, fn, trx_chan_desc[chan].chan_nr | tn,
-		n_errors, n_bits_total, *rssi_sum / *rssi_num, *toa_sum / *toa_num);
+		n_errors, n_bits_total, rssi, toa);
 
 	if (rc <= 0) {
 		LOGP(DL1C, LOGL_DEBUG, "Received bad PDTCH block ending at "
@@ -996,7 +986,7 @@ int rx_pdtch_fn(struct l1sched_trx *l1t, uint8_t tn, uint32_t fn,
 	uint16_t ber10k =
 		(n_bits_total == 0) ? 10000 : 10000 * n_errors / n_bits_total;
 	return _sched_compose_ph_data_ind(l1t, tn, (fn + GSM_HYPERFRAME - 3) % GSM_HYPERFRAME, chan,
-		l2, rc, *rssi_sum / *rssi_num, 4 * (*toa_sum) / *toa_num, 0,
+		l2, rc, rssi, 4 * toa, 0,
 					  ber10k, PRES_INFO_BOTH);
 }
 
@@ -1020,8 +1010,11 @@ int rx_tchf_fn(struct l1sched_trx *l1t, uint8_t tn, uint32_t fn,
 	if (chan_state->ho_rach_detect == 1)
 		return rx_rach_fn(l1t, tn, fn, chan, bid, bits, GSM_BURST_LEN, rssi, toa);
 
-	LOGP(DL1C, LOGL_DEBUG, "TCH/F received %s fn=%u ts=%u trx=%u bid=%u\n", 
-		trx_chan_desc[chan].name, fn, tn, l1t->trx->nr, bid);
+	HOTTRACE(DL1C, LOGL_DEBUG, "TCH/F received fn=%u ts=%u trx=%u "
+		 "bid=%u\n", fn, tn, l1t->trx->nr, bid);
+	LOGP_HOT(DL1C, LOGL_DEBUG, "TCH/F received %s fn=%u ts=%u trx=%u "
+		 "bid=%u\n", trx_chan_desc[chan].name, fn, tn, l1t->trx->nr,
+		 bid);
 
 	/* alloc burst memory, if not already */
 	if (!*bursts_p) {
@@ -39,6 +39,8 @@
 #include <osmo-bts/logging.h>
 #include <osmo-bts/bts.h>
 #include <osmo-bts/scheduler.h>
+#include <osmo-bts/hotlog.h>
+#include <osmo-bts/bringup.h>
 
 #include "l1_if.h"
 #include "trx_if.h"
@@ -157,35 +159,60 @@ static int trx_clk_read_cb(struct osmo_fd *ofd, unsigned int what)
 
 static void trx_ctrl_timer_cb(void *data);
 
-/* send first ctrl message and start timer */
+/* Commands are sent without waiting for the responses of the previous
+ * ones, up to TRX_CTRL_WINDOW of them.  The transceiver handles and
+ * answers them in order.  POWERON and POWEROFF depend on all commands
+ * before them and change what the ones after them do, so they are only
+ * sent alone. */
+#define TRX_CTRL_WINDOW	8
+
+/* send the queued ctrl messages the window allows, start timer */
 static void trx_ctrl_send(struct trx_l1h *l1h)
 {
 	struct trx_ctrl_msg *tcm;
+	int num_sent = 0;
+
+	llist_for_each_entry(tcm, &l1h->trx_ctrl_list, list) {
+		if (tcm->sent) {
+			if (tcm->barrier)
+				break;
+			num_sent++;
+			continue;
+		}
+		if (num_sent >= TRX_CTRL_WINDOW
+		 || (tcm->barrier && num_sent))
+			break;
+
+		LOGP(DTRX, LOGL_DEBUG, "Sending control '%s' to %s\n",
+			tcm->cmd, phy_instance_name(l1h->phy_inst));
+		/* send command */
+		send(l1h->trx_ofd_ctrl.fd, tcm->cmd, strlen(tcm->cmd)+1, 0);
+		tcm->sent = 1;
+		num_sent++;
+
+		if (tcm->barrier)
+			break;
+	}
 
-	/* get first command */
-	if (llist_empty(&l1h->trx_ctrl_list))
-		return;
-	tcm = llist_entry(l1h->trx_ctrl_list.next, struct trx_ctrl_msg, list);
-
-	LOGP(DTRX, LOGL_DEBUG, "Sending control '%s' to %s\n", tcm->cmd,
-		phy_instance_name(l1h->phy_inst));
-	/* send command */
-	send(l1h->trx_ofd_ctrl.fd, tcm->cmd, strlen(tcm->cmd)+1, 0);
-
-	/* start timer */
-	l1h->trx_ctrl_timer.cb = trx_ctrl_timer_cb;
-	l1h->trx_ctrl_timer.data = l1h;
-	osmo_timer_schedule(&l1h->trx_ctrl_timer, 2, 0);
+	/* start timer, if not running for an earlier command */
+	if (num_sent && !osmo_timer_pending(&l1h->trx_ctrl_timer)) {
+		l1h->trx_ctrl_timer.cb = trx_ctrl_timer_cb;
+		l1h->trx_ctrl_timer.data = l1h;
+		osmo_timer_schedule(&l1h->trx_ctrl_timer, 2, 0);
+	}
 }
 
-/* send first ctrl message and start timer */
+/* resend all unanswered ctrl messages */
 static void trx_ctrl_timer_cb(void *data)
 {
 	struct trx_l1h *l1h = data;
+	struct trx_ctrl_msg *tcm;
 
 	LOGP(DTRX, LOGL_NOTICE, "No response from transceiver for %s\n",
 		phy_instance_name(l1h->phy_inst));
 
+	llist_for_each_entry(tcm, &l1h->trx_ctrl_list, list)
+		tcm->sent = 0;
 	trx_ctrl_send(l1h);
 }
 
@@ -195,7 +222,7 @@ static int trx_ctrl_cmd(struct trx_l1h *l1h, int critical, const char *cmd,
 {
 	struct trx_ctrl_msg *tcm;
 	va_list ap;
-	int l, pending = 0;
+	int l;
 
 	if (!transceiver_available &&
 	    !(!strcmp(cmd, "POWEROFF") || !strcmp(cmd, "POWERON"))) {
@@ -204,9 +231,6 @@ static int trx_ctrl_cmd(struct trx_l1h *l1h, int critical, const char *cmd,
 		return -EIO;
 	}
 
-	if (!llist_empty(&l1h->trx_ctrl_list))
-		pending = 1;
-
 	/* create message */
 	tcm = talloc_zero(tall_bts_ctx, struct trx_ctrl_msg);
 	if (!tcm)
@@ -220,12 +244,14 @@ static int trx_ctrl_cmd(struct trx_l1h *l1h, int critical, const char *cmd,
 		snprintf(tcm->cmd, sizeof(tcm->cmd)-1, "CMD %s", cmd);
 	tcm->cmd_len = strlen(cmd);
 	tcm->critical = critical;
+	tcm->barrier = !strcmp(cmd, "POWEROFF") || !strcmp(cmd, "POWERON");
+	tcm->echo_args = !strcmp(cmd, "SETSLOT") || !strcmp(cmd, "HANDOVER")
+		|| !strcmp(cmd, "NOHANDOVER");
 	llist_add_tail(&tcm->list, &l1h->trx_ctrl_list);
 	LOGP(DTRX, LOGL_INFO, "Adding new control '%s'\n", tcm->cmd);
 
-	/* send message, if no pending message */
-	if (!pending)
-		trx_ctrl_send(l1h);
+	/* send message, if the window allows */
+	trx_ctrl_send(l1h);
 
 	return 0;
 }
@@ -337,6 +363,26 @@ int trx_if_cmd_nohandover(struct trx_l1h *l1h, uint8_t tn, uint8_t ss)
 	return trx_ctrl_cmd(l1h, 1, "NOHANDOVER", "%d %d", tn, ss);
 }
 
+/* check if a response answers a sent command.  The per-timeslot commands
+ * are sent for several timeslots at once, their responses repeat the
+ * arguments (e.g. "RSP SETSLOT <status> <tn> <type>") to tell them apart */
+static int trx_ctrl_rsp_match(const struct trx_ctrl_msg *tcm,
+	const char *rsp, int rsp_len, const char *rsp_args)
+{
+	const char *args;
+
+	if (!tcm->sent || rsp_len != tcm->cmd_len
+	 || strncmp(rsp, tcm->cmd + 4, rsp_len))
+		return 0;
+	if (!tcm->echo_args)
+		return 1;
+
+	args = tcm->cmd + 4 + tcm->cmd_len;
+	if (*args == ' ')
+		args++;
+	return !strcmp(args, rsp_args);
+}
+
 /* get response from ctrl socket */
 static int trx_ctrl_read_cb(struct osmo_fd *ofd, unsigned int what)
 {
@@ -352,7 +398,7 @@ static int trx_ctrl_read_cb(struct osmo_fd *ofd, unsigned int what)
 
 	if (!strncmp(buf, "RSP ", 4)) {
 		struct trx_ctrl_msg *tcm;
-		char *p;
+		char *p, *args;
 		int rsp_len = 0;
 
 		/* calculate the length of response item */
@@ -361,35 +407,44 @@ static int trx_ctrl_read_cb(struct osmo_fd *ofd, unsigned int what)
 			rsp_len = p - buf - 4;
 		else
 			rsp_len = strlen(buf) - 4;
+		/* the arguments repeated after the status */
+		if (p && (args = strchr(p + 1, ' ')))
+			args++;
+		else
+			args = "";
 
 		LOGP(DTRX, LOGL_INFO, "Response message: '%s'\n", buf);
 
-		/* abort timer and send next message, if any */
-		if (osmo_timer_pending(&l1h->trx_ctrl_timer))
-			osmo_timer_del(&l1h->trx_ctrl_timer);
-
 		/* get command for response message */
 		if (llist_empty(&l1h->trx_ctrl_list)) {
 			LOGP(DTRX, LOGL_NOTICE, "Response message without "
 				"command\n");
 			return -EINVAL;
 		}
-		tcm = llist_entry(l1h->trx_ctrl_list.next, struct trx_ctrl_msg,
-			list);
 
-		/* check if respose matches command */
-		if (rsp_len != tcm->cmd_len) {
-			notmatch:
+		/* the oldest sent command it answers, as the transceiver
+		 * answers in order */
+		llist_for_each_entry(tcm, &l1h->trx_ctrl_list, list) {
+			if (trx_ctrl_rsp_match(tcm, buf + 4, rsp_len, args))
+				break;
+		}
+		if (&tcm->list == &l1h->trx_ctrl_list) {
+			/* compare with the oldest command, as we did before
+			 * commands were pipelined.  Non-critical ones are
+			 * kept, their timer re-sends them. */
+			tcm = llist_entry(l1h->trx_ctrl_list.next,
+				struct trx_ctrl_msg, list);
 			LOGP(DTRX, (tcm->critical) ? LOGL_FATAL : LOGL_NOTICE,
 				"Response message '%s' does not match command "
 				"message '%s'\n", buf, tcm->cmd);
-			goto rsp_error;
+			if (tcm->critical)
+				goto rsp_error;
+			return 0;
 		}
-		if (!!strncmp(buf + 4, tcm->cmd + 4, rsp_len))
-			goto notmatch;
 
 		/* check for response code */
-		sscanf(p + 1, "%d", &resp);
+		if (!p || sscanf(p + 1, "%d", &resp) != 1)
+			resp = -1;
 		if (resp) {
 			LOGP(DTRX, (tcm->critical) ? LOGL_FATAL : LOGL_NOTICE,
 				"transceiver (%s) rejected TRX command "
@@ -403,11 +458,15 @@ rsp_error:
 			}
 		}
 
-		/* remove command from list */
+		/* remove command from list, restart the timer for the
+		 * remaining ones */
 		llist_del(&tcm->list);
 		talloc_free(tcm);
+		osmo_timer_del(&l1h->trx_ctrl_timer);
 
 		trx_ctrl_send(l1h);
+		if (llist_empty(&l1h->trx_ctrl_list))
+			bringup_end("trx_provision", pinst->trx->nr, -1);
 	} else
 		LOGP(DTRX, LOGL_NOTICE, "Unknown message on ctrl port: %s\n",
 			buf);
@@ -464,8 +523,10 @@ static int trx_data_read_cb(struct osmo_fd *ofd, unsigned int what)
 		return -EINVAL;
 	}
 
-	LOGP(DTRX, LOGL_DEBUG, "RX burst tn=%u fn=%u rssi=%d toa=%.2f\n",
-		tn, fn, rssi, toa);
+	HOTTRACE(DTRX, LOGL_DEBUG, "RX burst tn=%u fn=%u rssi=%d toa256=%d\n",
+		 tn, fn, rssi, (int16_t)(buf[6] << 8) | buf[7]);
+	LOGP_HOT(DTRX, LOGL_DEBUG, "RX burst tn=%u fn=%u rssi=%d toa=%.2f\n",
+		 tn, fn, rssi, toa);
 
 #ifdef TOA_RSSI_DEBUG
 	char deb[128];
@@ -491,7 +552,10 @@ int trx_if_data(struct trx_l1h *l1h, uint8_t tn, uint32_t fn, uint8_t pwr,
 		return -1;
 	}
 
-	LOGP(DTRX, LOGL_DEBUG, "TX burst tn=%u fn=%u pwr=%u\n", tn, fn, pwr);
+	HOTTRACE(DTRX, LOGL_DEBUG, "TX burst tn=%u fn=%u pwr=%u\n",
+		 tn, fn, pwr, 0);
+	LOGP_HOT(DTRX, LOGL_DEBUG, "TX burst tn=%u fn=%u pwr=%u\n",
+		 tn, fn, pwr);
 
 	buf[0] = tn;
 	buf[1] = (fn >> 24) & 0xff;
@@ -626,6 +690,8 @@ void trx_if_flush(struct trx_l1h *l1h)
 		llist_del(&tcm->list);
 		talloc_free(tcm);
 	}
+
+	osmo_timer_del(&l1h->trx_ctrl_timer);
 }
 
 void trx_if_close(struct trx_l1h *l1h)
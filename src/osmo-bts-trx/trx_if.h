@@ -13,6 +13,9 @@ struct trx_ctrl_msg {
 	char 			cmd[128];
 	int			cmd_len;
 	int			critical;
+	int			barrier;	/* not overlapped with others */
+	int			echo_args;	/* args repeated in the response */
+	int			sent;
 };
 
 int trx_if_cmd_poweroff(struct trx_l1h *l1h);
@@ -44,6 +44,7 @@
 #include "l1_if.h"
 #include "trx_if.h"
 #include "loops.h"
+#include "gsm0503_coding.h"
 
 #define OSMOTRX_STR	"OsmoTRX Transceiver configuration\n"
 
@@ -197,6 +198,25 @@ DEFUN(cfg_bts_no_timing_advance_loop, cfg_bts_no_timing_advance_loop_cmd,
 	return CMD_SUCCESS;
 }
 
+DEFUN(cfg_bts_amr_mode_search, cfg_bts_amr_mode_search_cmd,
+	"amr-mode-search",
+	"Decode AMR speech frames with all active modes, if the CRC fails "
+	"for the mode indicated in band\n")
+{
+	gsm0503_amr_mode_search = 1;
+
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_bts_no_amr_mode_search, cfg_bts_no_amr_mode_search_cmd,
+	"no amr-mode-search",
+	NO_STR "Decode AMR speech frames only with the mode indicated in band\n")
+{
+	gsm0503_amr_mode_search = 0;
+
+	return CMD_SUCCESS;
+}
+
 DEFUN(cfg_bts_settsc, cfg_bts_settsc_cmd,
 	"settsc",
 	"Use SETTSC to configure transceiver\n")
@@ -530,6 +550,8 @@ void bts_model_config_write_bts(struct vty *vty, struct gsm_bts *bts)
 		vty_out(vty, " no ms-power-loop%s", VTY_NEWLINE);
 	vty_out(vty, " %stiming-advance-loop%s", (trx_ta_loop) ? "":"no ",
 		VTY_NEWLINE);
+	if (gsm0503_amr_mode_search)
+		vty_out(vty, " amr-mode-search%s", VTY_NEWLINE);
 	if (settsc_enabled)
 		vty_out(vty, " settsc%s", VTY_NEWLINE);
 	if (setbsic_enabled)
@@ -551,6 +573,8 @@ int bts_model_vty_init(struct gsm_bts *bts)
 	install_element(BTS_NODE, &cfg_bts_no_ms_power_loop_cmd);
 	install_element(BTS_NODE, &cfg_bts_timing_advance_loop_cmd);
 	install_element(BTS_NODE, &cfg_bts_no_timing_advance_loop_cmd);
+	install_element(BTS_NODE, &cfg_bts_amr_mode_search_cmd);
+	install_element(BTS_NODE, &cfg_bts_no_amr_mode_search_cmd);
 	install_element(BTS_NODE, &cfg_bts_settsc_cmd);
 	install_element(BTS_NODE, &cfg_bts_setbsic_cmd);
 	install_element(BTS_NODE, &cfg_bts_no_settsc_cmd);
@@ -23,12 +23,16 @@
 #include <unistd.h>
 #include <string.h>
 #include <stdlib.h>
+#include <sys/time.h>
 
 #include <osmocom/core/bits.h>
 #include <osmocom/core/utils.h>
+#include <osmocom/codec/codec.h>
 #include <osmo-bts/gsm_data.h>
 
 #include "../../src/osmo-bts-trx/gsm0503_coding.h"
+#include "../../src/osmo-bts-trx/gsm0503_tables.h"
+#include "../../src/osmo-bts-trx/gsm0503_tch_order.h"
 
 #include <osmo-bts/logging.h>
 
@@ -441,6 +445,621 @@ uint8_t test_macblock[][54] = {
 	0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17 },
 };
 
+/* TCH bit order conversion, compared against the bit-at-a-time code in
+ * gsm0503_coding.c it replaced */
+
+static void ref_tch_fr_reassemble(uint8_t *tch_data, ubit_t *b_bits, int net_order)
+{
+	int i, j, k, l, o;
+
+	tch_data[0] = 0xd << 4;
+	memset(tch_data + 1, 0, 32);
+
+	if (net_order) {
+		i = 0; /* counts bits */
+		j = 4; /* counts output bits */
+		while (i < 260) {
+			tch_data[j>>3] |= (b_bits[i] << (7-(j&7)));
+			i++;
+			j++;
+		}
+		return;
+	}
+
+	/* reassemble d-bits */
+	i = 0; /* counts bits */
+	j = 4; /* counts output bits */
+	k = gsm0503_gsm_fr_map[0]-1; /* current number bit in element */
+	l = 0; /* counts element bits */
+	o = 0; /* offset input bits */
+	while (i < 260) {
+		tch_data[j>>3] |= (b_bits[k+o] << (7-(j&7)));
+		if (--k < 0) {
+			o += gsm0503_gsm_fr_map[l];
+			k = gsm0503_gsm_fr_map[++l]-1;
+		}
+		i++;
+		j++;
+	}
+}
+
+static void ref_tch_fr_disassemble(ubit_t *b_bits, uint8_t *tch_data, int net_order)
+{
+	int i, j, k, l, o;
+
+	if (net_order) {
+		i = 0; /* counts bits */
+		j = 4; /* counts output bits */
+		while (i < 260) {
+			b_bits[i] = (tch_data[j>>3] >> (7-(j&7))) & 1;
+			i++;
+			j++;
+		}
+		return;
+	}
+
+	i = 0; /* counts bits */
+	j = 4; /* counts input bits */
+	k = gsm0503_gsm_fr_map[0]-1; /* current number bit in element */
+	l = 0; /* counts element bits */
+	o = 0; /* offset output bits */
+	while (i < 260) {
+		b_bits[k+o] = (tch_data[j>>3] >> (7-(j&7))) & 1;
+		if (--k < 0) {
+			o += gsm0503_gsm_fr_map[l];
+			k = gsm0503_gsm_fr_map[++l]-1;
+		}
+		i++;
+		j++;
+	}
+}
+
+static void ref_tch_hr_reassemble(uint8_t *tch_data, ubit_t *b_bits)
+{
+	int i, j;
+
+	tch_data[0] = 0x00; /* F = 0, FT = 000 */
+	memset(tch_data + 1, 0, 14);
+
+	i = 0; /* counts bits */
+	j = 8; /* counts output bits */
+	while (i < 112) {
+		tch_data[j>>3] |= (b_bits[i] << (7-(j&7)));
+		i++;
+		j++;
+	}
+}
+
+static void ref_tch_hr_disassemble(ubit_t *b_bits, uint8_t *tch_data)
+{
+	int i, j;
+
+	i = 0; /* counts bits */
+	j = 8; /* counts output bits */
+	while (i < 112) {
+		b_bits[i] = (tch_data[j>>3] >> (7-(j&7))) & 1;
+		i++;
+		j++;
+	}
+}
+
+static void ref_tch_efr_reassemble(uint8_t *tch_data, ubit_t *b_bits)
+{
+	int i, j;
+
+	tch_data[0] = 0xc << 4;
+	memset(tch_data + 1, 0, 30);
+
+	i = 0; /* counts bits */
+	j = 4; /* counts output bits */
+	while (i < 244) {
+		tch_data[j>>3] |= (b_bits[i] << (7-(j&7)));
+		i++;
+		j++;
+	}
+}
+
+static void ref_tch_efr_disassemble(ubit_t *b_bits, uint8_t *tch_data)
+{
+	int i, j;
+
+	i = 0; /* counts bits */
+	j = 4; /* counts output bits */
+	while (i < 244) {
+		b_bits[i] = (tch_data[j>>3] >> (7-(j&7))) & 1;
+		i++;
+		j++;
+	}
+}
+
+static void ref_tch_amr_reassemble(uint8_t *tch_data, ubit_t *d_bits, int len)
+{
+	int i, j;
+
+	memset(tch_data, 0, (len + 7) >> 3);
+
+	i = 0; /* counts bits */
+	j = 0; /* counts output bits */
+	while (i < len) {
+		tch_data[j>>3] |= (d_bits[i] << (7-(j&7)));
+		i++;
+		j++;
+	}
+}
+
+static void ref_tch_amr_disassemble(ubit_t *d_bits, uint8_t *tch_data, int len)
+{
+	int i, j;
+
+	i = 0; /* counts bits */
+	j = 0; /* counts output bits */
+	while (i < len) {
+		d_bits[i] = (tch_data[j>>3] >> (7-(j&7))) & 1;
+		i++;
+		j++;
+	}
+}
+
+static void ref_tch_fr_d_to_b(ubit_t *b_bits, ubit_t *d_bits)
+{
+	int i;
+
+	for (i = 0; i < 260; i++)
+		b_bits[gsm610_bitorder[i]] = d_bits[i];
+}
+
+static void ref_tch_fr_b_to_d(ubit_t *d_bits, ubit_t *b_bits)
+{
+	int i;
+
+	for (i = 0; i < 260; i++)
+		d_bits[i] = b_bits[gsm610_bitorder[i]];
+}
+
+static void ref_tch_hr_d_to_b(ubit_t *b_bits, ubit_t *d_bits)
+{
+	int i;
+
+	const uint16_t *map;
+
+	if (!d_bits[93] && !d_bits[94])
+		map = gsm620_unvoiced_bitorder;
+	else
+		map = gsm620_voiced_bitorder;
+
+	for (i = 0; i < 112; i++)
+		b_bits[map[i]] = d_bits[i];
+}
+
+static void ref_tch_hr_b_to_d(ubit_t *d_bits, ubit_t *b_bits)
+{
+	int i;
+	const uint16_t *map;
+
+	if (!b_bits[34] && !b_bits[35])
+		map = gsm620_unvoiced_bitorder;
+	else
+		map = gsm620_voiced_bitorder;
+
+	for (i = 0; i < 112; i++)
+		d_bits[i] = b_bits[map[i]];
+}
+
+static void ref_tch_efr_d_to_w(ubit_t *b_bits, ubit_t *d_bits)
+{
+	int i;
+
+	for (i = 0; i < 260; i++)
+		b_bits[gsm660_bitorder[i]] = d_bits[i];
+}
+
+static void ref_tch_efr_w_to_d(ubit_t *d_bits, ubit_t *b_bits)
+{
+	int i;
+
+	for (i = 0; i < 260; i++)
+		d_bits[i] = b_bits[gsm660_bitorder[i]];
+}
+
+static void ref_tch_efr_protected(ubit_t *s_bits, ubit_t *b_bits)
+{
+	int i;
+
+	for (i = 0; i < 65; i++)
+		b_bits[i] = s_bits[gsm0503_gsm_efr_protected_bits[i]-1];
+}
+
+static void ref_tch_efr_reorder(ubit_t *w, ubit_t *s, ubit_t *p)
+{
+	memcpy(w, s, 71);
+	w[71] = w[72] = s[69];
+	memcpy(w+73, s+71, 50);
+	w[123] = w[124] = s[119];
+	memcpy(w+125, s+121, 53);
+	w[178] = w[179] = s[172];
+	memcpy(w+180, s+174, 50);
+	w[230] = w[231] = s[222];
+	memcpy(w+232, s+224, 20);
+	memcpy(w+252, p, 8);
+}
+
+static void ref_tch_efr_unreorder(ubit_t *s, ubit_t *p, ubit_t *w)
+{
+	int sum;
+
+	memcpy(s, w, 71);
+	sum = s[69] + w[71] + w[72];
+	s[69] = (sum > 2);
+	memcpy(s+71, w+73, 50);
+	sum = s[119] + w[123] + w[124];
+	s[119] = (sum > 2);
+	memcpy(s+121, w+125, 53);
+	sum = s[172] + w[178] + w[179];
+	s[172] = (sum > 2);
+	memcpy(s+174, w+180, 50);
+	sum = s[220] + w[230] + w[231];
+	s[222] = (sum > 2);
+	memcpy(s+224, w+232, 20);
+	memcpy(p, w+252, 8);
+}
+
+#define TCH_ORDER_RUNS		1000
+#define TCH_ORDER_BENCH_ITER	100000
+
+static const int amr_lens[] = { 244, 204, 159, 148, 134, 118, 103, 95 };
+
+/* same numbers on every platform, unlike rand() */
+static uint32_t lcg_state = 1;
+
+static uint32_t lcg(void)
+{
+	lcg_state = lcg_state * 1103515245 + 12345;
+	return lcg_state >> 8;
+}
+
+static void rand_bytes(uint8_t *buf, int len)
+{
+	int i;
+
+	for (i = 0; i < len; i++)
+		buf[i] = lcg();
+}
+
+static void rand_ubits(ubit_t *buf, int len)
+{
+	int i;
+
+	for (i = 0; i < len; i++)
+		buf[i] = (lcg() >> 7) & 1;
+}
+
+static void ref_fr_payload_to_d(ubit_t *d, uint8_t *tch_data, int net_order)
+{
+	ubit_t w[260];
+
+	ref_tch_fr_disassemble(w, tch_data, net_order);
+	ref_tch_fr_b_to_d(d, w);
+}
+
+static void ref_fr_d_to_payload(uint8_t *tch_data, ubit_t *d, int net_order)
+{
+	ubit_t w[260];
+
+	ref_tch_fr_d_to_b(w, d);
+	ref_tch_fr_reassemble(tch_data, w, net_order);
+}
+
+static void test_tch_order_fr(void)
+{
+	uint8_t pl[GSM_FR_BYTES], pl_ref[GSM_FR_BYTES];
+	ubit_t d[260], d_ref[260];
+	int i, net_order;
+
+	for (net_order = 0; net_order < 2; net_order++) {
+		for (i = 0; i < TCH_ORDER_RUNS; i++) {
+			rand_bytes(pl, sizeof(pl));
+			gsm0503_tch_fr_payload_to_d(d, pl, net_order);
+			ref_fr_payload_to_d(d_ref, pl, net_order);
+			ASSERT_TRUE(!memcmp(d, d_ref, sizeof(d)));
+
+			rand_ubits(d, sizeof(d));
+			gsm0503_tch_fr_d_to_payload(pl, d, net_order);
+			ref_fr_d_to_payload(pl_ref, d, net_order);
+			ASSERT_TRUE(!memcmp(pl, pl_ref, sizeof(pl)));
+		}
+	}
+	printf("tch_order: FR ok\n");
+}
+
+static void test_tch_order_efr(void)
+{
+	uint8_t pl[GSM_EFR_BYTES], pl_ref[GSM_EFR_BYTES];
+	ubit_t s[244], s_ref[244], w[260], b[65], b_ref[65];
+	ubit_t d[260], d_ref[260], p[8], p_ref[8];
+	int i;
+
+	for (i = 0; i < TCH_ORDER_RUNS; i++) {
+		rand_bytes(pl, sizeof(pl));
+		rand_ubits(p, sizeof(p));
+		gsm0503_tch_efr_payload_protected(b, pl);
+		gsm0503_tch_efr_payload_to_d(d, pl, p);
+		ref_tch_efr_disassemble(s_ref, pl);
+		ref_tch_efr_protected(s_ref, b_ref);
+		ref_tch_efr_reorder(w, s_ref, p);
+		ref_tch_efr_w_to_d(d_ref, w);
+		ASSERT_TRUE(!memcmp(b, b_ref, sizeof(b)));
+		ASSERT_TRUE(!memcmp(d, d_ref, sizeof(d)));
+
+		/* random d-bits, so the repetitions disagree */
+		rand_ubits(d, sizeof(d));
+		gsm0503_tch_efr_d_to_s(s, p, d);
+		ref_tch_efr_d_to_w(w, d);
+		ref_tch_efr_unreorder(s_ref, p_ref, w);
+		ASSERT_TRUE(!memcmp(s, s_ref, sizeof(s)));
+		ASSERT_TRUE(!memcmp(p, p_ref, sizeof(p)));
+
+		gsm0503_tch_efr_s_to_payload(pl, s);
+		ref_tch_efr_reassemble(pl_ref, s);
+		ASSERT_TRUE(!memcmp(pl, pl_ref, sizeof(pl)));
+	}
+	printf("tch_order: EFR ok\n");
+}
+
+static void test_tch_order_hr(void)
+{
+	uint8_t pl[15], pl_ref[15];
+	ubit_t b[112], d[112], d_ref[112];
+	int i;
+
+	for (i = 0; i < TCH_ORDER_RUNS; i++) {
+		rand_bytes(pl, sizeof(pl));
+		gsm0503_tch_hr_payload_to_d(d, pl);
+		ref_tch_hr_disassemble(b, pl);
+		ref_tch_hr_b_to_d(d_ref, b);
+		ASSERT_TRUE(!memcmp(d, d_ref, sizeof(d)));
+
+		rand_ubits(d, sizeof(d));
+		gsm0503_tch_hr_d_to_payload(pl, d);
+		ref_tch_hr_d_to_b(b, d);
+		ref_tch_hr_reassemble(pl_ref, b);
+		ASSERT_TRUE(!memcmp(pl, pl_ref, sizeof(pl)));
+	}
+	printf("tch_order: HR ok\n");
+}
+
+static void test_tch_order_amr(void)
+{
+	uint8_t pl[31], pl_ref[31];
+	ubit_t d[244], d_ref[244];
+	int i, j, len;
+
+	for (j = 0; j < ARRAY_SIZE(amr_lens); j++) {
+		len = amr_lens[j];
+		for (i = 0; i < TCH_ORDER_RUNS; i++) {
+			rand_bytes(pl, sizeof(pl));
+			gsm0503_tch_amr_payload_to_d(d, pl, len);
+			ref_tch_amr_disassemble(d_ref, pl, len);
+			ASSERT_TRUE(!memcmp(d, d_ref, len));
+
+			rand_ubits(d, len);
+			gsm0503_tch_amr_d_to_payload(pl, d, len);
+			ref_tch_amr_reassemble(pl_ref, d, len);
+			ASSERT_TRUE(!memcmp(pl, pl_ref, (len + 7) >> 3));
+		}
+	}
+	printf("tch_order: AMR ok\n");
+}
+
+static unsigned long usec_since(const struct timeval *start)
+{
+	struct timeval stop;
+
+	gettimeofday(&stop, NULL);
+	return (stop.tv_sec - start->tv_sec) * 1000000
+		+ stop.tv_usec - start->tv_usec;
+}
+
+/* micro benchmark, the figures are informational only */
+static void bench_tch_order(void)
+{
+	uint8_t pl[GSM_FR_BYTES];
+	ubit_t d[260];
+	struct timeval start;
+	int i;
+
+	rand_bytes(pl, sizeof(pl));
+
+	gettimeofday(&start, NULL);
+	for (i = 0; i < TCH_ORDER_BENCH_ITER; i++)
+		ref_fr_payload_to_d(d, pl, 0);
+	fprintf(stderr, "FR payload to d, bitwise: %lu ns per frame\n",
+		usec_since(&start) * 1000 / TCH_ORDER_BENCH_ITER);
+	gettimeofday(&start, NULL);
+	for (i = 0; i < TCH_ORDER_BENCH_ITER; i++)
+		gsm0503_tch_fr_payload_to_d(d, pl, 0);
+	fprintf(stderr, "FR payload to d, table: %lu ns per frame\n",
+		usec_since(&start) * 1000 / TCH_ORDER_BENCH_ITER);
+
+	gettimeofday(&start, NULL);
+	for (i = 0; i < TCH_ORDER_BENCH_ITER; i++)
+		ref_fr_d_to_payload(pl, d, 0);
+	fprintf(stderr, "FR d to payload, bitwise: %lu ns per frame\n",
+		usec_since(&start) * 1000 / TCH_ORDER_BENCH_ITER);
+	gettimeofday(&start, NULL);
+	for (i = 0; i < TCH_ORDER_BENCH_ITER; i++)
+		gsm0503_tch_fr_d_to_payload(pl, d, 0);
+	fprintf(stderr, "FR d to payload, table: %lu ns per frame\n",
+		usec_since(&start) * 1000 / TCH_ORDER_BENCH_ITER);
+
+	gettimeofday(&start, NULL);
+	for (i = 0; i < TCH_ORDER_BENCH_ITER; i++)
+		ref_tch_amr_disassemble(d, pl, 244);
+	fprintf(stderr, "AMR 12.2 payload to d, bitwise: %lu ns per frame\n",
+		usec_since(&start) * 1000 / TCH_ORDER_BENCH_ITER);
+	gettimeofday(&start, NULL);
+	for (i = 0; i < TCH_ORDER_BENCH_ITER; i++)
+		gsm0503_tch_amr_payload_to_d(d, pl, 244);
+	fprintf(stderr, "AMR 12.2 payload to d, table: %lu ns per frame\n",
+		usec_since(&start) * 1000 / TCH_ORDER_BENCH_ITER);
+}
+
+static void test_tch_order(void)
+{
+	test_tch_order_fr();
+	test_tch_order_efr();
+	test_tch_order_hr();
+	test_tch_order_amr();
+	bench_tch_order();
+}
+
+/* a frame sent with the codec list 'tx' is received with the codec list
+ * 'rx', in which its codec mode indication is out of range.  This is what
+ * a corrupt indication looks like to the decoder. */
+static void test_amr_mode_search(int ahs)
+{
+	uint8_t tx[4] = { 0, 2, 4, 5 };
+	uint8_t rx[3] = { 0, 2, 5 };
+	uint8_t speech[20], result[20];
+	ubit_t bursts_u[116 * 8];
+	sbit_t bursts_s[116 * 8];
+	uint8_t ft, cmr = 0;
+	int n_errors, n_bits_total;
+	int i, rc, search, len = sizeof(speech);
+
+	/* TCH/A*S7.95, 159 bits */
+	for (i = 0; i < len; i++)
+		speech[i] = i * 37 + 11;
+	speech[len - 1] &= 0xfe;
+
+	for (search = 0; search < 2; search++) {
+		memset(bursts_u, 0x23, sizeof(bursts_u));
+		memset(bursts_s, 0, sizeof(bursts_s));
+
+		/* indicated as ID 3 */
+		if (ahs)
+			rc = tch_ahs_encode(bursts_u, speech, len, 0, tx, 4, 3, 0);
+		else
+			rc = tch_afs_encode(bursts_u, speech, len, 0, tx, 4, 3, 0);
+		ASSERT_TRUE(rc == 0);
+		ubits2sbits(bursts_u, bursts_s, 116 * 8);
+
+		gsm0503_amr_mode_search = search;
+		ft = 0;
+		if (ahs)
+			rc = tch_ahs_decode(result, bursts_s, 0, 0, rx, 3, &ft,
+				&cmr, &n_errors, &n_bits_total);
+		else
+			rc = tch_afs_decode(result, bursts_s, 0, rx, 3, &ft,
+				&cmr, &n_errors, &n_bits_total);
+
+		printf("%s mode search %s: rc=%d\n",
+			ahs ? "tch_ahs_decode" : "tch_afs_decode",
+			search ? "on" : "off", rc);
+		if (search) {
+			ASSERT_TRUE(rc == len);
+			ASSERT_TRUE(ft == 2);
+			ASSERT_TRUE(!memcmp(speech, result, len));
+		} else
+			ASSERT_TRUE(rc == 3);
+	}
+
+	gsm0503_amr_mode_search = 0;
+}
+
+#define AMR_NOISE_RUNS	200
+
+static int amr_noise_decode(int ahs, sbit_t *bursts_s, uint8_t *codec,
+	int search)
+{
+	uint8_t result[31], ft = 0, cmr = 0;
+	int n_errors, n_bits_total;
+
+	gsm0503_amr_mode_search = search;
+	if (ahs)
+		return tch_ahs_decode(result, bursts_s, 0, 0, codec, 4, &ft,
+			&cmr, &n_errors, &n_bits_total);
+	return tch_afs_decode(result, bursts_s, 0, codec, 4, &ft, &cmr,
+		&n_errors, &n_bits_total);
+}
+
+/* the CRC of some mode matches noise quite often, mode search must not
+ * turn random or badly corrupted frames into speech */
+static void test_amr_mode_search_noise(int ahs)
+{
+	uint8_t codec[4] = { 0, 2, 4, 5 };
+	/* TCH/A*S4.75, 5.9, 7.4 and 7.95 */
+	int len[4] = { 12, 15, 19, 20 };
+	uint8_t speech[20];
+	ubit_t bursts_u[116 * 8];
+	sbit_t bursts_s[116 * 8];
+	int i, j, rc;
+
+	for (i = 0; i < AMR_NOISE_RUNS; i++) {
+		rand_ubits(bursts_u, 116 * 8);
+		ubits2sbits(bursts_u, bursts_s, 116 * 8);
+		rc = amr_noise_decode(ahs, bursts_s, codec, 0);
+		ASSERT_TRUE(amr_noise_decode(ahs, bursts_s, codec, 1) == rc);
+	}
+
+	for (i = 0; i < AMR_NOISE_RUNS; i++) {
+		/* every mode, a quarter of the bits flipped */
+		rand_bytes(speech, sizeof(speech));
+		if (ahs)
+			rc = tch_ahs_encode(bursts_u, speech, len[i % 4], 0,
+				codec, 4, i % 4, 0);
+		else
+			rc = tch_afs_encode(bursts_u, speech, len[i % 4], 0,
+				codec, 4, i % 4, 0);
+		ASSERT_TRUE(rc == 0);
+		for (j = 0; j < 116 * 8; j++)
+			bursts_u[j] ^= !(lcg() & 0x300);
+		ubits2sbits(bursts_u, bursts_s, 116 * 8);
+		rc = amr_noise_decode(ahs, bursts_s, codec, 0);
+		ASSERT_TRUE(amr_noise_decode(ahs, bursts_s, codec, 1) == rc);
+	}
+
+	gsm0503_amr_mode_search = 0;
+
+	printf("%s mode search: no random or corrupted frame recovered\n",
+		ahs ? "tch_ahs_decode" : "tch_afs_decode");
+}
+
+#define AMR_BENCH_RUNS	1000
+
+/* micro benchmark, the figures are informational only.  A frame that no
+ * mode decodes is the worst case: mode search tries every active mode
+ * after the indicated one failed */
+static void bench_amr_mode_search(int ahs)
+{
+	uint8_t codec[4] = { 0, 2, 4, 5 };
+	ubit_t bursts_u[116 * 8];
+	sbit_t bursts_s[116 * 8];
+	struct timeval start;
+	unsigned long usec, total, worst;
+	int i, search;
+
+	for (search = 0; search < 2; search++) {
+		total = worst = 0;
+		for (i = 0; i < AMR_BENCH_RUNS; i++) {
+			rand_ubits(bursts_u, 116 * 8);
+			ubits2sbits(bursts_u, bursts_s, 116 * 8);
+			gettimeofday(&start, NULL);
+			amr_noise_decode(ahs, bursts_s, codec, search);
+			usec = usec_since(&start);
+			total += usec;
+			if (usec > worst)
+				worst = usec;
+		}
+		fprintf(stderr, "%s mode search %s: %lu us per frame, "
+			"%lu us worst case\n",
+			ahs ? "tch_ahs_decode" : "tch_afs_decode",
+			search ? "on" : "off", total / AMR_BENCH_RUNS, worst);
+	}
+
+	gsm0503_amr_mode_search = 0;
+}
+
+
 uint8_t test_speech_fr[GSM_FR_BYTES];
 uint8_t test_speech_efr[GSM_EFR_BYTES];
 uint8_t test_speech_hr[15];
@@ -491,6 +1110,15 @@ int main(int argc, char **argv)
 		test_pdtch(test_macblock[i], 54);
 	}
 
+	test_tch_order();
+
+	test_amr_mode_search(0);
+	test_amr_mode_search(1);
+	test_amr_mode_search_noise(0);
+	test_amr_mode_search_noise(1);
+	bench_amr_mode_search(0);
+	bench_amr_mode_search(1);
+
 	printf("Success\n");
 
 	return 0;
@@ -0,0 +1,133 @@
+/* testing the pcap output of the GSMTAP tap ring */
+
+/* (C) 2017 by sysmocom s.f.m.c. GmbH
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/select.h>
+#include <osmocom/core/utils.h>
+#include <osmocom/core/gsmtap.h>
+
+#include <osmo-bts/logging.h>
+#include <osmo-bts/gsmtap_ring.h>
+
+extern void *tall_bts_ctx;
+
+/* pcap file header, record header, IPv4/UDP header, GSMTAP header */
+#define PCAP_FILE_HDR_LEN	24
+#define PCAP_REC_LEN(len)	(16 + 28 + sizeof(struct gsmtap_hdr) + (len))
+
+static const uint8_t frame[23] = { 0x55, 0x06, 0x19, };
+
+static void enqueue(unsigned int num)
+{
+	const struct gsmtap_ring_stats *st = gsmtap_ring_get_stats();
+	unsigned int i, done;
+
+	for (i = 0; i < num; i++)
+		OSMO_ASSERT(gsmtap_ring_enqueue(871, 0, GSMTAP_CHANNEL_BCCH,
+						0, i, frame,
+						sizeof(frame)) == 0);
+
+	/* run the writer until all records are handled */
+	done = st->pcap_written + st->pcap_err + num;
+	while (st->pcap_written + st->pcap_err < done)
+		osmo_select_main(0);
+}
+
+static void dump_stats(void)
+{
+	const struct gsmtap_ring_stats *st = gsmtap_ring_get_stats();
+
+	printf(" enqueued=%u written=%u not_written=%u files=%u fail=%u\n",
+		st->enqueued, st->pcap_written, st->pcap_err, st->pcap_files,
+		st->pcap_fail);
+}
+
+static off_t file_size(const char *path)
+{
+	struct stat sb;
+
+	OSMO_ASSERT(stat(path, &sb) == 0);
+	return sb.st_size;
+}
+
+static void test_pcap(void)
+{
+	const struct gsmtap_ring_stats *st = gsmtap_ring_get_stats();
+	char path[] = "/tmp/gsmtap_ring_test.XXXXXX";
+	int fd;
+
+	printf("Testing pcap output\n");
+
+	fd = mkstemp(path);
+	OSMO_ASSERT(fd >= 0);
+	close(fd);
+
+	OSMO_ASSERT(gsmtap_ring_set_pcap(path) == 0);
+	OSMO_ASSERT(gsmtap_ring_active);
+	enqueue(3);
+	dump_stats();
+	OSMO_ASSERT(st->pcap_written == 3);
+	OSMO_ASSERT(file_size(path) ==
+		    PCAP_FILE_HDR_LEN + 3 * PCAP_REC_LEN(sizeof(frame)));
+
+	printf("Testing pcap open failure\n");
+
+	/* the error is counted once, then the writer backs off */
+	OSMO_ASSERT(gsmtap_ring_set_pcap("/nonexistent/gsmtap.pcap") == 0);
+	enqueue(5);
+	enqueue(5);
+	dump_stats();
+	OSMO_ASSERT(st->pcap_fail == 1);
+	OSMO_ASSERT(st->pcap_err == 10);
+
+	/* a new path is tried right away */
+	OSMO_ASSERT(gsmtap_ring_set_pcap("/nonexistent/gsmtap2.pcap") == 0);
+	enqueue(1);
+	OSMO_ASSERT(st->pcap_fail == 2);
+
+	OSMO_ASSERT(gsmtap_ring_set_pcap(path) == 0);
+	enqueue(2);
+	dump_stats();
+	OSMO_ASSERT(st->pcap_fail == 2);
+	OSMO_ASSERT(file_size(path) ==
+		    PCAP_FILE_HDR_LEN + 2 * PCAP_REC_LEN(sizeof(frame)));
+
+	OSMO_ASSERT(gsmtap_ring_set_pcap(NULL) == 0);
+	OSMO_ASSERT(!gsmtap_ring_active);
+	unlink(path);
+}
+
+int main(int argc, char **argv)
+{
+	tall_bts_ctx = talloc_named_const(NULL, 1, "OsmoBTS context");
+	bts_log_init(NULL);
+
+	test_pcap();
+
+	printf("Success\n");
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,103 @@
+/* testing the rate limit of the hot path logging */
+
+/* (C) 2017 by sysmocom s.f.m.c. GmbH
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <osmo-bts/logging.h>
+#include <osmo-bts/hotlog.h>
+
+#include <osmocom/core/utils.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#include <unistd.h>
+
+/* number of messages admitted out of 'num' sent back to back */
+static unsigned int burst(int subsys, unsigned int num)
+{
+	unsigned int i, admitted = 0;
+
+	for (i = 0; i < num; i++)
+		admitted += hotlog_admit(subsys, LOGL_DEBUG);
+	return admitted;
+}
+
+static void test_default(void)
+{
+	printf("Testing default rate\n");
+
+	/* explicitly enabled logging is never throttled by default */
+	OSMO_ASSERT(hotlog_get_rate(DL1C) == 0);
+	OSMO_ASSERT(burst(DL1C, 1000) == 1000);
+	OSMO_ASSERT(hotlog_get_suppressed(DL1C) == 0);
+
+	/* unknown categories pass */
+	OSMO_ASSERT(hotlog_admit(-1, LOGL_DEBUG) == 1);
+	OSMO_ASSERT(hotlog_admit(HOTLOG_MAX_CAT, LOGL_DEBUG) == 1);
+	OSMO_ASSERT(hotlog_set_rate(HOTLOG_MAX_CAT, 10) == -EINVAL);
+}
+
+static void test_bucket(void)
+{
+	unsigned int admitted;
+
+	printf("Testing token bucket\n");
+
+	/* a full bucket holds one second worth of messages */
+	OSMO_ASSERT(hotlog_set_rate(DL1P, 10) == 0);
+	OSMO_ASSERT(hotlog_get_rate(DL1P) == 10);
+	admitted = burst(DL1P, 100);
+	printf(" burst: %u admitted\n", admitted);
+	OSMO_ASSERT(admitted == 10);
+	OSMO_ASSERT(hotlog_get_suppressed(DL1P) == 90);
+
+	/* other categories are not affected */
+	OSMO_ASSERT(burst(DL1C, 100) == 100);
+
+	/* refills with the configured rate, at least one token after
+	 * 200ms, never more than the bucket size */
+	usleep(200 * 1000);
+	admitted = burst(DL1P, 100);
+	OSMO_ASSERT(admitted >= 1 && admitted <= 10);
+	OSMO_ASSERT(hotlog_get_suppressed(DL1P) == 190 - admitted);
+
+	usleep(1500 * 1000);
+	admitted = burst(DL1P, 100);
+	printf(" after idle: %u admitted\n", admitted);
+	OSMO_ASSERT(admitted == 10);
+
+	/* setting a rate refills the bucket, 0 removes the limit */
+	OSMO_ASSERT(hotlog_set_rate(DL1P, 20) == 0);
+	OSMO_ASSERT(burst(DL1P, 100) == 20);
+	OSMO_ASSERT(hotlog_set_rate(DL1P, 0) == 0);
+	OSMO_ASSERT(burst(DL1P, 100) == 100);
+}
+
+int main(int argc, char **argv)
+{
+	bts_log_init(NULL);
+
+	test_default();
+	test_bucket();
+
+	printf("Success\n");
+
+	return 0;
+}
@@ -0,0 +1,226 @@
+/* testing the downlink RTP jitter buffer */
+
+/* (C) 2017 by sysmocom s.f.m.c. GmbH
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <osmo-bts/jitbuf.h>
+
+#include <osmocom/core/msgb.h>
+#include <osmocom/core/utils.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+
+/* frames are tagged with their sequence number in the first byte, the
+ * RTP timestamp is derived from it */
+static int put(struct jitbuf *jb, uint8_t seq)
+{
+	struct msgb *msg = msgb_alloc(16, "jitbuf test");
+
+	*msgb_put(msg, 1) = seq;
+	return jitbuf_put(jb, msg, 1000 + seq * JITBUF_FRAME_TS, seq * 4);
+}
+
+/* sequence number of the frame played out next, -1 for none */
+static int get(struct jitbuf *jb)
+{
+	struct msgb *msg = jitbuf_get(jb);
+	int seq;
+
+	if (!msg)
+		return -1;
+	seq = msg->data[0];
+	msgb_free(msg);
+	return seq;
+}
+
+static void dump_stats(const struct jitbuf *jb)
+{
+	const struct jitbuf_stats *st = &jb->stats;
+
+	printf(" in=%u out=%u late=%u dup=%u lost=%u underrun=%u depth=%u\n",
+		st->frames_in, st->frames_out, st->late, st->dup, st->lost,
+		st->underrun, jb->depth);
+}
+
+static void test_playout(void)
+{
+	struct jitbuf jb = { { 0 } };
+
+	printf("Testing prefill and playout\n");
+
+	jitbuf_init(&jb, 40, false);
+
+	OSMO_ASSERT(put(&jb, 0) == 0);
+	/* one frame buffered, depth is two */
+	OSMO_ASSERT(get(&jb) == -1);
+	OSMO_ASSERT(!jb.running);
+
+	OSMO_ASSERT(put(&jb, 1) == 0);
+	OSMO_ASSERT(get(&jb) == 0);
+	OSMO_ASSERT(jb.running);
+	OSMO_ASSERT(put(&jb, 2) == 0);
+	OSMO_ASSERT(get(&jb) == 1);
+	OSMO_ASSERT(get(&jb) == 2);
+
+	/* running dry restarts the prefill */
+	OSMO_ASSERT(get(&jb) == -1);
+	OSMO_ASSERT(!jb.running);
+	OSMO_ASSERT(jb.stats.underrun == 1);
+
+	OSMO_ASSERT(put(&jb, 10) == 0);
+	OSMO_ASSERT(get(&jb) == -1);
+	OSMO_ASSERT(put(&jb, 11) == 0);
+	OSMO_ASSERT(get(&jb) == 10);
+	OSMO_ASSERT(get(&jb) == 11);
+
+	dump_stats(&jb);
+	jitbuf_flush(&jb);
+}
+
+static void test_reorder(void)
+{
+	struct jitbuf jb = { { 0 } };
+	int i;
+
+	printf("Testing re-ordering\n");
+
+	jitbuf_init(&jb, 60, false);
+
+	OSMO_ASSERT(put(&jb, 0) == 0);
+	OSMO_ASSERT(put(&jb, 2) == 0);
+	OSMO_ASSERT(put(&jb, 1) == 0);
+	OSMO_ASSERT(get(&jb) == 0);
+
+	/* swapped pairs while running */
+	for (i = 3; i < 13; i += 2) {
+		OSMO_ASSERT(put(&jb, i + 1) == 0);
+		OSMO_ASSERT(put(&jb, i) == 0);
+		OSMO_ASSERT(get(&jb) == i - 2);
+		OSMO_ASSERT(get(&jb) == i - 1);
+	}
+	for (i = 11; i < 13; i++)
+		OSMO_ASSERT(get(&jb) == i);
+
+	/* during prefill, an older frame moves the playout point back */
+	OSMO_ASSERT(get(&jb) == -1);
+	OSMO_ASSERT(put(&jb, 22) == 0);
+	OSMO_ASSERT(put(&jb, 21) == 0);
+	OSMO_ASSERT(put(&jb, 20) == 0);
+	OSMO_ASSERT(get(&jb) == 20);
+	OSMO_ASSERT(get(&jb) == 21);
+	OSMO_ASSERT(get(&jb) == 22);
+
+	OSMO_ASSERT(jb.stats.lost == 0);
+	dump_stats(&jb);
+	jitbuf_flush(&jb);
+}
+
+static void test_late_dup(void)
+{
+	struct jitbuf jb = { { 0 } };
+
+	printf("Testing late and duplicate frames\n");
+
+	jitbuf_init(&jb, 40, false);
+
+	OSMO_ASSERT(put(&jb, 0) == 0);
+	OSMO_ASSERT(put(&jb, 1) == 0);
+	OSMO_ASSERT(put(&jb, 1) == -EEXIST);
+	OSMO_ASSERT(get(&jb) == 0);
+
+	/* frame 0 was already played out */
+	OSMO_ASSERT(put(&jb, 0) == -ETIME);
+	OSMO_ASSERT(put(&jb, 1) == -EEXIST);
+	OSMO_ASSERT(put(&jb, 2) == 0);
+	OSMO_ASSERT(get(&jb) == 1);
+	OSMO_ASSERT(get(&jb) == 2);
+
+	OSMO_ASSERT(jb.stats.late == 1);
+	OSMO_ASSERT(jb.stats.dup == 2);
+	/* fixed depth doesn't adapt */
+	OSMO_ASSERT(jb.depth == 2);
+	dump_stats(&jb);
+	jitbuf_flush(&jb);
+}
+
+static void test_loss(void)
+{
+	struct jitbuf jb = { { 0 } };
+
+	printf("Testing lost frames\n");
+
+	jitbuf_init(&jb, 40, false);
+
+	OSMO_ASSERT(put(&jb, 0) == 0);
+	OSMO_ASSERT(put(&jb, 1) == 0);
+	OSMO_ASSERT(put(&jb, 3) == 0);
+	OSMO_ASSERT(get(&jb) == 0);
+	OSMO_ASSERT(get(&jb) == 1);
+	/* gap is played out empty, playout keeps running */
+	OSMO_ASSERT(get(&jb) == -1);
+	OSMO_ASSERT(jb.running);
+	OSMO_ASSERT(get(&jb) == 3);
+
+	/* the missing frame shows up after its slot */
+	OSMO_ASSERT(put(&jb, 2) == -ETIME);
+
+	OSMO_ASSERT(jb.stats.lost == 1);
+	OSMO_ASSERT(jb.stats.underrun == 0);
+	dump_stats(&jb);
+	jitbuf_flush(&jb);
+}
+
+static void test_adaptive(void)
+{
+	struct jitbuf jb = { { 0 } };
+
+	printf("Testing adaptive depth\n");
+
+	/* configured depth is the upper bound */
+	jitbuf_init(&jb, 80, true);
+	OSMO_ASSERT(jb.depth == 2);
+
+	OSMO_ASSERT(put(&jb, 0) == 0);
+	OSMO_ASSERT(put(&jb, 1) == 0);
+	OSMO_ASSERT(get(&jb) == 0);
+	OSMO_ASSERT(get(&jb) == 1);
+	OSMO_ASSERT(put(&jb, 0) == -ETIME);
+	OSMO_ASSERT(jb.depth == 3);
+	OSMO_ASSERT(put(&jb, 1) == -ETIME);
+	OSMO_ASSERT(put(&jb, 0) == -ETIME);
+	OSMO_ASSERT(jb.depth == 4);
+
+	dump_stats(&jb);
+	jitbuf_flush(&jb);
+}
+
+int main(int argc, char **argv)
+{
+	test_playout();
+	test_reorder();
+	test_late_dup();
+	test_loss();
+	test_adaptive();
+
+	printf("Success\n");
+
+	return 0;
+}
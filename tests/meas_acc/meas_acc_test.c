@@ -0,0 +1,206 @@
+/* testing the fixed point measurement accumulator against the float code
+ * it replaced in the osmo-bts-trx loops */
+
+/* (C) 2017 by sysmocom s.f.m.c. GmbH
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <osmo-bts/meas_acc.h>
+
+#include <osmocom/core/utils.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+
+#define NUM_RUNS	1000
+
+/* same numbers on every platform, unlike rand() */
+static uint32_t lcg_state = 1;
+
+static uint32_t lcg(void)
+{
+	lcg_state = lcg_state * 1103515245 + 12345;
+	return lcg_state >> 8;
+}
+
+/* uniform in [lo, hi] */
+static float rand_float(float lo, float hi)
+{
+	return lo + (hi - lo) * (float)(lcg() & 0xffff) / 65535.0f;
+}
+
+static int rand_int(int lo, int hi)
+{
+	return lo + lcg() % (hi - lo + 1);
+}
+
+static void test_empty(void)
+{
+	struct meas_acc acc = { 0 };
+
+	printf("Testing empty accumulator\n");
+
+	OSMO_ASSERT(meas_acc_avg(&acc) == 0);
+	OSMO_ASSERT(meas_acc_min(&acc) == 0);
+
+	meas_acc_add(&acc, 5);
+	meas_acc_add(&acc, 3);
+	meas_acc_add(&acc, 7);
+	OSMO_ASSERT(meas_acc_avg(&acc) == 5);
+	OSMO_ASSERT(meas_acc_min(&acc) == 3);
+
+	meas_acc_reset(&acc);
+	OSMO_ASSERT(acc.num == 0);
+	meas_acc_add(&acc, 9);
+	OSMO_ASSERT(meas_acc_min(&acc) == 9);
+}
+
+static void test_rounding(void)
+{
+	struct meas_acc acc = { 0 };
+
+	printf("Testing rounding\n");
+
+	meas_acc_add(&acc, 1);
+	meas_acc_add(&acc, 2);
+	OSMO_ASSERT(meas_acc_avg(&acc) == 2);
+
+	meas_acc_reset(&acc);
+	meas_acc_add(&acc, -1);
+	meas_acc_add(&acc, -2);
+	OSMO_ASSERT(meas_acc_avg(&acc) == -2);
+
+	OSMO_ASSERT(meas_acc_fix(0.9f, MEAS_ACC_TOA_SHIFT) == 230);
+	OSMO_ASSERT(meas_acc_fix(-0.9f, MEAS_ACC_TOA_SHIFT) == -230);
+	OSMO_ASSERT(meas_acc_fix(1.0f, MEAS_ACC_BER_SHIFT) == 65536);
+}
+
+/* MS power loop: lowest RSSI since the last SACCH clock */
+static void test_rssi(void)
+{
+	int run, i;
+
+	printf("Testing RSSI minimum and average\n");
+
+	for (run = 0; run < NUM_RUNS; run++) {
+		struct meas_acc acc = { 0 };
+		int8_t rssi[32];
+		int n = rand_int(1, 32);
+		int min = 999;
+		float sum = 0;
+
+		for (i = 0; i < n; i++) {
+			rssi[i] = rand_int(-110, -20);
+			meas_acc_add(&acc, rssi[i]);
+		}
+
+		/* the former ms_power_clock() and rx_data_fn() */
+		for (i = 0; i < n; i++) {
+			if (min > rssi[i])
+				min = rssi[i];
+			sum += rssi[i];
+		}
+
+		OSMO_ASSERT(meas_acc_min(&acc) == min);
+		OSMO_ASSERT(fabsf(meas_acc_avg(&acc) - sum / n) <= 0.5f);
+	}
+}
+
+/* TA loop: average of 16 TOA values in symbols */
+static void test_toa(void)
+{
+	int run, i, decisions = 0;
+
+	printf("Testing TOA average\n");
+
+	for (run = 0; run < NUM_RUNS; run++) {
+		struct meas_acc acc = { 0 };
+		float bias = rand_float(-1.5f, 1.5f);
+		float toa, sum = 0;
+		int32_t toa256;
+		int dir_float, dir_fix;
+
+		for (i = 0; i < 16; i++) {
+			toa = bias + rand_float(-0.5f, 0.5f);
+			sum += toa;
+			meas_acc_add(&acc, meas_acc_fix(toa, MEAS_ACC_TOA_SHIFT));
+		}
+		toa = sum / 16;
+		toa256 = meas_acc_avg(&acc);
+
+		/* half a step for each input value, half for the average */
+		OSMO_ASSERT(fabsf(meas_acc_float(toa256, MEAS_ACC_TOA_SHIFT)
+				  - toa) <= 1.0f / 256);
+
+		/* the former ta_val() decision, unless it is a coin flip */
+		if (fabsf(fabsf(toa) - 0.9f) <= 1.0f / 256)
+			continue;
+		dir_float = toa < -0.9f ? -1 : (toa > 0.9f ? 1 : 0);
+		dir_fix = toa256 < -230 ? -1 : (toa256 > 230 ? 1 : 0);
+		OSMO_ASSERT(dir_float == dir_fix);
+		if (dir_float)
+			decisions++;
+	}
+
+	printf(" TA changes: %d\n", decisions);
+}
+
+/* AMR loop: average BER of 48 frames, TCH/H frames count twice */
+static void test_ber(void)
+{
+	int run;
+
+	printf("Testing BER average\n");
+
+	for (run = 0; run < NUM_RUNS; run++) {
+		struct meas_acc acc = { 0 };
+		int tchh = run & 1;
+		float ber, sum = 0;
+		int num = 0;
+
+		while (num < 48) {
+			ber = rand_float(0.0f, 0.25f);
+			if (tchh) {
+				num += 2;
+				sum += ber + ber;
+			} else {
+				num++;
+				sum += ber;
+			}
+			meas_acc_add_n(&acc, meas_acc_fix(ber,
+				       MEAS_ACC_BER_SHIFT), tchh ? 2 : 1);
+		}
+
+		OSMO_ASSERT(acc.num == num);
+		ber = meas_acc_float(meas_acc_avg(&acc), MEAS_ACC_BER_SHIFT);
+		OSMO_ASSERT(fabsf(ber - sum / num) <= 1.0f / 65536);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	test_empty();
+	test_rounding();
+	test_rssi();
+	test_toa();
+	test_ber();
+
+	printf("Success\n");
+	return EXIT_SUCCESS;
+}
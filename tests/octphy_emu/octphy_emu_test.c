@@ -0,0 +1,397 @@
+/* testing osmo-bts-octphy-emu from the BTS side of the link
+ *
+ * Starts the emulator given as first argument on the loopback device
+ * and talks OCTPKT/VC1 to it.  Needs CAP_NET_RAW, skipped otherwise. */
+
+/* (C) 2017 by sysmocom s.f.m.c. GmbH
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <arpa/inet.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <net/if.h>
+#include <net/ethernet.h>
+#include <linux/if_packet.h>
+
+#include <osmocom/core/msgb.h>
+#include <osmocom/core/utils.h>
+#include <osmocom/gsm/gsm_utils.h>
+
+#include <octphy/octpkt/octpkt_hdr.h>
+#include <octphy/octvc1/octvocnet_pkt.h>
+#include <octphy/octvc1/octvc1_msg.h>
+#include <octphy/octvc1/octvc1_msg_swap.h>
+#include <octphy/octvc1/gsm/octvc1_gsm_api.h>
+#include <octphy/octvc1/gsm/octvc1_gsm_api_swap.h>
+#include <octphy/octvc1/gsm/octvc1_gsm_evt_swap.h>
+#include <octphy/octvc1/gsm/octvc1_gsm_id.h>
+#include <octphy/octvc1/main/octvc1_main_api_swap.h>
+#include <octphy/octvc1/main/octvc1_main_default.h>
+
+#include "octpkt.h"
+
+#define cPKTAPI_FIFO_ID_MSG	0xAAAA0001
+
+#define TEST_DEV		"lo"
+#define TEST_SESSION		0x7e57
+
+struct rx_pkt {
+	uint32_t format;
+	/* control messages */
+	uint32_t type;
+	uint32_t id;
+	uint32_t tid;
+	uint32_t rc;
+	/* VC1 message or event in network byte order */
+	uint8_t *body;
+};
+
+static int fd;
+static struct sockaddr_ll phy_addr;
+static uint8_t rx_buf[2048];
+
+static int open_dev(const char *dev)
+{
+	struct ifreq ifr;
+	int sfd;
+
+	sfd = osmo_sock_packet_init(SOCK_DGRAM, cOCTPKT_HDR_ETHERTYPE, dev, 0);
+	if (sfd < 0)
+		return -errno;
+
+	memset(&ifr, 0, sizeof(ifr));
+	strncpy(ifr.ifr_name, dev, sizeof(ifr.ifr_name) - 1);
+	OSMO_ASSERT(ioctl(sfd, SIOCGIFINDEX, &ifr) == 0);
+
+	memset(&phy_addr, 0, sizeof(phy_addr));
+	phy_addr.sll_family = AF_PACKET;
+	phy_addr.sll_protocol = htons(cOCTPKT_HDR_ETHERTYPE);
+	phy_addr.sll_ifindex = ifr.ifr_ifindex;
+	phy_addr.sll_halen = ETH_ALEN;
+
+	return sfd;
+}
+
+static pid_t start_emu(const char *path)
+{
+	pid_t pid = fork();
+	int null;
+
+	OSMO_ASSERT(pid >= 0);
+	if (pid)
+		return pid;
+
+	/* the emulator prints its statistics, keep them out of the way */
+	null = open("/dev/null", O_WRONLY);
+	dup2(null, 1);
+	execl(path, path, "-i", TEST_DEV, "-d", "10", NULL);
+	fprintf(stderr, "Cannot start %s: %s\n", path, strerror(errno));
+	_exit(1);
+}
+
+/* send a VC1 command, 'mh' is the start of the swapped command */
+static void tx_cmd(const tOCTVC1_MSG_HEADER *mh)
+{
+	uint32_t len = ntohl(mh->ulLength);
+	struct msgb *msg;
+	int rc;
+
+	msg = msgb_alloc_headroom(1500, 64, "cmd");
+	OSMO_ASSERT(msg);
+	memcpy(msgb_put(msg, len), mh, len);
+	octvocnet_push_ctl_hdr(msg, cOCTVC1_FIFO_ID_MGW_CONTROL,
+			       cPKTAPI_FIFO_ID_MSG, 0);
+	octpkt_push_common_hdr(msg, cOCTVOCNET_PKT_FORMAT_CTRL, 0,
+			       cOCTPKT_HDR_CONTROL_PROTOCOL_TYPE_ENUM_OCTVOCNET);
+
+	rc = sendto(fd, msg->data, msgb_length(msg), 0,
+		    (struct sockaddr *) &phy_addr, sizeof(phy_addr));
+	OSMO_ASSERT(rc == msgb_length(msg));
+	msgb_free(msg);
+}
+
+static void tx_app_info(uint32_t tid)
+{
+	tOCTVC1_MAIN_MSG_APPLICATION_INFO_CMD ai;
+
+	memset(&ai, 0, sizeof(ai));
+	mOCTVC1_MAIN_MSG_APPLICATION_INFO_CMD_DEF(&ai);
+	octvc1_fill_msg_hdr(&ai.Header, sizeof(ai), TEST_SESSION, tid, 0,
+			    cOCTVC1_MSG_TYPE_COMMAND, 0,
+			    cOCTVC1_MAIN_MSG_APPLICATION_INFO_CID);
+	mOCTVC1_MAIN_MSG_APPLICATION_INFO_CMD_SWAP(&ai);
+	tx_cmd(&ai.Header);
+}
+
+static void tx_trx_open(uint32_t tid)
+{
+	tOCTVC1_GSM_MSG_TRX_OPEN_CMD oc;
+
+	memset(&oc, 0, sizeof(oc));
+	octvc1_fill_msg_hdr(&oc.Header, sizeof(oc), TEST_SESSION, tid, 0,
+			    cOCTVC1_MSG_TYPE_COMMAND, 0,
+			    cOCTVC1_GSM_MSG_TRX_OPEN_CID);
+	oc.TrxId.byTrxId = 0;
+	oc.Config.usArfcn = 871;
+	mOCTVC1_GSM_MSG_TRX_OPEN_CMD_SWAP(&oc);
+	tx_cmd(&oc.Header);
+}
+
+static void tx_enable_events(uint32_t tid)
+{
+	tOCTVC1_MAIN_MSG_API_SYSTEM_MODIFY_SESSION_EVT_CMD mse;
+
+	memset(&mse, 0, sizeof(mse));
+	mOCTVC1_MAIN_MSG_API_SYSTEM_MODIFY_SESSION_EVT_CMD_DEF(&mse);
+	octvc1_fill_msg_hdr(&mse.Header, sizeof(mse), TEST_SESSION, tid, 0,
+			    cOCTVC1_MSG_TYPE_COMMAND, 0,
+			    cOCTVC1_MAIN_MSG_API_SYSTEM_MODIFY_SESSION_EVT_CID);
+	mse.ulEvtActiveFlag = cOCT_TRUE;
+	mOCTVC1_MAIN_MSG_API_SYSTEM_MODIFY_SESSION_EVT_CMD_SWAP(&mse);
+	tx_cmd(&mse.Header);
+}
+
+static void tx_lchan_act(uint32_t tid, uint8_t sapi, uint8_t dir)
+{
+	tOCTVC1_GSM_MSG_TRX_ACTIVATE_LOGICAL_CHANNEL_CMD lac;
+
+	memset(&lac, 0, sizeof(lac));
+	octvc1_fill_msg_hdr(&lac.Header, sizeof(lac), TEST_SESSION, tid, 0,
+			    cOCTVC1_MSG_TYPE_COMMAND, 0,
+			    cOCTVC1_GSM_MSG_TRX_ACTIVATE_LOGICAL_CHANNEL_CID);
+	lac.TrxId.byTrxId = 0;
+	lac.LchId.byTimeslotNb = 0;
+	lac.LchId.bySubChannelNb = 0xf1;
+	lac.LchId.bySAPI = sapi;
+	lac.LchId.byDirection = dir;
+	mOCTVC1_GSM_MSG_TRX_ACTIVATE_LOGICAL_CHANNEL_CMD_SWAP(&lac);
+	tx_cmd(&lac.Header);
+}
+
+/* next packet from the emulator, 0 on timeout.  The loopback device
+ * also hands us our own commands, those are skipped. */
+static int rx(struct rx_pkt *p, int timeout_ms)
+{
+	const tOCTVOCNET_PKT_CTL_HEADER *ctlh;
+	const tOCTVC1_MSG_HEADER *mh;
+	const tOCTVC1_EVENT_HEADER *eh;
+	struct sockaddr_ll sll;
+	socklen_t sll_len;
+	struct pollfd pfd;
+	uint32_t ch, type_r_cmdid;
+	int rc;
+
+	pfd.fd = fd;
+	pfd.events = POLLIN;
+
+	while (1) {
+		if (poll(&pfd, 1, timeout_ms) <= 0)
+			return 0;
+
+		sll_len = sizeof(sll);
+		rc = recvfrom(fd, rx_buf, sizeof(rx_buf), 0,
+			      (struct sockaddr *) &sll, &sll_len);
+		OSMO_ASSERT(rc >= 4);
+		if (sll.sll_pkttype == PACKET_OUTGOING)
+			continue;
+
+		memset(p, 0, sizeof(*p));
+		ch = ntohl(*(uint32_t *) rx_buf);
+		p->format = (ch >> cOCTVOCNET_PKT_FORMAT_BIT_OFFSET)
+				& cOCTVOCNET_PKT_FORMAT_BIT_MASK;
+
+		switch (p->format) {
+		case cOCTVOCNET_PKT_FORMAT_CTRL:
+			ctlh = (const tOCTVOCNET_PKT_CTL_HEADER *) (rx_buf + 4);
+			mh = (const tOCTVC1_MSG_HEADER *) (ctlh + 1);
+			type_r_cmdid = ntohl(mh->ul_Type_R_CmdId);
+			p->type = (type_r_cmdid >> cOCTVC1_MSG_TYPE_BIT_OFFSET)
+					& cOCTVC1_MSG_TYPE_BIT_MASK;
+			if (p->type == cOCTVC1_MSG_TYPE_COMMAND)
+				continue;
+			p->id = (type_r_cmdid >> cOCTVC1_MSG_ID_BIT_OFFSET)
+					& cOCTVC1_MSG_ID_BIT_MASK;
+			p->tid = ntohl(mh->ulTransactionId);
+			p->rc = ntohl(mh->ulReturnCode);
+			p->body = (uint8_t *) mh;
+			return 1;
+		case cOCTVOCNET_PKT_FORMAT_F:
+			eh = (const tOCTVC1_EVENT_HEADER *) (rx_buf + 4 +
+					sizeof(tOCTVOCNET_PKT_DATA_F_HEADER));
+			p->id = ntohl(eh->ulEventId);
+			p->body = (uint8_t *) eh;
+			return 1;
+		}
+	}
+}
+
+/* wait for the response to 'tid', events in between are dropped */
+static int rx_rsp(struct rx_pkt *p, uint32_t tid, int timeout_ms)
+{
+	while (rx(p, timeout_ms)) {
+		if (p->format != cOCTVOCNET_PKT_FORMAT_CTRL)
+			continue;
+		if (p->type == cOCTVC1_MSG_TYPE_RESPONSE && p->tid != tid)
+			continue;
+		return 1;
+	}
+
+	return 0;
+}
+
+static void test_session(void)
+{
+	tOCTVC1_MAIN_MSG_APPLICATION_INFO_RSP *air;
+	struct rx_pkt p;
+	int i;
+
+	printf("Testing the command sequence\n");
+
+	/* the emulator needs a moment to open its socket */
+	for (i = 0; i < 50; i++) {
+		tx_app_info(0);
+		if (rx_rsp(&p, 0, 100))
+			break;
+	}
+	OSMO_ASSERT(i < 50);
+	OSMO_ASSERT(p.type == cOCTVC1_MSG_TYPE_RESPONSE);
+	OSMO_ASSERT(p.id == cOCTVC1_MAIN_MSG_APPLICATION_INFO_CID);
+	OSMO_ASSERT(p.rc == cOCTVC1_RC_OK);
+	air = (tOCTVC1_MAIN_MSG_APPLICATION_INFO_RSP *) p.body;
+	printf(" APP-INFO: %s\n", air->szName);
+
+	/* a lost command is rejected once, naming the missing one */
+	tx_enable_events(2);
+	OSMO_ASSERT(rx_rsp(&p, 2, 1000));
+	OSMO_ASSERT(p.type == cOCTVC1_MSG_TYPE_SUPERVISORY);
+	OSMO_ASSERT(p.id == cOCTVC1_CTRL_MSG_MODULE_REJECT_SID);
+	mOCTVC1_CTRL_MSG_MODULE_REJECT_SPV_SWAP(
+		(tOCTVC1_CTRL_MSG_MODULE_REJECT_SPV *) p.body);
+	printf(" REJECT: expected tid=%u\n",
+		((tOCTVC1_CTRL_MSG_MODULE_REJECT_SPV *) p.body)
+			->ulExpectedTransactionId);
+
+	/* retransmission from the missing command on */
+	tx_trx_open(1);
+	tx_enable_events(2);
+	OSMO_ASSERT(rx_rsp(&p, 1, 1000));
+	OSMO_ASSERT(p.type == cOCTVC1_MSG_TYPE_RESPONSE);
+	OSMO_ASSERT(p.id == cOCTVC1_GSM_MSG_TRX_OPEN_CID);
+	printf(" TRX-OPEN.resp tid=%u\n", p.tid);
+	OSMO_ASSERT(rx_rsp(&p, 2, 1000));
+	OSMO_ASSERT(p.type == cOCTVC1_MSG_TYPE_RESPONSE);
+	OSMO_ASSERT(p.id == cOCTVC1_MAIN_MSG_API_SYSTEM_MODIFY_SESSION_EVT_CID);
+	printf(" MODIFY-SESSION-EVT.resp tid=%u\n", p.tid);
+
+	/* a command executed before is answered again */
+	tx_trx_open(1);
+	OSMO_ASSERT(rx_rsp(&p, 1, 1000));
+	OSMO_ASSERT(p.type == cOCTVC1_MSG_TYPE_RESPONSE);
+	OSMO_ASSERT(p.id == cOCTVC1_GSM_MSG_TRX_OPEN_CID);
+	printf(" TRX-OPEN.resp tid=%u (duplicate)\n", p.tid);
+
+	tx_lchan_act(3, cOCTVC1_GSM_SAPI_ENUM_BCCH,
+		     cOCTVC1_GSM_DIRECTION_ENUM_TX_BTS_MS);
+	OSMO_ASSERT(rx_rsp(&p, 3, 1000));
+	OSMO_ASSERT(p.type == cOCTVC1_MSG_TYPE_RESPONSE);
+	OSMO_ASSERT(p.id == cOCTVC1_GSM_MSG_TRX_ACTIVATE_LOGICAL_CHANNEL_CID);
+	printf(" ACTIVATE-LOGICAL-CHANNEL.resp tid=%u\n", p.tid);
+}
+
+static void test_indications(void)
+{
+	tOCTVC1_GSM_MSG_TRX_TIME_INDICATION_EVT *tev;
+	tOCTVC1_GSM_MSG_TRX_LOGICAL_CHANNEL_READY_TO_SEND_INDICATION_EVT *rev;
+	uint32_t last_fn = 0;
+	int time_ind = 0, rts_ind = 0;
+	struct rx_pkt p;
+
+	printf("Testing the indications\n");
+
+	/* the BCCH comes once per 51-multiframe, 235ms */
+	while ((time_ind < 100 || !rts_ind) && rx(&p, 1000)) {
+		if (p.format != cOCTVOCNET_PKT_FORMAT_F)
+			continue;
+		switch (p.id) {
+		case cOCTVC1_GSM_MSG_TRX_TIME_INDICATION_EID:
+			tev = (tOCTVC1_GSM_MSG_TRX_TIME_INDICATION_EVT *) p.body;
+			mOCTVC1_GSM_MSG_TRX_TIME_INDICATION_EVT_SWAP(tev);
+			OSMO_ASSERT(tev->TrxId.byTrxId == 0);
+			/* one per TDMA frame, in order */
+			if (time_ind)
+				OSMO_ASSERT(tev->ulFrameNumber ==
+					    (last_fn + 1) % GSM_HYPERFRAME);
+			last_fn = tev->ulFrameNumber;
+			time_ind++;
+			break;
+		case cOCTVC1_GSM_MSG_TRX_LOGICAL_CHANNEL_READY_TO_SEND_INDICATION_EID:
+			rev = (tOCTVC1_GSM_MSG_TRX_LOGICAL_CHANNEL_READY_TO_SEND_INDICATION_EVT *) p.body;
+			mOCTVC1_GSM_MSG_TRX_LOGICAL_CHANNEL_READY_TO_SEND_INDICATION_EVT_SWAP(rev);
+			OSMO_ASSERT(rev->LchId.bySAPI ==
+				    cOCTVC1_GSM_SAPI_ENUM_BCCH);
+			OSMO_ASSERT(rev->ulFrameNumber % 51 == 0);
+			rts_ind++;
+			break;
+		}
+	}
+	OSMO_ASSERT(time_ind >= 100);
+	OSMO_ASSERT(rts_ind);
+	printf(" TIME.ind in sequence, RTS.ind for the BCCH\n");
+}
+
+int main(int argc, char **argv)
+{
+	pid_t pid;
+	int status;
+
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s path/to/osmo-bts-octphy-emu\n",
+			argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	fd = open_dev(TEST_DEV);
+	if (fd == -EPERM) {
+		fprintf(stderr, "No CAP_NET_RAW, skipping\n");
+		return 77;
+	}
+	OSMO_ASSERT(fd >= 0);
+
+	pid = start_emu(argv[1]);
+
+	test_session();
+	test_indications();
+
+	kill(pid, SIGTERM);
+	OSMO_ASSERT(waitpid(pid, &status, 0) == pid);
+	close(fd);
+
+	printf("Success\n");
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,160 @@
+/* testing the TPACKET_V3 rings over a network device
+ *
+ * Uses the loopback device unless two device names are given, e.g. both
+ * ends of a veth pair.  Needs CAP_NET_RAW, skipped otherwise. */
+
+/* (C) 2017 by sysmocom s.f.m.c. GmbH
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <osmo-bts/logging.h>
+
+#include "packet_ring.h"
+
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/utils.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <arpa/inet.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <net/if.h>
+#include <net/ethernet.h>
+#include <linux/if_packet.h>
+
+/* IEEE 802 local experimental */
+#define TEST_ETHERTYPE	0x88b5
+#define TEST_FRAMES	200
+#define TEST_LEN	300
+
+static int rx_next;
+
+static int open_dev(const char *dev, struct sockaddr_ll *sll)
+{
+	struct ifreq ifr;
+	int fd;
+
+	fd = socket(AF_PACKET, SOCK_DGRAM, htons(TEST_ETHERTYPE));
+	if (fd < 0)
+		return -errno;
+
+	memset(&ifr, 0, sizeof(ifr));
+	strncpy(ifr.ifr_name, dev, sizeof(ifr.ifr_name) - 1);
+	OSMO_ASSERT(ioctl(fd, SIOCGIFINDEX, &ifr) == 0);
+
+	memset(sll, 0, sizeof(*sll));
+	sll->sll_family = AF_PACKET;
+	sll->sll_protocol = htons(TEST_ETHERTYPE);
+	sll->sll_ifindex = ifr.ifr_ifindex;
+	OSMO_ASSERT(bind(fd, (struct sockaddr *) sll, sizeof(*sll)) == 0);
+
+	OSMO_ASSERT(ioctl(fd, SIOCGIFHWADDR, &ifr) == 0);
+	sll->sll_halen = ETH_ALEN;
+	memcpy(sll->sll_addr, ifr.ifr_hwaddr.sa_data, ETH_ALEN);
+
+	return fd;
+}
+
+static void rx_cb(const uint8_t *buf, unsigned int len, void *data)
+{
+	unsigned int i;
+
+	OSMO_ASSERT(len == TEST_LEN);
+	OSMO_ASSERT(buf[0] == (rx_next & 0xff));
+	for (i = 1; i < len; i++)
+		OSMO_ASSERT(buf[i] == (uint8_t) (buf[0] + i));
+	rx_next++;
+}
+
+int main(int argc, char **argv)
+{
+	const char *tx_dev = argc > 2 ? argv[1] : "lo";
+	const char *rx_dev = argc > 2 ? argv[2] : "lo";
+	struct sockaddr_ll tx_sll, rx_sll, dst;
+	struct pkt_ring *tx, *rx;
+	struct pollfd pfd;
+	int tx_fd, rx_fd, i, j;
+	uint8_t *buf;
+
+	bts_log_init(NULL);
+
+	tx_fd = open_dev(tx_dev, &tx_sll);
+	rx_fd = open_dev(rx_dev, &rx_sll);
+	if (tx_fd == -EPERM || rx_fd == -EPERM) {
+		fprintf(stderr, "No CAP_NET_RAW, skipping\n");
+		return 77;
+	}
+	OSMO_ASSERT(tx_fd >= 0 && rx_fd >= 0);
+
+	rx = pkt_ring_alloc(NULL, rx_fd, 4, 1, 0);
+	tx = pkt_ring_alloc(NULL, tx_fd, 1, 1, 64);
+	OSMO_ASSERT(rx && tx);
+	if (!pkt_ring_tx_get(tx)) {
+		fprintf(stderr, "No TPACKET_V3 TX ring, skipping\n");
+		return 77;
+	}
+
+	/* the frames leave through tx_dev towards the address of rx_dev */
+	dst = tx_sll;
+	memcpy(dst.sll_addr, rx_sll.sll_addr, ETH_ALEN);
+
+	printf("Testing TX ring\n");
+	for (i = 0; i < TEST_FRAMES; i++) {
+		buf = pkt_ring_tx_get(tx);
+		if (!buf) {
+			/* ring full, let the kernel catch up */
+			OSMO_ASSERT(pkt_ring_tx_kick(tx, &dst) == 0);
+			usleep(1000);
+			i--;
+			continue;
+		}
+		for (j = 0; j < TEST_LEN; j++)
+			buf[j] = i + j;
+		pkt_ring_tx_put(tx, TEST_LEN);
+		if (pkt_ring_tx_pending(tx) == 16)
+			OSMO_ASSERT(pkt_ring_tx_kick(tx, &dst) == 0);
+	}
+	OSMO_ASSERT(pkt_ring_tx_kick(tx, &dst) == 0);
+	OSMO_ASSERT(pkt_ring_get_stats(tx)->tx_frames == TEST_FRAMES);
+
+	printf("Testing RX ring\n");
+	pfd.fd = rx_fd;
+	pfd.events = POLLIN;
+	while (rx_next < TEST_FRAMES) {
+		if (poll(&pfd, 1, 1000) <= 0)
+			break;
+		pkt_ring_rx(rx, rx_cb, NULL);
+	}
+	printf("Received %d of %d frames\n", rx_next, TEST_FRAMES);
+	OSMO_ASSERT(pkt_ring_get_stats(rx)->rx_frames == TEST_FRAMES);
+	/* blocks carry several frames each */
+	OSMO_ASSERT(pkt_ring_get_stats(rx)->rx_blocks < TEST_FRAMES);
+
+	pkt_ring_free(tx);
+	pkt_ring_free(rx);
+	close(tx_fd);
+	close(rx_fd);
+
+	printf("Success\n");
+	return EXIT_SUCCESS;
+}
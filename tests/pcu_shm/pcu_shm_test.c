@@ -0,0 +1,290 @@
+/* testing the shared memory ring transport towards the PCU */
+
+/* (C) 2017 by sysmocom s.f.m.c. GmbH
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/select.h>
+#include <osmocom/core/utils.h>
+
+#include <osmo-bts/logging.h>
+#include <osmo-bts/pcuif_proto.h>
+#include <osmo-bts/pcuif_shm.h>
+#include <osmo-bts/pcu_shm.h>
+
+/* the PCU side of the transport */
+struct pcu_end {
+	int sock_fd;
+	struct pcu_if_shm *mem;
+	int mem_fd;
+	int rx_efd;	/* doorbell BTS->PCU */
+	int tx_efd;	/* doorbell PCU->BTS */
+};
+
+static void *ctx;
+
+/* messages are told apart by a sequence number */
+static void set_seq(struct gsm_pcu_if *pcu_prim, uint32_t seq)
+{
+	pcu_prim->msg_type = PCU_IF_MSG_INFO_IND;
+	pcu_prim->u.info_ind.trx[0].hlayer1 = seq;
+}
+
+static uint32_t get_seq(const struct gsm_pcu_if *pcu_prim)
+{
+	OSMO_ASSERT(pcu_prim->msg_type == PCU_IF_MSG_INFO_IND);
+	return pcu_prim->u.info_ind.trx[0].hlayer1;
+}
+
+static uint32_t rx_seq;
+
+static int bts_rx_cb(struct gsm_pcu_if *pcu_prim, void *data)
+{
+	OSMO_ASSERT(get_seq(pcu_prim) == rx_seq);
+	rx_seq++;
+	return 0;
+}
+
+/* receive the SHM_CNF and map the memory like the PCU does */
+static void pcu_connect(struct pcu_end *pcu)
+{
+	struct gsm_pcu_if pcu_prim;
+	union {
+		char buf[CMSG_SPACE(3 * sizeof(int))];
+		struct cmsghdr align;
+	} cmsg_buf;
+	struct iovec iov = {
+		.iov_base = &pcu_prim,
+		.iov_len = sizeof(pcu_prim),
+	};
+	struct msghdr mh = {
+		.msg_iov = &iov,
+		.msg_iovlen = 1,
+		.msg_control = cmsg_buf.buf,
+		.msg_controllen = sizeof(cmsg_buf.buf),
+	};
+	struct cmsghdr *cmsg;
+	int fds[3];
+
+	OSMO_ASSERT(recvmsg(pcu->sock_fd, &mh, 0) == sizeof(pcu_prim));
+	OSMO_ASSERT(pcu_prim.msg_type == PCU_IF_MSG_SHM_CNF);
+	OSMO_ASSERT(pcu_prim.u.shm_cnf.size == sizeof(struct pcu_if_shm));
+	OSMO_ASSERT(pcu_prim.u.shm_cnf.num_slots == PCU_IF_SHM_SLOTS);
+
+	cmsg = CMSG_FIRSTHDR(&mh);
+	OSMO_ASSERT(cmsg && cmsg->cmsg_type == SCM_RIGHTS);
+	OSMO_ASSERT(cmsg->cmsg_len == CMSG_LEN(sizeof(fds)));
+	memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+
+	pcu->mem_fd = fds[0];
+	pcu->rx_efd = fds[1];
+	pcu->tx_efd = fds[2];
+	pcu->mem = mmap(NULL, sizeof(*pcu->mem), PROT_READ | PROT_WRITE,
+			MAP_SHARED, pcu->mem_fd, 0);
+	OSMO_ASSERT(pcu->mem != MAP_FAILED);
+	OSMO_ASSERT(pcu->mem->magic == PCU_IF_SHM_MAGIC);
+	OSMO_ASSERT(pcu->mem->num_slots == PCU_IF_SHM_SLOTS);
+	OSMO_ASSERT(pcu->mem->slot_size == sizeof(struct gsm_pcu_if));
+}
+
+static void pcu_disconnect(struct pcu_end *pcu)
+{
+	munmap(pcu->mem, sizeof(*pcu->mem));
+	close(pcu->mem_fd);
+	close(pcu->rx_efd);
+	close(pcu->tx_efd);
+}
+
+/* number of doorbells since the last call */
+static uint64_t pcu_doorbell(struct pcu_end *pcu)
+{
+	uint64_t val;
+
+	if (read(pcu->rx_efd, &val, sizeof(val)) != sizeof(val)) {
+		OSMO_ASSERT(errno == EAGAIN);
+		return 0;
+	}
+	return val;
+}
+
+static int bts_send(struct pcu_shm *shm, uint32_t seq)
+{
+	struct gsm_pcu_if *pcu_prim = pcu_shm_tx_get(shm);
+
+	if (!pcu_prim)
+		return -ENOSPC;
+	set_seq(pcu_prim, seq);
+	pcu_shm_tx_put(shm);
+	return 0;
+}
+
+/* read 'num' messages, checking the sequence */
+static void pcu_recv(struct pcu_end *pcu, uint32_t *seq, unsigned int num)
+{
+	struct pcu_if_shm_ring *r = &pcu->mem->ring[PCU_IF_SHM_RING_BTS2PCU];
+	struct gsm_pcu_if *pcu_prim;
+
+	while (num--) {
+		pcu_prim = pcu_if_shm_ring_peek(r);
+		OSMO_ASSERT(pcu_prim);
+		OSMO_ASSERT(get_seq(pcu_prim) == *seq);
+		pcu_if_shm_ring_consume(r);
+		(*seq)++;
+	}
+}
+
+static void test_bts2pcu(void)
+{
+	const struct pcu_shm_stats *st;
+	struct pcu_end pcu;
+	struct pcu_shm *shm;
+	uint32_t tx = 0, rx = 0;
+	int sv[2], i;
+
+	printf("Testing BTS->PCU ring\n");
+
+	OSMO_ASSERT(socketpair(AF_UNIX, SOCK_SEQPACKET, 0, sv) == 0);
+	pcu.sock_fd = sv[1];
+
+	shm = pcu_shm_alloc(ctx, bts_rx_cb, NULL);
+	OSMO_ASSERT(shm);
+	st = pcu_shm_get_stats(shm);
+	OSMO_ASSERT(pcu_shm_start(shm, sv[0], 0) == 0);
+	pcu_connect(&pcu);
+
+	/* fill the ring, only the first message rings the doorbell */
+	for (i = 0; i < PCU_IF_SHM_SLOTS; i++)
+		OSMO_ASSERT(bts_send(shm, tx++) == 0);
+	OSMO_ASSERT(pcu_doorbell(&pcu) == 1);
+
+	/* full ring drops */
+	OSMO_ASSERT(bts_send(shm, tx) == -ENOSPC);
+	OSMO_ASSERT(st->tx_full == 1);
+
+	/* wrap the indices around the end of the slot array */
+	pcu_recv(&pcu, &rx, 100);
+	for (i = 0; i < 100; i++)
+		OSMO_ASSERT(bts_send(shm, tx++) == 0);
+	OSMO_ASSERT(bts_send(shm, tx) == -ENOSPC);
+	OSMO_ASSERT(pcu_doorbell(&pcu) == 0);
+	pcu_recv(&pcu, &rx, PCU_IF_SHM_SLOTS);
+	OSMO_ASSERT(!pcu_if_shm_ring_peek(
+			&pcu.mem->ring[PCU_IF_SHM_RING_BTS2PCU]));
+
+	/* empty again, the next message rings the doorbell */
+	OSMO_ASSERT(bts_send(shm, tx++) == 0);
+	OSMO_ASSERT(bts_send(shm, tx++) == 0);
+	OSMO_ASSERT(pcu_doorbell(&pcu) == 1);
+
+	/* a restarted reader maps the region again and resumes at the
+	 * shared read index */
+	munmap(pcu.mem, sizeof(*pcu.mem));
+	pcu.mem = mmap(NULL, sizeof(*pcu.mem), PROT_READ | PROT_WRITE,
+		       MAP_SHARED, pcu.mem_fd, 0);
+	OSMO_ASSERT(pcu.mem != MAP_FAILED);
+	pcu_recv(&pcu, &rx, 1);
+	OSMO_ASSERT(bts_send(shm, tx++) == 0);
+	pcu_recv(&pcu, &rx, 2);
+	OSMO_ASSERT(rx == tx);
+
+	printf(" tx=%u tx_full=%u doorbells=%u\n", st->tx, st->tx_full,
+		st->doorbells);
+
+	pcu_shm_free(shm);
+	pcu_disconnect(&pcu);
+	close(sv[0]);
+	close(sv[1]);
+}
+
+static void test_pcu2bts(void)
+{
+	static const uint64_t one = 1;
+	struct pcu_if_shm_ring *r;
+	struct gsm_pcu_if *pcu_prim;
+	struct pcu_end pcu;
+	struct pcu_shm *shm;
+	uint32_t tx = 0;
+	int sv[2], i;
+
+	printf("Testing PCU->BTS ring\n");
+
+	OSMO_ASSERT(socketpair(AF_UNIX, SOCK_SEQPACKET, 0, sv) == 0);
+	pcu.sock_fd = sv[1];
+
+	rx_seq = 0;
+	shm = pcu_shm_alloc(ctx, bts_rx_cb, NULL);
+	OSMO_ASSERT(shm);
+	OSMO_ASSERT(pcu_shm_start(shm, sv[0], 0) == 0);
+	pcu_connect(&pcu);
+	r = &pcu.mem->ring[PCU_IF_SHM_RING_PCU2BTS];
+
+	/* several rounds through the ring, each drained on its doorbell */
+	for (i = 0; i < 5 * PCU_IF_SHM_SLOTS; i++) {
+		pcu_prim = pcu_if_shm_ring_get(r);
+		OSMO_ASSERT(pcu_prim);
+		set_seq(pcu_prim, tx++);
+		if (pcu_if_shm_ring_put(r))
+			OSMO_ASSERT(write(pcu.tx_efd, &one, sizeof(one)) ==
+				    sizeof(one));
+		if (tx % 100 == 0 || !pcu_if_shm_ring_get(r))
+			osmo_select_main(0);
+	}
+	if (rx_seq != tx)
+		osmo_select_main(0);
+	OSMO_ASSERT(rx_seq == tx);
+	OSMO_ASSERT(pcu_shm_get_stats(shm)->rx == tx);
+	printf(" rx=%u\n", pcu_shm_get_stats(shm)->rx);
+
+	pcu_shm_free(shm);
+	pcu_disconnect(&pcu);
+
+	/* a reconnecting PCU gets a fresh, empty region */
+	shm = pcu_shm_alloc(ctx, bts_rx_cb, NULL);
+	OSMO_ASSERT(shm);
+	OSMO_ASSERT(pcu_shm_start(shm, sv[0], 0) == 0);
+	pcu_connect(&pcu);
+	OSMO_ASSERT(pcu.mem->ring[PCU_IF_SHM_RING_PCU2BTS].head == 0);
+	OSMO_ASSERT(pcu.mem->ring[PCU_IF_SHM_RING_BTS2PCU].tail == 0);
+	OSMO_ASSERT(pcu_doorbell(&pcu) == 0);
+
+	pcu_shm_free(shm);
+	pcu_disconnect(&pcu);
+	close(sv[0]);
+	close(sv[1]);
+}
+
+int main(int argc, char **argv)
+{
+	ctx = talloc_named_const(NULL, 1, "pcu_shm_test");
+	bts_log_init(NULL);
+
+	test_bts2pcu();
+	test_pcu2bts();
+
+	printf("Success\n");
+	return EXIT_SUCCESS;
+}
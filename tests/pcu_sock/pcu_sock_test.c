@@ -0,0 +1,312 @@
+/* testing the messages sent to the PCU socket */
+
+/* (C) 2017 by sysmocom s.f.m.c. GmbH
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/select.h>
+#include <osmocom/core/utils.h>
+
+#include <osmo-bts/gsm_data.h>
+#include <osmo-bts/logging.h>
+#include <osmo-bts/bts.h>
+#include <osmo-bts/l1sap.h>
+#include <osmo-bts/pcu_if.h>
+#include <osmo-bts/pcuif_proto.h>
+
+static struct gsm_bts *bts;
+static struct gsm_bts_role_bts *btsb;
+static struct gsm_bts_trx *trx;
+static char sock_path[64];
+
+/* let the BTS accept, read and write whatever is pending */
+static void bts_run(void)
+{
+	int i;
+
+	for (i = 0; i < 4; i++)
+		osmo_select_main(1);
+}
+
+static int pcu_connect(void)
+{
+	struct sockaddr_un un;
+	int fd;
+
+	fd = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+	OSMO_ASSERT(fd >= 0);
+
+	memset(&un, 0, sizeof(un));
+	un.sun_family = AF_UNIX;
+	strncpy(un.sun_path, sock_path, sizeof(un.sun_path) - 1);
+	OSMO_ASSERT(connect(fd, (struct sockaddr *) &un, sizeof(un)) == 0);
+	bts_run();
+
+	return fd;
+}
+
+static void pcu_disconnect(int fd)
+{
+	close(fd);
+	bts_run();
+	OSMO_ASSERT(!pcu_connected(bts));
+}
+
+/* the next message from the BTS, its length or 0 if there is none */
+static int pcu_recv(int fd, uint8_t *buf, size_t size)
+{
+	int rc;
+
+	bts_run();
+	rc = recv(fd, buf, size, MSG_DONTWAIT);
+	if (rc < 0) {
+		OSMO_ASSERT(errno == EAGAIN);
+		return 0;
+	}
+	return rc;
+}
+
+static void pcu_expect_info_ind(int fd, uint32_t version)
+{
+	struct gsm_pcu_if pcu_prim;
+
+	OSMO_ASSERT(pcu_recv(fd, (uint8_t *) &pcu_prim, sizeof(pcu_prim))
+		    == sizeof(pcu_prim));
+	OSMO_ASSERT(pcu_prim.msg_type == PCU_IF_MSG_INFO_IND);
+	printf(" INFO.ind version 0x%02x\n", pcu_prim.u.info_ind.version);
+	OSMO_ASSERT(pcu_prim.u.info_ind.version == version);
+}
+
+static void pcu_send_version_ind(int fd, uint32_t version)
+{
+	struct gsm_pcu_if pcu_prim;
+
+	memset(&pcu_prim, 0, sizeof(pcu_prim));
+	pcu_prim.msg_type = PCU_IF_MSG_VERSION_IND;
+	pcu_prim.u.version_ind.version = version;
+	OSMO_ASSERT(send(fd, &pcu_prim, sizeof(pcu_prim), 0)
+		    == sizeof(pcu_prim));
+}
+
+/* receive an RTS batch, check its layout and print it */
+static unsigned int pcu_expect_batch(int fd, uint32_t fn)
+{
+	uint8_t buf[sizeof(struct gsm_pcu_if) + PCU_IF_RTS_BATCH_LEN(
+			PCU_IF_RTS_BATCH_MAX)];
+	struct gsm_pcu_if *pcu_prim = (struct gsm_pcu_if *) buf;
+	struct gsm_pcu_if_rts_batch *batch =
+		(struct gsm_pcu_if_rts_batch *) &pcu_prim->u;
+	unsigned int i;
+	int len;
+
+	len = pcu_recv(fd, buf, sizeof(buf));
+	OSMO_ASSERT(len >= PCU_IF_RTS_BATCH_LEN(0));
+	OSMO_ASSERT(pcu_prim->msg_type == PCU_IF_MSG_RTS_BATCH);
+	OSMO_ASSERT(pcu_prim->bts_nr == bts->nr);
+	printf(" RTS batch fn=%u num_rts=%u len=%d\n", batch->fn,
+		batch->num_rts, len);
+	OSMO_ASSERT(batch->fn == fn);
+	OSMO_ASSERT(len == PCU_IF_RTS_BATCH_LEN(batch->num_rts));
+
+	for (i = 0; i < batch->num_rts; i++) {
+		const struct gsm_pcu_if_rts_batch_entry *e = &batch->rts[i];
+
+		if (i < 3 || i == batch->num_rts - 1)
+			printf("  sapi=0x%02x trx=%u ts=%u block=%u fn=%u\n",
+				e->sapi, e->trx_nr, e->ts_nr, e->block_nr,
+				e->fn);
+		else if (i == 3)
+			printf("  ...\n");
+		OSMO_ASSERT(e->sapi == PCU_IF_SAPI_PDTCH ||
+			    e->sapi == PCU_IF_SAPI_PTCCH);
+		OSMO_ASSERT(e->trx_nr == trx->nr);
+	}
+
+	return batch->num_rts;
+}
+
+static void test_legacy(void)
+{
+	struct gsm_pcu_if pcu_prim;
+	int fd;
+
+	printf("Testing legacy PCU\n");
+
+	fd = pcu_connect();
+	pcu_expect_info_ind(fd, PCU_IF_VERSION_LEGACY);
+
+	/* one RTS.req per PDCH, a separate TIME.ind */
+	btsb->gsm_time.fn = 52;
+	OSMO_ASSERT(pcu_tx_rts_req(&trx->ts[7], 0, 52, 871, 0) == 0);
+	OSMO_ASSERT(pcu_tx_time_ind(bts, 52) == 0);
+
+	OSMO_ASSERT(pcu_recv(fd, (uint8_t *) &pcu_prim, sizeof(pcu_prim))
+		    == sizeof(pcu_prim));
+	OSMO_ASSERT(pcu_prim.msg_type == PCU_IF_MSG_RTS_REQ);
+	OSMO_ASSERT(pcu_prim.u.rts_req.fn == 52);
+	OSMO_ASSERT(pcu_prim.u.rts_req.arfcn == 871);
+	OSMO_ASSERT(pcu_prim.u.rts_req.ts_nr == 7);
+	OSMO_ASSERT(pcu_recv(fd, (uint8_t *) &pcu_prim, sizeof(pcu_prim))
+		    == sizeof(pcu_prim));
+	OSMO_ASSERT(pcu_prim.msg_type == PCU_IF_MSG_TIME_IND);
+	OSMO_ASSERT(pcu_prim.u.time_ind.fn == 52);
+	OSMO_ASSERT(!pcu_recv(fd, (uint8_t *) &pcu_prim, sizeof(pcu_prim)));
+	printf(" RTS.req and TIME.ind\n");
+
+	pcu_disconnect(fd);
+}
+
+static void test_batch(void)
+{
+	uint8_t buf[sizeof(struct gsm_pcu_if)];
+	int fd, i;
+
+	printf("Testing RTS batch\n");
+
+	fd = pcu_connect();
+	pcu_expect_info_ind(fd, PCU_IF_VERSION_LEGACY);
+	pcu_send_version_ind(fd, PCU_IF_VERSION);
+	pcu_expect_info_ind(fd, PCU_IF_VERSION);
+
+	/* the RTS of one FN are held back until the time indication */
+	btsb->gsm_time.fn = 52;
+	for (i = 1; i <= 3; i++)
+		OSMO_ASSERT(pcu_tx_rts_req(&trx->ts[i], i == 3, 52, 871, 0)
+			    == 0);
+	OSMO_ASSERT(!pcu_recv(fd, buf, sizeof(buf)));
+	OSMO_ASSERT(pcu_tx_time_ind(bts, 52) == 0);
+	OSMO_ASSERT(pcu_expect_batch(fd, 52) == 3);
+
+	/* no MAC block boundary, no message */
+	OSMO_ASSERT(pcu_tx_time_ind(bts, 53) == 0);
+	OSMO_ASSERT(!pcu_recv(fd, buf, sizeof(buf)));
+
+	/* an empty batch as time indication */
+	OSMO_ASSERT(pcu_tx_time_ind(bts, 56) == 0);
+	OSMO_ASSERT(pcu_expect_batch(fd, 56) == 0);
+
+	/* an RTS for another FN flushes the batch */
+	btsb->gsm_time.fn = 60;
+	OSMO_ASSERT(pcu_tx_rts_req(&trx->ts[1], 0, 60, 871, 1) == 0);
+	OSMO_ASSERT(pcu_tx_rts_req(&trx->ts[1], 0, 64, 871, 2) == 0);
+	OSMO_ASSERT(pcu_expect_batch(fd, 60) == 1);
+	btsb->gsm_time.fn = 64;
+	OSMO_ASSERT(pcu_tx_time_ind(bts, 64) == 0);
+	OSMO_ASSERT(pcu_expect_batch(fd, 64) == 1);
+	OSMO_ASSERT(!pcu_recv(fd, buf, sizeof(buf)));
+
+	/* a full batch is sent right away */
+	btsb->gsm_time.fn = 65;
+	for (i = 0; i <= PCU_IF_RTS_BATCH_MAX; i++)
+		OSMO_ASSERT(pcu_tx_rts_req(&trx->ts[i % 8], 0, 65, 871, i / 8)
+			    == 0);
+	OSMO_ASSERT(pcu_expect_batch(fd, 65) == PCU_IF_RTS_BATCH_MAX);
+	OSMO_ASSERT(pcu_tx_time_ind(bts, 65) == 0);
+	OSMO_ASSERT(pcu_expect_batch(fd, 65) == 1);
+	OSMO_ASSERT(!pcu_recv(fd, buf, sizeof(buf)));
+
+	/* a reconnecting PCU starts out as legacy again */
+	pcu_disconnect(fd);
+	fd = pcu_connect();
+	pcu_expect_info_ind(fd, PCU_IF_VERSION_LEGACY);
+	pcu_disconnect(fd);
+}
+
+static void test_prio(void)
+{
+	struct gsm_pcu_if pcu_prim;
+	int fd;
+
+	printf("Testing upqueue priorities\n");
+
+	fd = pcu_connect();
+	pcu_expect_info_ind(fd, PCU_IF_VERSION_LEGACY);
+
+	/* queue messages of all classes before the BTS gets to write */
+	btsb->gsm_time.fn = 52;
+	OSMO_ASSERT(pcu_tx_time_ind(bts, 52) == 0);
+	OSMO_ASSERT(pcu_tx_rach_ind(bts, 0, 1, 52, 0,
+				    GSM_L1_BURST_TYPE_ACCESS_0) == 0);
+	OSMO_ASSERT(pcu_tx_rts_req(&trx->ts[7], 0, 52, 871, 0) == 0);
+	OSMO_ASSERT(pcu_tx_rach_ind(bts, 0, 2, 52, 0,
+				    GSM_L1_BURST_TYPE_ACCESS_0) == 0);
+	OSMO_ASSERT(pcu_tx_info_ind(bts) == 0);
+
+	/* highest class first, FIFO within a class */
+	while (pcu_recv(fd, (uint8_t *) &pcu_prim, sizeof(pcu_prim))) {
+		switch (pcu_prim.msg_type) {
+		case PCU_IF_MSG_INFO_IND:
+			printf(" INFO.ind\n");
+			break;
+		case PCU_IF_MSG_RACH_IND:
+			printf(" RACH.ind ra=%u\n", pcu_prim.u.rach_ind.ra);
+			break;
+		case PCU_IF_MSG_TIME_IND:
+			printf(" TIME.ind fn=%u\n", pcu_prim.u.time_ind.fn);
+			break;
+		case PCU_IF_MSG_RTS_REQ:
+			printf(" RTS.req fn=%u\n", pcu_prim.u.rts_req.fn);
+			break;
+		default:
+			OSMO_ASSERT(0);
+		}
+	}
+
+	pcu_disconnect(fd);
+}
+
+int main(int argc, char **argv)
+{
+	void *tall_bts_ctx;
+
+	tall_bts_ctx = talloc_named_const(NULL, 1, "OsmoBTS context");
+	msgb_talloc_ctx_init(tall_bts_ctx, 0);
+
+	bts_log_init(NULL);
+
+	bts = gsm_bts_alloc(tall_bts_ctx);
+	OSMO_ASSERT(bts);
+	trx = gsm_bts_trx_alloc(bts);
+	OSMO_ASSERT(trx);
+	OSMO_ASSERT(bts_init(bts) >= 0);
+	btsb = bts_role_bts(bts);
+
+	snprintf(sock_path, sizeof(sock_path), "/tmp/pcu_sock_test.%d",
+		 (int) getpid());
+	unlink(sock_path);
+	OSMO_ASSERT(pcu_sock_init(bts, sock_path) == 0);
+
+	test_legacy();
+	test_batch();
+	test_prio();
+
+	pcu_sock_exit(bts);
+	unlink(sock_path);
+
+	printf("Success\n");
+	return EXIT_SUCCESS;
+}
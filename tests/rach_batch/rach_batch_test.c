@@ -0,0 +1,213 @@
+/* testing the aggregation of RR access bursts */
+
+/* (C) 2017 by sysmocom s.f.m.c. GmbH
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/utils.h>
+#include <osmocom/gsm/protocol/gsm_08_58.h>
+#include <osmocom/abis/abis.h>
+
+#include <osmo-bts/gsm_data.h>
+#include <osmo-bts/logging.h>
+#include <osmo-bts/bts.h>
+#include <osmo-bts/l1sap.h>
+
+static struct gsm_bts *bts;
+static struct gsm_bts_role_bts *btsb;
+static struct gsm_bts_trx *trx;
+
+/* an RR access burst on the CCCH of timeslot tn */
+static void rach(uint32_t fn, uint8_t tn, uint8_t ra)
+{
+	struct osmo_phsap_prim l1sap;
+
+	memset(&l1sap, 0, sizeof(l1sap));
+	osmo_prim_init(&l1sap.oph, SAP_GSM_PH, PRIM_PH_RACH,
+		       PRIM_OP_INDICATION, NULL);
+	l1sap.u.rach_ind.chan_nr = 0x88 | tn;
+	l1sap.u.rach_ind.ra = ra;
+	l1sap.u.rach_ind.acc_delay = 1;
+	l1sap.u.rach_ind.fn = fn;
+	l1sap_up(trx, &l1sap);
+}
+
+/* print and count the CHAN RQDs sent so far */
+static unsigned int chan_rqd(void)
+{
+	struct abis_rsl_cchan_hdr *cch;
+	struct msgb *msg;
+	unsigned int n = 0;
+	uint8_t *ie;
+
+	while ((msg = msgb_dequeue(&trx->rsl_link->tx_list))) {
+		cch = (struct abis_rsl_cchan_hdr *) msgb_data(msg);
+		OSMO_ASSERT(cch->c.msg_type == RSL_MT_CHAN_RQD);
+		ie = (uint8_t *) (cch + 1);
+		OSMO_ASSERT(ie[0] == RSL_IE_REQ_REFERENCE);
+		printf(" CHAN RQD ra=0x%02x\n", ie[1]);
+		msgb_free(msg);
+		n++;
+	}
+
+	return n;
+}
+
+static void print_stats(void)
+{
+	printf(" received=%u duplicate=%u limit=%u load=%u sent=%u "
+		"batches=%u\n", btsb->rach_batch.stats.received,
+		btsb->rach_batch.stats.duplicate,
+		btsb->rach_batch.stats.rejected_limit,
+		btsb->rach_batch.stats.rejected_load,
+		btsb->rach_batch.stats.sent, btsb->rach_batch.stats.batches);
+}
+
+static void test_batch(void)
+{
+	int i;
+
+	printf("Testing aggregation per TDMA frame\n");
+
+	/* held back until the frame is over */
+	rach(100, 0, 0x21);
+	rach(100, 0, 0x22);
+	OSMO_ASSERT(chan_rqd() == 0);
+	l1sap_rach_flush(bts);
+	OSMO_ASSERT(chan_rqd() == 2);
+
+	/* a burst for the next frame sends the previous one */
+	rach(101, 0, 0x23);
+	rach(102, 0, 0x24);
+	OSMO_ASSERT(chan_rqd() == 1);
+	l1sap_rach_flush(bts);
+	OSMO_ASSERT(chan_rqd() == 1);
+
+	/* a full batch is sent before the next burst is added */
+	for (i = 0; i <= RACH_BATCH_MAX; i++)
+		rach(103, 0, 0x30 + i);
+	OSMO_ASSERT(chan_rqd() == RACH_BATCH_MAX);
+	l1sap_rach_flush(bts);
+	OSMO_ASSERT(chan_rqd() == 1);
+
+	print_stats();
+}
+
+static void test_dedup(void)
+{
+	printf("Testing duplicate bursts\n");
+
+	/* the same RA on the same CCCH, on another CCCH and in the next
+	 * frame */
+	rach(200, 0, 0x41);
+	rach(200, 0, 0x41);
+	rach(200, 2, 0x41);
+	rach(201, 0, 0x41);
+	OSMO_ASSERT(chan_rqd() == 2);
+	l1sap_rach_flush(bts);
+	OSMO_ASSERT(chan_rqd() == 1);
+	OSMO_ASSERT(btsb->rach_batch.stats.duplicate == 1);
+
+	print_stats();
+}
+
+static void test_max_per_mf(void)
+{
+	uint32_t fn = 51 * 10;
+	int i;
+
+	printf("Testing the limit per multiframe\n");
+
+	btsb->rach_batch.max_per_mf = 3;
+	for (i = 0; i < 5; i++)
+		rach(fn + i, 0, 0x50 + i);
+	l1sap_rach_flush(bts);
+	OSMO_ASSERT(chan_rqd() == 3);
+
+	/* the next multiframe admits again */
+	rach(fn + 51, 0, 0x55);
+	l1sap_rach_flush(bts);
+	OSMO_ASSERT(chan_rqd() == 1);
+	btsb->rach_batch.max_per_mf = 0;
+
+	print_stats();
+}
+
+static void test_agch_load(void)
+{
+	printf("Testing the AGCH load limit\n");
+
+	btsb->rach_batch.agch_reject = 80;
+	btsb->agch_max_queue_length = 10;
+
+	btsb->agch_queue_length = 8;
+	rach(1000, 0, 0x61);
+	l1sap_rach_flush(bts);
+	OSMO_ASSERT(chan_rqd() == 0);
+
+	btsb->agch_queue_length = 7;
+	rach(1001, 0, 0x62);
+	l1sap_rach_flush(bts);
+	OSMO_ASSERT(chan_rqd() == 1);
+
+	btsb->agch_queue_length = 0;
+	btsb->rach_batch.agch_reject = 0;
+
+	print_stats();
+}
+
+int main(int argc, char **argv)
+{
+	void *tall_bts_ctx;
+	struct e1inp_line *line;
+
+	tall_bts_ctx = talloc_named_const(NULL, 1, "OsmoBTS context");
+	msgb_talloc_ctx_init(tall_bts_ctx, 0);
+
+	bts_log_init(NULL);
+
+	bts = gsm_bts_alloc(tall_bts_ctx);
+	OSMO_ASSERT(bts);
+	trx = gsm_bts_trx_alloc(bts);
+	OSMO_ASSERT(trx);
+	OSMO_ASSERT(bts_init(bts) >= 0);
+	btsb = bts_role_bts(bts);
+
+	libosmo_abis_init(NULL);
+
+	line = e1inp_line_create(0, "ipa");
+	OSMO_ASSERT(line);
+	e1inp_ts_config_sign(&line->ts[E1INP_SIGN_RSL-1], line);
+	trx->rsl_link = e1inp_sign_link_create(&line->ts[E1INP_SIGN_RSL-1],
+					       E1INP_SIGN_RSL, NULL, 0, 0);
+	OSMO_ASSERT(trx->rsl_link);
+	trx->rsl_link->trx = trx;
+
+	test_batch();
+	test_dedup();
+	test_max_per_mf();
+	test_agch_load();
+
+	printf("Success\n");
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,240 @@
+/* testing the batched uplink RTP transmission */
+
+/* (C) 2017 by sysmocom s.f.m.c. GmbH
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/utils.h>
+#include <osmocom/trau/osmo_ortp.h>
+
+#include <ortp/ortp.h>
+
+#include <osmo-bts/gsm_data.h>
+#include <osmo-bts/logging.h>
+#include <osmo-bts/rtp_batch.h>
+
+#define PT_FR	3
+#define PT_EFR	97
+
+static void *tall_bts_ctx;
+
+/* a UDP socket on the loopback interface, port in host byte order */
+static int udp_socket(uint16_t *port)
+{
+	struct sockaddr_in sin;
+	socklen_t len = sizeof(sin);
+	int fd;
+
+	fd = socket(AF_INET, SOCK_DGRAM, 0);
+	OSMO_ASSERT(fd >= 0);
+
+	memset(&sin, 0, sizeof(sin));
+	sin.sin_family = AF_INET;
+	sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	OSMO_ASSERT(bind(fd, (struct sockaddr *) &sin, sizeof(sin)) == 0);
+	OSMO_ASSERT(getsockname(fd, (struct sockaddr *) &sin, &len) == 0);
+	*port = ntohs(sin.sin_port);
+
+	return fd;
+}
+
+/* set up an lchan as after CRCX/MDCX towards a receiving socket, the
+ * ORTP session is never bound, the batch only uses its fd */
+static int setup_lchan(struct gsm_lchan *lchan, uint8_t pt)
+{
+	struct osmo_rtp_socket *rs;
+	uint16_t port;
+	int rx_fd;
+
+	rs = osmo_rtp_socket_create(tall_bts_ctx, 0);
+	OSMO_ASSERT(rs);
+	rs->rtp_bfd.fd = udp_socket(&port);
+	lchan->abis_ip.rtp_socket = rs;
+	lchan->abis_ip.rtp_payload = pt;
+	rtp_batch_lchan_init(lchan);
+
+	rx_fd = udp_socket(&port);
+	lchan->abis_ip.connect_ip = INADDR_LOOPBACK;
+	lchan->abis_ip.connect_port = port;
+
+	return rx_fd;
+}
+
+/* receive one packet and check it against the lchan's ORTP session */
+static void expect_rtp(int rx_fd, struct gsm_lchan *lchan, uint16_t seq,
+		       uint32_t ts, bool marker, uint8_t pt, uint8_t fill)
+{
+	struct osmo_rtp_socket *rs = lchan->abis_ip.rtp_socket;
+	uint32_t ssrc = rtp_session_get_send_ssrc(rs->sess);
+	uint8_t buf[128];
+	int rc, i;
+
+	rc = recv(rx_fd, buf, sizeof(buf), MSG_DONTWAIT);
+	OSMO_ASSERT(rc == RTP_BATCH_HDR_LEN + 33);
+
+	OSMO_ASSERT(buf[0] == 0x80);
+	OSMO_ASSERT(buf[1] == ((marker ? 0x80 : 0) | pt));
+	OSMO_ASSERT(buf[2] == (uint8_t)(seq >> 8) && buf[3] == (uint8_t)seq);
+	OSMO_ASSERT(buf[4] == (uint8_t)(ts >> 24) &&
+		    buf[5] == (uint8_t)(ts >> 16) &&
+		    buf[6] == (uint8_t)(ts >> 8) && buf[7] == (uint8_t)ts);
+	OSMO_ASSERT(buf[8] == (uint8_t)(ssrc >> 24) &&
+		    buf[9] == (uint8_t)(ssrc >> 16) &&
+		    buf[10] == (uint8_t)(ssrc >> 8) &&
+		    buf[11] == (uint8_t)ssrc);
+	for (i = RTP_BATCH_HDR_LEN; i < rc; i++)
+		OSMO_ASSERT(buf[i] == fill);
+}
+
+static void expect_none(int rx_fd)
+{
+	uint8_t buf[128];
+
+	OSMO_ASSERT(recv(rx_fd, buf, sizeof(buf), MSG_DONTWAIT) < 0);
+}
+
+static void test_batch(struct gsm_bts_trx *trx)
+{
+	struct gsm_bts_role_bts *btsb = bts_role_bts(trx->bts);
+	struct gsm_lchan *lchan_a = &trx->ts[1].lchan[0];
+	struct gsm_lchan *lchan_b = &trx->ts[2].lchan[0];
+	const struct rtp_batch_stats *st;
+	RtpSession *sess_a, *sess_b;
+	uint16_t seq_a, seq_b;
+	uint32_t ts_a, ts_b;
+	uint8_t frame[33];
+	int rx_a, rx_b;
+	int i;
+
+	printf("Testing enqueue and flush\n");
+
+	btsb->rtp_batch = rtp_batch_alloc(tall_bts_ctx);
+	OSMO_ASSERT(btsb->rtp_batch);
+	st = rtp_batch_get_stats(btsb->rtp_batch);
+
+	rx_a = setup_lchan(lchan_a, PT_FR);
+	rx_b = setup_lchan(lchan_b, PT_EFR);
+	sess_a = lchan_a->abis_ip.rtp_socket->sess;
+	sess_b = lchan_b->abis_ip.rtp_socket->sess;
+	seq_a = sess_a->rtp.snd_seq;
+	seq_b = sess_b->rtp.snd_seq;
+	ts_a = lchan_a->abis_ip.rtp_socket->tx_timestamp;
+	ts_b = lchan_b->abis_ip.rtp_socket->tx_timestamp;
+
+	/* nothing leaves before the flush, runs of the same socket are
+	 * split correctly */
+	for (i = 0; i < 3; i++) {
+		memset(frame, 0xa0 + i, sizeof(frame));
+		OSMO_ASSERT(rtp_batch_enqueue(btsb->rtp_batch, lchan_a, frame,
+					      sizeof(frame), 160, i == 0) == 0);
+		if (i == 1)
+			continue;
+		memset(frame, 0xb0 + i, sizeof(frame));
+		OSMO_ASSERT(rtp_batch_enqueue(btsb->rtp_batch, lchan_b, frame,
+					      sizeof(frame), 320, false) == 0);
+	}
+	expect_none(rx_a);
+	expect_none(rx_b);
+
+	OSMO_ASSERT(rtp_batch_flush(btsb->rtp_batch) == 5);
+	OSMO_ASSERT(rtp_batch_flush(btsb->rtp_batch) == 0);
+	printf(" flushes=%u packets=%u dropped=%u\n",
+		st->flushes, st->packets, st->dropped);
+
+	for (i = 0; i < 3; i++)
+		expect_rtp(rx_a, lchan_a, seq_a + i, ts_a + 160 * (i + 1),
+			   i == 0, PT_FR, 0xa0 + i);
+	expect_none(rx_a);
+	expect_rtp(rx_b, lchan_b, seq_b, ts_b + 320, false, PT_EFR, 0xb0);
+	expect_rtp(rx_b, lchan_b, seq_b + 1, ts_b + 640, false, PT_EFR, 0xb2);
+	expect_none(rx_b);
+
+	/* the ORTP session continues where the batch left off */
+	OSMO_ASSERT(sess_a->rtp.snd_seq == (uint16_t)(seq_a + 3));
+	OSMO_ASSERT(lchan_a->abis_ip.rtp_socket->tx_timestamp == ts_a + 480);
+	OSMO_ASSERT(sess_a->rtp.snd_last_ts == ts_a + 480);
+	OSMO_ASSERT(sess_a->rtp.stats.packet_sent == 3);
+	OSMO_ASSERT(sess_a->rtp.stats.sent == 3 * sizeof(frame));
+	OSMO_ASSERT(sess_b->rtp.stats.packet_sent == 2);
+
+	printf("Testing queue overflow\n");
+
+	/* a full queue is flushed before the next frame is added */
+	memset(frame, 0xc0, sizeof(frame));
+	for (i = 0; i < 130; i++)
+		OSMO_ASSERT(rtp_batch_enqueue(btsb->rtp_batch, lchan_a, frame,
+					      sizeof(frame), 160, false) == 0);
+	OSMO_ASSERT(rtp_batch_flush(btsb->rtp_batch) == 2);
+	for (i = 0; i < 130; i++)
+		expect_rtp(rx_a, lchan_a, seq_a + 3 + i, ts_a + 160 * (4 + i),
+			   false, PT_FR, 0xc0);
+	expect_none(rx_a);
+	printf(" flushes=%u packets=%u dropped=%u\n",
+		st->flushes, st->packets, st->dropped);
+
+	printf("Testing rejected frames\n");
+
+	/* too long for a batch slot */
+	OSMO_ASSERT(rtp_batch_enqueue(btsb->rtp_batch, lchan_a, frame,
+				      1000, 160, false) == -EMSGSIZE);
+	/* no remote address yet */
+	lchan_b->abis_ip.connect_ip = 0;
+	OSMO_ASSERT(rtp_batch_enqueue(btsb->rtp_batch, lchan_b, frame,
+				      sizeof(frame), 160, false) == -ENOTCONN);
+	OSMO_ASSERT(rtp_batch_flush(btsb->rtp_batch) == 0);
+	expect_none(rx_a);
+	expect_none(rx_b);
+	OSMO_ASSERT(sess_b->rtp.stats.packet_sent == 2);
+	printf(" flushes=%u packets=%u dropped=%u\n",
+		st->flushes, st->packets, st->dropped);
+}
+
+int main(int argc, char **argv)
+{
+	struct gsm_bts_role_bts *btsb;
+	struct gsm_bts *bts;
+	struct gsm_bts_trx *trx;
+
+	tall_bts_ctx = talloc_named_const(NULL, 1, "OsmoBTS context");
+	bts_log_init(NULL);
+	osmo_rtp_init(tall_bts_ctx);
+
+	bts = gsm_bts_alloc(tall_bts_ctx);
+	OSMO_ASSERT(bts);
+	bts->role = btsb = talloc_zero(bts, struct gsm_bts_role_bts);
+	trx = gsm_bts_trx_alloc(bts);
+	OSMO_ASSERT(trx);
+	btsb->trx_role = talloc_zero_array(btsb, struct gsm_bts_trx_role_bts,
+					   1);
+	OSMO_ASSERT(btsb->trx_role);
+
+	test_batch(trx);
+
+	printf("Success\n");
+	return EXIT_SUCCESS;
+}
@@ -46,6 +46,9 @@ int bts_model_lchan_deactivate_sacch(struct gsm_lchan *lchan) { return 0; }
 int bts_model_adjst_ms_pwr(struct gsm_lchan *lchan)
 { return 0; }
 
+int bts_model_change_power(struct gsm_bts_trx *trx, int p_trxout_mdBm)
+{ return 0; }
+
 void bts_model_abis_close(struct gsm_bts *bts)
 { }
 
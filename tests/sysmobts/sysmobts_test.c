@@ -28,6 +28,7 @@
 #include <sysmocom/femtobts/gsml1prim.h>
 
 #include <stdio.h>
+#include <sys/time.h>
 
 static int direct_map[][3] = {
 	{ GSM_BAND_850,		GsmL1_FreqBand_850,	128	},
@@ -184,6 +185,7 @@ static void test_sysmobts_cipher(void)
 
 static void test_sysmobts_loop(void)
 {
+	static struct gsm_bts_trx_role_bts trx_role;
 	struct gsm_bts bts;
 	struct gsm_bts_role_bts btsb;
 	struct gsm_bts_trx trx;
@@ -201,9 +203,11 @@ static void test_sysmobts_loop(void)
 	ts.trx = &trx;
 	trx.bts = &bts;
 	bts.role = &btsb;
+	btsb.trx_role = &trx_role;
 	bts.band = GSM_BAND_1800;
 	trx.ms_power_control = 1;
-	btsb.ul_power_target = -75;
+	btsb.ul_power_ctrl = power_ctrl_ul_default;
+	btsb.ul_power_ctrl.target = -75;
 
 	printf("Testing sysmobts power control\n");
 
@@ -211,7 +215,7 @@ static void test_sysmobts_loop(void)
 	lchan->state = LCHAN_S_NONE;
 	lchan->ms_power_ctrl.current = ms_pwr_ctl_lvl(GSM_BAND_1800, 0);
 	OSMO_ASSERT(lchan->ms_power_ctrl.current == 15);
-	ret = lchan_ms_pwr_ctrl(lchan, lchan->ms_power_ctrl.current, -60);
+	ret = lchan_ms_pwr_ctrl(lchan, lchan->ms_power_ctrl.current, -60, 0);
 	OSMO_ASSERT(ret == 0);
 	OSMO_ASSERT(lchan->ms_power_ctrl.current == 15);
 
@@ -220,26 +224,158 @@ static void test_sysmobts_loop(void)
 	 * Now 15 dB too little and we should power it up. Could be a
 	 * power level of 7 or 8 for 15 dBm
 	 */
-	ret = lchan_ms_pwr_ctrl(lchan, lchan->ms_power_ctrl.current, -90);
+	ret = lchan_ms_pwr_ctrl(lchan, lchan->ms_power_ctrl.current, -90, 0);
 	OSMO_ASSERT(ret == 1);
 	OSMO_ASSERT(lchan->ms_power_ctrl.current == 7);
 
 	/* It should be clamped to level 0 and 30 dBm */
-	ret = lchan_ms_pwr_ctrl(lchan, lchan->ms_power_ctrl.current, -100);
+	ret = lchan_ms_pwr_ctrl(lchan, lchan->ms_power_ctrl.current, -100, 0);
 	OSMO_ASSERT(ret == 1);
 	OSMO_ASSERT(lchan->ms_power_ctrl.current == 0);
 
 	/* Fix it and jump down */
 	lchan->ms_power_ctrl.fixed = 1;
-	ret = lchan_ms_pwr_ctrl(lchan, lchan->ms_power_ctrl.current, -60);
+	ret = lchan_ms_pwr_ctrl(lchan, lchan->ms_power_ctrl.current, -60, 0);
 	OSMO_ASSERT(ret == 0);
 	OSMO_ASSERT(lchan->ms_power_ctrl.current == 0);
 
 	/* And leave it again */
 	lchan->ms_power_ctrl.fixed = 0;
-	ret = lchan_ms_pwr_ctrl(lchan, lchan->ms_power_ctrl.current, -40);
+	ret = lchan_ms_pwr_ctrl(lchan, lchan->ms_power_ctrl.current, -40, 0);
 	OSMO_ASSERT(ret == 1);
 	OSMO_ASSERT(lchan->ms_power_ctrl.current == 15);
+
+	/* Within the hysteresis nothing happens */
+	btsb.ul_power_ctrl.hyst = 3;
+	btsb.ul_power_ctrl.ewma = 50;
+	lchan_power_ctrl_reset(lchan);
+	ret = lchan_ms_pwr_ctrl(lchan, lchan->ms_power_ctrl.current, -77, 0);
+	OSMO_ASSERT(ret == 0);
+	OSMO_ASSERT(lchan->ms_power_ctrl.current == 15);
+
+	/* Averaged to -84 dBm, raise by 9 dB but at most by 4 dB */
+	btsb.ul_power_ctrl.raise_max = 4;
+	ret = lchan_ms_pwr_ctrl(lchan, lchan->ms_power_ctrl.current, -90, 0);
+	OSMO_ASSERT(ret == 1);
+	OSMO_ASSERT(lchan->ms_power_ctrl.current == 13);
+
+	/* Bad quality raises even at the target level */
+	btsb.ul_power_ctrl.rxqual_max = 3;
+	lchan_power_ctrl_reset(lchan);
+	ret = lchan_ms_pwr_ctrl(lchan, lchan->ms_power_ctrl.current, -75, 6);
+	OSMO_ASSERT(ret == 1);
+	OSMO_ASSERT(lchan->ms_power_ctrl.current == 12);
+}
+
+/* expected RTP payloads for the L1 payload pattern j * 7 + 3 used below,
+ * with the AMR header bytes patched in for AMR */
+#ifdef USE_L1_RTP_MODE
+static const uint8_t tch_ul_fr[] = {
+	0x03, 0x0a, 0x11, 0x18, 0x1f, 0x26, 0x2d, 0x34,
+	0x3b, 0x42, 0x49, 0x50, 0x57, 0x5e, 0x65, 0x6c,
+	0x73, 0x7a, 0x81, 0x88, 0x8f, 0x96, 0x9d, 0xa4,
+	0xab, 0xb2, 0xb9, 0xc0, 0xc7, 0xce, 0xd5, 0xdc,
+	0xe3,
+};
+static const uint8_t tch_ul_hr[] = {
+	0x03, 0x0a, 0x11, 0x18, 0x1f, 0x26, 0x2d, 0x34,
+	0x3b, 0x42, 0x49, 0x50, 0x57, 0x5e,
+};
+static const uint8_t tch_ul_amr[] = {
+	0x70, 0x3c, 0x1f, 0x26, 0x2d, 0x34, 0x3b, 0x42,
+	0x49, 0x50, 0x57, 0x5e, 0x65, 0x6c, 0x73, 0x7a,
+	0x81, 0x88, 0x8f, 0x96, 0x9d, 0xa4, 0xab, 0xb2,
+	0xb9, 0xc0, 0xc7, 0xce, 0xd5, 0xdc, 0xe3, 0xea,
+	0xf1,
+};
+#else
+static const uint8_t tch_ul_fr[] = {
+	0xdc, 0x05, 0x08, 0x81, 0x8f, 0x86, 0x4b, 0x42,
+	0xcd, 0xc4, 0x29, 0x20, 0xae, 0xa7, 0xaa, 0x63,
+	0x6c, 0xe5, 0xe8, 0x11, 0x1f, 0x16, 0x9b, 0x92,
+	0x5d, 0x54, 0xd9, 0xd0, 0x3e, 0x37, 0x3a, 0xb3,
+	0xbc,
+};
+static const uint8_t tch_ul_hr[] = {
+	0xc0, 0x50, 0x88, 0x18, 0xf8, 0x64, 0xb4, 0x2c,
+	0xdc, 0x42, 0x92, 0x0a, 0xea, 0x7a,
+};
+static const uint8_t tch_ul_amr[] = {
+	0x00, 0x04, 0xe3, 0xcf, 0x86, 0x4b, 0x42, 0xcd,
+	0xc4, 0x29, 0x20, 0xae, 0xa7, 0xaa, 0x63, 0x6c,
+	0xe5, 0xe8, 0x11, 0x1f, 0x16, 0x9b, 0x92, 0x5d,
+	0x54, 0xd9, 0xd0, 0x3e, 0x37, 0x3a, 0xb3, 0xbc,
+	0x75,
+};
+#endif
+
+/* one uplink frame per codec as delivered by the L1 */
+static const struct {
+	const char *name;
+	uint8_t pl_type;
+	uint8_t len;
+	const uint8_t *rtp;
+	int rtp_len;
+} tch_ul_frames[] = {
+	{ "FR",  GsmL1_TchPlType_Fr,  GSM_FR_BYTES,
+	  tch_ul_fr, sizeof(tch_ul_fr) },
+	{ "HR",  GsmL1_TchPlType_Hr,  GSM_HR_BYTES,
+	  tch_ul_hr, sizeof(tch_ul_hr) },
+#ifdef USE_L1_RTP_MODE
+	{ "AMR", GsmL1_TchPlType_Amr, 2 + 33,
+#else
+	{ "AMR", GsmL1_TchPlType_Amr, 2 + 32,
+#endif
+	  tch_ul_amr, sizeof(tch_ul_amr) },
+};
+
+#define TCH_UL_BENCH_ITER	100000
+
+static void test_sysmobts_tch_ul(void)
+{
+	struct gsm_lchan lchan;
+	uint8_t l1_pl[TCH_RTP_PL_MAX];
+	uint8_t rtp_pl[TCH_RTP_PL_MAX];
+	struct timeval start, stop;
+	unsigned long usec;
+	int i, j, rc;
+
+	memset(&lchan, 0, sizeof(lchan));
+
+	printf("Testing sysmobts TCH uplink conversion\n");
+
+	for (i = 0; i < ARRAY_SIZE(tch_ul_frames); i++) {
+		for (j = 0; j < sizeof(l1_pl); j++)
+			l1_pl[j] = j * 7 + 3;
+		/* no CMR from L1, then a valid CMR (12.2k) and TOC
+		 * (12.2k, Q=1) in the payload for AMR */
+		if (tch_ul_frames[i].pl_type == GsmL1_TchPlType_Amr) {
+			l1_pl[1] = GsmL1_AmrCodecMode_Unset;
+			l1_pl[2] = 0x70;
+			l1_pl[3] = 0x3c;
+		}
+
+		rc = l1if_tch_ul_to_rtp(&lchan, tch_ul_frames[i].pl_type,
+					l1_pl, tch_ul_frames[i].len, rtp_pl);
+		printf("%s: %d bytes\n", tch_ul_frames[i].name, rc);
+		OSMO_ASSERT(rc == tch_ul_frames[i].rtp_len);
+		if (memcmp(rtp_pl, tch_ul_frames[i].rtp, rc)) {
+			printf("%s: got %s\n", tch_ul_frames[i].name,
+				osmo_hexdump(rtp_pl, rc));
+			OSMO_ASSERT(0);
+		}
+
+		/* micro benchmark, the figures are informational only */
+		gettimeofday(&start, NULL);
+		for (j = 0; j < TCH_UL_BENCH_ITER; j++)
+			l1if_tch_ul_to_rtp(&lchan, tch_ul_frames[i].pl_type,
+					   l1_pl, tch_ul_frames[i].len, rtp_pl);
+		gettimeofday(&stop, NULL);
+		usec = (stop.tv_sec - start.tv_sec) * 1000000
+			+ stop.tv_usec - start.tv_usec;
+		fprintf(stderr, "%s: %lu ns per frame\n", tch_ul_frames[i].name,
+			usec * 1000 / TCH_UL_BENCH_ITER);
+	}
 }
 
 int main(int argc, char **argv)
@@ -248,6 +384,7 @@ int main(int argc, char **argv)
 	test_sysmobts_auto_band();
 	test_sysmobts_cipher();
 	test_sysmobts_loop();
+	test_sysmobts_tch_ul();
 	return 0;
 }
 
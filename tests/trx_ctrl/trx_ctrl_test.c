@@ -0,0 +1,291 @@
+/* testing the pipelined control interface to the OsmoTRX transceiver */
+
+/* (C) 2017 by sysmocom s.f.m.c. GmbH
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/utils.h>
+#include <osmocom/core/select.h>
+#include <osmocom/core/timer.h>
+
+#include <osmo-bts/gsm_data.h>
+#include <osmo-bts/logging.h>
+#include <osmo-bts/bts.h>
+#include <osmo-bts/bts_model.h>
+#include <osmo-bts/phy_link.h>
+#include <osmo-bts/scheduler.h>
+
+#include "l1_if.h"
+#include "trx_if.h"
+
+#define BASE_PORT_LOCAL		25700
+#define BASE_PORT_REMOTE	25800
+
+static struct trx_l1h *l1h;
+/* the transceiver side of the ctrl socket */
+static int trx_fd;
+
+/*
+ * the parts of osmo-bts-trx outside of trx_if.c
+ */
+void bts_model_phy_link_set_defaults(struct phy_link *plink)
+{ }
+void bts_model_phy_instance_set_defaults(struct phy_instance *pinst)
+{ }
+struct trx_l1h *l1if_open(struct phy_instance *pinst)
+{ return NULL; }
+int trx_sched_clock(struct gsm_bts *bts, uint32_t fn)
+{ return 0; }
+int trx_sched_ul_burst(struct l1sched_trx *l1t, uint8_t tn, uint32_t fn,
+	sbit_t *bits, uint16_t nbits, int8_t rssi, float toa)
+{ return 0; }
+
+/* print and count the commands sent to the transceiver so far */
+static unsigned int cmds(void)
+{
+	char buf[256];
+	unsigned int n = 0;
+	int len;
+
+	while ((len = recv(trx_fd, buf, sizeof(buf) - 1, MSG_DONTWAIT)) > 0) {
+		buf[len] = '\0';
+		printf(" -> %s\n", buf);
+		n++;
+	}
+	OSMO_ASSERT(len < 0 && errno == EAGAIN);
+
+	return n;
+}
+
+/* the transceiver answers, handle it as the select loop would */
+static void rsp(const char *rsp)
+{
+	printf(" <- %s\n", rsp);
+	OSMO_ASSERT(send(trx_fd, rsp, strlen(rsp) + 1, 0) > 0);
+	l1h->trx_ofd_ctrl.cb(&l1h->trx_ofd_ctrl, BSC_FD_READ);
+}
+
+/* the number of commands not answered yet */
+static unsigned int queued(void)
+{
+	struct trx_ctrl_msg *tcm;
+	unsigned int n = 0;
+
+	llist_for_each_entry(tcm, &l1h->trx_ctrl_list, list)
+		n++;
+
+	return n;
+}
+
+static void test_window(void)
+{
+	int i;
+
+	printf("Testing the window of unanswered commands\n");
+
+	for (i = 0; i < 10; i++)
+		OSMO_ASSERT(trx_if_cmd_setrxgain(l1h, i) == 0);
+	OSMO_ASSERT(cmds() == 8);
+
+	/* each response lets the next command go */
+	rsp("RSP SETRXGAIN 0 0");
+	OSMO_ASSERT(cmds() == 1);
+	rsp("RSP SETRXGAIN 0 1");
+	OSMO_ASSERT(cmds() == 1);
+	for (i = 2; i < 10; i++) {
+		OSMO_ASSERT(queued() == 10 - i);
+		rsp("RSP SETRXGAIN 0");
+	}
+	OSMO_ASSERT(cmds() == 0);
+	OSMO_ASSERT(queued() == 0);
+	OSMO_ASSERT(!osmo_timer_pending(&l1h->trx_ctrl_timer));
+}
+
+static void test_barrier(void)
+{
+	printf("Testing POWERON as a barrier\n");
+
+	trx_if_cmd_setpower(l1h, 10);
+	trx_if_cmd_poweron(l1h);
+	trx_if_cmd_setmaxdly(l1h, 4);
+	trx_if_cmd_setmaxdlynb(l1h, 2);
+	/* POWERON waits for the commands before it ... */
+	OSMO_ASSERT(cmds() == 1);
+	rsp("RSP SETPOWER 0 10");
+	/* ... and the ones after it for POWERON */
+	OSMO_ASSERT(cmds() == 1);
+	rsp("RSP POWERON 0");
+	OSMO_ASSERT(cmds() == 2);
+	rsp("RSP SETMAXDLY 0 4");
+	rsp("RSP SETMAXDLYNB 0 2");
+	OSMO_ASSERT(queued() == 0);
+}
+
+static void test_echo_args(void)
+{
+	printf("Testing the timeslot commands answered out of order\n");
+
+	trx_if_cmd_setslot(l1h, 1, 1);
+	trx_if_cmd_setslot(l1h, 2, 7);
+	trx_if_cmd_setslot(l1h, 3, 1);
+	OSMO_ASSERT(cmds() == 3);
+
+	/* matched by the repeated arguments, not by the order */
+	rsp("RSP SETSLOT 0 2 7");
+	OSMO_ASSERT(queued() == 2);
+	rsp("RSP SETSLOT 0 3 1");
+	OSMO_ASSERT(queued() == 1);
+	rsp("RSP SETSLOT 0 1 1");
+	OSMO_ASSERT(queued() == 0);
+	OSMO_ASSERT(cmds() == 0);
+}
+
+static void test_duplicate(void)
+{
+	printf("Testing duplicate and unexpected responses\n");
+
+	/* nothing to answer */
+	rsp("RSP SETPOWER 0 20");
+	OSMO_ASSERT(queued() == 0);
+
+	trx_if_cmd_setpower(l1h, 20);
+	trx_if_cmd_setmaxdly(l1h, 6);
+	OSMO_ASSERT(cmds() == 2);
+	rsp("RSP SETPOWER 0 20");
+	OSMO_ASSERT(queued() == 1);
+
+	/* answered twice, the other command is kept */
+	rsp("RSP SETPOWER 0 20");
+	OSMO_ASSERT(queued() == 1);
+	rsp("RSP SETMAXDLY 0 6");
+	OSMO_ASSERT(queued() == 0);
+	OSMO_ASSERT(cmds() == 0);
+}
+
+static void test_lost(void)
+{
+	printf("Testing a lost response\n");
+
+	trx_if_cmd_setrxgain(l1h, 12);
+	trx_if_cmd_setpower(l1h, 30);
+	OSMO_ASSERT(cmds() == 2);
+
+	/* the response to SETRXGAIN never arrives */
+	rsp("RSP SETPOWER 0 30");
+	OSMO_ASSERT(queued() == 1);
+	OSMO_ASSERT(osmo_timer_pending(&l1h->trx_ctrl_timer));
+
+	/* the timer sends it again */
+	l1h->trx_ctrl_timer.cb(l1h->trx_ctrl_timer.data);
+	OSMO_ASSERT(cmds() == 1);
+	OSMO_ASSERT(osmo_timer_pending(&l1h->trx_ctrl_timer));
+	rsp("RSP SETRXGAIN 0 12");
+	OSMO_ASSERT(queued() == 0);
+	OSMO_ASSERT(!osmo_timer_pending(&l1h->trx_ctrl_timer));
+}
+
+static void test_reject(void)
+{
+	printf("Testing a rejected critical command\n");
+
+	trx_if_cmd_setslot(l1h, 4, 1);
+	trx_if_cmd_setrxgain(l1h, 14);
+	OSMO_ASSERT(cmds() == 2);
+
+	/* the BTS is shut down, the commands are kept */
+	rsp("RSP SETSLOT 1 4 1");
+	OSMO_ASSERT(queued() == 2);
+
+	trx_if_flush(l1h);
+	OSMO_ASSERT(queued() == 0);
+}
+
+int main(int argc, char **argv)
+{
+	struct gsm_bts *bts;
+	struct gsm_bts_trx *trx;
+	struct phy_link *plink;
+	struct phy_instance *pinst;
+	struct sockaddr_in sin;
+
+	tall_bts_ctx = talloc_named_const(NULL, 1, "OsmoBTS context");
+	msgb_talloc_ctx_init(tall_bts_ctx, 0);
+
+	bts_log_init(NULL);
+
+	bts = gsm_bts_alloc(tall_bts_ctx);
+	OSMO_ASSERT(bts);
+	trx = gsm_bts_trx_alloc(bts);
+	OSMO_ASSERT(trx);
+
+	plink = phy_link_create(tall_bts_ctx, 0);
+	OSMO_ASSERT(plink);
+	plink->u.osmotrx.transceiver_ip = "127.0.0.1";
+	plink->u.osmotrx.base_port_local = BASE_PORT_LOCAL;
+	plink->u.osmotrx.base_port_remote = BASE_PORT_REMOTE;
+	pinst = phy_instance_create(plink, 0);
+	OSMO_ASSERT(pinst);
+	phy_instance_link_to_trx(pinst, trx);
+
+	/* the transceiver's end of the ctrl socket */
+	trx_fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	OSMO_ASSERT(trx_fd >= 0);
+	memset(&sin, 0, sizeof(sin));
+	sin.sin_family = AF_INET;
+	sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	sin.sin_port = htons(BASE_PORT_REMOTE + 1);
+	OSMO_ASSERT(bind(trx_fd, (struct sockaddr *) &sin, sizeof(sin)) == 0);
+	sin.sin_port = htons(BASE_PORT_LOCAL + 1);
+	OSMO_ASSERT(connect(trx_fd, (struct sockaddr *) &sin,
+			    sizeof(sin)) == 0);
+
+	l1h = talloc_zero(tall_bts_ctx, struct trx_l1h);
+	l1h->phy_inst = pinst;
+	pinst->u.osmotrx.hdl = l1h;
+
+	/* POWEROFF goes out before the clock arrives */
+	printf("Opening the transceiver\n");
+	OSMO_ASSERT(trx_if_open(l1h) == 0);
+	OSMO_ASSERT(cmds() == 1);
+	rsp("RSP POWEROFF 0");
+	OSMO_ASSERT(queued() == 0);
+	transceiver_available = 1;
+
+	test_window();
+	test_barrier();
+	test_echo_args();
+	test_duplicate();
+	test_lost();
+	test_reject();
+
+	trx_if_close(l1h);
+	close(trx_fd);
+
+	printf("Success\n");
+	return EXIT_SUCCESS;
+}
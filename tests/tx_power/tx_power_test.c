@@ -0,0 +1,210 @@
+/* testing the precomputed TX power tables and the TDMA frame driven
+ * power ramp */
+
+/* (C) 2017 by sysmocom s.f.m.c. GmbH
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <sys/time.h>
+
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/utils.h>
+
+#include <osmo-bts/gsm_data.h>
+#include <osmo-bts/logging.h>
+#include <osmo-bts/tx_power.h>
+
+#define BENCH_ITER	10000000
+
+/* copy of the power chain get_p_trxout_target_mdBm() walked for every
+ * call before the tables existed, the reference for test and benchmark */
+static int ref_get_pa_drive_level_mdBm(const struct power_amp *pa,
+		       int desired_p_out_mdBm, unsigned int arfcn)
+{
+	if (arfcn >= ARRAY_SIZE(pa->calib.gain_mdB))
+		return INT_MIN;
+
+	return desired_p_out_mdBm - pa->calib.gain_mdB[arfcn];
+}
+
+static int ref_get_p_max_out_mdBm(struct gsm_bts_trx *trx)
+{
+	struct trx_power_params *tpp = &trx->power_params;
+	return tpp->trx_p_max_out_mdBm + tpp->user_gain_mdB +
+			tpp->pa.nominal_gain_mdB + tpp->user_pa.nominal_gain_mdB;
+}
+
+static int ref_get_p_nominal_mdBm(struct gsm_bts_trx *trx)
+{
+	return ref_get_p_max_out_mdBm(trx) - to_mdB(trx->max_power_red);
+}
+
+static int ref_get_p_target_mdBm(struct gsm_bts_trx *trx, uint8_t bs_power_ie)
+{
+	return ref_get_p_nominal_mdBm(trx) - to_mdB(bs_power_ie * 2);
+}
+
+static int ref_p_trxout_target_mdBm(struct gsm_bts_trx *trx, uint8_t ie)
+{
+	struct trx_power_params *tpp = &trx->power_params;
+	int p_target_mdBm, user_pa_drvlvl_mdBm, pa_drvlvl_mdBm;
+	unsigned int arfcn = trx->arfcn;
+
+	p_target_mdBm = ref_get_p_target_mdBm(trx, ie) - tpp->user_gain_mdB;
+	user_pa_drvlvl_mdBm = ref_get_pa_drive_level_mdBm(&tpp->user_pa,
+						p_target_mdBm, arfcn);
+	pa_drvlvl_mdBm = ref_get_pa_drive_level_mdBm(&tpp->pa,
+						user_pa_drvlvl_mdBm, arfcn);
+	return pa_drvlvl_mdBm;
+}
+
+static void setup_trx(struct gsm_bts_trx *trx)
+{
+	struct trx_power_params *tpp = &trx->power_params;
+	int i;
+
+	tpp->trx_p_max_out_mdBm = to_mdB(23);
+	tpp->user_gain_mdB = -1500;
+	tpp->pa.nominal_gain_mdB = to_mdB(10);
+	for (i = 0; i < ARRAY_SIZE(tpp->pa.calib.gain_mdB); i++) {
+		tpp->pa.calib.gain_mdB[i] = 9000 + i;
+		tpp->user_pa.calib.gain_mdB[i] = i * 3;
+	}
+}
+
+static void test_tables(struct gsm_bts_trx *trx)
+{
+	unsigned int arfcn;
+	int ie;
+
+	printf("Testing power tables\n");
+
+	/* including ARFCNs without calibration entry */
+	for (arfcn = 0; arfcn < 1030; arfcn += 7) {
+		trx->arfcn = arfcn;
+		trx->max_power_red = arfcn % 10;
+		power_tables_update(trx);
+
+		/* and IEs beyond the table */
+		for (ie = 0; ie < TX_POWER_IE_NUM + 8; ie++) {
+			OSMO_ASSERT(get_p_target_mdBm(trx, ie) ==
+				    get_p_nominal_mdBm(trx) - to_mdB(ie * 2));
+			OSMO_ASSERT(get_p_trxout_target_mdBm(trx, ie) ==
+				    ref_p_trxout_target_mdBm(trx, ie));
+		}
+	}
+
+	trx->arfcn = 100;
+	trx->max_power_red = 0;
+	power_tables_update(trx);
+	printf("P_nominal %d mdBm, TRX output %d..%d mdBm\n",
+	       get_p_target_mdBm(trx, 0), get_p_trxout_target_mdBm(trx, 0),
+	       get_p_trxout_target_mdBm(trx, 15));
+}
+
+static void test_ramp(struct gsm_bts_trx *trx)
+{
+	struct gsm_bts_role_bts *btsb = bts_role_bts(trx->bts);
+	struct trx_power_params *tpp = &trx->power_params;
+	uint32_t fn;
+	int i;
+
+	printf("Testing FN driven power ramp\n");
+
+	tpp->ramp.max_initial_pout_mdBm = to_mdB(23);
+	tpp->ramp.step_size_mdB = to_mdB(4);
+	tpp->ramp.step_interval_sec = 1;
+	tpp->p_total_cur_mdBm = 0;
+
+	/* start just before the hyperframe wraps */
+	fn = GSM_HYPERFRAME - 100;
+	btsb->gsm_time.fn = fn;
+	power_ramp_fn_tick(trx, fn);
+	power_ramp_start(trx, get_p_target_mdBm(trx, 0), 0);
+	OSMO_ASSERT(tpp->ramp.step_pending);
+
+	for (i = 0; i < 10000 && tpp->ramp.step_pending; i++) {
+		fn = (fn + 1) % GSM_HYPERFRAME;
+		btsb->gsm_time.fn = fn;
+		power_ramp_fn_tick(trx, fn);
+		if (tpp->ramp.step_pending)
+			continue;
+
+		printf("fn=%u P_cur=%d mdBm TRX output %d mdBm\n", fn,
+		       tpp->p_total_cur_mdBm,
+		       get_p_trxout_eff_mdBm(trx, tpp->p_total_tgt_mdBm));
+		/* what the BTS model reports once L1 applied the step */
+		power_trx_change_compl(trx,
+			get_p_trxout_eff_mdBm(trx, tpp->p_total_tgt_mdBm));
+	}
+	OSMO_ASSERT(tpp->p_total_cur_mdBm == get_p_target_mdBm(trx, 0));
+	OSMO_ASSERT(tpp->ramp.attenuation_mdB == 0);
+}
+
+static void bench(struct gsm_bts_trx *trx, const char *name,
+		  int (*fn)(struct gsm_bts_trx *trx, uint8_t ie))
+{
+	struct timeval start, stop;
+	unsigned long usec;
+	int i, sum = 0;
+
+	/* micro benchmark, the figures are informational only */
+	gettimeofday(&start, NULL);
+	for (i = 0; i < BENCH_ITER; i++)
+		sum += fn(trx, i & 15);
+	gettimeofday(&stop, NULL);
+	usec = (stop.tv_sec - start.tv_sec) * 1000000
+		+ stop.tv_usec - start.tv_usec;
+	if (!usec)
+		usec = 1;
+	fprintf(stderr, "%s: %llu lookups per second (%d)\n", name,
+		(unsigned long long) BENCH_ITER * 1000000 / usec, sum);
+}
+
+int main(int argc, char **argv)
+{
+	void *tall_bts_ctx;
+	struct gsm_bts *bts;
+	struct gsm_bts_trx *trx;
+
+	tall_bts_ctx = talloc_named_const(NULL, 1, "OsmoBTS context");
+	bts_log_init(NULL);
+
+	bts = gsm_bts_alloc(tall_bts_ctx);
+	OSMO_ASSERT(bts);
+	bts->role = talloc_zero(bts, struct gsm_bts_role_bts);
+	trx = gsm_bts_trx_alloc(bts);
+	OSMO_ASSERT(trx);
+
+	setup_trx(trx);
+	test_tables(trx);
+	test_ramp(trx);
+
+	/* the benchmark only on request, it is too slow for emulated runs */
+	if (argc > 1 && !strcmp(argv[1], "bench")) {
+		bench(trx, "table", get_p_trxout_target_mdBm);
+		bench(trx, "chain", ref_p_trxout_target_mdBm);
+	}
+
+	printf("Success\n");
+	return EXIT_SUCCESS;
+}